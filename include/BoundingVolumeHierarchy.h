@@ -0,0 +1,198 @@
+#pragma once
+#ifndef BOUNDINGVOLUMEHIERARCHY_H
+#define BOUNDINGVOLUMEHIERARCHY_H
+
+#include "glm/glm.hpp"
+#include "FrustumCuller.h"
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace Sigma {
+	// An axis aligned bounding box.
+	struct AABB {
+		AABB() {}
+		AABB(const glm::vec3& minimum, const glm::vec3& maximum) : minimum(minimum), maximum(maximum) {}
+
+		static AABB FromSphere(const glm::vec3& center, float radius) {
+			return AABB(glm::vec3(center.x - radius, center.y - radius, center.z - radius), glm::vec3(center.x + radius, center.y + radius, center.z + radius));
+		}
+
+		static AABB Union(const AABB& a, const AABB& b) {
+			return AABB(glm::vec3(std::min(a.minimum.x, b.minimum.x), std::min(a.minimum.y, b.minimum.y), std::min(a.minimum.z, b.minimum.z)),
+				glm::vec3(std::max(a.maximum.x, b.maximum.x), std::max(a.maximum.y, b.maximum.y), std::max(a.maximum.z, b.maximum.z)));
+		}
+
+		bool Contains(const AABB& other) const {
+			return this->minimum.x <= other.minimum.x && this->minimum.y <= other.minimum.y && this->minimum.z <= other.minimum.z &&
+				other.maximum.x <= this->maximum.x && other.maximum.y <= this->maximum.y && other.maximum.z <= this->maximum.z;
+		}
+
+		bool Overlaps(const AABB& other) const {
+			return this->minimum.x <= other.maximum.x && other.minimum.x <= this->maximum.x &&
+				this->minimum.y <= other.maximum.y && other.minimum.y <= this->maximum.y &&
+				this->minimum.z <= other.maximum.z && other.minimum.z <= this->maximum.z;
+		}
+
+		float SurfaceArea() const {
+			glm::vec3 size = this->maximum - this->minimum;
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+	};
+
+	/**
+	 * \brief A dynamic bounding volume hierarchy of spheres for scene queries.
+	 *
+	 * Every proxy is a leaf holding a tight bounding sphere and a fat AABB, enlarged by a margin and
+	 * the last displacement, so small moves only update the sphere. Leaves that leave their fat box
+	 * are removed and reinserted where the surface area heuristic says they cost the least, and
+	 * the ancestors are refitted and rotated to keep the tree balanced. After many reinsertions
+	 * RebuildIfDegraded rebuilds the whole tree top down with a binned SAH when its cost got worse.
+	 *
+	 * Proxies carry a user pointer and a mask, queries only return proxies whose mask shares a bit
+	 * with the query mask. Results are in no particular order.
+	 */
+	class BoundingVolumeHierarchy {
+	public:
+		static const int NULL_NODE = -1;
+
+		/**
+		 * \param margin How much the fat AABBs are larger than the spheres on each side.
+		 */
+		explicit BoundingVolumeHierarchy(float margin = 0.5f);
+
+		/**
+		 * \brief Adds a proxy.
+		 *
+		 * \param center The sphere center.
+		 * \param radius The sphere radius.
+		 * \param userData Returned by the queries.
+		 * \param mask Query filter bits.
+		 * \return int The proxy id, valid until Remove.
+		 */
+		int Insert(const glm::vec3& center, float radius, void* userData, unsigned int mask = ~0u);
+
+		/**
+		 * \brief Removes a proxy.
+		 */
+		void Remove(int proxy);
+
+		/**
+		 * \brief Updates the sphere of a proxy.
+		 *
+		 * \return bool True if the proxy left its fat box and was reinserted.
+		 */
+		bool Move(int proxy, const glm::vec3& center, float radius);
+
+		/**
+		 * \brief Returns the user pointer of a proxy.
+		 */
+		void* GetUserData(int proxy) const { return this->nodes[proxy].userData; }
+
+		/**
+		 * \brief Returns the number of proxies.
+		 */
+		size_t Size() const { return this->proxyCount; }
+
+		/**
+		 * \brief Returns the height of the tree, 0 when empty and 1 for a single proxy.
+		 */
+		int Height() const { return this->root == NULL_NODE ? 0 : this->nodes[this->root].height + 1; }
+
+		/**
+		 * \brief Returns the SAH cost: the summed surface area of the internal nodes relative to the root.
+		 */
+		float Cost() const;
+
+		/**
+		 * \brief Rebuilds the tree top down with a binned surface area heuristic.
+		 */
+		void Rebuild();
+
+		/**
+		 * \brief Rebuilds the tree if enough proxies moved and the cost grew past a threshold.
+		 *
+		 * Cheap to call every frame, the cost is only computed after many reinsertions.
+		 * \param threshold The allowed cost growth since the last rebuild.
+		 * \return bool True if the tree was rebuilt.
+		 */
+		bool RebuildIfDegraded(float threshold = 1.3f);
+
+		/**
+		 * \brief Finds the proxies inside or intersecting a frustum.
+		 *
+		 * Subtrees fully inside the frustum are accepted without testing their leaves, the spheres of
+		 * the leaves that straddle a plane are tested in one batch by a FrustumCuller.
+		 * \param planes The frustum planes, see FrustumCuller::ExtractPlanes.
+		 * \param results The user pointers are appended here.
+		 * \param mask Query filter bits.
+		 */
+		void QueryFrustum(const glm::vec4 planes[6], std::vector<void*>& results, unsigned int mask = ~0u);
+
+		/**
+		 * \brief Finds the proxies whose sphere intersects a sphere.
+		 */
+		void QuerySphere(const glm::vec3& center, float radius, std::vector<void*>& results, unsigned int mask = ~0u) const;
+
+		/**
+		 * \brief Finds the proxies whose sphere intersects a box.
+		 */
+		void QueryAABB(const AABB& box, std::vector<void*>& results, unsigned int mask = ~0u) const;
+
+		/**
+		 * \brief Finds the proxies whose sphere is hit by a ray.
+		 *
+		 * \param origin The ray origin.
+		 * \param direction The normalized ray direction.
+		 * \param maxDistance The length of the ray.
+		 */
+		void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<void*>& results, unsigned int mask = ~0u) const;
+	private:
+		struct Node {
+			bool IsLeaf() const { return this->left == NULL_NODE; }
+
+			AABB box; // Fat box for leaves, the union of the children otherwise.
+			glm::vec3 center; // Leaves only.
+			float radius; // Leaves only.
+			void* userData; // Leaves only.
+			unsigned int mask; // The union of the children masks for internal nodes.
+			int parent; // The next free node when the node is free.
+			int left;
+			int right;
+			int height; // 0 for leaves, -1 for free nodes.
+		};
+
+		int AllocateNode();
+		void FreeNode(int node);
+		void InsertLeaf(int leaf);
+		void RemoveLeaf(int leaf);
+		// Recomputes the box, height and mask of an internal node from its children.
+		void UpdateNode(int node);
+		// Rotates the grandchildren of an unbalanced node up, returns the node now at its place.
+		int Balance(int node);
+		// Refits and balances the ancestors, starting at node.
+		void Refit(int node);
+		// Appends every leaf of a subtree matching mask.
+		void AddSubtree(int node, std::vector<void*>& results, unsigned int mask) const;
+		int BuildRange(std::vector<int>& leaves, size_t first, size_t last);
+
+		std::vector<Node> nodes;
+		int root;
+		int freeList;
+		size_t proxyCount;
+		float margin;
+		size_t reinsertions; // Since the last rebuild.
+		float rebuildCost; // Cost right after the last rebuild, 0 if never rebuilt.
+
+		// Scratch for QueryFrustum.
+		FrustumCuller narrowPhase;
+		std::vector<void*> candidates;
+		std::vector<unsigned char> visibility;
+	}; // class BoundingVolumeHierarchy
+} // namespace Sigma
+
+#endif // BOUNDINGVOLUMEHIERARCHY_H
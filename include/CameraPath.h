@@ -0,0 +1,66 @@
+#pragma once
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include "glm/glm.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Sigma {
+	// A camera pose at a point in time, rotation holds pitch, yaw and roll as GLTransform does.
+	struct CameraKey {
+		double time; // Seconds from the start of the path.
+		glm::vec3 position;
+		glm::vec3 rotation;
+	};
+
+	/**
+	 * \brief A list of camera keys played back at fixed times, so a run sees the same frames every time.
+	 *
+	 * The file format is one key per line: "time x y z pitch yaw roll", blank lines and lines
+	 * starting with # are ignored. Keys must be in increasing time order.
+	 */
+	class CameraPath {
+	public:
+		/**
+		 * \brief Reads the keys of a path file, replacing the current ones.
+		 *
+		 * \param path The file to read.
+		 * \return bool False if the file could not be read or a line is malformed.
+		 */
+		bool Load(const std::string& path);
+
+		/**
+		 * \brief Parses keys from text in the file format, replacing the current ones.
+		 *
+		 * \return bool False if a line is malformed or the times are not increasing.
+		 */
+		bool Parse(const std::string& text);
+
+		/**
+		 * \brief Appends a key, its time must be greater than the last one's.
+		 *
+		 * \return bool False if the key is out of order.
+		 */
+		bool AddKey(const CameraKey& key);
+
+		/**
+		 * \brief Interpolates the pose at a time, linearly between the keys around it.
+		 *
+		 * Times before the first key or after the last give that key, an empty path gives the origin.
+		 */
+		CameraKey Sample(double time) const;
+
+		/**
+		 * \brief Returns the time of the last key.
+		 */
+		double Duration() const { return this->keys.empty() ? 0.0 : this->keys.back().time; }
+
+		size_t KeyCount() const { return this->keys.size(); }
+	private:
+		std::vector<CameraKey> keys;
+	}; // class CameraPath
+} // namespace Sigma
+
+#endif // CAMERAPATH_H
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	/**
+	 * \brief Tests a packed array of bounding spheres against a view frustum.
+	 *
+	 * The spheres are stored as separate x, y, z and radius arrays so 4 (SSE) or 8 (AVX) of them
+	 * are tested against a plane with a handful of instructions. Large arrays are split between
+	 * worker threads, each writing its own range of the result.
+	 */
+	class FrustumCuller {
+	public:
+		// Below this many spheres the cost of starting threads outweighs the gain.
+		static const size_t PARALLEL_THRESHOLD = 16384;
+
+		FrustumCuller() : threadCount(0) {}
+
+		/**
+		 * \brief Extracts the 6 frustum planes from a view projection matrix.
+		 *
+		 * The planes are normalized and point inwards: a point p is inside a plane if
+		 * dot(plane.xyz, p) + plane.w >= 0. A viewProj matrix yields world space planes.
+		 * \param viewProj The view projection matrix.
+		 * \param planes Receives left, right, bottom, top, near and far planes.
+		 */
+		static void ExtractPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]);
+
+		/**
+		 * \brief Tests one sphere, the reference for the batched test.
+		 *
+		 * \param planes The frustum planes, see ExtractPlanes.
+		 * \param center The sphere center.
+		 * \param radius The sphere radius.
+		 * \return bool True if the sphere is inside or intersects the frustum.
+		 */
+		static bool SphereVisible(const glm::vec4 planes[6], const glm::vec3& center, float radius);
+
+		/**
+		 * \brief Removes every sphere.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Adds a sphere.
+		 *
+		 * \param center The world space center.
+		 * \param radius The world space radius.
+		 * \return unsigned int The index of the sphere in the result of Cull.
+		 */
+		unsigned int Add(const glm::vec3& center, float radius);
+
+		/**
+		 * \brief Returns the number of spheres.
+		 */
+		size_t Size() const { return this->radii.size(); }
+
+		/**
+		 * \brief Sets the number of threads Cull may use for large arrays.
+		 *
+		 * \param count The number of threads, 0 uses one per hardware thread, 1 never starts threads.
+		 */
+		void SetThreadCount(unsigned int count) { this->threadCount = count; }
+
+		/**
+		 * \brief Tests every sphere against the frustum.
+		 *
+		 * \param planes The frustum planes, see ExtractPlanes.
+		 * \param visible Receives one byte per sphere, 1 if visible, 0 if culled.
+		 * \return size_t The number of visible spheres.
+		 */
+		size_t Cull(const glm::vec4 planes[6], std::vector<unsigned char>& visible) const;
+	private:
+		/**
+		 * \brief Tests the spheres [first, last).
+		 *
+		 * \return size_t The number of visible spheres in the range.
+		 */
+		size_t CullRange(const glm::vec4 planes[6], size_t first, size_t last, unsigned char* visible) const;
+
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radii;
+		unsigned int threadCount;
+	}; // class FrustumCuller
+} // namespace Sigma
+
+#endif // FRUSTUMCULLER_H
@@ -3,6 +3,9 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+#include <algorithm>
+#include <atomic>
+
 namespace Sigma {
 	class GLTransform {
 	public:
@@ -19,18 +22,22 @@ namespace Sigma {
 						rotateMatrix(glm::mat4(1.0f)),
 						scaleMatrix(glm::mat4(1.0f)),
 						Euler(false),
-						parentTransform(0) {}
+						parentTransform(0),
+						MMhasChanged(true),
+						version(NextVersion()) {}
 
 		void Translate(float x, float y, float z) {
 			this->position += glm::vec3(x, y, z);
 			this->translateMatrix = glm::translate(glm::mat4(1.0f), this->position);
 			this->MMhasChanged = true;
+			this->version = NextVersion();
 		}
 
 		void TranslateTo(float x, float y, float z) {
 			this->position = glm::vec3(x, y, z);
 			this->translateMatrix = glm::translate(glm::vec3(x, y, z));
 			this->MMhasChanged = true;
+			this->version = NextVersion();
 		}
 
 		// Helper functions.
@@ -60,6 +67,7 @@ namespace Sigma {
 			}
 		
 			this->MMhasChanged = true;
+			this->version = NextVersion();
 		}
 
 		void Rotate(glm::vec3 rot) {
@@ -70,6 +78,7 @@ namespace Sigma {
 			this->scale = this->scale*glm::vec3(x, y, z);
 			this->scaleMatrix = glm::scale(this->scaleMatrix, glm::vec3(x, y, z));
 			this->MMhasChanged = true;
+			this->version = NextVersion();
 		}
 
 		void Scale(glm::vec3 scale) {
@@ -232,9 +241,29 @@ namespace Sigma {
 			return rot;
 		}
 
-		void SetParentTransform(GLTransform *trans) { this->parentTransform = trans; }
+		void SetParentTransform(GLTransform *trans) { this->parentTransform = trans; this->version = NextVersion(); }
+
+		/**
+		 * \brief Returns a counter that changes every time the matrix of this transform changes,
+		 *        including changes of the parent transforms.
+		 *
+		 * Compare with a previously returned value to find out if cached world space data is stale.
+		 * Every change takes a number no transform had before, so the largest number along the
+		 * parent chain only grows, whatever changed, re-parenting included.
+		 * \returns the version
+		 */
+		unsigned int GetVersion() const {
+			return this->parentTransform ? std::max(this->version, this->parentTransform->GetVersion()) : this->version;
+		}
 
 	private:
+		/**
+		 * \brief Returns the next number of the counter shared by every transform.
+		 */
+		static unsigned int NextVersion() { return ++versionCounter; }
+
+		static std::atomic<unsigned int> versionCounter;
+
 		glm::quat orientation;
 		glm::vec3 position;
 		glm::vec3 rotation;
@@ -250,6 +279,7 @@ namespace Sigma {
 		GLTransform *parentTransform;
 
 		bool MMhasChanged; // Set to true if the modelMatrix has changed and needs to be updated
+		unsigned int version; // NextVersion of the last change, see GetVersion
 		bool Euler; // Set to true to toggle rotation matrix construction between quaternions and euler angles
 	};
 }
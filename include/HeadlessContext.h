@@ -0,0 +1,76 @@
+#pragma once
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include <vector>
+
+#include "Sigma.h"
+
+namespace Sigma {
+	/**
+	 * \brief An OpenGL context without a window or a display server, for benchmarks and image tests.
+	 *
+	 * Uses EGL with the Mesa surfaceless platform when available, else the default EGL display,
+	 * and renders to a pbuffer of a fixed size, which is framebuffer 0, so the renderer runs
+	 * unchanged. Under Mesa llvmpipe this runs the full pipeline on any CI machine. Only built when
+	 * BUILD_HEADLESS_Sigma is on.
+	 */
+	class HeadlessContext {
+	public:
+		HeadlessContext() : display(nullptr), surface(nullptr), context(nullptr), width(0), height(0) { }
+		~HeadlessContext() { Destroy(); }
+
+		/**
+		 * \brief Creates the context and its pbuffer and makes the context current.
+		 *
+		 * \param[in] const int width, height The framebuffer size, it never changes.
+		 * \param[in] const unsigned int glMajor, glMinor The OpenGL version to ask for, compatibility profile.
+		 * \return bool If creation was successful or not.
+		 */
+		DLL_EXPORT bool Initialize(const int width, const int height, const unsigned int glMajor = 3, const unsigned int glMinor = 2);
+
+		/**
+		 * \brief Destroys the context and the pbuffer.
+		 *
+		 * \return void
+		 */
+		DLL_EXPORT void Destroy();
+
+		/**
+		 * \brief Makes the context current on the calling thread, or releases it.
+		 *
+		 * \param[in] bool current True to make the context current, false to release it.
+		 * \return void
+		 */
+		DLL_EXPORT void MakeContextCurrent(bool current);
+
+		/**
+		 * \brief Ends a frame. Nothing is presented, it waits for the GPU so frame times include its work.
+		 *
+		 * \return void
+		 */
+		DLL_EXPORT void SwapBuffers();
+
+		/**
+		 * \brief Reads framebuffer 0 back, bottom row first.
+		 *
+		 * \param[out] std::vector<unsigned char>& rgb width * height * 3 bytes.
+		 * \return void
+		 */
+		DLL_EXPORT void ReadPixels(std::vector<unsigned char>& rgb);
+
+		DLL_EXPORT int GetWindowWidth() const { return this->width; }
+
+		DLL_EXPORT int GetWindowHeight() const { return this->height; }
+	private:
+		HeadlessContext(const HeadlessContext&);
+		HeadlessContext& operator=(const HeadlessContext&);
+
+		// EGLDisplay, EGLSurface and EGLContext, kept opaque so EGL stays out of this header.
+		void* display;
+		void* surface;
+		void* context;
+		int width, height;
+	};
+}
+#endif //HEADLESSCONTEXT_H
@@ -10,7 +10,10 @@
 #include "components/SpatialComponent.h"
 #include "GLTransform.h"
 #include "systems/GLSLShader.h"
+#include "systems/RenderQueue.h"
+#include "OcclusionCuller.h"
 #include <unordered_map>
+#include <algorithm>
 #include <memory>
 #include "Sigma.h"
 
@@ -50,6 +53,11 @@ namespace Sigma {
             tr = 1.0f;
             hardness = 64.0f;
             illum = 1;
+            ambientMap = 0;
+            diffuseMap = 0;
+            specularMap = 0;
+            normalMap = 0;
+            uniformBuffer = 0;
         }
         float ka[3];
         float kd[3];
@@ -62,6 +70,7 @@ namespace Sigma {
         GLuint diffuseMap;
         GLuint specularMap;
 		GLuint normalMap;
+        GLuint uniformBuffer; // MaterialData uniform block, see RenderQueue::BuildMaterialBuffer.
     };
 
 	class IGLComponent : public SpatialComponent {
@@ -69,9 +78,9 @@ namespace Sigma {
 		SET_COMPONENT_TYPENAME("IGLComponent");
 
 		IGLComponent()
-			: lightingEnabled(true), SpatialComponent(0) {} // Default ctor setting entity ID to 0.
+			: lightingEnabled(true), impostorEnabled(false), boundingRadius(0.0f), renderLOD(0), SpatialComponent(0) {} // Default ctor setting entity ID to 0.
 		IGLComponent(const id_t entityID)
-			: lightingEnabled(true), SpatialComponent(entityID) {} // Ctor that sets the entity ID.
+			: lightingEnabled(true), impostorEnabled(false), boundingRadius(0.0f), renderLOD(0), SpatialComponent(entityID) {} // Ctor that sets the entity ID.
 
         typedef std::unordered_map<std::string, std::shared_ptr<GLSLShader>> ShaderMap;
 
@@ -99,6 +108,57 @@ namespace Sigma {
 		 */
 		virtual unsigned int MeshGroup_ElementCount(const unsigned int group = 0) const = 0;
 
+		/**
+		 * \brief Returns the number of triangles of the level picked by the last UpdateLOD call.
+		 *
+		 * Read while the frame is built, the frame carries the count to the thread drawing it.
+		 * The default assumes every mesh group is drawn as a triangle list.
+		 * \return unsigned int The number of triangles.
+		 */
+		virtual unsigned int LastTriangleCount() const {
+			unsigned int count = 0;
+			for (unsigned int group = 0, elements = MeshGroup_ElementCount(0); elements != 0; elements = MeshGroup_ElementCount(++group)) {
+				count += elements / 3;
+			}
+			return count;
+		}
+
+		/**
+		 * \brief Returns the bounding sphere center in model space.
+		 */
+		const glm::vec3& BoundingCenter() const { return this->boundingCenter; }
+
+		/**
+		 * \brief Returns the bounding sphere radius in model space. 0 if unknown.
+		 */
+		float BoundingRadius() const { return this->boundingRadius; }
+
+		/**
+		 * \brief Computes the world space bounding sphere used for frustum culling.
+		 *
+		 * \param center Receives the world space center.
+		 * \param radius Receives the world space radius, scaled by the largest axis scale.
+		 * \return bool False if the component has no bounds and must always be drawn.
+		 */
+		virtual bool WorldBoundingSphere(glm::vec3& center, float& radius) {
+			if (this->boundingRadius <= 0.0f) {
+				return false;
+			}
+			glm::mat4 model = this->Transform()->GetMatrix();
+			center = glm::vec3(model * glm::vec4(this->boundingCenter, 1.0f));
+			float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+			radius = this->boundingRadius * scale;
+			return true;
+		}
+
+		/**
+		 * \brief Returns the model space triangles the occlusion culler rasterizes for this component.
+		 *
+		 * \param geometry Receives the triangles, they must stay valid until the next frame.
+		 * \return bool False if the component hides nothing, the default.
+		 */
+		virtual bool GetOccluder(OccluderGeometry& /*geometry*/) const { return false; }
+
 		/**
 		 * \brief Returns the draw mode for this component.
 		 *
@@ -114,6 +174,57 @@ namespace Sigma {
 		 */
 		virtual void Render(glm::mediump_float *view, glm::mediump_float *proj)=0;
 
+		/**
+		 * \brief Adds the draws of this component to a render queue.
+		 *
+		 * The default queues a single packet that calls Render, sorted by shader and distance.
+		 * \param queue The queue of the current frame.
+		 * \param pass The RenderPass the component is drawn in.
+		 * \param view The current view matrix
+		 * \param proj The current projection matrix
+		 */
+		virtual void Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj) {
+			DrawPacket packet;
+			packet.component = this;
+			packet.shader = this->shader.get();
+			const glm::mat4 model = this->Transform()->GetMatrix();
+			packet.matrix = queue.AddInstance(model);
+			packet.lod = this->UpdateLOD(view * model, proj[1][1]);
+			packet.count = this->LastTriangleCount() * 3;
+			glm::vec4 center = view * model * glm::vec4(this->boundingCenter, 1.0f);
+			packet.key = RenderQueue::MakeKey(pass, this->shader ? this->shader->GetProgram() : 0, 0, 0, -center.z);
+			queue.Push(packet);
+		}
+
+		/**
+		 * \brief Returns the model matrix Render draws with.
+		 *
+		 * The matrix captured when the packet was queued, set by RenderQueue::Submit right before
+		 * calling Render, so a frame drawn on the render thread never reads a transform the
+		 * simulation is changing.
+		 */
+		const glm::mat4& RenderMatrix() const { return this->renderMatrix; }
+		void SetRenderMatrix(const glm::mat4& model) { this->renderMatrix = model; }
+
+		/**
+		 * \brief Picks the level of detail to draw for a view, called while the frame is built.
+		 *
+		 * The level reaches Render through the DrawPacket or the impostor capture, see RenderLOD,
+		 * so the thread drawing a frame never changes what the next frame is built from.
+		 * \param modelView The view matrix times the model matrix.
+		 * \param projScale The vertical scale of the projection, proj[1][1].
+		 * \return unsigned int The level, the default has a single one.
+		 */
+		virtual unsigned int UpdateLOD(const glm::mat4& /*modelView*/, float /*projScale*/) { return 0; }
+
+		/**
+		 * \brief Returns the level of detail Render draws.
+		 *
+		 * Set like RenderMatrix right before calling Render, from the level UpdateLOD picked.
+		 */
+		unsigned int RenderLOD() const { return this->renderLOD; }
+		void SetRenderLOD(unsigned int lod) { this->renderLOD = lod; }
+
 		/**
 		 * \brief Return the VAO ID of this component.
 		 *
@@ -149,9 +260,26 @@ namespace Sigma {
         void LoadShader(const std::string& filename);
 		std::shared_ptr<GLSLShader> GetShader() { return this->shader; }
 
+		/**
+		 * \brief Returns the instanced variant of the shader, loaded from "<filename>_instanced" if it exists.
+		 *
+		 * \return std::shared_ptr<GLSLShader> The shader, empty if there is no instanced variant.
+		 */
+		std::shared_ptr<GLSLShader> GetInstancedShader() { return this->instancedShader; }
+
 		void SetLightingEnabled(bool enabled) { this->lightingEnabled = enabled; }
 		bool IsLightingEnabled() { return this->lightingEnabled; }
 
+		/**
+		 * \brief Lets OpenGLSystem draw the component as a cached billboard while it is far away.
+		 *
+		 * For large bodies such as planets and stations. Render must draw with the FrameData view and
+		 * projection, it is called with the capture matrices in that block to draw the billboard image.
+		 * \param enabled True to allow impostors, false by default.
+		 */
+		void SetImpostorEnabled(bool enabled) { this->impostorEnabled = enabled; }
+		bool IsImpostorEnabled() const { return this->impostorEnabled; }
+
 		// The index in buffers for each type of buffer.
 		int ElemBufIndex;
 		int VertBufIndex;
@@ -166,10 +294,17 @@ namespace Sigma {
 		GLuint cull_face; // The current culling method for this component.
 
         std::shared_ptr<GLSLShader> shader; // shaders are shared among components
+        std::shared_ptr<GLSLShader> instancedShader; // draws many copies in one call, may be empty
         // name-->shader map to look up already-loaded shaders (so each can be loaded only once)
         static ShaderMap loadedShaders;
 
 		bool lightingEnabled;
+		bool impostorEnabled; // See SetImpostorEnabled.
+
+		glm::mat4 renderMatrix; // See RenderMatrix, only used on the thread drawing the frames.
+		unsigned int renderLOD; // See RenderLOD, only used on the thread drawing the frames.
+		glm::vec3 boundingCenter; // Model space bounding sphere, set up by InitializeBuffers.
+		float boundingRadius;
 	}; // class IGLComponent
 } // namespace Sigma
 
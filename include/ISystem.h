@@ -39,10 +39,11 @@ namespace Sigma {
              * \brief Adds a component
              *
              * Adds the given Component to the Entity specified by EntityID
+             * Virtual so systems can keep their own lists of the components they were given
              * \param[in] id_t EntityId the Id of the Entity the Component belongs to
              * \param[in] T* Component The Component that should be added to the given EntityID
              */
-            void addComponent(id_t EntityID,T* Component) {
+            virtual void addComponent(id_t EntityID,T* Component) {
 				auto found=_Components.find(EntityID);
                 if(found==_Components.end()) {
                    this-> _Components.insert(std::pair<id_t,ComponentMap>(EntityID,ComponentMap()));
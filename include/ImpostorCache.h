@@ -0,0 +1,110 @@
+#pragma once
+#ifndef IMPOSTORCACHE_H
+#define IMPOSTORCACHE_H
+
+#include "glm/glm.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace Sigma {
+	/**
+	 * \brief Hands out the cells of an impostor atlas and decides when they must be drawn again.
+	 *
+	 * A cell holds an image of one object taken from a direction given in the object's own space,
+	 * so a camera orbiting the object and the object spinning both count as the view changing.
+	 * The image is reused until the direction moves further than the angle threshold from the one
+	 * it was taken from. When every cell is taken, the cell of the object not requested for the
+	 * longest time is given away; a cell requested in the current frame never is. The number of
+	 * captures per frame is capped so a camera cut does not redraw the whole atlas at once. No GL call.
+	 */
+	class ImpostorCache {
+	public:
+		ImpostorCache();
+
+		/**
+		 * \brief Splits the atlas into square cells and forgets every image.
+		 *
+		 * \param atlasSize The width and height of the atlas in pixels.
+		 * \param cellSize The width and height of a cell in pixels.
+		 */
+		void Resize(unsigned int atlasSize, unsigned int cellSize);
+
+		/**
+		 * \brief Sets how far the view direction may turn before an image is taken again.
+		 *
+		 * \param degrees The angle between the direction an image was taken from and the current one.
+		 */
+		void SetAngleThreshold(float degrees);
+
+		/**
+		 * \brief Sets the number of images Request asks for in a frame, 0 for no limit.
+		 */
+		void SetCaptureBudget(unsigned int captures) { this->captureBudget = captures; }
+
+		/**
+		 * \brief Starts a frame, cells requested from now on are not given away until the next one.
+		 */
+		void BeginFrame();
+
+		/**
+		 * \brief Returns the cell of an object, assigning one the first time.
+		 *
+		 * \param key Identifies the object.
+		 * \param direction The normalized direction from the camera to the object, in object space.
+		 * \param capture Set to true if the cell must be drawn from this direction before it is used.
+		 * \return int The cell, -1 if none is free or the capture budget of the frame is spent.
+		 */
+		int Request(const void* key, const glm::vec3& direction, bool& capture);
+
+		/**
+		 * \brief Frees the cell of an object that no longer exists.
+		 */
+		void Remove(const void* key);
+
+		/**
+		 * \brief Returns the texture coordinates of the top left then bottom right corner of a cell.
+		 *
+		 * The top of a cell is the top of the image, drawn at the higher rows of the atlas.
+		 */
+		glm::vec4 CellRect(int cell) const;
+
+		/**
+		 * \brief Returns the position in pixels of the lower left corner of a cell.
+		 */
+		void CellOrigin(int cell, unsigned int& x, unsigned int& y) const;
+
+		unsigned int CellSize() const { return this->cellSize; }
+		unsigned int CellCount() const { return static_cast<unsigned int>(this->cells.size()); }
+		unsigned int Captures() const { return this->captures; } // Captures asked for in this frame.
+	private:
+		// The object a cell holds and when it was last requested.
+		struct Cell {
+			const void* key; // nullptr if free.
+			unsigned int frame;
+		};
+
+		// The cell of an object and the direction its image was taken from.
+		struct Entry {
+			int cell;
+			glm::vec3 direction;
+		};
+
+		/**
+		 * \brief Returns a free cell, or the least recently requested one not requested in this frame.
+		 */
+		int FindCell();
+
+		unsigned int atlasSize;
+		unsigned int cellSize;
+		unsigned int cellsPerRow;
+		float cosThreshold;
+		unsigned int captureBudget;
+		unsigned int captures;
+		unsigned int frame;
+		std::vector<Cell> cells;
+		std::unordered_map<const void*, Entry> entries;
+	}; // class ImpostorCache
+} // namespace Sigma
+
+#endif // IMPOSTORCACHE_H
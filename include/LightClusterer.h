@@ -0,0 +1,137 @@
+#pragma once
+#ifndef LIGHTCLUSTERER_H
+#define LIGHTCLUSTERER_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	/**
+	 * \brief Bins point and spot lights into a grid of view space clusters.
+	 *
+	 * The view frustum is split into TILES_X by TILES_Y screen tiles and SLICES depth slices,
+	 * spaced exponentially between the near and far planes. Bin builds, for every cluster, the list
+	 * of lights touching it so a single full screen pass can shade each pixel with only the lights
+	 * of its cluster. Lights are tested 4 at a time (SSE) against the cluster boxes, spot lights
+	 * also against the cluster bounding spheres with a cone test. Slices are split between worker
+	 * threads when there are many lights.
+	 */
+	class LightClusterer {
+	public:
+		static const unsigned int TILES_X = 16;
+		static const unsigned int TILES_Y = 9;
+		static const unsigned int SLICES = 24;
+		static const unsigned int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+		// Below this many lights the cost of starting threads outweighs the gain.
+		static const size_t PARALLEL_THRESHOLD = 256;
+
+		LightClusterer();
+
+		/**
+		 * \brief Computes the cluster bounds of a perspective projection.
+		 *
+		 * Only needs to be called when the projection changes.
+		 * \param projection The projection matrix, the near and far planes are extracted from it.
+		 */
+		void SetProjection(const glm::mat4& projection);
+
+		/**
+		 * \brief Removes every light, the cluster bounds are kept.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Adds a point light.
+		 *
+		 * \param position The view space position.
+		 * \param radius The distance at which the light has no effect.
+		 * \return unsigned int The light index used in the cluster lists.
+		 */
+		unsigned int AddPointLight(const glm::vec3& position, float radius);
+
+		/**
+		 * \brief Adds a spot light.
+		 *
+		 * \param position The view space position.
+		 * \param direction The normalized view space direction.
+		 * \param range The distance at which the light has no effect.
+		 * \param cosOuterAngle The cosine of the half angle of the cone.
+		 * \return unsigned int The light index used in the cluster lists.
+		 */
+		unsigned int AddSpotLight(const glm::vec3& position, const glm::vec3& direction, float range, float cosOuterAngle);
+
+		/**
+		 * \brief Returns the number of lights.
+		 */
+		size_t Size() const { return this->radii.size(); }
+
+		/**
+		 * \brief Sets how many threads Bin uses.
+		 *
+		 * \param threads 0 to use one per hardware thread, 1 to bin on the calling thread only.
+		 */
+		void SetThreadCount(unsigned int threads) { this->threadCount = threads; }
+
+		/**
+		 * \brief Builds the light list of every cluster.
+		 *
+		 * \return size_t The total length of the lists.
+		 */
+		size_t Bin();
+
+		/**
+		 * \brief Tests one light against one cluster, the reference for the batched test in Bin.
+		 */
+		bool Intersects(unsigned int light, unsigned int cluster) const;
+
+		/**
+		 * \brief Returns the offset in Indices and the light count of each cluster, 2 values per cluster.
+		 */
+		const std::vector<unsigned int>& Clusters() const { return this->clusters; }
+
+		/**
+		 * \brief Returns the concatenated light lists of the clusters.
+		 */
+		const std::vector<unsigned int>& Indices() const { return this->indices; }
+
+		/**
+		 * \brief Returns the index of a cluster from its tile and slice.
+		 */
+		static unsigned int ClusterIndex(unsigned int x, unsigned int y, unsigned int slice) {
+			return x + TILES_X * (y + TILES_Y * slice);
+		}
+
+		float NearPlane() const { return this->nearPlane; }
+		float FarPlane() const { return this->farPlane; }
+
+		/**
+		 * \brief Returns the factor turning log(depth / near) into a slice, as used by the shaders.
+		 */
+		float SliceScale() const { return this->sliceScale; }
+	private:
+		// Bins the clusters of slices [first, last), writing their offsets relative to lists.
+		void BinSlices(unsigned int first, unsigned int last, std::vector<unsigned int>& lists);
+
+		float nearPlane;
+		float farPlane;
+		float sliceScale;
+		unsigned int threadCount;
+
+		// Cluster boxes and bounding spheres in view space.
+		std::vector<float> boxMinX, boxMinY, boxMinZ;
+		std::vector<float> boxMaxX, boxMaxY, boxMaxZ;
+		std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+		std::vector<float> sliceDepths; // SLICES + 1 positive depths.
+
+		// Lights, point lights have a zero direction and a cone cosine of -1.
+		std::vector<float> positionX, positionY, positionZ, radii;
+		std::vector<float> directionX, directionY, directionZ, coneCos, coneSin;
+
+		std::vector<unsigned int> clusters;
+		std::vector<unsigned int> indices;
+	}; // class LightClusterer
+} // namespace Sigma
+
+#endif // LIGHTCLUSTERER_H
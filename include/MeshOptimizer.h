@@ -0,0 +1,121 @@
+#pragma once
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	namespace mesh {
+		/**
+		 * \brief Computes the average cache miss ratio (ACMR) of an index list.
+		 *
+		 * Simulates a FIFO post-transform cache and returns the number of vertex shader
+		 * invocations per triangle. 3.0 is the worst case, ~0.5 is the best a closed mesh can get.
+		 * \param indices The triangle list indices.
+		 * \param indexCount The number of indices (3 per triangle).
+		 * \param vertexCount The number of vertices referenced by indices.
+		 * \param cacheSize The size of the simulated FIFO cache.
+		 * \return float The ACMR, or 0 for an empty list.
+		 */
+		float CalculateACMR(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+		/**
+		 * \brief Reorders triangles to improve post-transform vertex cache hits.
+		 *
+		 * Uses Tom Forsyth's linear-speed vertex cache optimisation. Only the order of the triangles
+		 * changes, the vertex order (and thus winding) inside each triangle is kept.
+		 * \param indices The triangle list indices, reordered in place.
+		 * \param indexCount The number of indices (3 per triangle).
+		 * \param vertexCount The number of vertices referenced by indices.
+		 */
+		void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+		/**
+		 * \brief Reorders clusters of triangles to reduce overdraw.
+		 *
+		 * Should be run after OptimizeVertexCache. The triangles are split into clusters that keep
+		 * the cache behaviour intact, then the clusters are sorted so outward facing ones are drawn
+		 * first. threshold controls how much ACMR may be traded for smaller clusters (1.05 = 5%).
+		 * \param indices The triangle list indices, reordered in place.
+		 * \param indexCount The number of indices (3 per triangle).
+		 * \param positions Pointer to the x coordinate of the first vertex position.
+		 * \param vertexCount The number of vertices.
+		 * \param stride The distance in bytes between two vertex positions.
+		 * \param threshold The allowed ACMR degradation.
+		 */
+		void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t stride, float threshold = 1.05f);
+
+		/**
+		 * \brief Reorders vertices in the order they are first used by the index list.
+		 *
+		 * The indices are rewritten in place; remap receives the new location of each old vertex
+		 * (or ~0u when a vertex is never referenced). Use RemapVertices to apply it to each attribute.
+		 * \param remap Receives the old to new vertex mapping.
+		 * \param indices The triangle list indices, rewritten in place.
+		 * \param indexCount The number of indices.
+		 * \param vertexCount The number of vertices.
+		 * \return size_t The number of referenced vertices after the remap.
+		 */
+		size_t OptimizeVertexFetch(std::vector<unsigned int>& remap, unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+		/**
+		 * \brief Simplifies a triangle list using quadric error metrics.
+		 *
+		 * Collapses edges onto existing vertices, so the result indexes the same vertex buffer and no
+		 * new vertices are created. Vertices on open borders or attribute seams are never moved.
+		 * \param destination Receives the simplified indices. Must have room for indexCount indices.
+		 * \param indices The source triangle list indices.
+		 * \param indexCount The number of source indices.
+		 * \param positions Pointer to the x coordinate of the first vertex position.
+		 * \param vertexCount The number of vertices.
+		 * \param stride The distance in bytes between two vertex positions.
+		 * \param targetIndexCount The index count to stop at.
+		 * \param targetError The largest error (relative to the mesh extent) a collapse may introduce.
+		 * \param resultError If not null, receives the largest error introduced.
+		 * \return size_t The number of indices written to destination.
+		 */
+		size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t stride,
+			size_t targetIndexCount, float targetError = 1.0f, float* resultError = nullptr);
+
+		/**
+		 * \brief Splits every triangle into 4 by inserting a vertex at the middle of each edge.
+		 *
+		 * Edges are indexed directly from a sorted list of the unique edges, so shared edges get a
+		 * single midpoint. New vertices are numbered from vertexCount in edge order; the caller creates
+		 * them from parents, which receives the two end points of every new vertex.
+		 * \param indices The triangle list indices, replaced by the subdivided list.
+		 * \param parents Receives two indices per new vertex.
+		 * \param vertexCount The number of vertices before subdivision.
+		 * \return size_t The number of vertices after subdivision.
+		 */
+		size_t SubdivideTriangles(std::vector<unsigned int>& indices, std::vector<unsigned int>& parents, size_t vertexCount);
+
+		/**
+		 * \brief Applies a remap table produced by OptimizeVertexFetch to a vertex attribute array.
+		 *
+		 * \param data The attribute array. Left untouched if its size does not match the remap table.
+		 * \param remap The old to new vertex mapping.
+		 * \param newCount The number of vertices after the remap.
+		 */
+		template<typename T>
+		void RemapVertices(std::vector<T>& data, const std::vector<unsigned int>& remap, size_t newCount) {
+			if (data.size() != remap.size() || data.empty()) {
+				return;
+			}
+			std::vector<T> result;
+			result.reserve(newCount);
+			for (size_t i = 0; i < newCount; ++i) {
+				result.push_back(data[0]);
+			}
+			for (size_t i = 0; i < data.size(); ++i) {
+				if (remap[i] != ~0u) {
+					result[remap[i]] = data[i];
+				}
+			}
+			data.swap(result);
+		}
+	} // namespace mesh
+} // namespace Sigma
+
+#endif // MESHOPTIMIZER_H
@@ -44,6 +44,15 @@ namespace Sigma {
 		 */
 		DLL_EXPORT void SwapBuffers();
 
+		/**
+		 * \brief Makes the window's context current on the calling thread, or releases it.
+		 *
+		 * A context is current on one thread at a time, release it before another thread takes it.
+		 * \param[in] bool current True to make the context current, false to release it.
+		 * \return void
+		 */
+		DLL_EXPORT void MakeContextCurrent(bool current);
+
 		/**
 		 * \brief Processes events in the OS message event loop.
 		 *
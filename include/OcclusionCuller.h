@@ -0,0 +1,152 @@
+#pragma once
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	// Model space triangles of an occluder, see IGLComponent::GetOccluder.
+	struct OccluderGeometry {
+		OccluderGeometry() : positions(nullptr), stride(3 * sizeof(float)), vertexCount(0), indices(nullptr), indexCount(0) {}
+		const float* positions; // x, y, z of the first vertex.
+		size_t stride; // Bytes from one position to the next.
+		size_t vertexCount;
+		const unsigned int* indices; // 3 per triangle.
+		size_t indexCount;
+	};
+
+	/**
+	 * \brief Moves the vertices of an occluder inward so it lies inside the surface it stands for.
+	 *
+	 * A simplified mesh may bulge out of the source mesh by up to its error. Moving every vertex back
+	 * by that distance keeps it from hiding objects just past the silhouette of the source mesh.
+	 * \param positions x, y, z of the first vertex, moved in place.
+	 * \param directions x, y, z of the outward direction of the first vertex, usually its normal.
+	 * Vertices with a zero direction stay in place.
+	 * \param stride Bytes from one position, or direction, to the next.
+	 * \param vertexCount The number of vertices.
+	 * \param distance How far to move the vertices, in model units.
+	 */
+	inline void ShrinkOccluder(float* positions, const float* directions, size_t stride, size_t vertexCount, float distance) {
+		for (size_t i = 0; i < vertexCount; ++i) {
+			float* position = reinterpret_cast<float*>(reinterpret_cast<char*>(positions) + i * stride);
+			const float* direction = reinterpret_cast<const float*>(reinterpret_cast<const char*>(directions) + i * stride);
+			const glm::vec3 outward(direction[0], direction[1], direction[2]);
+			const float length = glm::length(outward);
+			if (length > 0.0f) {
+				const glm::vec3 step = outward * (distance / length);
+				position[0] -= step.x;
+				position[1] -= step.y;
+				position[2] -= step.z;
+			}
+		}
+	}
+
+	/**
+	 * \brief Culls boxes hidden behind occluder meshes with a small software depth buffer.
+	 *
+	 * The occluders are clipped against the near plane and rasterized at WIDTH by HEIGHT, 4 pixels
+	 * at a time (SSE), keeping the nearest depth. The rows are split in bands rasterized by worker
+	 * threads. A hierarchy of the farthest depth of each 2x2 block is then built, so a box is
+	 * tested against at most 4 texels: it is hidden when its nearest point is behind the farthest
+	 * occluder depth of every texel its screen rectangle covers.
+	 *
+	 * Occluders are two sided and should lie inside the surface they stand for, otherwise they
+	 * hide objects that are actually in view. Needs no GPU.
+	 */
+	class OcclusionCuller {
+	public:
+		static const unsigned int WIDTH = 256;
+		static const unsigned int HEIGHT = 128;
+		// Below this many triangles the cost of starting threads outweighs the gain.
+		static const size_t PARALLEL_THRESHOLD = 1024;
+
+		OcclusionCuller();
+
+		/**
+		 * \brief Sets the number of threads Rasterize may use for many triangles.
+		 *
+		 * \param count The number of threads, 0 uses one per hardware thread, 1 never starts threads.
+		 */
+		void SetThreadCount(unsigned int count) { this->threadCount = count; }
+
+		/**
+		 * \brief Removes every occluder and clears the depth buffer.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Transforms, clips and sets up the triangles of an occluder.
+		 *
+		 * \param modelViewProj The model view projection matrix of the occluder.
+		 * \param geometry The model space triangles.
+		 */
+		void AddOccluder(const glm::mat4& modelViewProj, const OccluderGeometry& geometry);
+
+		/**
+		 * \brief Returns the number of triangles set up since the last Clear.
+		 */
+		size_t TriangleCount() const { return this->triangles.size(); }
+
+		/**
+		 * \brief Rasterizes the occluders and builds the depth hierarchy. Call before testing boxes.
+		 *
+		 * \return size_t The number of threads used.
+		 */
+		size_t Rasterize();
+
+		/**
+		 * \brief Tests a box against the occluders rasterized by the last Rasterize.
+		 *
+		 * May be called from several threads at once.
+		 * \param viewProj The view projection matrix the occluders were drawn with.
+		 * \param minimum The world space minimum corner of the box.
+		 * \param maximum The world space maximum corner of the box.
+		 * \return bool False if the box is hidden or off screen. Boxes crossing the near plane are visible.
+		 */
+		bool IsBoxVisible(const glm::mat4& viewProj, const glm::vec3& minimum, const glm::vec3& maximum) const;
+
+		/**
+		 * \brief Returns the depth buffer value of a pixel, 0 at the near plane and 1 at the far plane.
+		 */
+		float Depth(unsigned int x, unsigned int y) const { return this->levels[0][y * WIDTH + x]; }
+	private:
+		// A screen space triangle set up for rasterization, every value is a function a * x + b * y + c.
+		struct Triangle {
+			float edgeA[3], edgeB[3], edgeC[3]; // Inside where all three are >= 0.
+			float depthA, depthB, depthC;
+			int minX, maxX, minY, maxY; // Pixel bounds, clamped to the buffer.
+		};
+
+		/**
+		 * \brief Clips a clip space triangle against the near plane and adds what is left.
+		 */
+		void AddClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+		/**
+		 * \brief Sets up a triangle whose vertices are in front of the near plane.
+		 */
+		void AddScreenTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+		/**
+		 * \brief Rasterizes every triangle into the rows [firstRow, lastRow).
+		 */
+		void RasterizeRows(int firstRow, int lastRow);
+
+		/**
+		 * \brief Fills levels 1 and up from the depth buffer.
+		 */
+		void BuildHierarchy();
+
+		std::vector<Triangle> triangles;
+		std::vector<std::vector<float>> levels; // levels[0] is the depth buffer, each next level is half its size.
+		std::vector<unsigned int> levelWidths;
+		std::vector<unsigned int> levelHeights;
+		unsigned int threadCount;
+	}; // class OcclusionCuller
+} // namespace Sigma
+
+#endif // OCCLUSIONCULLER_H
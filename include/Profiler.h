@@ -0,0 +1,132 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace Sigma {
+	// The track of the timeline GPU markers go to, CPU markers use one track per thread from 1 up.
+	static const unsigned int PROFILE_TRACK_GPU = 0;
+
+	// A timed span of the timeline.
+	struct ProfileEvent {
+		const char* name; // A string literal, it is not copied.
+		unsigned int track;
+		uint64_t frame; // The profiler frame the event was recorded in.
+		double start; // Microseconds since the profiler epoch.
+		double duration; // Microseconds.
+	};
+
+	// Timings of every event with the same name and track.
+	struct ProfileSummary {
+		const char* name;
+		unsigned int track;
+		size_t count;
+		double average; // Milliseconds.
+		double maximum; // Milliseconds.
+	};
+
+	/**
+	 * \brief Collects CPU and GPU timings of named markers on one timeline.
+	 *
+	 * CPU markers are recorded with ScopedMarker, GPU markers by GLGPUTimer once their queries are
+	 * read back, converted to the profiler clock. Recording is off until SetEnabled(true) and every
+	 * method may be called from any thread.
+	 */
+	class Profiler {
+	public:
+		// Events kept at most, the oldest are dropped once reached.
+		static const size_t MAX_EVENTS = 1 << 20;
+
+		/**
+		 * \brief Times the scope it is declared in on the track of the calling thread.
+		 */
+		class ScopedMarker {
+		public:
+			/**
+			 * \param name A string literal naming the marker.
+			 */
+			explicit ScopedMarker(const char* name) : name(name), start(Profiler::IsEnabled() ? Profiler::Now() : -1.0) {}
+			~ScopedMarker() {
+				if (this->start >= 0.0) {
+					Profiler::Record(this->name, Profiler::ThreadTrack(), this->start, Profiler::Now() - this->start);
+				}
+			}
+		private:
+			ScopedMarker(const ScopedMarker&);
+			ScopedMarker& operator=(const ScopedMarker&);
+
+			const char* name;
+			double start;
+		};
+
+		static void SetEnabled(bool enabled);
+		static bool IsEnabled();
+
+		/**
+		 * \brief Returns the microseconds elapsed since the profiler epoch, a steady clock.
+		 */
+		static double Now();
+
+		/**
+		 * \brief Starts a new frame, the following events are tagged with its number.
+		 */
+		static void NextFrame();
+
+		/**
+		 * \brief Returns the current frame number.
+		 */
+		static uint64_t Frame();
+
+		/**
+		 * \brief Returns the track of the calling thread, numbered from 1 in order of first use.
+		 */
+		static unsigned int ThreadTrack();
+
+		/**
+		 * \brief Adds an event to the timeline, does nothing when disabled.
+		 *
+		 * \param name A string literal naming the marker.
+		 * \param track PROFILE_TRACK_GPU or a thread track.
+		 * \param start Microseconds since the profiler epoch.
+		 * \param duration Microseconds.
+		 * \param frame The frame the event belongs to, the current one by default.
+		 */
+		static void Record(const char* name, unsigned int track, double start, double duration, uint64_t frame = ~0ull);
+
+		/**
+		 * \brief Returns a copy of the recorded events, in recording order.
+		 */
+		static std::vector<ProfileEvent> Events();
+
+		/**
+		 * \brief Returns the timings of each marker, sorted by track then name.
+		 */
+		static std::vector<ProfileSummary> Summarize();
+
+		/**
+		 * \brief Removes every event.
+		 */
+		static void Clear();
+
+		/**
+		 * \brief Writes the events in the Chrome trace event format, with the summary.
+		 *
+		 * The file opens in chrome://tracing or Perfetto, the "summary" array holds the average and
+		 * maximum of each marker for benchmark scripts.
+		 * \param path The file to write.
+		 * \return bool False if the file could not be written.
+		 */
+		static bool WriteJSON(const std::string& path);
+	}; // class Profiler
+} // namespace Sigma
+
+#define SIGMA_PROFILE_CONCAT2(a, b) a##b
+#define SIGMA_PROFILE_CONCAT(a, b) SIGMA_PROFILE_CONCAT2(a, b)
+// Times the rest of the enclosing scope as a CPU marker.
+#define PROFILE_SCOPE(name) Sigma::Profiler::ScopedMarker SIGMA_PROFILE_CONCAT(profileMarker, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	// A render target declared in a RenderGraph.
+	struct RenderGraphTexture {
+		std::string name;
+		unsigned int format; // OpenGL internal format.
+		float scale; // Of the viewport size.
+		int slot; // Pool texture backing it, -1 if no pass that runs touches it.
+		unsigned int firstPass; // First and last pass that runs and touches it.
+		unsigned int lastPass;
+	};
+
+	// A pass declared in a RenderGraph, in execution order.
+	struct RenderGraphPass {
+		std::string name;
+		std::vector<int> reads; // Textures sampled.
+		std::vector<int> writes; // Textures attached, in attachment order, may hold RenderGraph::BACKBUFFER.
+		std::vector<int> clears; // The writes whose previous content is discarded.
+		bool culled; // Nothing that reaches the back buffer depends on the pass.
+	};
+
+	// A pool texture shared by the declared textures whose lifetimes do not overlap.
+	struct RenderGraphSlot {
+		unsigned int format;
+		float scale;
+		unsigned int lastPass; // Last pass of the latest texture placed in it.
+	};
+
+	/**
+	 * \brief Orders the passes of a frame by the textures they read and write, with no GL call.
+	 *
+	 * Passes are declared in execution order with the textures they sample and attach. Compile
+	 * walks them from the back buffer backwards and culls every pass whose writes nothing later
+	 * depends on, then gives each remaining texture the lifetime between the first and last pass
+	 * touching it. Textures of the same format and scale whose lifetimes do not overlap share one
+	 * slot, which OpenGLSystem backs with a single texture resized with the viewport.
+	 *
+	 * A texture keeps its content only from its first to its last pass of a frame, so its first
+	 * pass should clear it.
+	 */
+	class RenderGraph {
+	public:
+		// Framebuffer 0, written by the passes that present the frame.
+		static const int BACKBUFFER = -1;
+
+		/**
+		 * \brief Removes every pass and texture.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Declares a render target.
+		 *
+		 * \param name For logs.
+		 * \param format The OpenGL internal format, e.g. GL_RGBA8 or GL_DEPTH24_STENCIL8.
+		 * \param scale The size of the target relative to the viewport.
+		 * \return int The texture to pass to Read and Write.
+		 */
+		int AddTexture(const std::string& name, unsigned int format, float scale = 1.0f);
+
+		/**
+		 * \brief Declares the next pass of the frame.
+		 *
+		 * \return int The pass to pass to Read and Write.
+		 */
+		int AddPass(const std::string& name);
+
+		/**
+		 * \brief Declares that a pass samples a texture.
+		 */
+		void Read(int pass, int texture);
+
+		/**
+		 * \brief Declares that a pass draws into a texture, attached in the order of the calls.
+		 *
+		 * \param pass The pass.
+		 * \param texture The texture, or BACKBUFFER.
+		 * \param clear True if the pass clears the texture, so earlier writes do not reach it.
+		 */
+		void Write(int pass, int texture, bool clear);
+
+		/**
+		 * \brief Culls the passes, computes the texture lifetimes and places them in slots.
+		 */
+		void Compile();
+
+		bool IsCulled(int pass) const { return this->passes[pass].culled; }
+
+		/**
+		 * \brief Returns the slot of a texture, -1 if it is not used.
+		 */
+		int Slot(int texture) const { return this->textures[texture].slot; }
+
+		size_t PassCount() const { return this->passes.size(); }
+		size_t TextureCount() const { return this->textures.size(); }
+		size_t SlotCount() const { return this->slots.size(); }
+		const RenderGraphPass& GetPass(int pass) const { return this->passes[pass]; }
+		const RenderGraphTexture& GetTexture(int texture) const { return this->textures[texture]; }
+		const RenderGraphSlot& GetSlot(int slot) const { return this->slots[slot]; }
+	private:
+		std::vector<RenderGraphTexture> textures;
+		std::vector<RenderGraphPass> passes;
+		std::vector<RenderGraphSlot> slots;
+	}; // class RenderGraph
+} // namespace Sigma
+
+#endif // RENDERGRAPH_H
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <ostream>
+#include <string>
+#include <stdint.h>
+
+namespace Sigma {
+	// The passes of OpenGLSystem::RenderFrame draw calls are counted for, in the order they are drawn.
+	enum RenderStatsPass {
+		STATS_PASS_IMPOSTORS = 0, // Impostor images drawn into their atlas cells.
+		STATS_PASS_GBUFFER = 1,
+		STATS_PASS_LIGHTING = 2,
+		STATS_PASS_UNLIT = 3,
+		STATS_PASS_OVERLAY = 4,
+		STATS_PASS_COUNT = 5
+	};
+
+	/**
+	 * \brief Counters of what the renderer did in a frame, or the sum of several frames.
+	 *
+	 * OpenGLSystem fills one per frame, see OpenGLSystem::GetFrameStats. Summary and WriteJSON
+	 * divide every counter by a number of frames, so sums of several frames print as averages.
+	 */
+	struct RenderStats {
+		RenderStats();
+
+		// Culling, counted while the frame is built.
+		unsigned int objects; // Components rendered, billboards included.
+		unsigned int culled; // Components skipped because their bounds are outside the view frustum.
+		unsigned int occluded; // Components in the frustum skipped because occluders hide them.
+		unsigned int impostors; // Components drawn as billboards, counted in objects.
+		unsigned int impostorCaptures; // Billboard images drawn again because the view changed.
+
+		// Drawing.
+		unsigned int lights; // Point and spot lights shaded by the lighting pass.
+		unsigned int triangles; // Triangles submitted, after level of detail selection.
+		unsigned int drawCalls; // Every pass.
+		unsigned int passDrawCalls[STATS_PASS_COUNT]; // Draw calls of each RenderStatsPass.
+		unsigned int shaderChanges; // Shader binds done by the render queue.
+		unsigned int instances; // Packets merged into instanced draw calls.
+
+		// Driver calls, see GLStateCounters.
+		unsigned int programBinds;
+		unsigned int vertexArrayBinds;
+		unsigned int textureBinds;
+		unsigned int uniforms; // Uniform values set, uniform blocks are counted in uploadedBytes.
+		unsigned int stateCalls; // State changes GLState passed on to the driver, binds included.
+		unsigned int redundantStateCalls; // State changes GLState skipped.
+		uint64_t uploadedBytes; // Buffer data sent to the GPU, through the ring buffer or not.
+
+		/**
+		 * \brief Adds the counters of another frame.
+		 */
+		void Add(const RenderStats& other);
+
+		/**
+		 * \brief Returns the lower case name of a RenderStatsPass, as written by WriteJSON.
+		 */
+		static const char* PassName(unsigned int pass);
+
+		/**
+		 * \brief Returns the counters on one line, for the log.
+		 *
+		 * \param frames The number of frames the counters were summed over.
+		 * \return std::string The counters divided by frames.
+		 */
+		std::string Summary(unsigned int frames = 1) const;
+
+		/**
+		 * \brief Writes the counters as a JSON object.
+		 *
+		 * \param stream The stream to write to.
+		 * \param frames The number of frames the counters were summed over.
+		 */
+		void WriteJSON(std::ostream& stream, unsigned int frames = 1) const;
+	}; // struct RenderStats
+} // namespace Sigma
+
+#endif // RENDERSTATS_H
@@ -19,7 +19,7 @@ namespace Sigma {
 	public:
 		SET_COMPONENT_TYPENAME("ALSound");
 
-		ALSound(int entityID,OpenALSystem *m) : ISound(entityID), buffercount(0), bufferindex(0), master(m), sourceid(0), stream(false) { }
+		ALSound(int entityID,OpenALSystem *m) : ISound(entityID), buffercount(0), bufferindex(0), master(m), sourceid(0), stream(false), proxy(-1) { }
 		virtual ~ALSound() { Destroy(); }
 
 		void Generate();
@@ -48,5 +48,6 @@ namespace Sigma {
 		int buffercount;
 		resource::Decoder codec;
 		OpenALSystem *master;
+		int proxy; // Emitter proxy in the master's index, -1 until positioned.
 	};
 } // namespace Sigma
@@ -2,12 +2,15 @@
 #include "../IBulletShape.h"
 #include "Sigma.h"
 
+#include <memory>
+
 namespace Sigma{
 	class GLMesh;
+	struct MeshData;
 	class BulletShapeMesh : public IBulletShape {
 	public:
 		SET_COMPONENT_TYPENAME("BulletShapeMesh");
-		BulletShapeMesh(const id_t entityID = 0) : IBulletShape(entityID) { }
+		BulletShapeMesh(const id_t entityID = 0) : IBulletShape(entityID), btmesh(nullptr) { }
 		~BulletShapeMesh() {
 			if (this->btmesh != nullptr) {
 				delete this->btmesh;
@@ -18,7 +21,17 @@ namespace Sigma{
 		void SetMesh(const GLMesh* mesh, float scale);
 		void SetMesh(const GLMesh* mesh);
 
+		/**
+		 * \brief Builds the collision shape directly on shared CPU mesh data.
+		 *
+		 * The triangles are not copied, the shape indexes data and keeps it alive.
+		 * \param data The geometry, see GLMesh::LoadMeshData.
+		 * \param scale The uniform scale of the shape.
+		 */
+		void SetMesh(std::shared_ptr<const MeshData> data, float scale);
+
 	private:
-		btTriangleMesh* btmesh;
+		btStridingMeshInterface* btmesh;
+		std::shared_ptr<const MeshData> meshData; // Referenced by btmesh when set.
 	};
 }
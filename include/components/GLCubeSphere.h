@@ -5,7 +5,7 @@
 #include "GLMesh.h"
 #include "Sigma.h"
 
-#include <stdint.h>
+#include <map>
 
 namespace Sigma {
     class GLCubeSphere : public GLMesh {
@@ -25,12 +25,29 @@ namespace Sigma {
         void InitializeBuffers();
 
         /**
-         * \brief Updates the rotation and renders the mesh
+         * \brief Binds the cubemaps and renders the mesh
          *
          * \return void
          */
         void Render(glm::mediump_float *view, glm::mediump_float *proj);
 
+        /**
+         * \brief Spheres fixed to the camera surround it and are never culled.
+         */
+        bool WorldBoundingSphere(glm::vec3& center, float& radius) {
+            if (this->_fixToCamera) {
+                return false;
+            }
+            return GLMesh::WorldBoundingSphere(center, radius);
+        }
+
+        /**
+         * \brief Queues a single packet that calls Render, the cubemaps need their own state.
+         *
+         * Spheres fixed to the camera are moved to the camera position first.
+         */
+        void Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj);
+
         /**
          * \brief Returns the number of elements to draw for this component.
          *
@@ -39,10 +56,10 @@ namespace Sigma {
          * \return unsigned int The number of elements to draw.
          */
         virtual unsigned int MeshGroup_ElementCount(const unsigned int group = 0) const {
-            if (group > 0) {
+            if (group > 0 || this->lods.empty()) {
                 return 0;
 			}
-            return this->faces.size() * 3;
+            return this->lods[0].faceCount * 3;
         }
 
         /**
@@ -81,7 +98,10 @@ namespace Sigma {
 
         // helper functions for refinement
         static Vertex GetMidPoint(const Vertex& v1, const Vertex& v2);
-        int CreateOrGetMidpoint(std::map<int64_t,int> &cache, const int v1, const int v2);
+        /// fills verts and faces with the refined, normalized cube and its levels of detail
+        void BuildGeometry();
+
+        static std::map<int, SharedGeometry> geometryCache; // subdivision level --> geometry
     }; // class GLCubeSphere
 
 } // namespace Sigma
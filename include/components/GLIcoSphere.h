@@ -6,6 +6,7 @@
 #include "Sigma.h"
 
 #include <map>
+#include <vector>
 #include <stdint.h>
 
 namespace Sigma{
@@ -30,21 +31,50 @@ namespace Sigma{
          * \brief Refines each equilateral triangle face into 4 sub-triangles.
          *
          * Recursively subdivides faces <level> times, so that the total number of faces at the end is
-         *  20 * 4^level. Works with the existing set of verts and faces.
+         *  20 * 4^level. Works with the existing set of verts and faces. The two parents of every
+         *  new vertex are recorded in midpointParents.
          * \param level The number of refinements to apply.
          * \return   void
          * \exception
          */
         void Refine(int level);
 
-        void RefineFace(const unsigned int index);
+        /**
+         * \brief Sets the number of refinements. Must be called before InitializeBuffers.
+         *
+         * \param levels The number of refinements, the sphere has 20 * 4^levels faces.
+         */
+        void SetSubdivisions(int levels) { this->subdivisionLevels = levels; }
+
+        /**
+         * \brief Reuses the colors of the first icosphere of the same level instead of random ones.
+         *
+         * Icospheres sharing their colors have no per instance vertex data, so the render queue can
+         * draw them all with one instanced draw. Must be called before InitializeBuffers.
+         * \param shared True to share the colors.
+         */
+        void SetSharedColors(bool shared) { this->sharedColors = shared; }
 
     private:
+        // Geometry generated once per subdivision level and drawn by every icosphere of that level.
+        struct CachedGeometry {
+            SharedGeometry geometry;
+            std::vector<unsigned int> midpointParents; // Two entries per vertex after the first 12.
+            GLuint colorBuffer; // The colors of the icosphere that built the level.
+        };
+
         // helper functions for refinement
         void RefineColor(const int v1, const int v2, float* green, float* blue) const;
-        int CreateOrGetMidpoint(std::map<int64_t,int> &cache, const int v1, const int v2);
         /// given two vertices on the unit sphere, return their midpoint on the sphere
         Vertex GetUnitSphereMidPoint(const Vertex& v1, const Vertex& v2) const;
+        /// generates the random land/water colors of this instance from the midpoint parents
+        void GenerateColors(const std::vector<unsigned int>& parents);
+
+        int subdivisionLevels;
+        bool sharedColors;
+        std::vector<unsigned int> midpointParents;
+
+        static std::map<int, CachedGeometry> geometryCache; // subdivision level --> geometry
     }; // class GLIcoSphere
 
 } // namespace Sigma
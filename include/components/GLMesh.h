@@ -5,10 +5,12 @@
 #include "../GLTransform.h"
 #include "../IGLComponent.h"
 #include "Sigma.h"
+#include "systems/GLStaticBatch.h"
 
 #include <vector>
 #include <map>
 #include <memory>
+#include <string>
 
 namespace Sigma{
     // Helper structs for OBJ loading
@@ -25,10 +27,53 @@ namespace Sigma{
         VertexIndices v[3];
     };
 
+    // A run of faces in the element buffer that is drawn with one material.
+    struct MeshRange {
+        unsigned int firstFace; // Offset (in faces) into the element buffer.
+        unsigned int faceCount;
+        std::string material; // Empty when the mesh has no materials.
+    };
+
+    // One level of detail. Level 0 is the source mesh, every following level is coarser.
+    struct MeshLOD {
+        MeshLOD() : error(0.0f), faceCount(0) {}
+        std::vector<MeshRange> ranges;
+        float error; // Largest deviation from the source mesh, in model units.
+        unsigned int faceCount;
+    };
+
+    // Positions and full resolution faces of a mesh kept on the CPU for physics or picking.
+    // Shared by every user of the same mesh file, see GLMesh::LoadMeshData.
+    struct MeshData {
+        std::vector<Vertex> verts;
+        std::vector<Face> faces;
+    };
+
+    // Uploaded geometry owned by a cache and drawn by several meshes, see GLMesh::ShareGeometry.
+    struct SharedGeometry {
+        SharedGeometry() : vertexBuffer(0), normalBuffer(0), elementBuffer(0), indexType(GL_UNSIGNED_INT), vertexCount(0), boundingRadius(0.0f) {}
+        GLuint vertexBuffer;
+        GLuint normalBuffer; // 0 if the geometry has no normals.
+        GLuint elementBuffer;
+        GLenum indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+        unsigned int vertexCount;
+        std::vector<MeshLOD> lods;
+        glm::vec3 boundingCenter;
+        float boundingRadius;
+    };
+
     class GLMesh : public IGLComponent {
     public:
         using IGLComponent::LoadShader;
 
+        // Which CPU side data is kept after InitializeBuffers uploaded it. Everything else is freed.
+        enum Residency {
+            RESIDENT_NONE = 0,
+            RESIDENT_GEOMETRY = 1, // verts and full resolution faces, for physics and picking
+            RESIDENT_ATTRIBUTES = 2, // normals, texture coordinates, colors, LOD faces and face groups
+            RESIDENT_ALL = RESIDENT_GEOMETRY | RESIDENT_ATTRIBUTES
+        };
+
         SET_COMPONENT_TYPENAME("GLMesh");
         GLMesh(const id_t entityID);
         virtual ~GLMesh(){}
@@ -50,6 +95,16 @@ namespace Sigma{
          */
         virtual void Render(glm::mediump_float *view, glm::mediump_float *proj);
 
+        /**
+         * \brief Selects the level of detail and queues one packet per material range.
+         *
+         * \param queue The queue of the current frame.
+         * \param pass The RenderPass the mesh is drawn in.
+         * \param view The current view matrix
+         * \param proj The current projection matrix
+         */
+        virtual void Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj);
+
         /**
          * \brief Returns the number of elements to draw for this component.
          *
@@ -70,12 +125,157 @@ namespace Sigma{
                 return 0;
             }
 			else {
-                return (this->faces.size() - this->groupIndex[group]) * 3;
+                // The faces may have been released after upload, level 0 still knows their count.
+                unsigned int faceCount = this->lods.empty() ? this->faces.size() : this->lods[0].faceCount;
+                return (faceCount - this->groupIndex[group]) * 3;
             }
         }
 
         bool LoadMesh(std::string fname);
 
+        /**
+         * \brief Optimizes the loaded mesh for the GPU.
+         *
+         * Reorders the triangles of each face group for the post-transform vertex cache (and optionally
+         * for overdraw), then reorders the vertices in the order they are fetched. Face groups and their
+         * materials are kept intact. Called by LoadMesh.
+         * \param name The name used when reporting the results.
+         */
+        void OptimizeMesh(const std::string& name);
+
+        /**
+         * \brief Enables the overdraw-aware cluster sort in OptimizeMesh.
+         *
+         * Must be set before LoadMesh is called.
+         * \param optimize true to sort triangle clusters front to back.
+         */
+        void SetOptimizeOverdraw(bool optimize) { this->optimizeOverdraw = optimize; }
+
+        /**
+         * \brief Builds a chain of simplified levels of detail from the current faces.
+         *
+         * Each level is simplified from the previous one to about half its triangles with
+         * mesh::SimplifyMesh, per face group so materials are kept. Generation stops early when a
+         * level can no longer be reduced meaningfully. Must be called before InitializeBuffers.
+         * \param levels The number of levels to add after the full resolution mesh.
+         */
+        void GenerateLODs(unsigned int levels);
+
+        /**
+         * \brief Sets the number of levels LoadMesh generates. 0 disables LOD generation.
+         *
+         * Must be set before LoadMesh is called.
+         * \param levels The number of levels to add after the full resolution mesh.
+         */
+        void SetLODLevels(unsigned int levels) { this->lodLevels = levels; }
+
+        /**
+         * \brief Returns the number of levels of detail, including the full resolution mesh.
+         */
+        unsigned int GetLODCount() const { return this->lods.size(); }
+
+        /**
+         * \brief Returns the level of detail selected by the last UpdateLOD call.
+         */
+        unsigned int GetCurrentLOD() const { return this->currentLOD; }
+
+        /**
+         * \brief Selects the level of detail with SelectLOD and remembers it for the hysteresis.
+         */
+        virtual unsigned int UpdateLOD(const glm::mat4& modelView, float projScale);
+
+        /**
+         * \brief Sets the projected error (as a fraction of the screen height) a level may have.
+         *
+         * The coarsest level whose simplification error projects below this size is drawn. Shared by
+         * all meshes. The default of 0.001 is about one pixel at 1080 lines.
+         * \param threshold The allowed projected error.
+         */
+        static void SetLODThreshold(float threshold) { GLMesh::lodThreshold = threshold; }
+
+        virtual unsigned int LastTriangleCount() const { return this->lastTriangleCount; }
+
+        /**
+         * \brief Sets which CPU side data survives InitializeBuffers.
+         *
+         * By default everything is freed once it is on the GPU. Keep RESIDENT_GEOMETRY for meshes
+         * that physics or picking read back through GetVertex/GetFace or GetMeshData.
+         * \param flags A combination of Residency flags.
+         */
+        void SetResidency(unsigned int flags) { this->residency = flags; }
+        unsigned int GetResidency() const { return this->residency; }
+
+        /**
+         * \brief Makes the mesh hide what is behind it from the occlusion culler.
+         *
+         * InitializeBuffers keeps a copy of the coarsest level of detail whose error is below
+         * OCCLUDER_ERROR of the bounding radius for the culler, moved inward along the normals by
+         * that error so it never covers more than the full mesh (see ShrinkOccluder). Suits large
+         * closed meshes (planets, walls), small or thin ones cost more than they hide.
+         * \param occluder true to rasterize the mesh into the occlusion buffer.
+         */
+        void SetOccluder(bool occluder) { this->occluder = occluder; }
+
+        virtual bool GetOccluder(OccluderGeometry& geometry) const;
+
+        // The largest simplification error of the occluder, as a fraction of the bounding radius.
+        static const float OCCLUDER_ERROR;
+
+        /**
+         * \brief Draws the mesh from a batch of static geometry, see GLStaticBatch.
+         *
+         * InitializeBuffers adds the geometry to the batch baked with the current transform, so set
+         * the transform first and never move the mesh afterwards. Submit then selects the level of
+         * detail in the batch instead of queueing packets. Meshes with shared geometry or a draw
+         * mode other than GL_TRIANGLES are not batched. Must be called before InitializeBuffers.
+         * \param batch The batch, or nullptr to draw through the render queue.
+         */
+        void SetStaticBatch(GLStaticBatch* batch) { this->staticBatch = batch; }
+
+        /**
+         * \brief Returns true if the mesh is drawn by a static batch.
+         */
+        bool IsStatic() const { return this->staticEntry >= 0; }
+
+        /**
+         * \brief Returns the shared CPU geometry kept by RESIDENT_GEOMETRY, or nullptr.
+         */
+        std::shared_ptr<const MeshData> GetMeshData() const { return this->meshData; }
+
+        /**
+         * \brief Returns the CPU geometry of a mesh file, shared with every other user of the file.
+         *
+         * Uses the copy of a resident GLMesh (or of an earlier caller) when one is alive, otherwise
+         * loads and optimizes the file once more. The data lives as long as someone holds it.
+         * \param fname The mesh file, as passed to LoadMesh.
+         * \return std::shared_ptr<const MeshData> The geometry, empty if the file could not be loaded.
+         */
+        static std::shared_ptr<const MeshData> LoadMeshData(const std::string& fname);
+
+        /**
+         * \brief Returns the total number of bytes of CPU mesh data freed after upload so far.
+         */
+        static size_t ReleasedBytes() { return GLMesh::releasedBytes; }
+
+        /**
+         * \brief Draws geometry uploaded by another mesh instead of this mesh's own verts and faces.
+         *
+         * InitializeBuffers then binds the shared vertex, normal and element buffers into this mesh's
+         * VAO without uploading them. Per instance attributes (colors, texture coordinates) are
+         * still uploaded from this mesh. Must be called before InitializeBuffers.
+         * \param geometry The geometry to draw, as returned by DetachGeometry.
+         */
+        void ShareGeometry(const SharedGeometry& geometry);
+
+        /**
+         * \brief Hands the uploaded vertex, normal and element buffers over to the caller.
+         *
+         * Call after InitializeBuffers. This mesh keeps drawing the buffers, but releases its CPU
+         * copies of the verts, normals and faces. The caller owns the buffers from now on.
+         * \return SharedGeometry The geometry to pass to ShareGeometry of other meshes.
+         */
+        SharedGeometry DetachGeometry();
+
         void ParseMTL(std::string fname);
 
         /**
@@ -95,14 +295,15 @@ namespace Sigma{
          * \return   const Vertex* The vertex at the index or nullptr if the index was invalid.
          */
         const Vertex* GetVertex(const unsigned int index) const {
-            if(index < this->verts.size()) {
-                return &this->verts[index];
+            const std::vector<Vertex>& verts = this->meshData ? this->meshData->verts : this->verts;
+            if(index < verts.size()) {
+                return &verts[index];
 			}
             return nullptr;
         }
 
 		unsigned int GetVertexCount() const {
-			return this->verts.size();
+			return this->meshData ? this->meshData->verts.size() : this->verts.size();
 		}
 
         /**
@@ -122,8 +323,9 @@ namespace Sigma{
          * \return   const Face* The face at the index or nullptr if the index was invalid.
          */
         const Face* GetFace(const unsigned int index) const {
-            if(index < this->faces.size()) {
-                return &this->faces[index];
+            const std::vector<Face>& faces = this->meshData ? this->meshData->faces : this->faces;
+            if(index < faces.size()) {
+                return &faces[index];
 			}
             return nullptr;
         }
@@ -138,7 +340,7 @@ namespace Sigma{
 
 
         unsigned int GetFaceCount() const {
-            return this->faces.size();
+            return this->meshData ? this->meshData->faces.size() : this->faces.size();
         }
 
         /**
@@ -195,6 +397,43 @@ namespace Sigma{
         static const std::string DEFAULT_SHADER;
 
     protected:
+        /**
+         * \brief Returns the sorted face indices at which a face group or material starts.
+         *
+         * Always contains 0 and the face count, so consecutive entries describe a range.
+         */
+        std::vector<unsigned int> GroupBoundaries() const;
+
+        /**
+         * \brief Rebuilds level 0 of the LOD chain from the faces and face groups.
+         */
+        void BuildBaseLOD();
+
+        /**
+         * \brief Picks the level of detail to draw, with hysteresis around the threshold.
+         *
+         * \param modelView The model view matrix of this instance.
+         * \param projScale The vertical scale of the projection matrix (proj[1][1]).
+         * \return unsigned int The selected level.
+         */
+        unsigned int SelectLOD(const glm::mat4& modelView, float projScale) const;
+
+        /**
+         * \brief Frees the CPU side data that is not flagged resident. Called by InitializeBuffers.
+         */
+        void ReleaseCPUData();
+
+        /**
+         * \brief Copies the occluder triangles out of the level of detail chain. Called by InitializeBuffers.
+         */
+        void BuildOccluder();
+
+        /**
+         * \brief Adds every level of detail to the static batch. Called by InitializeBuffers.
+         */
+        void AddToStaticBatch();
+
+
         // Note that these values are protected, not private! Inheriting classes get access to these
         //  basic drawing elements.
         std::vector<unsigned int> groupIndex; // Stores which index in faces a group starts at.
@@ -206,6 +445,32 @@ namespace Sigma{
         std::vector<TexCoord> texCoords; // The texture coords for each vertex.
         std::vector<Color> colors;
         std::map<std::string, Material> mats;
+        bool optimizeOverdraw; // Sort triangle clusters to reduce overdraw when optimizing the mesh.
+
+        std::vector<MeshLOD> lods; // The level of detail chain, lods[0] draws faces as is.
+        std::vector<Face> lodFaces; // Faces of the simplified levels, stored after faces in the element buffer.
+        unsigned int lodLevels; // The number of simplified levels LoadMesh generates.
+        unsigned int currentLOD; // The level picked by the last UpdateLOD call, Render draws RenderLOD.
+        unsigned int lastTriangleCount; // The triangles of currentLOD.
+        bool sharedGeometry; // The vertex, normal and element buffers belong to a cache, see ShareGeometry.
+        bool perInstanceAttributes; // Shared geometry with own colors or texture coordinates, never drawn instanced.
+        GLenum indexType; // Element type of the element buffer, 16 bit when every vertex index fits.
+        unsigned int indexSize; // Size in bytes of one index.
+        unsigned int uploadedVertexCount; // The number of verts in the vertex buffer.
+
+        unsigned int residency; // Residency flags, see SetResidency.
+        bool occluder; // See SetOccluder.
+        std::vector<Vertex> occluderVerts; // The vertices used by occluderIndices only.
+        std::vector<unsigned int> occluderIndices;
+        GLStaticBatch* staticBatch; // See SetStaticBatch.
+        int staticEntry; // The entry in staticBatch, -1 if the mesh is not batched.
+        std::string meshName; // The file LoadMesh read, used to share MeshData.
+        std::shared_ptr<const MeshData> meshData; // verts and faces once they are resident and shared.
+
+        static std::map<std::string, std::weak_ptr<const MeshData>> sharedMeshData; // file name --> CPU geometry
+        static size_t releasedBytes;
+
+        static float lodThreshold;
     }; // class GLMesh
 
 } // namespace Sigma
@@ -28,6 +28,11 @@ public:
 
 	DLL_EXPORT void SetTexture(resource::GLTexture* texture);
 
+	/**
+	 * \brief Fills the quad GLSpriteBatch draws in place of Render, from the current position and size.
+	 */
+	void GetSpriteQuad(SpriteQuad& quad) const;
+
 	int NearestPowerOf2(const float width, const float height) const {
 		unsigned int power = 0;
 		unsigned int dim = 1;
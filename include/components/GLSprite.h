@@ -20,19 +20,24 @@ namespace Sigma{
 		/**
 		 * \brief Initializes the sprite.
 		 *
-		 * Registers with the current OpenGL context, allocates space, etc..
+		 * Sprites have no buffers of their own, their quads are drawn by GLSpriteBatch.
 		 */
         void InitializeBuffers();
 
         /**
-         * \brief Renders a GLSprite.
-         *
+         * \brief Does nothing, the quad is added to the frame by Submit.
          *
          * \param[in/out] glm::mediump_float * view The current view matrix.
          * \param[in/out] glm::mediump_float * proj The current projection matrix.
-         * \exception
          */
-        virtual void Render(glm::mediump_float *view, glm::mediump_float *proj);
+        virtual void Render(glm::mediump_float* /*view*/, glm::mediump_float* /*proj*/) {}
+
+        /**
+         * \brief Adds the quad, from -1 to 1 in x and y of the transform, to the sprites of the frame.
+         *
+         * Sprites are drawn unlit, in the unlit pass, whatever the pass asked for.
+         */
+        virtual void Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj);
 
 		/**
 		 * \brief Set the GLTexture resource
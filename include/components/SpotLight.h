@@ -25,10 +25,19 @@ namespace Sigma {
 		float outerAngle;
 		float cosInnerAngle;
 		float cosOuterAngle;
+		float range; // Distance past which the light is ignored by the clustered lighting pass.
 
 		bool enabled;
 
 		bool IsEnabled() { return enabled; }
+
+		/**
+		 * \brief Computes the smallest sphere holding the cone lit by the light.
+		 *
+		 * \param center Receives the world space center.
+		 * \param radius Receives the radius.
+		 */
+		void BoundingSphere(glm::vec3& center, float& radius);
 	};
 }
 #endif
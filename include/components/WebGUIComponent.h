@@ -7,12 +7,15 @@
 #include "resources/GLTexture.h"
 #include "Sigma.h"
 
+#include <vector>
+#include <mutex>
+
 namespace Sigma {
 	class WebGUIView : public Sigma::IComponent, public CefClient, public CefLifeSpanHandler, public CefRenderHandler {
 	public:
 		SET_COMPONENT_TYPENAME("WebGUIView");
-		WebGUIView() : texture(nullptr), entity_id(0), mouseDown(0) { }
-		WebGUIView(const id_t entityID) : texture(nullptr), entity_id(entityID), mouseDown(0) { };
+		WebGUIView() : texture(nullptr), entity_id(0), mouseDown(0), paintWidth(0), paintHeight(0), paintPending(false) { }
+		WebGUIView(const id_t entityID) : texture(nullptr), entity_id(entityID), mouseDown(0), paintWidth(0), paintHeight(0), paintPending(false) { };
 		virtual ~WebGUIView() {
 			this->browserHost->ParentWindowWillClose();
 			this->browserHost->CloseBrowser(true);
@@ -72,9 +75,32 @@ namespace Sigma {
 			return true;
 		}
 
+		/**
+		 * \brief Copies the painted page, the texture is updated by UploadPaint.
+		 *
+		 * The GL context may be owned by the render thread, so no GL call is made here.
+		 */
 		virtual void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList& dirtyRects, const void *buffer, int width, int height) OVERRIDE {
 			if (this->texture) {
-				this->texture->LoadDataFromMemory((const unsigned char*) buffer, width, height);
+				const unsigned char* pixels = static_cast<const unsigned char*>(buffer);
+				std::lock_guard<std::mutex> lock(this->paintMutex);
+				this->paintBuffer.assign(pixels, pixels + width * height * 4);
+				this->paintWidth = width;
+				this->paintHeight = height;
+				this->paintPending = true;
+			}
+		}
+
+		/**
+		 * \brief Uploads the last painted page to the texture, if there is a new one.
+		 *
+		 * Call on the thread owning the GL context.
+		 */
+		void UploadPaint() {
+			std::lock_guard<std::mutex> lock(this->paintMutex);
+			if (this->paintPending) {
+				this->texture->LoadDataFromMemory(&this->paintBuffer[0], this->paintWidth, this->paintHeight);
+				this->paintPending = false;
 			}
 		}
 	private:
@@ -88,6 +114,11 @@ namespace Sigma {
 		unsigned int windowWidth; // The width of the window
 		unsigned int windowHeight; // The height of the window
 
+		std::mutex paintMutex; // Guards the painted page, OnPaint and UploadPaint may run on different threads.
+		std::vector<unsigned char> paintBuffer; // BGRA pixels of the last painted page.
+		int paintWidth, paintHeight;
+		bool paintPending;
+
 		const id_t entity_id;
 
 		IMPLEMENT_REFCOUNTING(WebGUIView);
@@ -9,6 +9,7 @@
 #include <cassert>
 
 #include "SOIL/SOIL.h"
+#include "systems/GLState.h"
 
 namespace Sigma {
 	namespace resource {
@@ -43,11 +44,11 @@ namespace Sigma {
 				this->width = width;
 				this->height = height;
 
-				glBindTexture(GL_TEXTURE_2D, this->id);
+				GLState::BindTexture(GL_TEXTURE_2D, this->id);
 				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->mag_filter);
 				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->min_filter);
 				glTexImage2D(GL_TEXTURE_2D, 0, this->int_format, this->width, this->height, 0, this->format, GL_UNSIGNED_BYTE, NULL);
-				glBindTexture(GL_TEXTURE_2D, 0);
+				GLState::BindTexture(GL_TEXTURE_2D, 0);
 			}
 
 			/**
@@ -64,7 +65,7 @@ namespace Sigma {
 				this->width = width;
 				this->height = height;
 
-				glBindTexture(GL_TEXTURE_2D, this->id);
+				GLState::BindTexture(GL_TEXTURE_2D, this->id);
 
 				glTexImage2D(GL_TEXTURE_2D, 0, this->int_format , this->width, this->height, 0, this->format, this->type, data);
 
@@ -79,7 +80,7 @@ namespace Sigma {
 				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->mag_filter);
 				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->min_filter);
 
-				glBindTexture(GL_TEXTURE_2D, 0);
+				GLState::BindTexture(GL_TEXTURE_2D, 0);
 			}
 
 			/**
@@ -92,11 +93,11 @@ namespace Sigma {
 				if (id != 0) {
 					assert (this->width > 0 && this->height > 0);
 
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexSubImage2D(	GL_TEXTURE_2D, 0,
 										0, 0, this->width, this->height, 
 										this->format, this->type, data);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -172,9 +173,9 @@ namespace Sigma {
 			void WrapS(GLint val) {
 				wrap_s = val;
 				if (id != 0) {
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -183,9 +184,9 @@ namespace Sigma {
 			void WrapT(GLint val) {
 				wrap_t = val;
 				if (id != 0) {
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -194,9 +195,9 @@ namespace Sigma {
 			void WrapR(GLint val) {
 				wrap_r = val;
 				if (id != 0) {
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, wrap_r);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -215,9 +216,9 @@ namespace Sigma {
 			void MagFilter(GLint val) {
 				mag_filter = val; 
 				if (id != 0) {
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -226,9 +227,9 @@ namespace Sigma {
 			void MinFilter(GLint val) {
 				min_filter = val;
 				if (id != 0) {
-					glBindTexture(GL_TEXTURE_2D, this->id);
+					GLState::BindTexture(GL_TEXTURE_2D, this->id);
 					glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-					glBindTexture(GL_TEXTURE_2D, 0);
+					GLState::BindTexture(GL_TEXTURE_2D, 0);
 				}
 			}
 
@@ -0,0 +1,162 @@
+#pragma once
+#ifndef DRAWLISTBUILDER_H
+#define DRAWLISTBUILDER_H
+
+#include "systems/RenderQueue.h"
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Sigma {
+	class IGLComponent;
+
+	/**
+	 * \brief Fills a render queue with the draws of many components on worker threads, and sorts it.
+	 *
+	 * The components are split in contiguous ranges, each thread calls IGLComponent::Submit on its
+	 * range into its own queue of plain data packets. The sizes of the queues are then summed up so
+	 * each thread copies its queue to its own slice of the target queue, in range order, so the
+	 * packets end up in the same order as a single threaded build and sort the same way. Sort runs
+	 * the passes of RadixSort with every thread counting and moving a slice of the entries. The
+	 * worker threads are started by the first parallel Build or Sort and then wait for the next
+	 * one, they are stopped when the thread count changes or the builder is destroyed.
+	 *
+	 * Submit runs concurrently for different components, it must only change the component it
+	 * is called on. The transforms must be up to date (GLTransform::GetMatrix called since their
+	 * last change, as OpenGLSystem::UpdateSceneIndex does) so reading them writes nothing.
+	 */
+	class DrawListBuilder {
+	public:
+		// Below this many components the cost of waking the workers outweighs the gain.
+		static const size_t PARALLEL_THRESHOLD = 2048;
+		// Below this many packets Sort runs on the calling thread.
+		static const size_t PARALLEL_SORT_THRESHOLD = 16384;
+
+		DrawListBuilder();
+		~DrawListBuilder();
+
+		/**
+		 * \brief Sets the number of threads Build may use for large lists.
+		 *
+		 * \param count The number of threads, 0 uses one per hardware thread, 1 never starts threads.
+		 */
+		void SetThreadCount(unsigned int count) { this->threadCount = count; }
+
+		/**
+		 * \brief Submits components to a queue, the queue is not sorted.
+		 *
+		 * Lit components are submitted to PASS_GBUFFER, the others to PASS_UNLIT.
+		 * \param components The components to submit.
+		 * \param count The number of components.
+		 * \param queue The queue receiving the packets, after the ones it already has.
+		 * \param view The view matrix.
+		 * \param proj The projection matrix.
+		 * \return size_t The number of threads used.
+		 */
+		size_t Build(IGLComponent* const* components, size_t count, RenderQueue& queue, const glm::mat4& view, const glm::mat4& proj);
+
+		/**
+		 * \brief Sorts the packets of a queue by key, like RenderQueue::Sort.
+		 *
+		 * \param queue The queue to sort.
+		 * \return size_t The number of threads used.
+		 */
+		size_t Sort(RenderQueue& queue);
+	private:
+		DrawListBuilder(const DrawListBuilder&);
+		DrawListBuilder& operator=(const DrawListBuilder&);
+
+		// The work of a Build or a Sort, run by the calling thread (participant 0) and every worker.
+		struct Job {
+			bool sort; // Sort queue, otherwise submit the components to it.
+			unsigned int parts; // The number of participants.
+			RenderQueue* queue;
+			IGLComponent* const* components; // Split in ranges of chunk components, participant i takes range i.
+			size_t count;
+			size_t chunk;
+			const glm::mat4* view;
+			const glm::mat4* proj;
+		};
+
+		// Submits components [first, last) to queue.
+		static void SubmitRange(IGLComponent* const* components, size_t first, size_t last, RenderQueue& queue, const glm::mat4& view, const glm::mat4& proj);
+
+		/**
+		 * \brief Returns the number of threads to use, see SetThreadCount.
+		 */
+		unsigned int Threads() const;
+
+		/**
+		 * \brief Starts or stops workers so count threads take part in the next job.
+		 */
+		void UseThreads(unsigned int count);
+
+		/**
+		 * \brief Hands a job to the workers, the calling thread then runs its part and calls WaitForWorkers.
+		 */
+		void PostJob(const Job& job);
+
+		/**
+		 * \brief Waits for every worker to finish its part of the job.
+		 */
+		void WaitForWorkers();
+
+		/**
+		 * \brief Submits the range of a participant, then copies its queue to the target queue.
+		 */
+		void BuildPart(const Job& job, unsigned int participant);
+
+		/**
+		 * \brief Runs the radix sort passes on the slice of a participant.
+		 *
+		 * \return bool true when the sorted entries ended up in the scratch space of the queue.
+		 */
+		bool SortPart(const Job& job, unsigned int participant);
+
+		/**
+		 * \brief Waits for every participant of the job to reach this point.
+		 */
+		void Barrier();
+
+		/**
+		 * \brief Starts count worker threads, with a queue each.
+		 */
+		void StartWorkers(unsigned int count);
+
+		/**
+		 * \brief Wakes the workers up to return and joins them.
+		 */
+		void StopWorkers();
+
+		/**
+		 * \brief Waits for jobs and runs the part of the worker until stopped.
+		 *
+		 * \param index The index of the worker, it is participant index + 1.
+		 * \param generation The jobGeneration when the worker was started, the next job is the first it takes.
+		 */
+		void WorkerLoop(unsigned int index, unsigned int generation);
+
+		unsigned int threadCount;
+		std::vector<std::unique_ptr<RenderQueue>> queues; // Queue i + 1 belongs to worker i, reused between frames.
+		std::vector<RenderQueueOffsets> partOffsets; // Where the queue of each participant goes in the target queue.
+		std::vector<size_t> sortCounts; // The RadixCount of each participant for the current pass.
+		std::vector<std::thread> workers;
+		std::mutex jobMutex; // Guards the members below.
+		std::condition_variable jobReady; // Notified when a job is posted or the workers are stopped.
+		std::condition_variable jobDone; // Notified when the last worker finishes its range.
+		Job job;
+		unsigned int jobGeneration; // Incremented for every job posted.
+		unsigned int jobPending; // Workers still running their part of the job.
+		std::condition_variable barrierDone; // Notified when the last participant reaches a Barrier.
+		unsigned int barrierArrived; // Participants waiting at the current Barrier.
+		unsigned int barrierGeneration; // Incremented every time every participant reached a Barrier.
+		bool stopping;
+	}; // class DrawListBuilder
+} // namespace Sigma
+
+#endif // DRAWLISTBUILDER_H
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef GLGPUTIMER_H
+#define GLGPUTIMER_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include "GL/glew.h"
+#endif
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace Sigma {
+	/**
+	 * \brief Times render passes on the GPU and adds them to the Profiler timeline.
+	 *
+	 * Begin and End put a GL_TIMESTAMP query on each side of a pass, so passes can nest, unlike
+	 * GL_TIME_ELAPSED queries. The queries of a frame are read back LATENCY frames later, when the
+	 * GPU is done with them, so reading never stalls the pipeline; a frame whose queries are still
+	 * pending then is dropped. GPU timestamps are mapped to the profiler clock with glGetInteger64v
+	 * (GL_TIMESTAMP), recalibrated every CALIBRATION_FRAMES frames.
+	 *
+	 * Needs GL 3.3 or ARB_timer_query, which Mesa llvmpipe has. Every method must be called on the
+	 * thread owning the context, and does nothing while the Profiler is disabled.
+	 */
+	class GLGPUTimer {
+	public:
+		static const unsigned int LATENCY = 4;
+		static const unsigned int CALIBRATION_FRAMES = 600;
+
+		GLGPUTimer();
+		~GLGPUTimer();
+
+		/**
+		 * \brief Checks for timer query support.
+		 *
+		 * \return bool False if timer queries are not supported, every call then does nothing.
+		 */
+		bool Create();
+
+		/**
+		 * \brief Deletes the queries.
+		 */
+		void Destroy();
+
+		/**
+		 * \brief Reads back the frame recorded LATENCY frames ago and starts recording a new one.
+		 */
+		void BeginFrame();
+
+		/**
+		 * \brief Starts timing a pass.
+		 *
+		 * \param name A string literal naming the pass, the GPU track of the profiler shows it.
+		 */
+		void Begin(const char* name);
+
+		/**
+		 * \brief Ends the pass started by the last unmatched Begin.
+		 */
+		void End();
+
+		bool IsSupported() const { return this->supported; }
+
+		/**
+		 * \brief Returns the number of frames dropped because their queries were not ready in time.
+		 */
+		unsigned int DroppedFrames() const { return this->droppedFrames; }
+	private:
+		GLGPUTimer(const GLGPUTimer&);
+		GLGPUTimer& operator=(const GLGPUTimer&);
+
+		// A pass of a recorded frame, its queries are queries[2 * i] and queries[2 * i + 1].
+		struct Pass {
+			const char* name;
+		};
+
+		struct Frame {
+			Frame() : used(0), frame(0) {}
+			std::vector<GLuint> queries; // Begin and end timestamp of each pass, created on demand.
+			std::vector<Pass> passes;
+			size_t used; // Passes recorded.
+			uint64_t frame; // The profiler frame.
+		};
+
+		/**
+		 * \brief Adds the passes of a frame to the profiler if its queries are done.
+		 */
+		void Collect(Frame& frame);
+
+		/**
+		 * \brief Samples the GPU and CPU clocks together.
+		 */
+		void Calibrate();
+
+		bool supported;
+		Frame frames[LATENCY];
+		unsigned int current; // The frame being recorded.
+		bool recording; // BeginFrame was called while the profiler was enabled.
+		std::vector<size_t> open; // The passes begun and not ended yet.
+		unsigned int framesSinceCalibration;
+		int64_t gpuReference; // Nanoseconds, sampled at the same time as cpuReference.
+		double cpuReference; // Profiler microseconds.
+		unsigned int droppedFrames;
+	}; // class GLGPUTimer
+} // namespace Sigma
+
+#endif // GLGPUTIMER_H
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef GLIMPOSTORATLAS_H
+#define GLIMPOSTORATLAS_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include "GL/glew.h"
+#endif
+
+#include "systems/GLSLShader.h"
+
+namespace Sigma {
+	/**
+	 * \brief The textures the impostors of distant objects are drawn into and sampled from.
+	 *
+	 * An RGBA8 albedo and an RGBA8 normal texture with a depth buffer, laid out like the classic
+	 * GBuffer so the deferred shaders of the captured components write them unchanged. Texels no
+	 * capture covered have a zero albedo alpha. The cells are handed out by ImpostorCache.
+	 */
+	class GLImpostorAtlas {
+	public:
+		GLImpostorAtlas();
+		~GLImpostorAtlas();
+
+		/**
+		 * \brief Creates the textures, the framebuffer and the shader. Call once the context is current.
+		 *
+		 * \param size The width and height of the atlas in pixels.
+		 * \return bool False if the framebuffer is incomplete, the atlas is then destroyed.
+		 */
+		bool Create(unsigned int size);
+
+		/**
+		 * \brief Deletes the textures, the depth buffer and the framebuffer.
+		 */
+		void Destroy();
+
+		/**
+		 * \brief Binds the framebuffer for drawing into a cell and clears the cell.
+		 *
+		 * Sets the viewport and leaves depth testing and writing enabled, the caller binds the
+		 * previous framebuffer and viewport back.
+		 * \param x, y The lower left corner of the cell, see ImpostorCache::CellOrigin.
+		 * \param size The width and height of the cell.
+		 */
+		void BeginCapture(unsigned int x, unsigned int y, unsigned int size);
+
+		/**
+		 * \brief Returns the shader drawing lit impostors into the GBuffer.
+		 *
+		 * Reads in_ViewProj like the sprite batch shader, the albedo on texture unit 0 and the
+		 * normals on unit 1, see GLSpriteBatch::Draw.
+		 */
+		GLSLShader& GetShader() { return this->shader; }
+
+		GLuint Albedo() const { return this->textures[0]; }
+		GLuint Normal() const { return this->textures[1]; }
+		bool IsCreated() const { return this->framebuffer != 0; }
+	private:
+		GLImpostorAtlas(const GLImpostorAtlas&);
+		GLImpostorAtlas& operator=(const GLImpostorAtlas&);
+
+		GLSLShader shader;
+		GLuint textures[2]; // Albedo then normals.
+		GLuint depthBuffer;
+		GLuint framebuffer;
+	}; // class GLImpostorAtlas
+} // namespace Sigma
+
+#endif // GLIMPOSTORATLAS_H
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef GLRINGBUFFER_H
+#define GLRINGBUFFER_H
+
+#ifndef __APPLE__
+#include "GL/glew.h"
+#endif
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	/**
+	 * \brief A buffer for the dynamic data of a frame, split in FRAMES regions used in turn.
+	 *
+	 * With ARB_buffer_storage the whole buffer is mapped once, persistent and coherent, and the
+	 * data is written straight into it. BeginFrame waits on the fence of the region it reuses,
+	 * so the GPU is never reading what is written and the driver never has to synchronize.
+	 * Without it, the data goes to a copy in memory that Flush uploads into storage orphaned by
+	 * BeginFrame.
+	 *
+	 * Allocate is lock free and may be called from any thread between BeginFrame and EndFrame,
+	 * the other methods make GL calls and must be called on the thread owning the context.
+	 */
+	class GLRingBuffer {
+	public:
+		static const unsigned int FRAMES = 3;
+
+		GLRingBuffer();
+		~GLRingBuffer();
+
+		/**
+		 * \brief Creates the buffer.
+		 *
+		 * \param frameSize The bytes available to each frame.
+		 * \return bool False if the buffer could not be created.
+		 */
+		bool Create(size_t frameSize);
+
+		/**
+		 * \brief Releases the buffer, the mapping and the fences.
+		 */
+		void Destroy();
+
+		/**
+		 * \brief Starts the allocations of a new frame in the next region.
+		 *
+		 * Waits for the GPU to be done with the frame that used the region last.
+		 */
+		void BeginFrame();
+
+		/**
+		 * \brief Ends the allocations of the frame, call after its last draw.
+		 */
+		void EndFrame();
+
+		/**
+		 * \brief Reserves memory in the current frame.
+		 *
+		 * \param size The number of bytes.
+		 * \param alignment The alignment of the offset in the buffer, a power of two.
+		 * \param offset Receives the offset of the memory in Buffer, to bind it.
+		 * \return void* Where to write the data, nullptr when the frame is full.
+		 */
+		void* Allocate(size_t size, size_t alignment, size_t& offset);
+
+		/**
+		 * \brief Makes the data written since the last call visible to the GPU.
+		 *
+		 * Does nothing with a persistent mapping. Call before drawing with the data.
+		 */
+		void Flush();
+
+		GLuint Buffer() const { return this->buffer; }
+
+		/**
+		 * \brief Returns true when the buffer is persistently mapped.
+		 */
+		bool IsPersistent() const { return this->persistent; }
+
+		/**
+		 * \brief Returns the bytes allocated in the current frame.
+		 */
+		size_t Used() const { return this->head.load(); }
+	private:
+		GLRingBuffer(const GLRingBuffer&);
+		GLRingBuffer& operator=(const GLRingBuffer&);
+
+		GLuint buffer;
+		size_t frameSize;
+		unsigned int frame; // The region being written.
+		bool persistent;
+		bool fenced; // Sync objects are available.
+		unsigned char* mapped; // The persistent mapping of every region.
+		std::vector<unsigned char> staging; // The data of the frame without persistent mapping.
+		size_t flushed; // Bytes of the frame already uploaded by Flush.
+		std::atomic<size_t> head; // Bytes allocated in the current frame.
+		GLsync fences[FRAMES];
+	}; // class GLRingBuffer
+} // namespace Sigma
+
+#endif // GLRINGBUFFER_H
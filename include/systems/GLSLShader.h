@@ -14,6 +14,22 @@
 class GLSLShader
 {
 public:
+	// Vertex attribute locations bound before linking, so a VAO set up for one program works with every other.
+	enum AttributeLocation {
+		ATTRIB_POSITION = 0, // in_Position
+		ATTRIB_NORMAL = 1, // in_Normal
+		ATTRIB_UV = 2, // in_UV
+		ATTRIB_COLOR = 3, // in_Color
+		ATTRIB_INSTANCE_MODEL = 4, // in_InstanceModel, a mat4 taking locations 4 to 7
+		ATTRIB_INSTANCE_COLOR = 8 // in_InstanceColor
+	};
+
+	// Uniform buffer binding points of the uniform blocks every program may declare.
+	enum BlockBinding {
+		BLOCK_FRAME = 0, // FrameData, updated once per frame by OpenGLSystem
+		BLOCK_MATERIAL = 1 // MaterialData, one buffer per mesh material
+	};
+
 	GLSLShader(void);
 	~GLSLShader(void);
 	void LoadFromString(GLenum whichShader, const std::string source);
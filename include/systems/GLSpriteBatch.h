@@ -0,0 +1,118 @@
+#pragma once
+#ifndef GLSPRITEBATCH_H
+#define GLSPRITEBATCH_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include "GL/glew.h"
+#endif
+#include "glm/glm.hpp"
+
+#include "systems/GLSLShader.h"
+#include "systems/RenderQueue.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace Sigma {
+	class GLRingBuffer;
+
+	// Counters of the quads drawn since the last ResetCounters.
+	struct SpriteBatchCounters {
+		SpriteBatchCounters() : draws(0), quads(0) {}
+		unsigned int draws;
+		unsigned int quads;
+	};
+
+	/**
+	 * \brief Draws textured quads, sprites and screen overlays, with one draw per texture run.
+	 *
+	 * The quads of a Draw are written into one vertex buffer, streamed through the frame's ring
+	 * buffer when it has room, and drawn with a shared index buffer, so a quad costs 4 vertices
+	 * instead of a VAO, buffers and a draw call of its own. World space quads are sorted by
+	 * texture. Screen space quads keep their painter's order: a quad only joins an earlier draw of
+	 * its texture when it overlaps nothing drawn in between.
+	 */
+	class GLSpriteBatch {
+	public:
+		GLSpriteBatch();
+		~GLSpriteBatch();
+
+		/**
+		 * \brief Loads the shader and creates the vertex array. Call once the context is current.
+		 */
+		void Create();
+
+		/**
+		 * \brief Deletes the buffers, the vertex array and the white texture.
+		 */
+		void Destroy();
+
+		/**
+		 * \brief Sets the buffer the vertices are written to.
+		 *
+		 * The buffer must be between GLRingBuffer::BeginFrame and EndFrame when Draw is called.
+		 * When it is full, or not set, the vertices go to a buffer of the batch orphaned every Draw.
+		 * \param buffer The ring buffer, or nullptr.
+		 */
+		void SetStreamBuffer(GLRingBuffer* buffer) { this->streamBuffer = buffer; }
+
+		/**
+		 * \brief Draws quads.
+		 *
+		 * Blending and depth state are left to the caller. Leaves face culling set to GL_BACK.
+		 * \param quads The quads, in the order they were submitted.
+		 * \param viewProj Transforms the corners to clip space, identity for screen space quads.
+		 * \param keepOrder True if overlapping quads must be drawn in the given order.
+		 * \param shader Draws the quads instead of the sprite shader, it must have an in_ViewProj
+		 * uniform and sample the quad textures on texture unit 0. Other units are left to the caller.
+		 */
+		void Draw(const std::vector<SpriteQuad>& quads, const glm::mat4& viewProj, bool keepOrder, GLSLShader* shader = nullptr);
+
+		void ResetCounters() { this->counters = SpriteBatchCounters(); }
+
+		const SpriteBatchCounters& GetCounters() const { return this->counters; }
+	private:
+		GLSpriteBatch(const GLSpriteBatch&);
+		GLSpriteBatch& operator=(const GLSpriteBatch&);
+
+		struct SpriteVertex {
+			float position[3];
+			float uv[2];
+			unsigned char color[4];
+		};
+
+		// Quads drawn by one draw call, positions in order.
+		struct Run {
+			GLuint texture;
+			size_t first;
+			size_t count;
+		};
+
+		/**
+		 * \brief Fills order and runs with the draw order of quads.
+		 */
+		void Order(const std::vector<SpriteQuad>& quads, bool keepOrder);
+
+		/**
+		 * \brief Grows the index buffer to hold the indices of count quads.
+		 */
+		void ReserveIndices(size_t count);
+
+		GLSLShader shader;
+		GLuint vao;
+		GLuint indexBuffer;
+		size_t indexCapacity; // In quads.
+		GLuint vertexBuffer; // Used when the ring buffer is full.
+		size_t vertexCapacity; // In bytes.
+		GLuint whiteTexture; // Bound for untextured quads.
+		GLRingBuffer* streamBuffer;
+		std::vector<unsigned int> order; // Indices of the quads of a Draw, in draw order.
+		std::vector<Run> runs;
+		std::vector<SpriteVertex> staging; // The vertices when they do not go to the ring buffer.
+		SpriteBatchCounters counters;
+	}; // class GLSpriteBatch
+} // namespace Sigma
+
+#endif // GLSPRITEBATCH_H
@@ -0,0 +1,163 @@
+#pragma once
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include "GL/glew.h"
+#endif
+
+#include <stdint.h>
+
+namespace Sigma {
+	// Counters of the state calls made through GLState since the last ResetCounters.
+	struct GLStateCounters {
+		GLStateCounters() : issued(0), redundant(0), programs(0), vertexArrays(0), textures(0), uniforms(0), uploadedBytes(0) {}
+		unsigned int issued; // Calls passed on to the driver.
+		unsigned int redundant; // Calls skipped because the state was already set.
+		unsigned int programs; // Issued glUseProgram calls, also counted in issued.
+		unsigned int vertexArrays; // Issued glBindVertexArray calls.
+		unsigned int textures; // Issued glBindTexture calls.
+		unsigned int uniforms; // Uniform values set, see CountUniform.
+		uint64_t uploadedBytes; // See CountUpload.
+	};
+
+	/**
+	 * \brief Shadows the GL state that changes between draws and skips calls that would not change it.
+	 *
+	 * Every Sigma renderer sets program, VAO, texture, face culling, depth and blend state through
+	 * here instead of calling GL directly, otherwise the shadow copy goes stale. Code outside of
+	 * Sigma that changes the state behind our back must be followed by a call to Invalidate.
+	 * The state starts out unknown, so the first call of each kind is always issued.
+	 */
+	class GLState {
+	public:
+		static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+		/**
+		 * \brief glUseProgram.
+		 */
+		static void UseProgram(GLuint program);
+
+		/**
+		 * \brief glBindVertexArray.
+		 */
+		static void BindVertexArray(GLuint vao);
+
+		/**
+		 * \brief glActiveTexture.
+		 *
+		 * \param unit The unit enum, GL_TEXTURE0 + i.
+		 */
+		static void ActiveTexture(GLenum unit);
+
+		/**
+		 * \brief glBindTexture on the active texture unit.
+		 *
+		 * GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP are tracked per unit, other targets are always issued.
+		 * \param target The texture target.
+		 * \param texture The texture name, 0 to unbind.
+		 */
+		static void BindTexture(GLenum target, GLuint texture);
+
+		/**
+		 * \brief Sets face culling.
+		 *
+		 * \param face GL_BACK, GL_FRONT or GL_FRONT_AND_BACK, 0 disables GL_CULL_FACE.
+		 */
+		static void SetCullFace(GLenum face);
+
+		/**
+		 * \brief Enables or disables GL_DEPTH_TEST.
+		 */
+		static void SetDepthTest(bool enabled);
+
+		/**
+		 * \brief glDepthMask.
+		 */
+		static void SetDepthMask(bool write);
+
+		/**
+		 * \brief glDepthFunc.
+		 */
+		static void SetDepthFunc(GLenum func);
+
+		/**
+		 * \brief Enables or disables GL_SCISSOR_TEST.
+		 */
+		static void SetScissorTest(bool enabled);
+
+		/**
+		 * \brief Enables or disables GL_BLEND.
+		 */
+		static void SetBlend(bool enabled);
+
+		/**
+		 * \brief glBlendFunc.
+		 */
+		static void SetBlendFunc(GLenum source, GLenum destination);
+
+		/**
+		 * \brief Forgets the shadowed state, the next call of each kind is issued.
+		 *
+		 * Also call it when a bound program, VAO or texture gets deleted, since GL then
+		 * binds 0 without telling us.
+		 */
+		static void Invalidate();
+
+		/**
+		 * \brief Counts a uniform value set, called by GLSLShader for every uniform location looked up.
+		 */
+		static void CountUniform() { counters.uniforms++; }
+
+		/**
+		 * \brief Counts buffer data sent to the driver with glBufferData or glBufferSubData.
+		 *
+		 * Called by the renderers for the data they upload every frame, the ring buffer keeps its own count.
+		 * \param bytes The size of the data.
+		 */
+		static void CountUpload(uint64_t bytes) { counters.uploadedBytes += bytes; }
+
+		/**
+		 * \brief Returns the counters since the last ResetCounters.
+		 */
+		static const GLStateCounters& GetCounters() { return counters; }
+
+		/**
+		 * \brief Zeroes the counters, called once per frame by OpenGLSystem.
+		 */
+		static void ResetCounters() { counters = GLStateCounters(); }
+	private:
+		// Counts the call and returns true if it has to be issued, updating the shadow copy.
+		template<typename T>
+		static bool Changed(T& current, T value) {
+			if (current == value) {
+				counters.redundant++;
+				return false;
+			}
+			current = value;
+			counters.issued++;
+			return true;
+		}
+
+		// The states below hold UNKNOWN until set.
+		static const GLuint UNKNOWN = ~0u;
+		static GLuint program;
+		static GLuint vao;
+		static GLuint activeUnit; // Index, not the GL_TEXTUREi enum.
+		static GLuint textures2D[MAX_TEXTURE_UNITS];
+		static GLuint texturesCube[MAX_TEXTURE_UNITS];
+		static GLuint cullFace;
+		static GLuint depthTest;
+		static GLuint depthMask;
+		static GLuint depthFunc;
+		static GLuint scissorTest;
+		static GLuint blend;
+		static GLuint blendSource;
+		static GLuint blendDestination;
+		static GLStateCounters counters;
+	}; // class GLState
+} // namespace Sigma
+
+#endif // GLSTATE_H
@@ -0,0 +1,233 @@
+#pragma once
+#ifndef GLSTATICBATCH_H
+#define GLSTATICBATCH_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include "GL/glew.h"
+#endif
+#include "glm/glm.hpp"
+
+#include "IGLComponent.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+class GLSLShader;
+
+namespace Sigma {
+	// A run of indices of a static mesh drawn with one material at one level of detail.
+	struct StaticRange {
+		unsigned int lod;
+		unsigned int firstIndex; // Into StaticGeometry::indices.
+		unsigned int count;
+		const Material* material; // Copied by GLStaticBatch::Add, nullptr draws without textures.
+	};
+
+	// Model space geometry of a static mesh, see GLStaticBatch::Add. Attribute arrays have vertexCount entries.
+	struct StaticGeometry {
+		StaticGeometry() : positions(nullptr), normals(nullptr), texCoords(nullptr), colors(nullptr), vertexCount(0), indices(nullptr), indexCount(0) {}
+		const Vertex* positions;
+		const Vertex* normals; // nullptr if the mesh has none, the same for the other attributes.
+		const TexCoord* texCoords;
+		const Color* colors;
+		size_t vertexCount;
+		const unsigned int* indices; // Triangles of every level of detail.
+		size_t indexCount;
+		std::vector<StaticRange> ranges;
+	};
+
+	// Counters of the last frame drawn by a GLStaticBatch.
+	struct StaticBatchCounters {
+		StaticBatchCounters() : draws(0), commands(0), triangles(0), patched(0) {}
+		unsigned int draws; // Multi draw calls.
+		unsigned int commands; // Visible ranges drawn by them.
+		unsigned int triangles;
+		unsigned int patched; // Commands rewritten because a mesh was hidden, shown or changed level of detail.
+	};
+
+	/**
+	 * \brief Draws meshes that never move from shared vertex and index pools with multi draws.
+	 *
+	 * Add bakes the vertices of a mesh into world space and appends them to the pools, so every
+	 * mesh of the batch draws with the same VAO and an identity model matrix. Each range of a mesh
+	 * owns one DrawElementsIndirectCommand, grouped by shader, material and face culling, and each
+	 * group is drawn with a single glMultiDrawElementsIndirect (GL 4.3 or ARB_multi_draw_indirect),
+	 * or a glMultiDrawElements of its visible ranges without it.
+	 *
+	 * The command buffer is laid out once when meshes are added. Every frame the meshes selected
+	 * on the simulation thread are compared with the previous frame and only the commands that
+	 * changed, hidden ones get an instance count of 0, are uploaded again.
+	 *
+	 * Moving a mesh after it is added has no effect on the batch, and the pool space of a deleted
+	 * mesh is not reclaimed: meant for stations and planets that live as long as the scene.
+	 */
+	class GLStaticBatch {
+	public:
+		GLStaticBatch();
+		~GLStaticBatch();
+
+		/**
+		 * \brief Checks for multi draw indirect support. Call once the context is current.
+		 *
+		 * \return bool False if the batch draws with glMultiDrawElements.
+		 */
+		bool Create();
+
+		/**
+		 * \brief Deletes the pools and vertex arrays.
+		 */
+		void Destroy();
+
+		/**
+		 * \brief Adds a mesh, its geometry is copied and uploaded by the next Update.
+		 *
+		 * \param shader The shader of the mesh, drawn without instancing.
+		 * \param model The model matrix the vertices are baked with.
+		 * \param cullFace The face culling of the mesh, 0 for none.
+		 * \param pass The RenderPass the mesh is drawn in.
+		 * \param geometry The model space triangles, at least one range.
+		 * \return int The entry to pass to Select, -1 if the geometry is empty.
+		 */
+		int Add(const std::shared_ptr<GLSLShader>& shader, const glm::mat4& model, GLuint cullFace, unsigned int pass, const StaticGeometry& geometry);
+
+		/**
+		 * \brief Hides every mesh of the batch. Call on the simulation thread before submitting a frame.
+		 */
+		void BeginFrame();
+
+		/**
+		 * \brief Shows a mesh in the frame being submitted.
+		 *
+		 * Several threads may select different entries at once.
+		 * \param entry The entry returned by Add.
+		 * \param lod The level of detail to draw.
+		 */
+		void Select(int entry, unsigned int lod) { this->selection[entry] = lod + 1; }
+
+		/**
+		 * \brief Returns the level of detail plus one of each entry in the frame being submitted, 0 if hidden.
+		 */
+		const std::vector<unsigned int>& Selection() const { return this->selection; }
+
+		/**
+		 * \brief Uploads the added meshes and patches the commands that differ from the last frame.
+		 *
+		 * Call on the thread owning the context before Draw.
+		 * \param selection A copy of Selection taken when the frame was submitted.
+		 */
+		void Update(const std::vector<unsigned int>& selection);
+
+		/**
+		 * \brief Draws the visible meshes of one pass.
+		 *
+		 * The FrameData uniform block must be bound. Leaves face culling set to GL_BACK.
+		 * \param pass The RenderPass to draw.
+		 */
+		void Draw(unsigned int pass);
+
+		bool IsIndirect() const { return this->indirect; }
+
+		/**
+		 * \brief Returns the number of meshes added.
+		 */
+		size_t EntryCount() const { return this->selection.size(); }
+
+		/**
+		 * \brief Returns the counters of the last Update and the Draw calls after it.
+		 */
+		const StaticBatchCounters& GetCounters() const { return this->counters; }
+	private:
+		GLStaticBatch(const GLStaticBatch&);
+		GLStaticBatch& operator=(const GLStaticBatch&);
+
+		// Interleaved vertex of the pool, missing attributes are 0 like a disabled attribute array.
+		struct StaticVertex {
+			float position[3];
+			float normal[3];
+			float uv[2];
+			float color[3];
+		};
+
+		// Layout of glMultiDrawElementsIndirect.
+		struct DrawCommand {
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		// The indices a range of one entry draws at each level of detail, one command.
+		struct Slot {
+			unsigned int entry;
+			unsigned int ordinal; // Ranges of the same entry and material at one level are told apart by their order.
+			std::vector<GLuint> firstIndex; // Into the index pool, per level.
+			std::vector<GLuint> count; // 0 at levels the range does not exist.
+		};
+
+		// Slots drawn by one multi draw.
+		struct Group {
+			std::shared_ptr<GLSLShader> shader;
+			Material material;
+			bool textured; // material is used, else the draws are untextured.
+			GLuint cullFace;
+			unsigned int pass;
+			std::vector<Slot> slots;
+			size_t firstCommand; // Position of the first slot's command in commands.
+			unsigned int visible; // Commands with an instance count, counted by Update.
+			unsigned int triangles;
+		};
+
+		/**
+		 * \brief Returns the group drawing with this state, creating it if needed.
+		 */
+		Group& FindGroup(const std::shared_ptr<GLSLShader>& shader, const Material* material, GLuint cullFace, unsigned int pass);
+
+		/**
+		 * \brief Appends the pending vertices and indices to the pools, growing them if needed.
+		 */
+		void UploadPending();
+
+		/**
+		 * \brief Grows a buffer to hold at least size bytes, keeping the first used bytes.
+		 *
+		 * \return bool True if the buffer was replaced by a new one.
+		 */
+		static bool Reserve(GLuint& buffer, size_t& capacity, size_t used, size_t size);
+
+		/**
+		 * \brief Points the attributes of a vertex array at the pools, with the locations of a program.
+		 */
+		void SetupVertexArray(GLuint vao, GLuint program);
+
+		bool indirect; // glMultiDrawElementsIndirect is supported.
+		std::mutex mutex; // Guards everything Add and Update both touch.
+		std::vector<Group> groups;
+		std::vector<StaticVertex> pendingVertices; // Added since the last Update.
+		std::vector<GLuint> pendingIndices;
+		size_t vertexCount; // In the pools, pending included.
+		size_t indexCount;
+		size_t uploadedVertices;
+		size_t uploadedIndices;
+		bool layoutChanged; // Slots were added, every command is rewritten.
+		GLuint vertexBuffer;
+		GLuint elementBuffer;
+		GLuint commandBuffer;
+		size_t vertexCapacity; // Bytes.
+		size_t indexCapacity;
+		std::map<GLuint, GLuint> vertexArrays; // Program --> VAO with its attribute locations.
+		std::vector<DrawCommand> commands; // As last uploaded, in group order.
+		std::vector<unsigned int> selection; // Written while a frame is submitted.
+		std::vector<unsigned int> drawnSelection; // The selection of the last Update.
+		std::vector<GLsizei> counts; // Arguments of the glMultiDrawElements fallback.
+		std::vector<const GLvoid*> offsets;
+		StaticBatchCounters counters;
+	}; // class GLStaticBatch
+} // namespace Sigma
+
+#endif // GLSTATICBATCH_H
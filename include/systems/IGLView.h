@@ -5,6 +5,7 @@
 #include "GLTransform.h"
 #include "components/SpatialComponent.h"
 #include "Sigma.h"
+#include "FrustumCuller.h"
 
 namespace Sigma{
 	struct Plane {
@@ -25,25 +26,17 @@ namespace Sigma{
 		Plane planes[6];
 
 		bool intersectsSphere(glm::vec3 position, float radius) {
-			float distToPlane;
-
-			// calculate our distances to each of the planes
+			// calculate our signed distances to each of the planes
 			for(int i = 0; i < 6; ++i) {
-				// find the distance to this plane
-				distToPlane = (float)fabs(glm::dot(this->planes[i].normal, position) + this->planes[i].distance);
+				float distToPlane = glm::dot(this->planes[i].normal, position) + this->planes[i].distance;
 
 				// if this distance is < -sphere.radius, we are outside
 				if(distToPlane < -radius) {
 					return false;
 				}
-
-				// else if the distance is between +- radius, then we intersect
-				if(distToPlane < radius) {
-					return true; // intersection
-				}
 			}
 
-			// otherwise we are fully in view
+			// otherwise we intersect or are fully in view
 			return true;
 		}
 	};
@@ -69,19 +62,11 @@ namespace Sigma{
 		 *        view*proj will yield world space
 		 */
 		virtual void CalculateFrustum(glm::mat4 mvp) {
-			this->CameraFrustum.planes[0] = Plane(mvp[3]+mvp[0]);
-			this->CameraFrustum.planes[1] = Plane(mvp[3]-mvp[0]);
-			this->CameraFrustum.planes[2] = Plane(mvp[3]-mvp[1]);
-			this->CameraFrustum.planes[3] = Plane(mvp[3]+mvp[1]);
-			this->CameraFrustum.planes[4] = Plane(mvp[3]+mvp[2]);
-			this->CameraFrustum.planes[5] = Plane(mvp[3]-mvp[2]);
-
-			this->CameraFrustum.planes[0].normalize();
-			this->CameraFrustum.planes[1].normalize();
-			this->CameraFrustum.planes[2].normalize();
-			this->CameraFrustum.planes[3].normalize();
-			this->CameraFrustum.planes[4].normalize();
-			this->CameraFrustum.planes[5].normalize();
+			glm::vec4 planes[6];
+			FrustumCuller::ExtractPlanes(mvp, planes);
+			for(int i = 0; i < 6; ++i) {
+				this->CameraFrustum.planes[i] = Plane(planes[i]);
+			}
 		}
 
 	}; // stuct IGLView
@@ -11,6 +11,7 @@
 #endif
 #include "glm/glm.hpp"
 #include "GLTransform.h"
+#include "BoundingVolumeHierarchy.h"
 #include "IFactory.h"
 #include "ISystem.h"
 #include <memory>
@@ -23,6 +24,8 @@
 #include "Sigma.h"
 
 namespace Sigma {
+	class ALSound;
+
 	class OpenALSystem
 		: public Sigma::IFactory, public ISystem<IComponent> {
 		friend class ALSound;
@@ -87,8 +90,21 @@ namespace Sigma {
 		DLL_EXPORT void UpdateTransform(GLTransform &t);
 		DLL_EXPORT void UpdateTransform(glm::vec3 pos, glm::vec3 forward, glm::vec3 up);
 
+		/**
+		 * \brief Finds the sound sources positioned within a sphere.
+		 *
+		 * \param center The sphere center.
+		 * \param radius The sphere radius.
+		 * \param results The sources are appended here.
+		 */
+		DLL_EXPORT void QueryEmitters(const glm::vec3& center, float radius, std::vector<ALSound*>& results);
+
 		DLL_EXPORT void test();
 	private:
+		void MoveEmitter(ALSound* sound, const glm::vec3& position);
+		void RemoveEmitter(ALSound* sound);
+		BoundingVolumeHierarchy emitters; // Positioned sound sources.
+		std::vector<void*> emitterResults;
 		std::map<std::string,FactoryFunction> getFactoryFunctions();
 		int AllocateBuffer();
 		std::vector<std::unique_ptr<resource::ALBuffer>> buffers;
@@ -11,6 +11,11 @@
 #include "glm/ext.hpp"
 
 #include <memory>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "IFactory.h"
 #include "ISystem.h"
@@ -19,7 +24,20 @@
 #include <vector>
 #include "resources/GLTexture.h"
 #include "components/GLScreenQuad.h"
+#include "systems/RenderQueue.h"
+#include "systems/DrawListBuilder.h"
+#include "systems/GLRingBuffer.h"
+#include "systems/GLGPUTimer.h"
+#include "systems/GLStaticBatch.h"
+#include "systems/GLSpriteBatch.h"
+#include "systems/GLImpostorAtlas.h"
+#include "BoundingVolumeHierarchy.h"
+#include "LightClusterer.h"
+#include "RenderGraph.h"
+#include "ImpostorCache.h"
+#include "RenderStats.h"
 #include "Sigma.h"
+#include <unordered_map>
 
 struct IGLView;
 
@@ -27,6 +45,8 @@ int printOglError(const std::string &file, int line);
 #define printOpenGLError() printOglError(__FILE__, __LINE__)
 
 namespace Sigma{
+	class PointLight;
+	class SpotLight;
 
 	struct RenderTarget {
 		std::vector<GLuint> texture_ids;
@@ -35,8 +55,9 @@ namespace Sigma{
 		unsigned int width;
 		unsigned int height;
 		bool hasDepth;
+		bool depthTexture; // depth_id is a texture that can be sampled rather than a renderbuffer.
 
-		RenderTarget() : fbo_id(0), depth_id(0) {}
+		RenderTarget() : fbo_id(0), depth_id(0), depthTexture(false) {}
 		virtual ~RenderTarget();
 
 		void BindWrite();
@@ -45,11 +66,78 @@ namespace Sigma{
 		void UnbindRead();
 	};
 
+	// Mirror of the std140 FrameData uniform block declared by the shaders.
+	struct FrameUniforms {
+		glm::mat4 view;
+		glm::mat4 proj;
+		glm::mat4 viewProjInverse;
+		glm::vec3 viewPosition;
+		float ambientIntensity;
+		float diffuseIntensity;
+		float specularIntensity;
+		glm::vec2 screenSize; // The window size in pixels.
+		int gbufferLayout; // 0 for the classic GBuffer, 1 for the lean one, see OpenGLSystem::createLeanGBuffer.
+		float padding[3];
+	};
+	static_assert(sizeof(FrameUniforms) == 240, "FrameUniforms must match the std140 layout of FrameData");
+
+	// A light copied into a FrameSnapshot.
+	struct LightSnapshot {
+		glm::vec3 position; // World space.
+		float radius; // The point light radius or the spot light range.
+		glm::vec4 color;
+		glm::vec3 direction; // Normalized, spot lights only.
+		float cosInnerAngle;
+		float cosOuterAngle;
+		glm::vec3 center; // World space bounding sphere.
+		float boundingRadius;
+		bool spot;
+	};
+
+	// A component drawn into its impostor atlas cell, see OpenGLSystem::SetImpostors.
+	struct ImpostorCapture {
+		IGLComponent* component;
+		glm::mat4 model;
+		glm::mat4 view; // Looks at the bounding sphere along the direction the camera sees it from.
+		glm::mat4 projection; // Orthographic, fits the bounding sphere.
+		unsigned int x, y; // Lower left corner of the cell in the atlas.
+		unsigned int lod; // The level of detail drawn, picked for the camera, see IGLComponent::UpdateLOD.
+		unsigned int triangles; // The triangles of that level.
+	};
+
+	/**
+	 * \brief Everything needed to draw a frame, built by OpenGLSystem::Update.
+	 *
+	 * Built on the simulation thread, then drawn on the thread owning the context. Nothing in it
+	 * refers to a transform or light the simulation may change, the draws of the queue carry their
+	 * model matrices.
+	 */
+	struct FrameSnapshot {
+		FrameUniforms uniforms;
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 frustumPlanes[6];
+		unsigned int width, height;
+		bool clustered; // Lights go through the clustered pass, see OpenGLSystem::SetClusteredLighting.
+		RenderQueue queue; // Sorted draws of the GBuffer and unlit passes, also holds their draw state.
+		std::vector<unsigned int> staticSelection; // See GLStaticBatch::Selection.
+		std::vector<ImpostorCapture> impostorCaptures; // Drawn before the GBuffer pass.
+		std::vector<SpriteQuad> impostors; // Billboards of the lit components, the unlit ones are sprites of the queue.
+		std::vector<LightSnapshot> lights; // The lights in the frustum, for the per light path.
+		std::vector<unsigned int> clusters; // See LightClusterer::Clusters.
+		std::vector<unsigned int> lightIndices; // See LightClusterer::Indices.
+		std::vector<glm::vec4> lightData; // See OpenGLSystem::BinClusteredLights.
+		float clusterNear; // See LightClusterer::NearPlane, also bounds the light volumes.
+		float clusterScale; // See LightClusterer::SliceScale.
+		RenderStats stats; // Objects and culled components, counted while building.
+	};
+
 	class OpenGLSystem
 		: public Sigma::IFactory, public ISystem<IComponent> {
 	public:
 
 		DLL_EXPORT OpenGLSystem();
+		DLL_EXPORT ~OpenGLSystem();
 
 		/**
 		 * \brief Starts the OpenGL rendering system.
@@ -63,11 +151,43 @@ namespace Sigma{
 		 * \brief Causes an update in the system based on the change in time.
 		 *
 		 * Updates the state of the system based off how much time has elapsed since the last update.
+		 * When it is time for a new frame, a snapshot of the scene is built. Without a render thread
+		 * it is drawn right away, otherwise it is handed to the render thread, waiting first if that
+		 * thread is still one frame behind.
 		 * \param delta the time (in seconds) since the last update
-		 * \return true if rendering was performed
+		 * \return true if a frame was rendered on the calling thread and must be presented
 		 */
 		DLL_EXPORT bool Update(const double delta);
 
+		/**
+		 * \brief Moves the drawing to a dedicated thread owning the GL context.
+		 *
+		 * Update then only builds the frame snapshots, so the next frame is simulated while the
+		 * last one is drawn. Every GL object must be created before the call, other systems do
+		 * their GL work in frame callbacks, see AddFrameCallback.
+		 * \param bindContext Makes the context current on the calling thread when passed true,
+		 * releases it when passed false. Called here with false, then on the render thread.
+		 * \param present Called on the render thread after each frame, usually swaps the buffers.
+		 */
+		DLL_EXPORT void StartRenderThread(std::function<void(bool)> bindContext, std::function<void()> present);
+
+		/**
+		 * \brief Draws the frame handed to the render thread, stops it and takes the context back.
+		 *
+		 * Does nothing without a render thread. Called by the destructor.
+		 */
+		DLL_EXPORT void StopRenderThread();
+
+		DLL_EXPORT bool IsRenderThreadRunning() const { return this->renderThread.joinable(); }
+
+		/**
+		 * \brief Adds a function called at the start of every frame, on the thread drawing it.
+		 *
+		 * For the GL work of other systems, such as texture uploads. Add them before StartRenderThread.
+		 * \param callback The function.
+		 */
+		DLL_EXPORT void AddFrameCallback(std::function<void()> callback) { this->frameCallbacks.push_back(callback); }
+
 		/**
 		 * \brief Sets the window width and height for glViewport
 		 *
@@ -80,6 +200,7 @@ namespace Sigma{
 		/**
 		 * \brief Sets the viewport width and height.
 		 *
+		 * The targets of the render graph are resized by the next rendered frame.
 		 * \param width new viewport width
 		 * \param height new viewport height
 		 */
@@ -110,7 +231,20 @@ namespace Sigma{
 		/*
 		 * \brief creates a new render target of desired size
 		 */
-		DLL_EXPORT int createRenderTarget(const unsigned int w, const unsigned int h, bool hasDepth);
+		DLL_EXPORT int createRenderTarget(const unsigned int w, const unsigned int h, bool hasDepth, bool depthTexture = false);
+
+		/**
+		 * \brief Renders with the lean GBuffer, declared as the passes of a render graph.
+		 *
+		 * RGBA8 albedo with the specular hardness in alpha, RG16 octahedral normals and a depth
+		 * texture the lighting reads directly. The lighting draws into a light target without a depth
+		 * attachment, the unlit and overlay passes then draw into it with the GBuffer depth attached,
+		 * and it is copied to the back buffer once at the end. Only the light volumes, drawn when
+		 * clustered lighting is off, need the depth attached while it is sampled, they test against
+		 * a copy. The targets follow SetViewportSize and are allocated by the next rendered frame,
+		 * render targets made with createRenderTarget are then ignored.
+		 */
+		DLL_EXPORT void createLeanGBuffer();
 
 		/*
 		 * \brief returns the fbo_id of primary render target (index 0)
@@ -162,6 +296,95 @@ namespace Sigma{
 
 		DLL_EXPORT GLTransform* GetTransformFor(const unsigned int entityID);
 
+		/**
+		 * \brief Adds a component, replacing the component of the same type the entity had.
+		 *
+		 * Overrides ISystem::addComponent so renderables and lights are registered for the scene
+		 * index once, when they are added through any pointer to the system, instead of finding
+		 * them among every component each frame.
+		 * \param entityID The entity the component belongs to.
+		 * \param component The component, owned by the system from now on.
+		 */
+		void addComponent(id_t entityID, IComponent* component) override;
+
+		/**
+		 * \brief Returns the counters of the last rendered frame.
+		 *
+		 * Culling is counted while the frame is built, draws, binds, uniforms and uploads while it
+		 * is drawn, from the frame callbacks to the final copy to the back buffer.
+		 * \return RenderStats The frame statistics, copied as the render thread may be drawing.
+		 */
+		DLL_EXPORT RenderStats GetFrameStats() const {
+			std::lock_guard<std::mutex> lock(this->frameMutex);
+			return this->frameStats;
+		}
+
+		/**
+		 * \brief Logs the frame statistics averaged over a period, see RenderStats::Summary.
+		 *
+		 * Set it before StartRenderThread, the log line is written by the thread drawing the frames.
+		 * \param seconds The period, 0 to stop logging, the default.
+		 */
+		DLL_EXPORT void SetStatsLogInterval(double seconds) { this->statsLogInterval = seconds; }
+
+		/**
+		 * \brief Selects how the deferred lights are shaded.
+		 *
+		 * The clustered pass bins the lights into a view space grid on the CPU and shades them all in
+		 * one full screen pass. The other path draws the bounding volume of each light, a sphere or a
+		 * cone, so only the pixels the light may reach are shaded. Clustered by default.
+		 * \param enabled True for the clustered pass.
+		 */
+		DLL_EXPORT void SetClusteredLighting(bool enabled) { this->clusteredLighting = enabled; }
+		DLL_EXPORT bool IsClusteredLighting() const { return this->clusteredLighting; }
+
+		/**
+		 * \brief Enables culling of the components hidden behind occluder meshes, see GLMesh::SetOccluder.
+		 *
+		 * The occluders in the frustum are rasterized on the CPU each frame, the other visible
+		 * components are tested against the result before they are submitted. Enabled by default,
+		 * it costs nothing while there are no occluders.
+		 * \param enabled True to cull occluded components.
+		 */
+		DLL_EXPORT void SetOcclusionCulling(bool enabled) { this->occlusionCulling = enabled; }
+		DLL_EXPORT bool IsOcclusionCulling() const { return this->occlusionCulling; }
+
+		/**
+		 * \brief Draws the distant components that allow it as billboards, see IGLComponent::SetImpostorEnabled.
+		 *
+		 * A component more than 10 bounding radii away that covers less than a cell of the impostor
+		 * atlas is drawn once into its cell, then as a single quad facing the camera. The cell is
+		 * drawn again when the direction the component is seen from, in its own space, turned by
+		 * more than the angle threshold, so both the camera moving and the component spinning count.
+		 * Lit components keep their albedo and normals in the atlas and are lit like meshes. Enabled
+		 * by default, needs Start to have created the atlas.
+		 * \param enabled True to draw impostors.
+		 */
+		DLL_EXPORT void SetImpostors(bool enabled) { this->impostors = enabled; }
+		DLL_EXPORT bool IsImpostors() const { return this->impostors; }
+
+		/**
+		 * \brief Sets how far the view of an impostor may turn before its image is drawn again.
+		 *
+		 * \param degrees The angle, 5 by default.
+		 */
+		DLL_EXPORT void SetImpostorAngle(float degrees) { this->impostorCache.SetAngleThreshold(degrees); }
+
+		// Query masks of the proxies in the scene index.
+		enum SceneMask {
+			SCENE_RENDERABLE = 1, // The user data is an IGLComponent*.
+			SCENE_POINT_LIGHT = 2 // The user data is a PointLight*.
+		};
+
+		/**
+		 * \brief Returns the bounding volume hierarchy of the renderables and point lights.
+		 *
+		 * Brought up to date with the transforms at the start of every rendered frame. Filter the
+		 * queries with SceneMask to know the type of the returned user data.
+		 * \return BoundingVolumeHierarchy& The scene index.
+		 */
+		DLL_EXPORT BoundingVolumeHierarchy& GetSceneIndex() { return this->sceneIndex; }
+
 		static std::map<std::string, Sigma::resource::GLTexture> textures;
 	private:
 		unsigned int windowWidth; // Store the width of our window
@@ -178,12 +401,260 @@ namespace Sigma{
 
 		// Utility quads for rendering
 		// TODO make this smarter, allow multiple shaders/materials per glcomponent
-		GLScreenQuad pointQuad, spotQuad, ambientQuad;
+		GLScreenQuad ambientQuad, clusteredQuad;
+
+		// Closed meshes bounding the lights of the per light path.
+		enum LightVolume {
+			VOLUME_SPHERE = 0, // Unit sphere.
+			VOLUME_CONE = 1 // Apex at the origin, unit base circle at z = -1.
+		};
+
+		/**
+		 * \brief Creates the light volume meshes and the shaders lighting them.
+		 */
+		void CreateLightVolumes();
+
+		/**
+		 * \brief Draws a light volume with the bound light shader.
+		 *
+		 * Back faces are drawn with GL_GEQUAL against the scene depth, so only pixels in front of the
+		 * far side of the volume get shaded. The pass is also clipped to the projected rectangle of
+		 * the bounding sphere and, when supported, to its depth bounds.
+		 * \param frame The frame drawn, its camera and window size.
+		 * \param volume The mesh to draw.
+		 * \param model Places the mesh around the light.
+		 * \param center The world space center of the bounding sphere.
+		 * \param radius The radius of the bounding sphere.
+		 * \param shader The bound light shader.
+		 * \return bool False if the light covers no pixel and nothing was drawn.
+		 */
+		bool RenderLightVolume(const FrameSnapshot& frame, LightVolume volume, const glm::mat4& model, const glm::vec3& center, float radius, GLSLShader& shader);
+
+		GLSLShader pointVolumeShader, spotVolumeShader;
+		GLuint volumeVAOs[2];
+		GLuint volumeBuffers[4]; // Vertices then indices of each volume.
+		GLsizei volumeIndexCounts[2];
+		bool depthBoundsSupported; // GL_EXT_depth_bounds_test
+		bool depthClampSupported; // GL_ARB_depth_clamp
 
 		// Render targets to draw to
 		std::vector<std::unique_ptr<RenderTarget>> renderTargets;
 
-		std::vector<std::unique_ptr<IGLComponent>> screensSpaceComp; // A vector that holds only screen space components. These are rendered separately.
+		std::vector<std::unique_ptr<GLScreenQuad>> screensSpaceComp; // A vector that holds only screen space components. These are rendered separately.
+		std::vector<SpriteQuad> overlayQuads; // The quads of screensSpaceComp, refilled every frame.
+
+		/**
+		 * \brief Brings the scene index up to date with the components and their transforms.
+		 *
+		 * Only components whose transform changed get their bounds recomputed. Proxies of
+		 * components that lost their bounds are removed.
+		 */
+		void UpdateSceneIndex();
+
+		/**
+		 * \brief Removes a component being replaced from the registries and the scene index.
+		 */
+		void UnregisterComponent(IComponent* component);
+
+		/**
+		 * \brief Frees the replaced components no snapshot waiting or being drawn can point at.
+		 *
+		 * \param drawn The number of frames the render thread has finished.
+		 */
+		void ReleaseRetiredComponents(unsigned int drawn);
+
+		// A replaced component, freed once the frames built before it was replaced are drawn.
+		struct RetiredComponent {
+			std::unique_ptr<IComponent> component;
+			unsigned int frame; // framesBuilt when the component was replaced.
+		};
+
+		// A component in the scene index.
+		struct SceneProxy {
+			int proxy;
+			unsigned int version; // GLTransform::GetVersion when the bounds were computed.
+			float modelRadius; // IGLComponent::BoundingRadius when the bounds were computed.
+			unsigned int frame; // The last frame the component was seen.
+		};
+
+		BoundingVolumeHierarchy sceneIndex; // Renderables with bounds and point lights.
+		std::unordered_map<IComponent*, SceneProxy> sceneProxies;
+		unsigned int sceneFrame;
+		size_t renderableProxies; // Proxies with SCENE_RENDERABLE, for the culled counter.
+		std::vector<IGLComponent*> renderables; // Every IGLComponent, registered by addComponent.
+		std::vector<PointLight*> pointLights; // Registered by addComponent.
+		std::vector<SpotLight*> spotLights; // Registered by addComponent.
+		std::vector<IGLComponent*> unboundedComponents; // Components without bounds, never culled.
+		std::vector<void*> sceneResults; // Query results, reused between frames.
+		std::vector<IGLComponent*> visibleComponents; // The renderables of the last frustum query.
+		bool occlusionCulling;
+		OcclusionCuller occlusionCuller;
+		std::vector<unsigned char> occluderFlags; // 1 for the visible components rasterized as occluders.
+
+		/**
+		 * \brief Removes the visible components hidden behind the visible occluders.
+		 *
+		 * \param viewProj The view projection matrix.
+		 * \return unsigned int The number of components removed.
+		 */
+		unsigned int CullOccluded(const glm::mat4& viewProj);
+
+		/**
+		 * \brief Replaces the far visible components allowed to by billboards from the impostor atlas.
+		 *
+		 * Removes them from the visible components and adds the billboards and the cells to draw
+		 * again to the snapshot.
+		 * \param frame The snapshot being built.
+		 * \param viewPosition The camera position.
+		 * \return unsigned int The number of components replaced.
+		 */
+		unsigned int SelectImpostors(FrameSnapshot& frame, const glm::vec3& viewPosition);
+
+		/**
+		 * \brief Draws the captures of a snapshot into their atlas cells.
+		 *
+		 * Leaves the back buffer bound with the frame viewport and uniforms.
+		 * \param viewMatrix, projectionMatrix The camera, passed to Render, the level of detail drawn is
+		 *        the one SelectImpostors picked.
+		 */
+		void RenderImpostorCaptures(const FrameSnapshot& frame, glm::mat4& viewMatrix, glm::mat4& projectionMatrix);
+		DrawListBuilder drawListBuilder; // Submits the visible components on worker threads.
+		GLuint frameUniformBuffer; // FrameData uniform block, used when streamBuffer is full.
+		GLRingBuffer streamBuffer; // Instances and frame uniforms, rewritten every frame.
+		GLint uniformAlignment; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		GLGPUTimer gpuTimer; // Times the passes of RenderFrame for the Profiler.
+		GLStaticBatch staticBatch; // The meshes created with the static property.
+		GLSpriteBatch spriteBatch; // Draws the sprites of the unlit pass and the screen space quads.
+		bool impostors; // See SetImpostors.
+		ImpostorCache impostorCache; // Cells of impostorAtlas, only used by BuildFrame.
+		GLImpostorAtlas impostorAtlas;
+
+		/**
+		 * \brief Uploads frame uniforms and binds them to the FrameData block.
+		 *
+		 * \param uniforms The uniforms.
+		 */
+		void BindFrameUniforms(const FrameUniforms& uniforms);
+
+		/**
+		 * \brief Fills a snapshot with the view, the visible draws and lights of the current frame.
+		 *
+		 * Runs on the simulation thread, no GL call is made.
+		 * \param frame The snapshot, its previous content is replaced.
+		 */
+		void BuildFrame(FrameSnapshot& frame);
+
+		/**
+		 * \brief Draws a snapshot on the thread owning the context.
+		 *
+		 * \param frame The snapshot built by BuildFrame.
+		 */
+		void RenderFrame(FrameSnapshot& frame);
+
+		/**
+		 * \brief Bins the lights of a snapshot into clusters and stores the lists and light data in it.
+		 *
+		 * Each light takes 4 texels of the light buffer: world position and radius or range, color,
+		 * spot direction and cosine of the outer angle, then cosine of the inner angle and type (0 for
+		 * point lights, 1 for spot lights).
+		 */
+		void BinClusteredLights(FrameSnapshot& frame);
+
+		/**
+		 * \brief Uploads the cluster lists and light data of a snapshot.
+		 *
+		 * \return size_t The number of lights uploaded.
+		 */
+		size_t UploadClusteredLights(const FrameSnapshot& frame);
+
+		/**
+		 * \brief The render thread, draws the snapshots Update hands over until StopRenderThread.
+		 */
+		void RenderLoop();
+
+		bool clusteredLighting;
+		bool leanGBuffer; // Set by createLeanGBuffer.
+
+		// Textures and passes of the lean GBuffer in renderGraph.
+		struct LeanGraph {
+			int albedo, normal, depth, light, volumeDepth;
+			int gbuffer, lighting, volumes, unlit, overlay, present;
+		};
+
+		/**
+		 * \brief Sizes the textures of the render graph for a frame, reallocating them when the viewport changed.
+		 *
+		 * Creates the textures and the framebuffers of the passes the first time.
+		 * \param width, height The viewport size of the frame.
+		 */
+		void BeginRenderGraph(unsigned int width, unsigned int height);
+
+		/**
+		 * \brief Binds the framebuffer of a render graph pass and clears the textures it clears.
+		 *
+		 * Nothing is bound for a culled pass.
+		 */
+		void BeginRenderPass(int pass);
+
+		/**
+		 * \brief Returns the texture backing a texture of the render graph.
+		 */
+		GLuint GraphTexture(int texture) const { return this->graphTextures[this->renderGraph.Slot(texture)]; }
+
+		/**
+		 * \brief Returns the framebuffer with these attachments, creating it the first time.
+		 *
+		 * \param colors The color attachments, in order.
+		 * \param depth The depth texture, 0 for none.
+		 * \param depthAttachment GL_DEPTH_ATTACHMENT or GL_DEPTH_STENCIL_ATTACHMENT.
+		 */
+		GLuint FindGraphFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment);
+
+		RenderGraph renderGraph; // Declared by createLeanGBuffer.
+		LeanGraph leanGraph;
+		std::vector<GLuint> graphTextures; // One per slot of renderGraph.
+		std::vector<GLuint> passFramebuffers; // Per pass of renderGraph, 0 for the back buffer.
+		std::map<std::vector<GLuint>, GLuint> graphFramebuffers; // Color then depth attachments --> framebuffer, shared by the passes drawing into the same textures.
+		unsigned int graphWidth, graphHeight; // The viewport size graphTextures are allocated for.
+		GLuint boundFramebuffer; // Draw framebuffer bound by BeginRenderPass in the current frame.
+		LightClusterer lightClusterer; // Cluster bounds follow ProjectionMatrix.
+		GLuint lightBuffers[3]; // Cluster ranges, light indices and light data.
+		GLuint lightTextures[3]; // Buffer textures reading lightBuffers.
+
+		/**
+		 * \brief Returns the draw calls made so far in the frame being drawn.
+		 */
+		unsigned int FrameDrawCalls(const FrameSnapshot& frame) const;
+
+		/**
+		 * \brief Counts the draw calls made since the end of the previous pass as draws of a pass.
+		 */
+		void EndStatsPass(RenderStatsPass pass, const FrameSnapshot& frame);
+
+		RenderStats drawStats; // Counters of the frame being drawn, drawCalls only holds the draws made outside of the batches until the end.
+		RenderStats frameStats; // Counters of the last rendered frame, guarded by frameMutex.
+		unsigned int passDrawMark; // FrameDrawCalls at the end of the last pass.
+		double statsLogInterval; // Seconds, see SetStatsLogInterval.
+		double statsLogStart; // Profiler::Now when statsLogSum was started.
+		RenderStats statsLogSum; // The frames drawn since the last log line.
+		unsigned int statsLogFrames;
+
+		// Two snapshots so one can be built while the other is drawn.
+		FrameSnapshot frames[2];
+		unsigned int buildFrame; // The snapshot Update builds next.
+		int readyFrame; // The snapshot handed to the render thread and not picked up yet, -1 if none.
+		int drawingFrame; // The snapshot the render thread draws, -1 if none.
+		unsigned int framesBuilt; // Snapshots built by Update, only used on the simulation thread.
+		unsigned int framesDrawn; // Snapshots the render thread has finished.
+		bool renderThreadRunning; // Cleared by StopRenderThread.
+		std::thread renderThread;
+		mutable std::mutex frameMutex; // Guards framesDrawn, the 3 snapshot indices, renderThreadRunning and frameStats.
+		std::condition_variable frameReady; // Signaled when readyFrame is set or the thread must stop.
+		std::condition_variable frameDone; // Signaled when the render thread picks up or finishes a snapshot.
+		std::function<void(bool)> bindContext;
+		std::function<void()> present;
+		std::vector<std::function<void()>> frameCallbacks;
+		std::vector<RetiredComponent> retiredComponents; // See addComponent.
 	}; // class OpenGLSystem
 } // namespace Sigma
 #endif // OPENGLSYSTEM_H
@@ -0,0 +1,380 @@
+#pragma once
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#ifndef __APPLE__
+#include "GL/glew.h"
+#endif
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+class GLSLShader;
+
+namespace Sigma {
+	class IGLComponent;
+	class GLRingBuffer;
+	struct Material;
+
+	// The passes of the deferred renderer, in the order they are drawn.
+	enum RenderPass {
+		PASS_GBUFFER = 0, // Lit components, written to the geometry buffer.
+		PASS_UNLIT = 1 // Components drawn after lighting, straight to the screen.
+	};
+
+	// One draw call. Packets are plain data so a frame worth of them can be sorted cheaply.
+	struct DrawPacket {
+		DrawPacket() : key(0), component(nullptr), shader(nullptr), instancedShader(nullptr), material(nullptr), vao(0), geometry(0),
+			mode(GL_TRIANGLES), indexType(GL_UNSIGNED_INT), cullFace(GL_BACK), count(0), offset(0), matrix(0), lod(0) {}
+		uint64_t key; // See RenderQueue::MakeKey.
+		IGLComponent* component; // If set, the packet is drawn by calling component->Render and every other field but shader is ignored.
+		GLSLShader* shader; // Required unless component is set, RenderQueue::Push drops packets without one.
+		GLSLShader* instancedShader; // Used when several packets draw the same geometry, nullptr disables instancing.
+		const Material* material; // nullptr draws without textures.
+		GLuint vao;
+		GLuint geometry; // Element buffer name. Packets with the same one draw the same vertices.
+		GLenum mode;
+		GLenum indexType;
+		GLuint cullFace; // 0 disables face culling.
+		unsigned int count; // Number of indices, for component packets the ones Render draws, only counted.
+		size_t offset; // Offset in bytes into the element buffer.
+		unsigned int matrix; // Instance data, index returned by RenderQueue::AddInstance.
+		unsigned int lod; // The level of detail a component packet draws, see IGLComponent::UpdateLOD.
+	};
+
+	// Per instance data, streamed to the instanced shaders as vertex attributes.
+	struct InstanceData {
+		glm::mat4 model; // in_InstanceModel
+		glm::vec4 color; // in_InstanceColor
+	};
+
+	// A textured quad drawn by GLSpriteBatch instead of a draw call of its own.
+	struct SpriteQuad {
+		glm::vec3 corners[4]; // Top left, top right, bottom left, bottom right; world or screen space.
+		glm::vec4 uvRect; // Texture coordinates of the top left then bottom right corner.
+		glm::vec4 color; // Multiplies the texture.
+		GLuint texture; // 0 draws the color alone.
+	};
+
+	// A packet reference sorted by the radix sort.
+	struct SortEntry {
+		uint64_t key;
+		unsigned int index;
+	};
+
+	/**
+	 * \brief Counts the entries [first, last) by the byte of their key at shift.
+	 *
+	 * The first step of a pass of RadixSort, see RadixOffsets.
+	 * \param counts 256 counters, overwritten.
+	 */
+	inline void RadixCount(const SortEntry* entries, size_t first, size_t last, unsigned int shift, size_t* counts) {
+		std::memset(counts, 0, 256 * sizeof(size_t));
+		for (size_t i = first; i < last; ++i) {
+			++counts[(entries[i].key >> shift) & 0xFF];
+		}
+	}
+
+	/**
+	 * \brief Computes where the entries of one slice go in a pass of a radix sort split in slices.
+	 *
+	 * The entries of a slice go after the ones with a smaller byte, then after the ones with the
+	 * same byte in the previous slices, so sorting the slices on different threads stays stable.
+	 * \param counts The RadixCount of every slice, 256 per slice, in slice order.
+	 * \param slices The number of slices.
+	 * \param slice The slice to compute the offsets of.
+	 * \param offsets 256 positions, the first entry of each byte of the slice goes there.
+	 * \return bool false when every entry has the same byte, the pass can then be skipped.
+	 */
+	inline bool RadixOffsets(const size_t* counts, size_t slices, size_t slice, size_t* offsets) {
+		size_t sum = 0;
+		size_t largest = 0;
+		for (unsigned int digit = 0; digit < 256; ++digit) {
+			size_t digitCount = 0;
+			for (size_t s = 0; s < slices; ++s) {
+				if (s == slice) {
+					offsets[digit] = sum + digitCount;
+				}
+				digitCount += counts[s * 256 + digit];
+			}
+			largest = std::max(largest, digitCount);
+			sum += digitCount;
+		}
+		return largest < sum;
+	}
+
+	/**
+	 * \brief Moves the entries [first, last) to their position for the byte at shift.
+	 *
+	 * \param offsets The positions computed by RadixOffsets, advanced past the moved entries.
+	 * \param sorted Receives the entries, it must not overlap entries.
+	 */
+	inline void RadixScatter(const SortEntry* entries, size_t first, size_t last, unsigned int shift, size_t* offsets, SortEntry* sorted) {
+		for (size_t i = first; i < last; ++i) {
+			sorted[offsets[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+		}
+	}
+
+	/**
+	 * \brief Sorts entries by key with a least significant digit radix sort.
+	 *
+	 * 8 passes of 8 bits each, a pass is skipped when every key has the same byte. The sort is
+	 * stable, so packets with the same key keep their submission order.
+	 * DrawListBuilder::Sort runs the same passes on several threads.
+	 * \param entries The entries to sort, sorted in place.
+	 * \param scratch Temporary storage, reused between frames to avoid allocations.
+	 */
+	inline void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+		const size_t count = entries.size();
+		if (count < 2) {
+			return;
+		}
+		scratch.resize(count);
+		for (unsigned int shift = 0; shift < 64; shift += 8) {
+			size_t counts[256];
+			size_t offsets[256];
+			RadixCount(&entries[0], 0, count, shift, counts);
+			if (!RadixOffsets(counts, 1, 0, offsets)) {
+				continue;
+			}
+			RadixScatter(&entries[0], 0, count, shift, offsets, &scratch[0]);
+			entries.swap(scratch);
+		}
+	}
+
+	// Counters of the packets submitted since the last Clear.
+	struct RenderQueueCounters {
+		RenderQueueCounters() : draws(0), instancedDraws(0), instances(0), triangles(0), shaderChanges(0), materialChanges(0) {}
+		unsigned int draws;
+		unsigned int instancedDraws; // Draws that drew several packets at once.
+		unsigned int instances; // Packets drawn by instanced draws.
+		unsigned int triangles;
+		unsigned int shaderChanges;
+		unsigned int materialChanges;
+	};
+
+	// The sizes of a queue, also where the contents of a queue start once appended, see RenderQueue::AppendAt.
+	struct RenderQueueOffsets {
+		RenderQueueOffsets() : packets(0), instances(0), sprites(0) {}
+		size_t packets; // Also the sort entries, there is one per packet.
+		size_t instances;
+		size_t sprites;
+	};
+
+	/**
+	 * \brief Collects the draws of a frame, sorts them by state and submits them.
+	 *
+	 * Components emit packets with IGLComponent::Submit. The packets are sorted by a 64 bit key so
+	 * draws sharing a shader, then a material, end up next to each other, and Submit only changes
+	 * the GL state that differs from the previous packet. Consecutive packets drawing the same
+	 * geometry with the same material are merged into one instanced draw.
+	 */
+	class RenderQueue {
+	public:
+		RenderQueue() : instanceBuffer(0), instanceCapacity(0), streamBuffer(nullptr), instanceSource(0), instanceOffset(0) {}
+		~RenderQueue();
+
+		// Called after a shader is bound, to set the uniforms a pass needs.
+		typedef std::function<void(GLSLShader&)> ShaderSetup;
+
+		/**
+		 * \brief Builds a sort key.
+		 *
+		 * From the most significant bits down: pass (4 bits), shader program (12 bits),
+		 * material (16 bits), geometry (8 bits) so instances of a mesh end up next to each other,
+		 * and the view space depth (24 bits) so opaque draws go front to back.
+		 * \param pass The RenderPass.
+		 * \param program The shader program name.
+		 * \param material A material key, see MaterialKey.
+		 * \param geometry The element buffer name, see DrawPacket::geometry.
+		 * \param depth The distance along the view direction. Negative depths sort as 0.
+		 * \return uint64_t The key.
+		 */
+		static uint64_t MakeKey(unsigned int pass, unsigned int program, unsigned int material, unsigned int geometry, float depth) {
+			// Non negative floats compare like their bit patterns, the low mantissa bits are dropped.
+			uint32_t depthBits = 0;
+			if (depth > 0.0f) {
+				std::memcpy(&depthBits, &depth, sizeof(depthBits));
+			}
+			return (static_cast<uint64_t>(pass & 0xF) << 60) | (static_cast<uint64_t>(program & 0xFFF) << 48) |
+				(static_cast<uint64_t>(material & 0xFFFF) << 32) | (static_cast<uint64_t>(geometry & 0xFF) << 24) | (depthBits >> 8);
+		}
+
+		/**
+		 * \brief Returns the pass stored in a sort key.
+		 */
+		static unsigned int KeyPass(uint64_t key) { return static_cast<unsigned int>(key >> 60); }
+
+		/**
+		 * \brief Returns a 16 bit key that groups materials using the same textures.
+		 *
+		 * \param material The material, or nullptr.
+		 * \return unsigned int The key, 0 for nullptr.
+		 */
+		static unsigned int MaterialKey(const Material* material);
+
+		/**
+		 * \brief Creates or refills the MaterialData uniform buffer of a material.
+		 *
+		 * Called once when a mesh is uploaded, drawing then only binds the buffer.
+		 * \param material The material, its uniformBuffer is set.
+		 */
+		static void BuildMaterialBuffer(Material& material);
+
+		/**
+		 * \brief Binds the textures and the MaterialData uniform buffer of a mesh material.
+		 *
+		 * The samplers are expected on texture unit 0 (texDiff) and 1 (texAmb).
+		 * \param material The material, or nullptr to disable texturing.
+		 */
+		static void ApplyMaterial(const Material* material);
+
+		/**
+		 * \brief Sets the buffer the instances of the merged packets are written to.
+		 *
+		 * The buffer must be between GLRingBuffer::BeginFrame and EndFrame when Submit is called.
+		 * When it is full, or not set, the instances go to a buffer of the queue orphaned every pass.
+		 * \param buffer The ring buffer, or nullptr.
+		 */
+		void SetStreamBuffer(GLRingBuffer* buffer) { this->streamBuffer = buffer; }
+
+		/**
+		 * \brief Removes every packet and resets the counters.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Stores the model matrix and color of an instance for this frame.
+		 *
+		 * \param model The model matrix.
+		 * \param color The color the instanced shaders multiply the surface color with.
+		 * \return unsigned int The index to put in DrawPacket::matrix.
+		 */
+		unsigned int AddInstance(const glm::mat4& model, const glm::vec4& color = glm::vec4(1.0f)) {
+			InstanceData instance;
+			instance.model = model;
+			instance.color = color;
+			this->instances.push_back(instance);
+			return static_cast<unsigned int>(this->instances.size() - 1);
+		}
+
+		/**
+		 * \brief Adds a packet to the queue.
+		 *
+		 * A packet without a component nor a shader has nothing to set its model matrix with, it is
+		 * dropped.
+		 */
+		void Push(const DrawPacket& packet) {
+			if (!packet.component && !packet.shader) {
+				return;
+			}
+			SortEntry entry = { packet.key, static_cast<unsigned int>(this->packets.size()) };
+			this->packets.push_back(packet);
+			this->order.push_back(entry);
+		}
+
+		/**
+		 * \brief Adds a world space quad, drawn with the other sprites of the frame in the unlit pass.
+		 */
+		void AddSprite(const SpriteQuad& sprite) { this->sprites.push_back(sprite); }
+
+		/**
+		 * \brief Returns the quads added since the last Clear, in submission order.
+		 */
+		const std::vector<SpriteQuad>& Sprites() const { return this->sprites; }
+
+		/**
+		 * \brief Returns the number of packets, instances and sprites in the queue.
+		 */
+		RenderQueueOffsets Offsets() const;
+
+		/**
+		 * \brief Grows the queue to the given sizes, the new packets, instances and sprites are left for AppendAt.
+		 */
+		void Resize(const RenderQueueOffsets& sizes);
+
+		/**
+		 * \brief Copies the packets, instances and sprites of another queue into space made by Resize.
+		 *
+		 * Used to merge the queues filled by worker threads, see DrawListBuilder. The packets keep
+		 * their order and their instance indices are moved along with the instances. Queues copied
+		 * to space that does not overlap may be copied concurrently.
+		 * \param other The queue to copy from, it is left unchanged.
+		 * \param at Where the packets, instances and sprites of other go.
+		 */
+		void AppendAt(const RenderQueue& other, const RenderQueueOffsets& at);
+
+		/**
+		 * \brief Sorts the packets by key. Call once after every packet is pushed.
+		 */
+		void Sort() { RadixSort(this->order, this->scratch); }
+
+		/**
+		 * \brief Draws the packets of one pass in key order.
+		 *
+		 * Leaves face culling set to GL_BACK. The last shader, VAO and textures stay bound.
+		 * \param pass The RenderPass to draw.
+		 * \param view The view matrix.
+		 * \param proj The projection matrix.
+		 * \param setup Called every time a shader gets bound, may be empty. The view and projection
+		 * come from the FrameData uniform block, which must be bound.
+		 * \return unsigned int The number of packets drawn.
+		 */
+		unsigned int Submit(unsigned int pass, const glm::mat4& view, const glm::mat4& proj, const ShaderSetup& setup = ShaderSetup());
+
+		/**
+		 * \brief Returns the number of packets in the queue.
+		 */
+		size_t Size() const { return this->packets.size(); }
+
+		/**
+		 * \brief Returns the counters of the packets submitted since the last Clear.
+		 */
+		const RenderQueueCounters& GetCounters() const { return this->counters; }
+	private:
+		friend class DrawListBuilder; // Sorts order on several threads, see DrawListBuilder::Sort.
+
+		/**
+		 * \brief Returns the end of the run of packets starting at first that can be drawn instanced.
+		 *
+		 * \param first The position in order of the first packet.
+		 * \param last The end of the pass in order.
+		 * \return size_t first + 1 when the packet can not be merged with the following ones.
+		 */
+		size_t InstanceRun(size_t first, size_t last) const;
+
+		/**
+		 * \brief Points the instance attributes of the bound VAO at the instances uploaded by Submit.
+		 *
+		 * \param firstInstance The position in instanceStaging of the first instance to draw.
+		 */
+		void BindInstanceAttributes(size_t firstInstance);
+
+		// A run of packets merged into one instanced draw.
+		struct InstanceBatch {
+			size_t first, last; // Positions in order.
+			size_t firstInstance; // Position in instanceStaging.
+		};
+
+		std::vector<DrawPacket> packets; // In push order.
+		std::vector<SortEntry> order; // Indices into packets, in draw order after Sort.
+		std::vector<SortEntry> scratch;
+		std::vector<InstanceData> instances;
+		std::vector<SpriteQuad> sprites;
+		std::vector<InstanceData> instanceStaging; // The instances of the merged packets, in draw order.
+		std::vector<InstanceBatch> batches; // The instanced draws of the pass being submitted.
+		GLuint instanceBuffer;
+		size_t instanceCapacity; // Size of instanceBuffer in instances.
+		GLRingBuffer* streamBuffer;
+		GLuint instanceSource; // The buffer holding instanceStaging for the pass being submitted.
+		size_t instanceOffset; // The offset in bytes of instanceStaging in instanceSource.
+		RenderQueueCounters counters;
+	}; // class RenderQueue
+} // namespace Sigma
+
+#endif // RENDERQUEUE_H
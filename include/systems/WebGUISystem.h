@@ -42,6 +42,13 @@ namespace Sigma {
 		 */
 		DLL_EXPORT bool Update(const double delta);
 
+		/**
+		 * \brief Uploads the pages painted since the last call to their textures.
+		 *
+		 * Call on the thread owning the GL context, see OpenGLSystem::AddFrameCallback.
+		 */
+		DLL_EXPORT void UploadTextures();
+
 		std::map<std::string,FactoryFunction> getFactoryFunctions();
 
 		DLL_EXPORT IComponent* createWebGUIView(const id_t entityID, const std::vector<Property> &properties);
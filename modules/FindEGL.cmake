@@ -0,0 +1,26 @@
+# Find EGL
+# Find the EGL includes and library
+#
+#  EGL_INCLUDE_DIRS - where to find EGL/egl.h, etc.
+#  EGL_LIBRARIES    - List of libraries when using EGL.
+#  EGL_FOUND        - True if EGL found.
+#
+# Based on the FindSOIL.cmake module.
+
+IF (EGL_INCLUDE_DIR)
+  # Already in cache, be silent
+  SET(EGL_FIND_QUIETLY TRUE)
+ENDIF (EGL_INCLUDE_DIR)
+
+FIND_PATH(EGL_INCLUDE_DIR EGL/egl.h)
+FIND_LIBRARY(EGL_LIBRARY NAMES EGL)
+MARK_AS_ADVANCED( EGL_LIBRARY EGL_INCLUDE_DIR )
+
+# Per-recommendation
+SET(EGL_INCLUDE_DIRS "${EGL_INCLUDE_DIR}")
+SET(EGL_LIBRARIES    "${EGL_LIBRARY}")
+
+# handle the QUIETLY and REQUIRED arguments and set EGL_FOUND to TRUE if
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(EGL DEFAULT_MSG EGL_LIBRARIES EGL_INCLUDE_DIRS)
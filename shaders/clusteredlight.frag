@@ -0,0 +1,144 @@
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+// Cluster grid, see LightClusterer
+uniform ivec3 clusterDims; // tiles x, tiles y, depth slices
+uniform float clusterNear;
+uniform float clusterScale; // slices / log(far / near)
+
+uniform usamplerBuffer clusterBuffer; // offset and count of each cluster
+uniform usamplerBuffer lightIndexBuffer; // concatenated light lists
+uniform samplerBuffer lightBuffer; // 4 texels per light, see OpenGLSystem::UploadClusteredLights
+
+uniform sampler2D diffuseBuffer;
+uniform sampler2D normalBuffer;
+uniform sampler2D depthBuffer;
+
+in vec2 ex_UV;
+out vec4 out_Color;
+
+vec3 decode(vec3 normal) {
+	return normal * 2.0 - 1.0;
+}
+
+// Inverse of encodeOctahedral in mesh_deferred.frag
+vec3 decodeOctahedral(vec2 encoded) {
+	encoded = encoded * 2.0 - 1.0;
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0) {
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(normal);
+}
+
+// Same lighting as pointlight.frag
+vec3 pointLight(vec3 position, vec3 normal, vec3 diffuse, float specularHardness, vec3 viewVector, vec4 light0, vec4 light1) {
+	vec3 lightVector = light0.xyz - position;
+	float A = 1.0 - (dot(lightVector, lightVector) / (light0.w*light0.w));
+	if(A <= 0.0) {
+		return vec3(0.0);
+	}
+	lightVector = normalize(lightVector);
+
+	float NdL = max(dot(normal, lightVector), 0.0);
+	float specularLight = 0.0;
+	if(NdL > 0.0) {
+		vec3 halfVector = normalize(lightVector + viewVector);
+		specularLight = pow(clamp(dot(normal, halfVector), 0.0, 1.0), specularHardness);
+	}
+	return clamp(light1.rgb*diffuse*clamp(NdL + specularLight, 0.0, 1.0)*A, 0.0, 1.0);
+}
+
+// Same lighting as spotlight.frag, cut off at the range of the light
+vec3 spotLight(vec3 position, vec3 normal, vec3 diffuse, float specularHardness, vec3 viewVector, vec4 light0, vec4 light2, vec4 light3) {
+	vec3 lightVector = light0.xyz - position;
+	float distance = length(lightVector);
+	if(distance > light0.w) {
+		return vec3(0.0);
+	}
+	float distAttenuation = 1.0 / (1.0 + 0.01*distance + 0.001*(distance*distance));
+	lightVector = normalize(lightVector);
+
+	float spot = dot(-lightVector, light2.xyz);
+	float cosOuter = light2.w;
+	float cosInner = light3.x;
+	float coneAttenuation = 0.0;
+	if(spot >= cosOuter)
+		coneAttenuation = 0.5*smoothstep(cosOuter, cosInner, spot);
+	if(spot >= cosInner)
+		coneAttenuation += 0.5*smoothstep(cosInner, 1.0, spot);
+	coneAttenuation = clamp(coneAttenuation, 0.0, 1.0);
+
+	float NdL = max(dot(normal, lightVector), 0.0);
+	float specularLight = 0.0;
+	if(NdL > 0.0) {
+		vec3 halfVector = normalize(lightVector + viewVector);
+		specularLight = pow(clamp(dot(normal, halfVector), 0.0, 1.0), specularHardness);
+	}
+	return clamp(distAttenuation*coneAttenuation*diffuse*clamp(NdL + specularLight, 0.0, 1.0), 0.0, 1.0);
+}
+
+void main(void) {
+	vec4 diffuse = texture(diffuseBuffer,ex_UV);
+	vec4 normalData = texture(normalBuffer,ex_UV);
+	vec3 normal = normalize(decode(normalData.rgb));
+	float specularHardness = normalData.a*1000.0f;
+
+	// RECREATE POSITION
+	float depthValue = texture(depthBuffer, ex_UV).r;
+
+	if (gbufferLayout == 1) {
+		// Lean GBuffer: octahedral normal, hardness in the albedo alpha, window space depth
+		normal = decodeOctahedral(normalData.rg);
+		specularHardness = diffuse.a*1000.0f;
+		depthValue = depthValue * 2.0 - 1.0;
+	}
+	vec4 position = viewProjInverse * vec4(ex_UV.s * 2.0 - 1.0, ex_UV.t * 2.0 - 1.0, depthValue, 1.0);
+	position /= position.w;
+
+	// FIND THE CLUSTER //
+	float viewDepth = -(in_View * position).z;
+	int slice = int(floor(log(max(viewDepth, clusterNear) / clusterNear) * clusterScale));
+	if(slice >= clusterDims.z) {
+		discard;
+	}
+	ivec2 tile = min(ivec2(ex_UV * vec2(clusterDims.xy)), clusterDims.xy - 1);
+	int cluster = tile.x + clusterDims.x * (tile.y + clusterDims.y * slice);
+	uvec2 range = texelFetch(clusterBuffer, cluster).rg;
+	if(range.y == 0u) {
+		discard;
+	}
+
+	// SHADE EVERY LIGHT OF THE CLUSTER //
+	vec3 viewVector = normalize(viewPosW - position.xyz);
+	vec3 color = vec3(0.0);
+	for(uint i = 0u; i < range.y; ++i) {
+		int light = int(texelFetch(lightIndexBuffer, int(range.x + i)).r) * 4;
+		vec4 light0 = texelFetch(lightBuffer, light);
+		vec4 light1 = texelFetch(lightBuffer, light + 1);
+		vec4 light2 = texelFetch(lightBuffer, light + 2);
+		vec4 light3 = texelFetch(lightBuffer, light + 3);
+		if(light3.y == 0.0) {
+			color += pointLight(position.xyz, normal, diffuse.rgb, specularHardness, viewVector, light0, light1);
+		}
+		else {
+			color += spotLight(position.xyz, normal, diffuse.rgb, specularHardness, viewVector, light0, light2, light3);
+		}
+	}
+
+	out_Color = vec4(color, 1.0);
+}
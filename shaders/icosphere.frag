@@ -6,12 +6,31 @@ precision highp float; // needed only for version 1.30
 
 uniform sampler2D texDiff;
 uniform sampler2D texAmb;
-uniform int diffuseTexEnabled;
-uniform int ambientTexEnabled;
+
+// Per material data, one buffer per mesh material
+layout(std140) uniform MaterialData {
+	float specularHardness;
+	int diffuseTexEnabled;
+	int ambientTexEnabled;
+	int texEnabled;
+};
+
 uniform vec4 diffuseLightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-uniform float diffuseLightIntensity = 1.0f;
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
 uniform vec4 ambLightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-uniform float ambLightIntensity = 0.15f;
 
 in  vec3 ex_Color;
 in  vec3 ex_Normal;
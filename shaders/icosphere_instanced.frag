@@ -0,0 +1,64 @@
+// Fragment Shader - file "icosphere_instanced.frag", same as icosphere.frag
+ 
+#version 140
+ 
+precision highp float; // needed only for version 1.30
+
+uniform sampler2D texDiff;
+uniform sampler2D texAmb;
+
+// Per material data, one buffer per mesh material
+layout(std140) uniform MaterialData {
+	float specularHardness;
+	int diffuseTexEnabled;
+	int ambientTexEnabled;
+	int texEnabled;
+};
+
+uniform vec4 diffuseLightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+uniform vec4 ambLightColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+in  vec3 ex_Color;
+in  vec3 ex_Normal;
+in  vec2 ex_UV;
+in  vec3 ex_LightDir;
+out vec4 out_Color;
+ 
+void main(void)
+{
+	vec4 final_Color;
+	vec4 ambientLight;
+
+	float NdL = clamp(dot(normalize(ex_Normal), normalize(ex_LightDir)), 0.0f, 1.0f);
+
+	if (ambientTexEnabled >= 1) {
+        vec4 ambTextureColor = texture(texAmb,ex_UV);
+		ambientLight = ambLightIntensity*ambLightColor*ambTextureColor;
+	} else {
+        ambientLight = ambLightIntensity*ambLightColor;
+	}
+	
+	if (diffuseTexEnabled >= 1) {
+		vec4 diffColor = texture(texDiff,ex_UV);
+		final_Color = vec4(ex_Color, 1.0f)*diffColor*(clamp(NdL + ambientLight, 0.0f, 1.0f));
+	}
+	else {
+		final_Color = vec4(ex_Color, 1.0f)*(clamp(NdL+ambientLight, 0.0f, 1.0f));
+	}
+
+	out_Color = final_Color;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Fragment Shader - file "impostor.frag"
+// Billboards of distant objects, the atlas holds the classic GBuffer layout of the captured object
+
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+uniform sampler2D in_Texture; // Albedo, alpha is 0 where the capture drew nothing
+uniform sampler2D in_NormalTexture; // World space normal in [0, 1] and specular hardness in alpha
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+in vec2 ex_UV;
+in vec2 ex_Depth;
+
+out vec4 out_Color;
+out vec4 out_Normal;
+out float out_Depth;
+
+// Folds the unit sphere onto an octahedron and unfolds it into [0, 1]^2
+vec2 encodeOctahedral(vec3 normal) {
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	vec2 folded = normal.xy;
+	if (normal.z < 0.0) {
+		folded = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return folded * 0.5 + 0.5;
+}
+
+void main(void)
+{
+	vec4 albedo = texture(in_Texture, ex_UV);
+	// Half covered texels at the silhouette, the billboard is opaque
+	if (albedo.a < 0.5) {
+		discard;
+	}
+	vec4 stored = texture(in_NormalTexture, ex_UV);
+
+	out_Color = vec4(albedo.rgb, 1.0);
+	if (gbufferLayout == 1) {
+		vec3 normal = normalize(stored.rgb * 2.0 - 1.0);
+		out_Color.a = stored.a;
+		out_Normal = vec4(encodeOctahedral(normal), 0.0, 0.0);
+	}
+	else {
+		out_Normal = stored;
+		out_Depth = ex_Depth.x / ex_Depth.y;
+	}
+}
@@ -0,0 +1,21 @@
+// Vertex Shader - file "impostor.vert"
+// Billboards of distant objects, drawn into the GBuffer from their impostor atlas cells
+
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+uniform mat4 in_ViewProj;
+
+in vec3 in_Position;
+in vec2 in_UV;
+
+out vec2 ex_UV;
+out vec2 ex_Depth;
+
+void main(void) {
+	vec4 position = in_ViewProj * vec4(in_Position, 1.0);
+	ex_Depth = vec2(position.z, position.w);
+	ex_UV = in_UV;
+	gl_Position = position;
+}
@@ -0,0 +1,28 @@
+// Vertex Shader - file "lightvolume.vert"
+// Places the sphere or cone bounding a light, lit by pointlight.frag or spotlight.frag
+
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+uniform mat4 volumeModel;
+
+in vec3 in_Position;
+
+void main()
+{
+	gl_Position = in_Proj * in_View * volumeModel * vec4(in_Position, 1.0);
+}
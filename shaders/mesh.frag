@@ -6,7 +6,14 @@ precision highp float; // needed only for version 1.30
 
 uniform sampler2D texDiff;
 uniform sampler2D texAmb;
-uniform int texEnabled;
+
+// Per material data, one buffer per mesh material
+layout(std140) uniform MaterialData {
+	float specularHardness;
+	int diffuseTexEnabled;
+	int ambientTexEnabled;
+	int texEnabled;
+};
 
 in  vec3 ex_Color;
 in  vec3 ex_Normal;
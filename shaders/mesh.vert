@@ -6,8 +6,20 @@ in  vec3 in_Position;
 in  vec3 in_Color;
 in  vec3 in_Normal;
 uniform  mat4 in_Model;
-uniform  mat4 in_View;
-uniform  mat4 in_Proj;
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
 in  vec2 in_UV;
 out vec2 ex_UV;
 out vec3 ex_Color;
@@ -7,9 +7,27 @@ precision highp float; // needed only for version 1.30
 // Texture vars
 uniform sampler2D texDiff;
 uniform sampler2D texAmb;
-uniform int diffuseTexEnabled;
-uniform int ambientTexEnabled;
-uniform float specularHardness;
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+// Per material data, one buffer per mesh material
+layout(std140) uniform MaterialData {
+	float specularHardness;
+	int diffuseTexEnabled;
+	int ambientTexEnabled;
+	int texEnabled;
+};
 
 in  vec3 ex_Color;
 in  vec3 ex_Normal;
@@ -20,6 +38,16 @@ out vec4 out_Color;
 out vec4 out_Normal;
 out float out_Depth;
  
+// Folds the unit sphere onto an octahedron and unfolds it into [0, 1]^2
+vec2 encodeOctahedral(vec3 normal) {
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	vec2 folded = normal.xy;
+	if (normal.z < 0.0) {
+		folded = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return folded * 0.5 + 0.5;
+}
+
 void main(void)
 {
 	// Albedo color
@@ -31,10 +59,17 @@ void main(void)
 	
 	vec3 normal = normalize(ex_Normal);
 
-	// Output normal, Adjusted to the [0.0f, 1.0f] domain
-	out_Normal.rgb = (0.5 * normal) + 0.5;
-	out_Normal.a = specularHardness / 1000.0;
+	if (gbufferLayout == 1) {
+		// Lean layout: octahedral normal, hardness in the albedo alpha and depth from the depth texture
+		out_Color.a = specularHardness / 1000.0;
+		out_Normal = vec4(encodeOctahedral(normal), 0.0, 0.0);
+	}
+	else {
+		// Output normal, Adjusted to the [0.0f, 1.0f] domain
+		out_Normal.rgb = (0.5 * normal) + 0.5;
+		out_Normal.a = specularHardness / 1000.0;
 
-	// Output depth, stored as one 32-bit value
-	out_Depth = ex_Depth.x / ex_Depth.y;
+		// Output depth, stored as one 32-bit value
+		out_Depth = ex_Depth.x / ex_Depth.y;
+	}
 }
\ No newline at end of file
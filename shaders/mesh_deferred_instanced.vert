@@ -0,0 +1,39 @@
+// Vertex Shader - file "mesh_deferred_instanced.vert"
+// mesh_deferred.vert with the model matrix and a color read per instance.
+ 
+#version 140
+
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+ 
+in  vec3 in_Position;
+in  vec3 in_Normal;
+in  vec2 in_UV;
+in  mat4 in_InstanceModel;
+in  vec4 in_InstanceColor;
+
+out vec2 ex_UV;
+out vec3 ex_Color;
+out vec3 ex_Normal;
+out vec2 ex_Depth;
+
+void main(void)
+{
+	ex_Normal = (in_InstanceModel * vec4(in_Normal,0)).xyz;
+	ex_UV = in_UV;
+	ex_Color = in_InstanceColor.rgb;
+
+	vec4 position = in_Proj * (in_View * (in_InstanceModel * vec4(in_Position,1))); 
+	ex_Depth = vec2(position.z, position.w);
+	gl_Position = position;
+}
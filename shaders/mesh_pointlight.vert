@@ -3,11 +3,21 @@
 #version 140
 
 uniform  mat4 in_Model;
-uniform  mat4 in_View;
-uniform  mat4 in_Proj;
 
-// Viewer position
-uniform vec3 viewPosW;
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
+// Light position
 uniform vec3 lightPositionW = vec3(0.0f, 1.5f, 0.0f);
  
 in  vec3 in_Position;
@@ -2,8 +2,19 @@
 
 precision highp float; // needed only for version 1.30
 
-uniform mat4 viewProjInverse;
-uniform vec3 viewPosW;
+// Per frame data, filled once per frame by OpenGLSystem
+layout(std140) uniform FrameData {
+	mat4 in_View;
+	mat4 in_Proj;
+	mat4 viewProjInverse;
+	vec3 viewPosW;
+	float ambLightIntensity;
+	float diffuseLightIntensity;
+	float specularLightIntensity;
+	vec2 screenSize;
+	int gbufferLayout; // 0: RGBA8 normal and R32F depth targets, 1: RG16 octahedral normal and the depth texture
+};
+
 uniform vec3 lightPosW;
 uniform vec3 lightDirW;
 uniform vec4 lightColor;
@@ -15,19 +26,31 @@ uniform sampler2D diffuseBuffer;
 uniform sampler2D normalBuffer;
 uniform sampler2D depthBuffer;
 
-in vec2 ex_UV;
 out vec4 out_Color;
 
 vec3 decode(vec3 normal) {
 	return normal * 2.0 - 1.0;
 }
 
+// Inverse of encodeOctahedral in mesh_deferred.frag
+vec3 decodeOctahedral(vec2 encoded) {
+	encoded = encoded * 2.0 - 1.0;
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0) {
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(normal);
+}
+
 void main(void) {
+	// Drawn as a light volume, find the GBuffer texel from the window position
+	vec2 uv = gl_FragCoord.xy / screenSize;
+
 	// GET DIFFUSE DATA
-	vec4 diffuse = texture(diffuseBuffer,ex_UV);
+	vec4 diffuse = texture(diffuseBuffer,uv);
 	
 	// GET NORMAL DATA
-	vec4 normalData = texture(normalBuffer,ex_UV);
+	vec4 normalData = texture(normalBuffer,uv);
 
 	// Transform normal back to [-1, 1] range
 	vec3 normal = normalize(decode(normalData.rgb));
@@ -35,13 +58,20 @@ void main(void) {
 	
 	// RECREATE POSITION
 	// Retrieve screen-space depth value
-	float depthValue = texture(depthBuffer, ex_UV).r;
+	float depthValue = texture(depthBuffer, uv).r;
+
+	if (gbufferLayout == 1) {
+		// Lean GBuffer: octahedral normal, hardness in the albedo alpha, window space depth
+		normal = decodeOctahedral(normalData.rg);
+		specularHardness = diffuse.a*1000.0f;
+		depthValue = depthValue * 2.0 - 1.0;
+	}
 
 	// screen space position
 	vec4 position;
 
-	position.x = ex_UV.s * 2.0 - 1.0;
-	position.y = ex_UV.t * 2.0 - 1.0;
+	position.x = uv.s * 2.0 - 1.0;
+	position.y = uv.t * 2.0 - 1.0;
 	position.z = depthValue;
 	position.w = 1.0;
 
@@ -0,0 +1,22 @@
+// Fragment Shader - file "spritebatch.frag"
+// Quads of GLSpriteBatch, untextured ones sample a white texture
+
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+uniform sampler2D in_Texture;
+
+in vec2 ex_UV;
+in vec4 ex_Color;
+
+out vec4 out_Color;
+
+void main(void) {
+	vec4 color = texture(in_Texture, ex_UV) * ex_Color;
+	// Transparent texels must not hide what is drawn behind them later
+	if (color.a < 0.01) {
+		discard;
+	}
+	out_Color = color;
+}
@@ -0,0 +1,21 @@
+// Vertex Shader - file "spritebatch.vert"
+// Quads of GLSpriteBatch, already placed in world or screen space
+
+#version 140
+
+precision highp float; // needed only for version 1.30
+
+uniform mat4 in_ViewProj; // Identity for screen space quads
+
+in vec3 in_Position;
+in vec2 in_UV;
+in vec4 in_Color;
+
+out vec2 ex_UV;
+out vec4 ex_Color;
+
+void main(void) {
+	gl_Position = in_ViewProj * vec4(in_Position, 1.0);
+	ex_UV = in_UV;
+	ex_Color = in_Color;
+}
@@ -0,0 +1,554 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <cmath>
+
+namespace Sigma {
+	namespace {
+		const unsigned int kBinCount = 16;
+		// Fat boxes are extended by this many times the last displacement, in its direction.
+		const float kDisplacementMultiplier = 2.0f;
+
+		float Component(const glm::vec3& v, int axis) {
+			return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+		}
+
+		bool SpheresOverlap(const glm::vec3& a, float radiusA, const glm::vec3& b, float radiusB) {
+			glm::vec3 offset = a - b;
+			float distance = radiusA + radiusB;
+			return glm::dot(offset, offset) <= distance * distance;
+		}
+
+		bool SphereOverlapsBox(const glm::vec3& center, float radius, const AABB& box) {
+			float x = std::max(box.minimum.x, std::min(center.x, box.maximum.x)) - center.x;
+			float y = std::max(box.minimum.y, std::min(center.y, box.maximum.y)) - center.y;
+			float z = std::max(box.minimum.z, std::min(center.z, box.maximum.z)) - center.z;
+			return x * x + y * y + z * z <= radius * radius;
+		}
+
+		bool RayHitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const AABB& box) {
+			float nearest = 0.0f, farthest = maxDistance;
+			for (int axis = 0; axis < 3; ++axis) {
+				float t1 = (Component(box.minimum, axis) - Component(origin, axis)) * Component(inverseDirection, axis);
+				float t2 = (Component(box.maximum, axis) - Component(origin, axis)) * Component(inverseDirection, axis);
+				if (t1 > t2) {
+					std::swap(t1, t2);
+				}
+				// Written so a NaN from a ray parallel to a slab keeps the previous bounds.
+				nearest = t1 > nearest ? t1 : nearest;
+				farthest = t2 < farthest ? t2 : farthest;
+				if (nearest > farthest) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool RayHitsSphere(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const glm::vec3& center, float radius) {
+			glm::vec3 offset = origin - center;
+			float b = glm::dot(offset, direction);
+			float c = glm::dot(offset, offset) - radius * radius;
+			if (c > 0.0f && b > 0.0f) {
+				// Outside and pointing away.
+				return false;
+			}
+			float discriminant = b * b - c;
+			if (discriminant < 0.0f) {
+				return false;
+			}
+			float distance = -b - std::sqrt(discriminant);
+			return distance <= maxDistance;
+		}
+
+		// -1 if the box is outside a plane, 1 if inside every plane, 0 if it straddles one.
+		int ClassifyBox(const glm::vec4 planes[6], const AABB& box) {
+			int result = 1;
+			for (int i = 0; i < 6; ++i) {
+				const glm::vec4& plane = planes[i];
+				// The corners farthest along and against the plane normal.
+				glm::vec3 positive(plane.x >= 0.0f ? box.maximum.x : box.minimum.x, plane.y >= 0.0f ? box.maximum.y : box.minimum.y, plane.z >= 0.0f ? box.maximum.z : box.minimum.z);
+				glm::vec3 negative(plane.x >= 0.0f ? box.minimum.x : box.maximum.x, plane.y >= 0.0f ? box.minimum.y : box.maximum.y, plane.z >= 0.0f ? box.minimum.z : box.maximum.z);
+				if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f) {
+					return -1;
+				}
+				if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.0f) {
+					result = 0;
+				}
+			}
+			return result;
+		}
+	}
+
+	BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin) : root(NULL_NODE), freeList(NULL_NODE), proxyCount(0), margin(margin),
+		reinsertions(0), rebuildCost(0.0f) {
+		this->narrowPhase.SetThreadCount(1);
+	}
+
+	int BoundingVolumeHierarchy::AllocateNode() {
+		int node = this->freeList;
+		if (node == NULL_NODE) {
+			node = static_cast<int>(this->nodes.size());
+			this->nodes.push_back(Node());
+		}
+		else {
+			this->freeList = this->nodes[node].parent;
+		}
+		Node& allocated = this->nodes[node];
+		allocated.parent = NULL_NODE;
+		allocated.left = NULL_NODE;
+		allocated.right = NULL_NODE;
+		allocated.height = 0;
+		allocated.userData = nullptr;
+		allocated.mask = 0;
+		allocated.radius = 0.0f;
+		return node;
+	}
+
+	void BoundingVolumeHierarchy::FreeNode(int node) {
+		this->nodes[node].parent = this->freeList;
+		this->nodes[node].height = -1;
+		this->freeList = node;
+	}
+
+	int BoundingVolumeHierarchy::Insert(const glm::vec3& center, float radius, void* userData, unsigned int mask) {
+		int leaf = AllocateNode();
+		Node& node = this->nodes[leaf];
+		node.center = center;
+		node.radius = radius;
+		node.userData = userData;
+		node.mask = mask;
+		node.box = AABB::FromSphere(center, radius + this->margin);
+		InsertLeaf(leaf);
+		this->proxyCount++;
+		return leaf;
+	}
+
+	void BoundingVolumeHierarchy::Remove(int proxy) {
+		RemoveLeaf(proxy);
+		FreeNode(proxy);
+		this->proxyCount--;
+	}
+
+	bool BoundingVolumeHierarchy::Move(int proxy, const glm::vec3& center, float radius) {
+		Node& node = this->nodes[proxy];
+		glm::vec3 displacement = center - node.center;
+		node.center = center;
+		node.radius = radius;
+		if (node.box.Contains(AABB::FromSphere(center, radius))) {
+			return false;
+		}
+
+		RemoveLeaf(proxy);
+		// Predict the next moves so an object moving steadily is not reinserted every frame.
+		AABB fat = AABB::FromSphere(center, radius + this->margin);
+		glm::vec3 predicted = fat.minimum + displacement * kDisplacementMultiplier;
+		fat.minimum = glm::vec3(std::min(fat.minimum.x, predicted.x), std::min(fat.minimum.y, predicted.y), std::min(fat.minimum.z, predicted.z));
+		predicted = fat.maximum + displacement * kDisplacementMultiplier;
+		fat.maximum = glm::vec3(std::max(fat.maximum.x, predicted.x), std::max(fat.maximum.y, predicted.y), std::max(fat.maximum.z, predicted.z));
+		this->nodes[proxy].box = fat;
+		InsertLeaf(proxy);
+		this->reinsertions++;
+		return true;
+	}
+
+	void BoundingVolumeHierarchy::InsertLeaf(int leaf) {
+		if (this->root == NULL_NODE) {
+			this->root = leaf;
+			this->nodes[leaf].parent = NULL_NODE;
+			return;
+		}
+
+		// Descend towards the sibling with the lowest surface area cost.
+		const AABB leafBox = this->nodes[leaf].box;
+		int index = this->root;
+		while (!this->nodes[index].IsLeaf()) {
+			const Node& node = this->nodes[index];
+			const float area = node.box.SurfaceArea();
+			const float combinedArea = AABB::Union(node.box, leafBox).SurfaceArea();
+
+			// Cost of making a new parent for this node and the leaf.
+			const float cost = 2.0f * combinedArea;
+			// Minimum cost of pushing the leaf further down, every ancestor grows by this much.
+			const float inheritance = 2.0f * (combinedArea - area);
+
+			float childCost[2];
+			const int children[2] = { node.left, node.right };
+			for (int i = 0; i < 2; ++i) {
+				const Node& child = this->nodes[children[i]];
+				float grown = AABB::Union(leafBox, child.box).SurfaceArea();
+				childCost[i] = (child.IsLeaf() ? grown : grown - child.box.SurfaceArea()) + inheritance;
+			}
+
+			if (cost < childCost[0] && cost < childCost[1]) {
+				break;
+			}
+			index = (childCost[0] < childCost[1]) ? node.left : node.right;
+		}
+
+		const int sibling = index;
+		const int oldParent = this->nodes[sibling].parent;
+		const int newParent = AllocateNode();
+		this->nodes[newParent].parent = oldParent;
+		this->nodes[newParent].left = sibling;
+		this->nodes[newParent].right = leaf;
+		this->nodes[sibling].parent = newParent;
+		this->nodes[leaf].parent = newParent;
+		if (oldParent == NULL_NODE) {
+			this->root = newParent;
+		}
+		else if (this->nodes[oldParent].left == sibling) {
+			this->nodes[oldParent].left = newParent;
+		}
+		else {
+			this->nodes[oldParent].right = newParent;
+		}
+		Refit(newParent);
+	}
+
+	void BoundingVolumeHierarchy::RemoveLeaf(int leaf) {
+		if (leaf == this->root) {
+			this->root = NULL_NODE;
+			return;
+		}
+
+		const int parent = this->nodes[leaf].parent;
+		const int grandParent = this->nodes[parent].parent;
+		const int sibling = (this->nodes[parent].left == leaf) ? this->nodes[parent].right : this->nodes[parent].left;
+
+		// The sibling takes the place of the parent.
+		this->nodes[sibling].parent = grandParent;
+		if (grandParent == NULL_NODE) {
+			this->root = sibling;
+		}
+		else {
+			if (this->nodes[grandParent].left == parent) {
+				this->nodes[grandParent].left = sibling;
+			}
+			else {
+				this->nodes[grandParent].right = sibling;
+			}
+		}
+		FreeNode(parent);
+		this->nodes[leaf].parent = NULL_NODE;
+		if (grandParent != NULL_NODE) {
+			Refit(grandParent);
+		}
+	}
+
+	void BoundingVolumeHierarchy::UpdateNode(int node) {
+		Node& updated = this->nodes[node];
+		const Node& left = this->nodes[updated.left];
+		const Node& right = this->nodes[updated.right];
+		updated.box = AABB::Union(left.box, right.box);
+		updated.height = 1 + std::max(left.height, right.height);
+		updated.mask = left.mask | right.mask;
+	}
+
+	void BoundingVolumeHierarchy::Refit(int node) {
+		while (node != NULL_NODE) {
+			UpdateNode(node);
+			node = Balance(node);
+			node = this->nodes[node].parent;
+		}
+	}
+
+	int BoundingVolumeHierarchy::Balance(int a) {
+		if (this->nodes[a].IsLeaf() || this->nodes[a].height < 2) {
+			return a;
+		}
+
+		const int b = this->nodes[a].left;
+		const int c = this->nodes[a].right;
+		const int balance = this->nodes[c].height - this->nodes[b].height;
+		if (balance >= -1 && balance <= 1) {
+			return a;
+		}
+
+		// Rotate the taller child up, a takes its shorter grandchild.
+		const int up = (balance > 1) ? c : b;
+		const int other = (balance > 1) ? b : c;
+		const int upLeft = this->nodes[up].left;
+		const int upRight = this->nodes[up].right;
+		const bool keepLeft = this->nodes[upLeft].height > this->nodes[upRight].height;
+		const int kept = keepLeft ? upLeft : upRight;
+		const int moved = keepLeft ? upRight : upLeft;
+
+		const int parent = this->nodes[a].parent;
+		this->nodes[up].parent = parent;
+		if (parent == NULL_NODE) {
+			this->root = up;
+		}
+		else if (this->nodes[parent].left == a) {
+			this->nodes[parent].left = up;
+		}
+		else {
+			this->nodes[parent].right = up;
+		}
+
+		this->nodes[up].left = a;
+		this->nodes[up].right = kept;
+		this->nodes[a].parent = up;
+		this->nodes[a].left = other;
+		this->nodes[a].right = moved;
+		this->nodes[moved].parent = a;
+
+		UpdateNode(a);
+		UpdateNode(up);
+		return up;
+	}
+
+	float BoundingVolumeHierarchy::Cost() const {
+		if (this->root == NULL_NODE) {
+			return 0.0f;
+		}
+		const float rootArea = this->nodes[this->root].box.SurfaceArea();
+		if (rootArea <= 0.0f) {
+			return 0.0f;
+		}
+		float total = 0.0f;
+		for (auto itr = this->nodes.begin(); itr != this->nodes.end(); ++itr) {
+			if (itr->height > 0) {
+				total += itr->box.SurfaceArea();
+			}
+		}
+		return total / rootArea;
+	}
+
+	void BoundingVolumeHierarchy::Rebuild() {
+		std::vector<int> leaves;
+		leaves.reserve(this->proxyCount);
+		for (int i = 0; i < static_cast<int>(this->nodes.size()); ++i) {
+			if (this->nodes[i].height == 0) {
+				leaves.push_back(i);
+			}
+			else if (this->nodes[i].height > 0) {
+				FreeNode(i);
+			}
+		}
+		this->root = leaves.empty() ? NULL_NODE : BuildRange(leaves, 0, leaves.size());
+		if (this->root != NULL_NODE) {
+			this->nodes[this->root].parent = NULL_NODE;
+		}
+		this->reinsertions = 0;
+		this->rebuildCost = Cost();
+	}
+
+	bool BoundingVolumeHierarchy::RebuildIfDegraded(float threshold) {
+		if (this->reinsertions < std::max<size_t>(16, this->proxyCount / 8)) {
+			return false;
+		}
+		this->reinsertions = 0;
+		if (this->rebuildCost > 0.0f && Cost() <= this->rebuildCost * threshold) {
+			return false;
+		}
+		Rebuild();
+		return true;
+	}
+
+	int BoundingVolumeHierarchy::BuildRange(std::vector<int>& leaves, size_t first, size_t last) {
+		if (last - first == 1) {
+			return leaves[first];
+		}
+
+		// Split along the longest axis of the box centers.
+		AABB centers(this->nodes[leaves[first]].center, this->nodes[leaves[first]].center);
+		for (size_t i = first + 1; i < last; ++i) {
+			const glm::vec3& center = this->nodes[leaves[i]].center;
+			centers = AABB::Union(centers, AABB(center, center));
+		}
+		const glm::vec3 extent = centers.maximum - centers.minimum;
+		const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+		const float axisMinimum = Component(centers.minimum, axis);
+		const float axisExtent = Component(extent, axis);
+
+		size_t middle = first;
+		if (axisExtent > 0.0f) {
+			// Binned SAH: evaluate the split between every pair of neighbouring bins.
+			size_t binCounts[kBinCount] = { 0 };
+			AABB binBoxes[kBinCount];
+			const float scale = kBinCount / axisExtent;
+			auto binOf = [&](int leaf) {
+				unsigned int bin = static_cast<unsigned int>((Component(this->nodes[leaf].center, axis) - axisMinimum) * scale);
+				return std::min(bin, kBinCount - 1);
+			};
+			for (size_t i = first; i < last; ++i) {
+				unsigned int bin = binOf(leaves[i]);
+				binBoxes[bin] = binCounts[bin] ? AABB::Union(binBoxes[bin], this->nodes[leaves[i]].box) : this->nodes[leaves[i]].box;
+				binCounts[bin]++;
+			}
+
+			float rightCosts[kBinCount] = { 0.0f };
+			AABB accumulated;
+			size_t count = 0;
+			for (unsigned int bin = kBinCount - 1; bin > 0; --bin) {
+				if (binCounts[bin]) {
+					accumulated = count ? AABB::Union(accumulated, binBoxes[bin]) : binBoxes[bin];
+					count += binCounts[bin];
+				}
+				rightCosts[bin] = count ? accumulated.SurfaceArea() * count : 0.0f;
+			}
+
+			float bestCost = 0.0f;
+			unsigned int bestSplit = 0;
+			count = 0;
+			for (unsigned int bin = 0; bin + 1 < kBinCount; ++bin) {
+				if (binCounts[bin]) {
+					accumulated = count ? AABB::Union(accumulated, binBoxes[bin]) : binBoxes[bin];
+					count += binCounts[bin];
+				}
+				if (count == 0 || count == last - first) {
+					continue;
+				}
+				float cost = accumulated.SurfaceArea() * count + rightCosts[bin + 1];
+				if (bestSplit == 0 || cost < bestCost) {
+					bestCost = cost;
+					bestSplit = bin + 1;
+				}
+			}
+
+			if (bestSplit != 0) {
+				middle = std::partition(leaves.begin() + first, leaves.begin() + last, [&](int leaf) { return binOf(leaf) < bestSplit; }) - leaves.begin();
+			}
+		}
+		if (middle == first || middle == last) {
+			// Every center in the same spot, or in the same bin: split in the middle.
+			middle = first + (last - first) / 2;
+			std::nth_element(leaves.begin() + first, leaves.begin() + middle, leaves.begin() + last, [&](int a, int b) {
+				return Component(this->nodes[a].center, axis) < Component(this->nodes[b].center, axis);
+			});
+		}
+
+		const int left = BuildRange(leaves, first, middle);
+		const int right = BuildRange(leaves, middle, last);
+		const int node = AllocateNode();
+		this->nodes[node].left = left;
+		this->nodes[node].right = right;
+		this->nodes[left].parent = node;
+		this->nodes[right].parent = node;
+		UpdateNode(node);
+		return node;
+	}
+
+	void BoundingVolumeHierarchy::AddSubtree(int node, std::vector<void*>& results, unsigned int mask) const {
+		std::vector<int> stack(1, node);
+		while (!stack.empty()) {
+			const Node& current = this->nodes[stack.back()];
+			stack.pop_back();
+			if ((current.mask & mask) == 0) {
+				continue;
+			}
+			if (current.IsLeaf()) {
+				results.push_back(current.userData);
+				continue;
+			}
+			stack.push_back(current.left);
+			stack.push_back(current.right);
+		}
+	}
+
+	void BoundingVolumeHierarchy::QueryFrustum(const glm::vec4 planes[6], std::vector<void*>& results, unsigned int mask) {
+		if (this->root == NULL_NODE) {
+			return;
+		}
+		this->narrowPhase.Clear();
+		this->candidates.clear();
+
+		std::vector<int> stack(1, this->root);
+		while (!stack.empty()) {
+			const int index = stack.back();
+			stack.pop_back();
+			const Node& node = this->nodes[index];
+			if ((node.mask & mask) == 0) {
+				continue;
+			}
+			const int side = ClassifyBox(planes, node.box);
+			if (side < 0) {
+				continue;
+			}
+			if (side > 0) {
+				AddSubtree(index, results, mask);
+				continue;
+			}
+			if (node.IsLeaf()) {
+				this->narrowPhase.Add(node.center, node.radius);
+				this->candidates.push_back(node.userData);
+				continue;
+			}
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+
+		this->narrowPhase.Cull(planes, this->visibility);
+		for (size_t i = 0; i < this->candidates.size(); ++i) {
+			if (this->visibility[i]) {
+				results.push_back(this->candidates[i]);
+			}
+		}
+	}
+
+	void BoundingVolumeHierarchy::QuerySphere(const glm::vec3& center, float radius, std::vector<void*>& results, unsigned int mask) const {
+		if (this->root == NULL_NODE) {
+			return;
+		}
+		std::vector<int> stack(1, this->root);
+		while (!stack.empty()) {
+			const Node& node = this->nodes[stack.back()];
+			stack.pop_back();
+			if ((node.mask & mask) == 0 || !SphereOverlapsBox(center, radius, node.box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (SpheresOverlap(center, radius, node.center, node.radius)) {
+					results.push_back(node.userData);
+				}
+				continue;
+			}
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+
+	void BoundingVolumeHierarchy::QueryAABB(const AABB& box, std::vector<void*>& results, unsigned int mask) const {
+		if (this->root == NULL_NODE) {
+			return;
+		}
+		std::vector<int> stack(1, this->root);
+		while (!stack.empty()) {
+			const Node& node = this->nodes[stack.back()];
+			stack.pop_back();
+			if ((node.mask & mask) == 0 || !box.Overlaps(node.box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (SphereOverlapsBox(node.center, node.radius, box)) {
+					results.push_back(node.userData);
+				}
+				continue;
+			}
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+
+	void BoundingVolumeHierarchy::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<void*>& results, unsigned int mask) const {
+		if (this->root == NULL_NODE) {
+			return;
+		}
+		const glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		std::vector<int> stack(1, this->root);
+		while (!stack.empty()) {
+			const Node& node = this->nodes[stack.back()];
+			stack.pop_back();
+			if ((node.mask & mask) == 0 || !RayHitsBox(origin, inverseDirection, maxDistance, node.box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (RayHitsSphere(origin, direction, maxDistance, node.center, node.radius)) {
+					results.push_back(node.userData);
+				}
+				continue;
+			}
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+} // namespace Sigma
@@ -0,0 +1,71 @@
+#include "CameraPath.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace Sigma {
+	bool CameraPath::Load(const std::string& path) {
+		std::ifstream file(path.c_str());
+		if (!file) {
+			return false;
+		}
+		std::stringstream text;
+		text << file.rdbuf();
+		return Parse(text.str());
+	}
+
+	bool CameraPath::Parse(const std::string& text) {
+		this->keys.clear();
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line)) {
+			const size_t first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos || line[first] == '#') {
+				continue;
+			}
+			std::istringstream values(line);
+			CameraKey key;
+			values >> key.time >> key.position.x >> key.position.y >> key.position.z
+				>> key.rotation.x >> key.rotation.y >> key.rotation.z;
+			if (values.fail() || !AddKey(key)) {
+				this->keys.clear();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool CameraPath::AddKey(const CameraKey& key) {
+		if (!this->keys.empty() && key.time <= this->keys.back().time) {
+			return false;
+		}
+		this->keys.push_back(key);
+		return true;
+	}
+
+	CameraKey CameraPath::Sample(double time) const {
+		if (this->keys.empty()) {
+			CameraKey origin = { 0.0, glm::vec3(0.0f), glm::vec3(0.0f) };
+			return origin;
+		}
+		if (time <= this->keys.front().time) {
+			return this->keys.front();
+		}
+		if (time >= this->keys.back().time) {
+			return this->keys.back();
+		}
+		// The last key at or before time, keys are few so a linear scan is enough.
+		size_t i = 0;
+		while (this->keys[i + 1].time <= time) {
+			++i;
+		}
+		const CameraKey& a = this->keys[i];
+		const CameraKey& b = this->keys[i + 1];
+		const float t = static_cast<float>((time - a.time) / (b.time - a.time));
+		CameraKey key;
+		key.time = time;
+		key.position = a.position + (b.position - a.position) * t;
+		key.rotation = a.rotation + (b.rotation - a.rotation) * t;
+		return key;
+	}
+} // namespace Sigma
@@ -0,0 +1,171 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIGMA_CULL_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SIGMA_CULL_SSE
+#endif
+
+namespace Sigma {
+	namespace {
+		glm::vec4 NormalizePlane(const glm::vec4& plane) {
+			float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			return plane / length;
+		}
+	}
+
+	void FrustumCuller::ExtractPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]) {
+		// Gribb and Hartmann: the planes are sums of the rows of the matrix, glm stores columns.
+		glm::vec4 rows[4];
+		for (int row = 0; row < 4; ++row) {
+			rows[row] = glm::vec4(viewProj[0][row], viewProj[1][row], viewProj[2][row], viewProj[3][row]);
+		}
+		planes[0] = NormalizePlane(rows[3] + rows[0]);
+		planes[1] = NormalizePlane(rows[3] - rows[0]);
+		planes[2] = NormalizePlane(rows[3] + rows[1]);
+		planes[3] = NormalizePlane(rows[3] - rows[1]);
+		planes[4] = NormalizePlane(rows[3] + rows[2]);
+		planes[5] = NormalizePlane(rows[3] - rows[2]);
+	}
+
+	bool FrustumCuller::SphereVisible(const glm::vec4 planes[6], const glm::vec3& center, float radius) {
+		for (int i = 0; i < 6; ++i) {
+			if (planes[i].x * center.x + planes[i].y * center.y + planes[i].z * center.z + planes[i].w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void FrustumCuller::Clear() {
+		this->centerX.clear();
+		this->centerY.clear();
+		this->centerZ.clear();
+		this->radii.clear();
+	}
+
+	unsigned int FrustumCuller::Add(const glm::vec3& center, float radius) {
+		this->centerX.push_back(center.x);
+		this->centerY.push_back(center.y);
+		this->centerZ.push_back(center.z);
+		this->radii.push_back(radius);
+		return static_cast<unsigned int>(this->radii.size() - 1);
+	}
+
+	size_t FrustumCuller::CullRange(const glm::vec4 planes[6], size_t first, size_t last, unsigned char* visible) const {
+		const float* x = this->centerX.empty() ? nullptr : &this->centerX[0];
+		const float* y = this->centerY.empty() ? nullptr : &this->centerY[0];
+		const float* z = this->centerZ.empty() ? nullptr : &this->centerZ[0];
+		const float* r = this->radii.empty() ? nullptr : &this->radii[0];
+		size_t count = 0;
+		size_t i = first;
+
+#if defined(SIGMA_CULL_AVX)
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p) {
+			planeX[p] = _mm256_set1_ps(planes[p].x);
+			planeY[p] = _mm256_set1_ps(planes[p].y);
+			planeZ[p] = _mm256_set1_ps(planes[p].z);
+			planeW[p] = _mm256_set1_ps(planes[p].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		for (; i + 8 <= last; i += 8) {
+			const __m256 cx = _mm256_loadu_ps(x + i);
+			const __m256 cy = _mm256_loadu_ps(y + i);
+			const __m256 cz = _mm256_loadu_ps(z + i);
+			const __m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(r + i));
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < 6; ++p) {
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+			const int mask = _mm256_movemask_ps(inside);
+			for (int k = 0; k < 8; ++k) {
+				visible[i + k] = static_cast<unsigned char>((mask >> k) & 1);
+				count += visible[i + k];
+			}
+		}
+#elif defined(SIGMA_CULL_SSE)
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; ++p) {
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= last; i += 4) {
+			const __m128 cx = _mm_loadu_ps(x + i);
+			const __m128 cy = _mm_loadu_ps(y + i);
+			const __m128 cz = _mm_loadu_ps(z + i);
+			const __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(r + i));
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < 6; ++p) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+			const int mask = _mm_movemask_ps(inside);
+			for (int k = 0; k < 4; ++k) {
+				visible[i + k] = static_cast<unsigned char>((mask >> k) & 1);
+				count += visible[i + k];
+			}
+		}
+#endif
+
+		// The tail, or everything when no SIMD instruction set is available.
+		for (; i < last; ++i) {
+			visible[i] = SphereVisible(planes, glm::vec3(x[i], y[i], z[i]), r[i]) ? 1 : 0;
+			count += visible[i];
+		}
+		return count;
+	}
+
+	size_t FrustumCuller::Cull(const glm::vec4 planes[6], std::vector<unsigned char>& visible) const {
+		const size_t size = this->radii.size();
+		visible.resize(size);
+		if (size == 0) {
+			return 0;
+		}
+
+		unsigned int threads = this->threadCount;
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		if (threads < 2 || size < PARALLEL_THRESHOLD) {
+			return CullRange(planes, 0, size, &visible[0]);
+		}
+
+		// Chunks are a multiple of 8 spheres so only the last one has a scalar tail.
+		const size_t chunk = ((size + threads - 1) / threads + 7) & ~static_cast<size_t>(7);
+		std::vector<size_t> counts(threads, 0);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; ++t) {
+			const size_t first = std::min(size, t * chunk);
+			const size_t last = std::min(size, first + chunk);
+			if (first >= last) {
+				break;
+			}
+			workers.push_back(std::thread([this, planes, first, last, &visible, &counts, t]() {
+				counts[t] = CullRange(planes, first, last, &visible[0]);
+			}));
+		}
+		counts[0] = CullRange(planes, 0, std::min(size, chunk), &visible[0]);
+		for (auto itr = workers.begin(); itr != workers.end(); ++itr) {
+			itr->join();
+		}
+
+		size_t total = 0;
+		for (auto itr = counts.begin(); itr != counts.end(); ++itr) {
+			total += *itr;
+		}
+		return total;
+	}
+} // namespace Sigma
@@ -4,4 +4,5 @@ namespace Sigma {
 	const glm::vec3 GLTransform::FORWARD_VECTOR(0.0f,0.0f,-1.0f);
 	const glm::vec3 GLTransform::UP_VECTOR(0.0f,1.0f,0.0f);
 	const glm::vec3 GLTransform::RIGHT_VECTOR(1.0f,0.0f,0.0f);
+	std::atomic<unsigned int> GLTransform::versionCounter(0);
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "HeadlessContext.h"
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+#include "Log.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace Sigma {
+	namespace {
+		// The surfaceless platform needs neither X11 nor a GPU device, fall back to the default display.
+		EGLDisplay OpenDisplay() {
+			const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+			if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+				PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+					reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+				if (getPlatformDisplay) {
+					EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+					if (display != EGL_NO_DISPLAY) {
+						return display;
+					}
+				}
+			}
+			return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+	}
+
+	bool HeadlessContext::Initialize(const int width, const int height, const unsigned int glMajor /*= 3*/, const unsigned int glMinor /*= 2*/) {
+		EGLDisplay display = OpenDisplay();
+		EGLint major = 0, minor = 0;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			LOG_ERROR << "Failed initializing EGL.";
+			return false;
+		}
+		this->display = display;
+		LOG << "EGL " << major << "." << minor << " " << eglQueryString(display, EGL_VENDOR);
+
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			LOG_ERROR << "EGL does not support desktop OpenGL.";
+			Destroy();
+			return false;
+		}
+
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24,
+			EGL_STENCIL_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+			LOG_ERROR << "No EGL config with a pbuffer and desktop OpenGL.";
+			Destroy();
+			return false;
+		}
+
+		const EGLint surfaceAttributes[] = {
+			EGL_WIDTH, width,
+			EGL_HEIGHT, height,
+			EGL_NONE
+		};
+		this->surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		if (this->surface == EGL_NO_SURFACE) {
+			LOG_ERROR << "Failed creating a " << width << "x" << height << " pbuffer.";
+			Destroy();
+			return false;
+		}
+
+		// Same version and profile as the GLFW window.
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, static_cast<EGLint>(glMajor),
+			EGL_CONTEXT_MINOR_VERSION_KHR, static_cast<EGLint>(glMinor),
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+			EGL_NONE
+		};
+		this->context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (this->context == EGL_NO_CONTEXT) {
+			LOG_ERROR << "Failed creating an OpenGL " << glMajor << "." << glMinor << " context.";
+			Destroy();
+			return false;
+		}
+
+		this->width = width;
+		this->height = height;
+		MakeContextCurrent(true);
+
+		glewExperimental = GL_TRUE;
+		GLenum error = glewInit();
+		// GLEW built for GLX fails to open an X display it does not need, the GL entry points still load.
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		if (error == GLEW_ERROR_NO_GLX_DISPLAY) {
+			error = GLEW_OK;
+		}
+#endif
+		if (error != GLEW_OK) {
+			LOG_ERROR << "Failed initializing GLEW: " << glewGetErrorString(error);
+			Destroy();
+			return false;
+		}
+		// glewInit may leave an error behind from querying the core profile extensions.
+		glGetError();
+
+		LOG << "Headless " << glGetString(GL_RENDERER) << " " << width << "x" << height;
+		return true;
+	}
+
+	void HeadlessContext::Destroy() {
+		if (!this->display) {
+			return;
+		}
+		eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (this->context) {
+			eglDestroyContext(this->display, this->context);
+		}
+		if (this->surface) {
+			eglDestroySurface(this->display, this->surface);
+		}
+		eglTerminate(this->display);
+		this->display = nullptr;
+		this->surface = nullptr;
+		this->context = nullptr;
+	}
+
+	void HeadlessContext::MakeContextCurrent(bool current) {
+		if (current) {
+			eglMakeCurrent(this->display, this->surface, this->surface, this->context);
+		}
+		else {
+			eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		}
+	}
+
+	void HeadlessContext::SwapBuffers() {
+		glFinish();
+	}
+
+	void HeadlessContext::ReadPixels(std::vector<unsigned char>& rgb) {
+		rgb.resize(static_cast<size_t>(this->width) * this->height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, this->width, this->height, GL_RGB, GL_UNSIGNED_BYTE, &rgb[0]);
+	}
+}
@@ -1,5 +1,7 @@
 #include "IGLComponent.h"
 
+#include <fstream>
+
 namespace Sigma{
 	// static member initialization
     IGLComponent::ShaderMap IGLComponent::loadedShaders;
@@ -28,6 +30,30 @@ namespace Sigma{
 				IGLComponent::loadedShaders[filename] = this->shader;
 			}
         }
+
+		// The optional instanced variant reads the model matrix from a per instance attribute.
+		const std::string instancedFilename = filename + "_instanced";
+		existingShader = IGLComponent::loadedShaders.find(instancedFilename);
+		if (existingShader != IGLComponent::loadedShaders.end()) {
+			this->instancedShader = existingShader->second;
+		}
+		else {
+			this->instancedShader.reset();
+			if (std::ifstream(instancedFilename + ".vert")) {
+				GLSLShader* theShader = new GLSLShader();
+				theShader->LoadFromFile(GL_VERTEX_SHADER, instancedFilename + ".vert");
+				theShader->LoadFromFile(GL_FRAGMENT_SHADER, instancedFilename + ".frag");
+				theShader->CreateAndLinkProgram();
+				if (theShader->isLoaded()) {
+					this->instancedShader = std::shared_ptr<GLSLShader>(theShader);
+				}
+				else {
+					delete theShader;
+				}
+			}
+			// Missing variants are stored too, so the file is only probed once.
+			IGLComponent::loadedShaders[instancedFilename] = this->instancedShader;
+		}
     }
 
 } // namespace Sigma
@@ -0,0 +1,101 @@
+#include "ImpostorCache.h"
+
+#include <cmath>
+
+namespace Sigma {
+	ImpostorCache::ImpostorCache() : atlasSize(0), cellSize(0), cellsPerRow(0), cosThreshold(0.0f), captureBudget(0), captures(0), frame(0) {
+		SetAngleThreshold(5.0f);
+	}
+
+	void ImpostorCache::Resize(unsigned int atlasSize, unsigned int cellSize) {
+		this->atlasSize = atlasSize;
+		this->cellSize = cellSize;
+		this->cellsPerRow = cellSize > 0 ? atlasSize / cellSize : 0;
+		Cell free = { nullptr, 0 };
+		this->cells.assign(this->cellsPerRow * this->cellsPerRow, free);
+		this->entries.clear();
+	}
+
+	void ImpostorCache::SetAngleThreshold(float degrees) {
+		this->cosThreshold = std::cos(degrees * 3.14159265f / 180.0f);
+	}
+
+	void ImpostorCache::BeginFrame() {
+		// Frame 0 marks cells that were never requested.
+		this->frame++;
+		this->captures = 0;
+	}
+
+	int ImpostorCache::Request(const void* key, const glm::vec3& direction, bool& capture) {
+		const bool budgetLeft = this->captureBudget == 0 || this->captures < this->captureBudget;
+		auto found = this->entries.find(key);
+		if (found != this->entries.end()) {
+			Entry& entry = found->second;
+			this->cells[entry.cell].frame = this->frame;
+			// Past the threshold the old image is still closer to right than nothing, so it is kept
+			// when the budget is spent.
+			capture = budgetLeft && glm::dot(direction, entry.direction) < this->cosThreshold;
+			if (capture) {
+				entry.direction = direction;
+				this->captures++;
+			}
+			return entry.cell;
+		}
+
+		capture = false;
+		if (!budgetLeft) {
+			return -1;
+		}
+		const int cell = FindCell();
+		if (cell < 0) {
+			return -1;
+		}
+		if (this->cells[cell].key) {
+			this->entries.erase(this->cells[cell].key);
+		}
+		this->cells[cell].key = key;
+		this->cells[cell].frame = this->frame;
+		Entry entry = { cell, direction };
+		this->entries[key] = entry;
+		capture = true;
+		this->captures++;
+		return cell;
+	}
+
+	void ImpostorCache::Remove(const void* key) {
+		auto found = this->entries.find(key);
+		if (found == this->entries.end()) {
+			return;
+		}
+		this->cells[found->second.cell].key = nullptr;
+		this->cells[found->second.cell].frame = 0;
+		this->entries.erase(found);
+	}
+
+	int ImpostorCache::FindCell() {
+		int oldest = -1;
+		for (size_t i = 0; i < this->cells.size(); ++i) {
+			const Cell& cell = this->cells[i];
+			if (!cell.key) {
+				return static_cast<int>(i);
+			}
+			if (cell.frame != this->frame && (oldest < 0 || cell.frame < this->cells[oldest].frame)) {
+				oldest = static_cast<int>(i);
+			}
+		}
+		return oldest;
+	}
+
+	glm::vec4 ImpostorCache::CellRect(int cell) const {
+		unsigned int x, y;
+		CellOrigin(cell, x, y);
+		const float scale = 1.0f / static_cast<float>(this->atlasSize);
+		return glm::vec4(x * scale, (y + this->cellSize) * scale, (x + this->cellSize) * scale, y * scale);
+	}
+
+	void ImpostorCache::CellOrigin(int cell, unsigned int& x, unsigned int& y) const {
+		const unsigned int index = static_cast<unsigned int>(cell);
+		x = (index % this->cellsPerRow) * this->cellSize;
+		y = (index / this->cellsPerRow) * this->cellSize;
+	}
+} // namespace Sigma
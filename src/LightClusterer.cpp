@@ -0,0 +1,271 @@
+#include "LightClusterer.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SIGMA_CLUSTER_SSE
+#endif
+
+namespace Sigma {
+	namespace {
+		// Padding lights, far enough away to never touch a cluster.
+		const float NOWHERE = 1e18f;
+
+		// Lights of one slice, padded to a multiple of 4.
+		struct SliceLights {
+			void Clear() {
+				x.clear(); y.clear(); z.clear(); radius.clear();
+				dirX.clear(); dirY.clear(); dirZ.clear(); cosine.clear(); sine.clear();
+				ids.clear();
+			}
+
+			void Add(float px, float py, float pz, float r, float dx, float dy, float dz, float c, float s, unsigned int id) {
+				x.push_back(px); y.push_back(py); z.push_back(pz); radius.push_back(r);
+				dirX.push_back(dx); dirY.push_back(dy); dirZ.push_back(dz); cosine.push_back(c); sine.push_back(s);
+				ids.push_back(id);
+			}
+
+			std::vector<float> x, y, z, radius;
+			std::vector<float> dirX, dirY, dirZ, cosine, sine;
+			std::vector<unsigned int> ids;
+		};
+	}
+
+	const unsigned int LightClusterer::TILES_X;
+	const unsigned int LightClusterer::TILES_Y;
+	const unsigned int LightClusterer::SLICES;
+	const unsigned int LightClusterer::CLUSTER_COUNT;
+	const size_t LightClusterer::PARALLEL_THRESHOLD;
+
+	LightClusterer::LightClusterer() : nearPlane(0.1f), farPlane(1000.0f), sliceScale(1.0f), threadCount(0) {
+		glm::mat4 projection(1.0f);
+		// A 90 degree square frustum until SetProjection is called.
+		projection[2][2] = -(this->farPlane + this->nearPlane) / (this->farPlane - this->nearPlane);
+		projection[2][3] = -1.0f;
+		projection[3][2] = -2.0f * this->farPlane * this->nearPlane / (this->farPlane - this->nearPlane);
+		projection[3][3] = 0.0f;
+		SetProjection(projection);
+	}
+
+	void LightClusterer::SetProjection(const glm::mat4& projection) {
+		this->nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		this->farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+		this->sliceScale = SLICES / std::log(this->farPlane / this->nearPlane);
+
+		this->sliceDepths.resize(SLICES + 1);
+		for (unsigned int slice = 0; slice <= SLICES; ++slice) {
+			this->sliceDepths[slice] = this->nearPlane * std::pow(this->farPlane / this->nearPlane, static_cast<float>(slice) / SLICES);
+		}
+
+		this->boxMinX.resize(CLUSTER_COUNT); this->boxMinY.resize(CLUSTER_COUNT); this->boxMinZ.resize(CLUSTER_COUNT);
+		this->boxMaxX.resize(CLUSTER_COUNT); this->boxMaxY.resize(CLUSTER_COUNT); this->boxMaxZ.resize(CLUSTER_COUNT);
+		this->sphereX.resize(CLUSTER_COUNT); this->sphereY.resize(CLUSTER_COUNT); this->sphereZ.resize(CLUSTER_COUNT);
+		this->sphereRadius.resize(CLUSTER_COUNT);
+
+		// A point at depth d with normalized device x lies at x = d * (ndcX + P[2][0]) / P[0][0] in view space.
+		for (unsigned int slice = 0; slice < SLICES; ++slice) {
+			const float depths[2] = { this->sliceDepths[slice], this->sliceDepths[slice + 1] };
+			for (unsigned int y = 0; y < TILES_Y; ++y) {
+				const float ndcY[2] = { 2.0f * y / TILES_Y - 1.0f, 2.0f * (y + 1) / TILES_Y - 1.0f };
+				for (unsigned int x = 0; x < TILES_X; ++x) {
+					const float ndcX[2] = { 2.0f * x / TILES_X - 1.0f, 2.0f * (x + 1) / TILES_X - 1.0f };
+					glm::vec3 minimum(1e30f, 1e30f, -depths[1]);
+					glm::vec3 maximum(-1e30f, -1e30f, -depths[0]);
+					for (int d = 0; d < 2; ++d) {
+						for (int k = 0; k < 2; ++k) {
+							const float vx = depths[d] * (ndcX[k] + projection[2][0]) / projection[0][0];
+							const float vy = depths[d] * (ndcY[k] + projection[2][1]) / projection[1][1];
+							minimum.x = std::min(minimum.x, vx);
+							maximum.x = std::max(maximum.x, vx);
+							minimum.y = std::min(minimum.y, vy);
+							maximum.y = std::max(maximum.y, vy);
+						}
+					}
+
+					const unsigned int cluster = ClusterIndex(x, y, slice);
+					this->boxMinX[cluster] = minimum.x; this->boxMinY[cluster] = minimum.y; this->boxMinZ[cluster] = minimum.z;
+					this->boxMaxX[cluster] = maximum.x; this->boxMaxY[cluster] = maximum.y; this->boxMaxZ[cluster] = maximum.z;
+					const glm::vec3 half = (maximum - minimum) * 0.5f;
+					this->sphereX[cluster] = minimum.x + half.x;
+					this->sphereY[cluster] = minimum.y + half.y;
+					this->sphereZ[cluster] = minimum.z + half.z;
+					this->sphereRadius[cluster] = std::sqrt(half.x * half.x + half.y * half.y + half.z * half.z);
+				}
+			}
+		}
+	}
+
+	void LightClusterer::Clear() {
+		this->positionX.clear(); this->positionY.clear(); this->positionZ.clear(); this->radii.clear();
+		this->directionX.clear(); this->directionY.clear(); this->directionZ.clear();
+		this->coneCos.clear(); this->coneSin.clear();
+	}
+
+	unsigned int LightClusterer::AddPointLight(const glm::vec3& position, float radius) {
+		return AddSpotLight(position, glm::vec3(0.0f, 0.0f, 0.0f), radius, -1.0f);
+	}
+
+	unsigned int LightClusterer::AddSpotLight(const glm::vec3& position, const glm::vec3& direction, float range, float cosOuterAngle) {
+		// The cone test only holds for cones narrower than a half space, wider ones are binned as spheres.
+		const bool cone = cosOuterAngle > 0.0f;
+		this->positionX.push_back(position.x);
+		this->positionY.push_back(position.y);
+		this->positionZ.push_back(position.z);
+		this->radii.push_back(range);
+		this->directionX.push_back(cone ? direction.x : 0.0f);
+		this->directionY.push_back(cone ? direction.y : 0.0f);
+		this->directionZ.push_back(cone ? direction.z : 0.0f);
+		this->coneCos.push_back(cone ? cosOuterAngle : -1.0f);
+		this->coneSin.push_back(cone ? std::sqrt(1.0f - cosOuterAngle * cosOuterAngle) : 0.0f);
+		return static_cast<unsigned int>(this->radii.size() - 1);
+	}
+
+	bool LightClusterer::Intersects(unsigned int light, unsigned int cluster) const {
+		const float x = this->positionX[light], y = this->positionY[light], z = this->positionZ[light];
+		const float radius = this->radii[light];
+
+		// Sphere against box.
+		const float dx = std::max(std::max(this->boxMinX[cluster] - x, 0.0f), x - this->boxMaxX[cluster]);
+		const float dy = std::max(std::max(this->boxMinY[cluster] - y, 0.0f), y - this->boxMaxY[cluster]);
+		const float dz = std::max(std::max(this->boxMinZ[cluster] - z, 0.0f), z - this->boxMaxZ[cluster]);
+		if (dx * dx + dy * dy + dz * dz > radius * radius) {
+			return false;
+		}
+
+		// Cone against the cluster sphere, always passes for point lights.
+		const float vx = this->sphereX[cluster] - x, vy = this->sphereY[cluster] - y, vz = this->sphereZ[cluster] - z;
+		const float lengthSquared = vx * vx + vy * vy + vz * vz;
+		const float along = vx * this->directionX[light] + vy * this->directionY[light] + vz * this->directionZ[light];
+		const float closest = this->coneCos[light] * std::sqrt(std::max(lengthSquared - along * along, 0.0f)) - along * this->coneSin[light];
+		const float sphere = this->sphereRadius[cluster];
+		return !(closest > sphere || along > sphere + radius || along < -sphere);
+	}
+
+	void LightClusterer::BinSlices(unsigned int first, unsigned int last, std::vector<unsigned int>& lists) {
+		SliceLights lights;
+		for (unsigned int slice = first; slice < last; ++slice) {
+			// Only the lights overlapping the depth range of the slice are tested against its clusters.
+			const float sliceNear = -this->sliceDepths[slice];
+			const float sliceFar = -this->sliceDepths[slice + 1];
+			lights.Clear();
+			for (size_t i = 0; i < this->radii.size(); ++i) {
+				if (this->positionZ[i] - this->radii[i] <= sliceNear && this->positionZ[i] + this->radii[i] >= sliceFar) {
+					lights.Add(this->positionX[i], this->positionY[i], this->positionZ[i], this->radii[i],
+						this->directionX[i], this->directionY[i], this->directionZ[i], this->coneCos[i], this->coneSin[i], static_cast<unsigned int>(i));
+				}
+			}
+			while (lights.ids.size() % 4) {
+				lights.Add(NOWHERE, NOWHERE, NOWHERE, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0);
+			}
+
+			for (unsigned int cluster = ClusterIndex(0, 0, slice); cluster < ClusterIndex(0, 0, slice + 1); ++cluster) {
+				const size_t start = lists.size();
+				size_t i = 0;
+#if defined(SIGMA_CLUSTER_SSE)
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 minX = _mm_set1_ps(this->boxMinX[cluster]), maxX = _mm_set1_ps(this->boxMaxX[cluster]);
+				const __m128 minY = _mm_set1_ps(this->boxMinY[cluster]), maxY = _mm_set1_ps(this->boxMaxY[cluster]);
+				const __m128 minZ = _mm_set1_ps(this->boxMinZ[cluster]), maxZ = _mm_set1_ps(this->boxMaxZ[cluster]);
+				const __m128 centerX = _mm_set1_ps(this->sphereX[cluster]);
+				const __m128 centerY = _mm_set1_ps(this->sphereY[cluster]);
+				const __m128 centerZ = _mm_set1_ps(this->sphereZ[cluster]);
+				const __m128 sphere = _mm_set1_ps(this->sphereRadius[cluster]);
+				const __m128 negSphere = _mm_sub_ps(zero, sphere);
+				for (; i < lights.ids.size(); i += 4) {
+					const __m128 x = _mm_loadu_ps(&lights.x[i]);
+					const __m128 y = _mm_loadu_ps(&lights.y[i]);
+					const __m128 z = _mm_loadu_ps(&lights.z[i]);
+					const __m128 radius = _mm_loadu_ps(&lights.radius[i]);
+
+					// Sphere against box.
+					const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), zero), _mm_sub_ps(x, maxX));
+					const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), zero), _mm_sub_ps(y, maxY));
+					const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), zero), _mm_sub_ps(z, maxZ));
+					const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					__m128 hit = _mm_cmple_ps(distance, _mm_mul_ps(radius, radius));
+					if (_mm_movemask_ps(hit) == 0) {
+						continue;
+					}
+
+					// Cone against the cluster sphere.
+					const __m128 vx = _mm_sub_ps(centerX, x), vy = _mm_sub_ps(centerY, y), vz = _mm_sub_ps(centerZ, z);
+					const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+					const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&lights.dirX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&lights.dirY[i]))),
+						_mm_mul_ps(vz, _mm_loadu_ps(&lights.dirZ[i])));
+					const __m128 side = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lengthSquared, _mm_mul_ps(along, along)), zero));
+					const __m128 closest = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&lights.cosine[i]), side), _mm_mul_ps(along, _mm_loadu_ps(&lights.sine[i])));
+					hit = _mm_and_ps(hit, _mm_cmple_ps(closest, sphere));
+					hit = _mm_and_ps(hit, _mm_cmple_ps(along, _mm_add_ps(sphere, radius)));
+					hit = _mm_and_ps(hit, _mm_cmpge_ps(along, negSphere));
+
+					const int mask = _mm_movemask_ps(hit);
+					for (int k = 0; k < 4; ++k) {
+						if (mask & (1 << k)) {
+							lists.push_back(lights.ids[i + k]);
+						}
+					}
+				}
+#endif
+				// Without SSE every light goes through the reference test.
+				for (; i < lights.ids.size(); ++i) {
+					if (lights.x[i] != NOWHERE && Intersects(lights.ids[i], cluster)) {
+						lists.push_back(lights.ids[i]);
+					}
+				}
+				this->clusters[cluster * 2] = static_cast<unsigned int>(start);
+				this->clusters[cluster * 2 + 1] = static_cast<unsigned int>(lists.size() - start);
+			}
+		}
+	}
+
+	size_t LightClusterer::Bin() {
+		this->clusters.assign(CLUSTER_COUNT * 2, 0);
+		this->indices.clear();
+		if (this->radii.empty()) {
+			return 0;
+		}
+
+		unsigned int threads = this->threadCount;
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = std::min(threads, SLICES);
+		if (threads < 2 || this->radii.size() < PARALLEL_THRESHOLD) {
+			BinSlices(0, SLICES, this->indices);
+			return this->indices.size();
+		}
+
+		// Each thread bins a range of slices into its own list, the lists are then concatenated.
+		const unsigned int chunk = (SLICES + threads - 1) / threads;
+		std::vector<std::vector<unsigned int>> lists(threads);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; ++t) {
+			const unsigned int first = std::min(SLICES, t * chunk);
+			const unsigned int last = std::min(SLICES, first + chunk);
+			if (first >= last) {
+				break;
+			}
+			workers.push_back(std::thread([this, first, last, &lists, t]() {
+				BinSlices(first, last, lists[t]);
+			}));
+		}
+		BinSlices(0, std::min(SLICES, chunk), lists[0]);
+		for (auto itr = workers.begin(); itr != workers.end(); ++itr) {
+			itr->join();
+		}
+
+		for (unsigned int t = 0; t < threads; ++t) {
+			const unsigned int base = static_cast<unsigned int>(this->indices.size());
+			const unsigned int first = std::min(SLICES, t * chunk);
+			const unsigned int last = std::min(SLICES, first + chunk);
+			for (unsigned int cluster = ClusterIndex(0, 0, first); cluster < ClusterIndex(0, 0, last); ++cluster) {
+				this->clusters[cluster * 2] += base;
+			}
+			this->indices.insert(this->indices.end(), lists[t].begin(), lists[t].end());
+		}
+		return this->indices.size();
+	}
+} // namespace Sigma
@@ -0,0 +1,707 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace Sigma {
+	namespace mesh {
+		namespace {
+			// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+			const int kCacheSize = 32;
+			const float kCacheDecayPower = 1.5f;
+			const float kLastTriScore = 0.75f;
+			const float kValenceBoostScale = 2.0f;
+			const float kValenceBoostPower = 0.5f;
+
+			float VertexScore(int cachePosition, unsigned int activeTris) {
+				if (activeTris == 0) {
+					// No triangles left using this vertex, make sure it is never picked.
+					return -1.0f;
+				}
+
+				float score = 0.0f;
+				if (cachePosition >= 0) {
+					if (cachePosition < 3) {
+						// The vertex was used by the last triangle, so it is given a fixed score
+						// to avoid favouring one of the three vertices over the others.
+						score = kLastTriScore;
+					}
+					else {
+						const float scaler = 1.0f / (kCacheSize - 3);
+						score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+					}
+				}
+
+				// Boost vertices with few triangles left so lone triangles are not left behind.
+				score += kValenceBoostScale * std::pow(static_cast<float>(activeTris), -kValenceBoostPower);
+				return score;
+			}
+
+			struct Position {
+				float x, y, z;
+			};
+
+			Position GetPosition(const float* positions, size_t stride, unsigned int index) {
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + stride * index);
+				Position result = { p[0], p[1], p[2] };
+				return result;
+			}
+
+			// Symmetric 4x4 error quadric of a set of planes, see Garland & Heckbert.
+			// The weight sum turns the error into a mean squared distance instead of an area.
+			struct Quadric {
+				double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd, w;
+
+				Quadric() : a2(0), b2(0), c2(0), d2(0), ab(0), ac(0), ad(0), bc(0), bd(0), cd(0), w(0) {}
+
+				void AddPlane(double a, double b, double c, double d, double weight) {
+					a2 += a * a * weight; b2 += b * b * weight; c2 += c * c * weight; d2 += d * d * weight;
+					ab += a * b * weight; ac += a * c * weight; ad += a * d * weight;
+					bc += b * c * weight; bd += b * d * weight; cd += c * d * weight;
+					w += weight;
+				}
+
+				void Add(const Quadric& q) {
+					a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+					ab += q.ab; ac += q.ac; ad += q.ad;
+					bc += q.bc; bd += q.bd; cd += q.cd;
+					w += q.w;
+				}
+
+				double Error(const Position& p) const {
+					double x = p.x, y = p.y, z = p.z;
+					double e = a2 * x * x + b2 * y * y + c2 * z * z + d2
+						+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+						+ 2.0 * (ad * x + bd * y + cd * z);
+					if (w > 0.0) {
+						e /= w;
+					}
+					return e < 0.0 ? 0.0 : e;
+				}
+			};
+
+			struct Collapse {
+				unsigned int from, to;
+				double cost;
+			};
+
+			// Triangle normal (not normalized) of p0 p1 p2.
+			void TriangleNormal(const Position& p0, const Position& p1, const Position& p2, double* n) {
+				double ex = p1.x - p0.x, ey = p1.y - p0.y, ez = p1.z - p0.z;
+				double fx = p2.x - p0.x, fy = p2.y - p0.y, fz = p2.z - p0.z;
+				n[0] = ey * fz - ez * fy;
+				n[1] = ez * fx - ex * fz;
+				n[2] = ex * fy - ey * fx;
+			}
+
+			uint64_t EdgeKey(unsigned int a, unsigned int b) {
+				return (static_cast<uint64_t>(a) << 32) | b;
+			}
+
+			// Simulates a FIFO cache over [start, end) triangles from a cold cache and returns the misses.
+			unsigned int CountMisses(const unsigned int* indices, size_t start, size_t end, std::vector<unsigned int>& timestamps, unsigned int& timestamp, unsigned int cacheSize) {
+				unsigned int misses = 0;
+				// Bumping the timestamp past the cache size flushes every entry.
+				timestamp += cacheSize + 1;
+				for (size_t i = start * 3; i < end * 3; ++i) {
+					unsigned int v = indices[i];
+					if (timestamp - timestamps[v] > cacheSize) {
+						timestamps[v] = timestamp++;
+						++misses;
+					}
+				}
+				return misses;
+			}
+		}
+
+		float CalculateACMR(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+			if (indexCount < 3) {
+				return 0.0f;
+			}
+
+			std::vector<unsigned int> timestamps(vertexCount, 0);
+			unsigned int timestamp = 0;
+			unsigned int misses = CountMisses(indices, 0, indexCount / 3, timestamps, timestamp, cacheSize);
+			return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		}
+
+		void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+			const size_t triCount = indexCount / 3;
+			if (triCount == 0) {
+				return;
+			}
+
+			// Build the vertex to triangle adjacency as one flat array.
+			std::vector<unsigned int> activeTris(vertexCount, 0);
+			for (size_t i = 0; i < triCount * 3; ++i) {
+				activeTris[indices[i]]++;
+			}
+
+			std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+			for (size_t v = 0; v < vertexCount; ++v) {
+				adjacencyOffset[v + 1] = adjacencyOffset[v] + activeTris[v];
+			}
+
+			std::vector<unsigned int> adjacency(triCount * 3);
+			{
+				std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+				for (size_t t = 0; t < triCount; ++t) {
+					for (int k = 0; k < 3; ++k) {
+						unsigned int v = indices[t * 3 + k];
+						adjacency[fill[v]++] = static_cast<unsigned int>(t);
+					}
+				}
+			}
+
+			std::vector<int> cachePosition(vertexCount, -1);
+			std::vector<float> vertexScore(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v) {
+				vertexScore[v] = VertexScore(-1, activeTris[v]);
+			}
+
+			std::vector<float> triScore(triCount);
+			std::vector<bool> triAdded(triCount, false);
+			for (size_t t = 0; t < triCount; ++t) {
+				triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			}
+
+			std::vector<unsigned int> output;
+			output.reserve(triCount * 3);
+
+			// Cache holds up to kCacheSize entries plus the 3 pushed by the newest triangle.
+			std::vector<unsigned int> cache;
+			std::vector<unsigned int> newCache;
+			cache.reserve(kCacheSize + 3);
+			newCache.reserve(kCacheSize + 3);
+
+			int bestTri = -1;
+			size_t scanStart = 0;
+
+			for (size_t emitted = 0; emitted < triCount; ++emitted) {
+				if (bestTri < 0) {
+					// Nothing in the cache is useful, fall back to the best remaining triangle overall.
+					float bestScore = -1.0f;
+					for (size_t t = scanStart; t < triCount; ++t) {
+						if (!triAdded[t] && triScore[t] > bestScore) {
+							bestScore = triScore[t];
+							bestTri = static_cast<int>(t);
+						}
+					}
+				}
+
+				const unsigned int tri = static_cast<unsigned int>(bestTri);
+				triAdded[tri] = true;
+				while (scanStart < triCount && triAdded[scanStart]) {
+					++scanStart;
+				}
+
+				newCache.clear();
+				for (int k = 0; k < 3; ++k) {
+					unsigned int v = indices[tri * 3 + k];
+					output.push_back(v);
+					newCache.push_back(v);
+
+					// Remove the triangle from the vertex's active list.
+					unsigned int* begin = &adjacency[adjacencyOffset[v]];
+					unsigned int* end = begin + activeTris[v];
+					unsigned int* found = std::find(begin, end, tri);
+					if (found != end) {
+						*found = *(end - 1);
+						activeTris[v]--;
+					}
+				}
+
+				// Move the new triangle's vertices to the front of the LRU cache.
+				for (size_t i = 0; i < cache.size(); ++i) {
+					unsigned int v = cache[i];
+					if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+						newCache.push_back(v);
+					}
+				}
+				cache.swap(newCache);
+
+				// Vertices pushed past the end of the cache lose their cache bonus.
+				for (size_t i = 0; i < cache.size(); ++i) {
+					unsigned int v = cache[i];
+					cachePosition[v] = (i < static_cast<size_t>(kCacheSize)) ? static_cast<int>(i) : -1;
+					float score = VertexScore(cachePosition[v], activeTris[v]);
+					float delta = score - vertexScore[v];
+					vertexScore[v] = score;
+					for (unsigned int a = 0; a < activeTris[v]; ++a) {
+						triScore[adjacency[adjacencyOffset[v] + a]] += delta;
+					}
+				}
+				if (cache.size() > static_cast<size_t>(kCacheSize)) {
+					cache.resize(kCacheSize);
+				}
+
+				// The next triangle is the best one touching the cache.
+				bestTri = -1;
+				float bestScore = -1.0f;
+				for (size_t i = 0; i < cache.size(); ++i) {
+					unsigned int v = cache[i];
+					for (unsigned int a = 0; a < activeTris[v]; ++a) {
+						unsigned int t = adjacency[adjacencyOffset[v] + a];
+						if (triScore[t] > bestScore) {
+							bestScore = triScore[t];
+							bestTri = static_cast<int>(t);
+						}
+					}
+				}
+			}
+
+			std::copy(output.begin(), output.end(), indices);
+		}
+
+		void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t stride, float threshold) {
+			const size_t triCount = indexCount / 3;
+			if (triCount < 2 || positions == nullptr) {
+				return;
+			}
+
+			const unsigned int cacheSize = 16;
+			std::vector<unsigned int> timestamps(vertexCount, 0);
+			unsigned int timestamp = 0;
+
+			// Hard boundaries: triangles where every vertex misses the cache start a new cluster,
+			// splitting there costs nothing in cache efficiency.
+			std::vector<size_t> hard;
+			timestamp += cacheSize + 1;
+			for (size_t t = 0; t < triCount; ++t) {
+				unsigned int misses = 0;
+				for (int k = 0; k < 3; ++k) {
+					unsigned int v = indices[t * 3 + k];
+					if (timestamp - timestamps[v] > cacheSize) {
+						timestamps[v] = timestamp++;
+						++misses;
+					}
+				}
+				if (t == 0 || misses == 3) {
+					hard.push_back(t);
+				}
+			}
+			hard.push_back(triCount);
+
+			// Soft boundaries: split a hard cluster further as long as the prefix ACMR stays
+			// within threshold of the cluster's own ACMR.
+			std::vector<size_t> clusters;
+			for (size_t h = 0; h + 1 < hard.size(); ++h) {
+				size_t start = hard[h];
+				size_t end = hard[h + 1];
+				float clusterACMR = static_cast<float>(CountMisses(indices, start, end, timestamps, timestamp, cacheSize)) / (end - start);
+
+				clusters.push_back(start);
+				timestamp += cacheSize + 1;
+				unsigned int misses = 0;
+				size_t clusterStart = start;
+				for (size_t t = start; t < end; ++t) {
+					for (int k = 0; k < 3; ++k) {
+						unsigned int v = indices[t * 3 + k];
+						if (timestamp - timestamps[v] > cacheSize) {
+							timestamps[v] = timestamp++;
+							++misses;
+						}
+					}
+					float acmr = static_cast<float>(misses) / (t - clusterStart + 1);
+					if (t + 1 < end && acmr <= clusterACMR * threshold) {
+						clusters.push_back(t + 1);
+						clusterStart = t + 1;
+						misses = 0;
+						timestamp += cacheSize + 1;
+					}
+				}
+			}
+			clusters.push_back(triCount);
+
+			const size_t clusterCount = clusters.size() - 1;
+			if (clusterCount < 2) {
+				return;
+			}
+
+			// Area weighted centroid of the whole mesh.
+			Position meshCenter = { 0.0f, 0.0f, 0.0f };
+			float meshArea = 0.0f;
+			std::vector<Position> clusterCenter(clusterCount);
+			std::vector<Position> clusterNormal(clusterCount);
+
+			for (size_t c = 0; c < clusterCount; ++c) {
+				Position center = { 0.0f, 0.0f, 0.0f };
+				Position normal = { 0.0f, 0.0f, 0.0f };
+				float area = 0.0f;
+
+				for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+					Position p0 = GetPosition(positions, stride, indices[t * 3]);
+					Position p1 = GetPosition(positions, stride, indices[t * 3 + 1]);
+					Position p2 = GetPosition(positions, stride, indices[t * 3 + 2]);
+
+					float ex = p1.x - p0.x, ey = p1.y - p0.y, ez = p1.z - p0.z;
+					float fx = p2.x - p0.x, fy = p2.y - p0.y, fz = p2.z - p0.z;
+					float nx = ey * fz - ez * fy;
+					float ny = ez * fx - ex * fz;
+					float nz = ex * fy - ey * fx;
+					float a = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+					center.x += (p0.x + p1.x + p2.x) / 3.0f * a;
+					center.y += (p0.y + p1.y + p2.y) / 3.0f * a;
+					center.z += (p0.z + p1.z + p2.z) / 3.0f * a;
+					normal.x += nx;
+					normal.y += ny;
+					normal.z += nz;
+					area += a;
+				}
+
+				meshCenter.x += center.x;
+				meshCenter.y += center.y;
+				meshCenter.z += center.z;
+				meshArea += area;
+
+				if (area > 0.0f) {
+					center.x /= area;
+					center.y /= area;
+					center.z /= area;
+				}
+				float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+				if (length > 0.0f) {
+					normal.x /= length;
+					normal.y /= length;
+					normal.z /= length;
+				}
+				clusterCenter[c] = center;
+				clusterNormal[c] = normal;
+			}
+
+			if (meshArea > 0.0f) {
+				meshCenter.x /= meshArea;
+				meshCenter.y /= meshArea;
+				meshCenter.z /= meshArea;
+			}
+
+			// Clusters facing away from the center are more likely to occlude, draw them first.
+			std::vector<float> sortKey(clusterCount);
+			std::vector<unsigned int> order(clusterCount);
+			for (size_t c = 0; c < clusterCount; ++c) {
+				sortKey[c] = (clusterCenter[c].x - meshCenter.x) * clusterNormal[c].x +
+					(clusterCenter[c].y - meshCenter.y) * clusterNormal[c].y +
+					(clusterCenter[c].z - meshCenter.z) * clusterNormal[c].z;
+				order[c] = static_cast<unsigned int>(c);
+			}
+			std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int lhs, unsigned int rhs) {
+				return sortKey[lhs] > sortKey[rhs];
+			});
+
+			std::vector<unsigned int> result;
+			result.reserve(triCount * 3);
+			for (size_t i = 0; i < clusterCount; ++i) {
+				unsigned int c = order[i];
+				result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+			}
+			std::copy(result.begin(), result.end(), indices);
+		}
+
+		size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t stride,
+			size_t targetIndexCount, float targetError, float* resultError) {
+			std::vector<unsigned int> result(indices, indices + (indexCount / 3) * 3);
+			double maxError = 0.0;
+
+			if (result.empty() || positions == nullptr) {
+				std::copy(result.begin(), result.end(), destination);
+				if (resultError) {
+					*resultError = 0.0f;
+				}
+				return result.size();
+			}
+
+			// Scale positions into a unit box so errors are relative to the mesh extent.
+			std::vector<Position> points(vertexCount);
+			Position minimum = GetPosition(positions, stride, result[0]);
+			Position maximum = minimum;
+			for (size_t v = 0; v < vertexCount; ++v) {
+				points[v] = GetPosition(positions, stride, static_cast<unsigned int>(v));
+			}
+			for (size_t i = 0; i < result.size(); ++i) {
+				const Position& p = points[result[i]];
+				minimum.x = std::min(minimum.x, p.x); maximum.x = std::max(maximum.x, p.x);
+				minimum.y = std::min(minimum.y, p.y); maximum.y = std::max(maximum.y, p.y);
+				minimum.z = std::min(minimum.z, p.z); maximum.z = std::max(maximum.z, p.z);
+			}
+			float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+			float invExtent = extent > 0.0f ? 1.0f / extent : 0.0f;
+			for (size_t v = 0; v < vertexCount; ++v) {
+				points[v].x = (points[v].x - minimum.x) * invExtent;
+				points[v].y = (points[v].y - minimum.y) * invExtent;
+				points[v].z = (points[v].z - minimum.z) * invExtent;
+			}
+
+			// Vertices sharing a position (attribute seams) map to one position id.
+			std::vector<unsigned int> positionId(vertexCount);
+			std::vector<unsigned int> wedgeCount(vertexCount, 0);
+			{
+				std::unordered_map<uint64_t, std::vector<unsigned int>> buckets;
+				for (size_t v = 0; v < vertexCount; ++v) {
+					uint32_t bits[3];
+					std::memcpy(bits, &points[v], sizeof(bits));
+					uint64_t hash = (static_cast<uint64_t>(bits[0]) * 73856093u) ^ (static_cast<uint64_t>(bits[1]) * 19349663u) ^ (static_cast<uint64_t>(bits[2]) * 83492791u);
+					std::vector<unsigned int>& bucket = buckets[hash];
+					positionId[v] = static_cast<unsigned int>(v);
+					for (size_t b = 0; b < bucket.size(); ++b) {
+						const Position& other = points[bucket[b]];
+						if (other.x == points[v].x && other.y == points[v].y && other.z == points[v].z) {
+							positionId[v] = bucket[b];
+							break;
+						}
+					}
+					if (positionId[v] == v) {
+						bucket.push_back(static_cast<unsigned int>(v));
+					}
+				}
+			}
+
+			// Count the wedges that are actually referenced at each position.
+			{
+				std::vector<bool> used(vertexCount, false);
+				for (size_t i = 0; i < result.size(); ++i) {
+					used[result[i]] = true;
+				}
+				for (size_t v = 0; v < vertexCount; ++v) {
+					if (used[v]) {
+						wedgeCount[positionId[v]]++;
+					}
+				}
+			}
+
+			// Lock seam vertices and vertices on an open border, only interior vertices move.
+			std::vector<bool> locked(vertexCount, false);
+			{
+				std::unordered_map<uint64_t, unsigned int> edges;
+				for (size_t i = 0; i < result.size(); i += 3) {
+					for (int k = 0; k < 3; ++k) {
+						unsigned int a = positionId[result[i + k]];
+						unsigned int b = positionId[result[i + (k + 1) % 3]];
+						edges[EdgeKey(a, b)]++;
+					}
+				}
+				for (size_t i = 0; i < result.size(); i += 3) {
+					for (int k = 0; k < 3; ++k) {
+						unsigned int a = positionId[result[i + k]];
+						unsigned int b = positionId[result[i + (k + 1) % 3]];
+						if (edges.find(EdgeKey(b, a)) == edges.end() || edges[EdgeKey(a, b)] > 1) {
+							locked[a] = true;
+							locked[b] = true;
+						}
+					}
+				}
+				for (size_t v = 0; v < vertexCount; ++v) {
+					if (wedgeCount[positionId[v]] > 1 || locked[positionId[v]]) {
+						locked[v] = true;
+					}
+				}
+			}
+
+			// Area weighted plane quadrics, accumulated per position.
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < result.size(); i += 3) {
+				const Position& p0 = points[result[i]];
+				const Position& p1 = points[result[i + 1]];
+				const Position& p2 = points[result[i + 2]];
+				double n[3];
+				TriangleNormal(p0, p1, p2, n);
+				double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length <= 0.0) {
+					continue;
+				}
+				double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+				double d = -(a * p0.x + b * p0.y + c * p0.z);
+				for (int k = 0; k < 3; ++k) {
+					quadrics[positionId[result[i + k]]].AddPlane(a, b, c, d, length * 0.5);
+				}
+			}
+
+			const double errorLimit = static_cast<double>(targetError) * targetError;
+			std::vector<unsigned int> remap(vertexCount);
+			std::vector<bool> touched(vertexCount);
+			std::vector<unsigned int> adjacencyOffset(vertexCount + 1);
+			std::vector<unsigned int> adjacency;
+			std::vector<Collapse> collapses;
+
+			while (result.size() > targetIndexCount) {
+				const size_t triCount = result.size() / 3;
+
+				// Vertex to triangle adjacency of the current triangle list.
+				std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+				for (size_t i = 0; i < result.size(); ++i) {
+					adjacencyOffset[result[i] + 1]++;
+				}
+				for (size_t v = 0; v < vertexCount; ++v) {
+					adjacencyOffset[v + 1] += adjacencyOffset[v];
+				}
+				adjacency.resize(result.size());
+				{
+					std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+					for (size_t i = 0; i < result.size(); ++i) {
+						adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+					}
+				}
+
+				// Every edge leaving an interior vertex is a candidate.
+				collapses.clear();
+				for (size_t i = 0; i < result.size(); i += 3) {
+					for (int k = 0; k < 3; ++k) {
+						unsigned int from = result[i + k];
+						if (locked[from]) {
+							continue;
+						}
+						for (int j = 1; j < 3; ++j) {
+							unsigned int to = result[i + (k + j) % 3];
+							Quadric q = quadrics[positionId[from]];
+							q.Add(quadrics[positionId[to]]);
+							Collapse c = { from, to, q.Error(points[to]) };
+							collapses.push_back(c);
+						}
+					}
+				}
+				if (collapses.empty()) {
+					break;
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+					return lhs.cost < rhs.cost;
+				});
+
+				for (size_t v = 0; v < vertexCount; ++v) {
+					remap[v] = static_cast<unsigned int>(v);
+				}
+				std::fill(touched.begin(), touched.end(), false);
+
+				size_t remaining = triCount;
+				size_t collapsed = 0;
+				for (size_t c = 0; c < collapses.size() && remaining * 3 > targetIndexCount; ++c) {
+					const Collapse& collapse = collapses[c];
+					if (collapse.cost > errorLimit) {
+						break;
+					}
+					if (touched[collapse.from] || touched[collapse.to]) {
+						continue;
+					}
+
+					// Reject collapses that would flip a triangle around the moving vertex.
+					bool flips = false;
+					unsigned int removed = 0;
+					for (unsigned int a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; ++a) {
+						const unsigned int* tri = &result[adjacency[a] * 3];
+						if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+							removed++;
+							continue;
+						}
+						Position p[3], q[3];
+						for (int k = 0; k < 3; ++k) {
+							p[k] = points[tri[k]];
+							q[k] = (tri[k] == collapse.from) ? points[collapse.to] : p[k];
+						}
+						double before[3], after[3];
+						TriangleNormal(p[0], p[1], p[2], before);
+						TriangleNormal(q[0], q[1], q[2], after);
+						if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0) {
+							flips = true;
+							break;
+						}
+					}
+					if (flips) {
+						continue;
+					}
+
+					remap[collapse.from] = collapse.to;
+					quadrics[positionId[collapse.to]].Add(quadrics[positionId[collapse.from]]);
+					maxError = std::max(maxError, collapse.cost);
+					remaining -= removed;
+					collapsed++;
+
+					// The one-ring of the moved vertex changed shape, leave it alone for this pass.
+					for (unsigned int a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; ++a) {
+						const unsigned int* tri = &result[adjacency[a] * 3];
+						touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+					}
+					touched[collapse.to] = true;
+				}
+
+				if (collapsed == 0) {
+					break;
+				}
+
+				// Apply the collapses and drop the triangles that became degenerate.
+				size_t write = 0;
+				for (size_t i = 0; i < result.size(); i += 3) {
+					unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+					unsigned int pa = positionId[a], pb = positionId[b], pc = positionId[c];
+					if (pa != pb && pb != pc && pa != pc) {
+						result[write++] = a;
+						result[write++] = b;
+						result[write++] = c;
+					}
+				}
+				result.resize(write);
+			}
+
+			std::copy(result.begin(), result.end(), destination);
+			if (resultError) {
+				*resultError = static_cast<float>(std::sqrt(maxError));
+			}
+			return result.size();
+		}
+
+		size_t SubdivideTriangles(std::vector<unsigned int>& indices, std::vector<unsigned int>& parents, size_t vertexCount) {
+			std::vector<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				for (int k = 0; k < 3; ++k) {
+					unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+					edges.push_back(EdgeKey(std::min(a, b), std::max(a, b)));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+			parents.resize(edges.size() * 2);
+			for (size_t e = 0; e < edges.size(); ++e) {
+				parents[e * 2] = static_cast<unsigned int>(edges[e] >> 32);
+				parents[e * 2 + 1] = static_cast<unsigned int>(edges[e] & 0xffffffffu);
+			}
+
+			std::vector<unsigned int> result;
+			result.reserve(indices.size() * 4);
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				unsigned int mid[3];
+				for (int k = 0; k < 3; ++k) {
+					unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+					uint64_t key = EdgeKey(std::min(a, b), std::max(a, b));
+					mid[k] = static_cast<unsigned int>(vertexCount + (std::lower_bound(edges.begin(), edges.end(), key) - edges.begin()));
+				}
+				// Same corner order as the source triangle, so the winding is kept.
+				const unsigned int tris[12] = {
+					indices[i], mid[0], mid[2],
+					indices[i + 1], mid[1], mid[0],
+					indices[i + 2], mid[2], mid[1],
+					mid[0], mid[1], mid[2] };
+				result.insert(result.end(), tris, tris + 12);
+			}
+			indices.swap(result);
+			return vertexCount + edges.size();
+		}
+
+		size_t OptimizeVertexFetch(std::vector<unsigned int>& remap, unsigned int* indices, size_t indexCount, size_t vertexCount) {
+			remap.assign(vertexCount, ~0u);
+			unsigned int next = 0;
+
+			for (size_t i = 0; i < indexCount; ++i) {
+				unsigned int v = indices[i];
+				if (remap[v] == ~0u) {
+					remap[v] = next++;
+				}
+				indices[i] = remap[v];
+			}
+
+			return next;
+		}
+	} // namespace mesh
+} // namespace Sigma
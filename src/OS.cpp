@@ -89,6 +89,10 @@ namespace Sigma {
 		glfwSwapBuffers(this->window);
 	}
 
+	void OS::MakeContextCurrent(bool current) {
+		glfwMakeContextCurrent(current ? this->window : NULL);
+	}
+
 	void OS::OSMessageLoop() {
 		glfwPollEvents();
 	}
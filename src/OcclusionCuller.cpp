@@ -0,0 +1,277 @@
+#include "OcclusionCuller.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SIGMA_OCCLUSION_SSE
+#endif
+
+namespace Sigma {
+	const unsigned int OcclusionCuller::WIDTH;
+	const unsigned int OcclusionCuller::HEIGHT;
+	const size_t OcclusionCuller::PARALLEL_THRESHOLD;
+
+	namespace {
+		// The point where the segment from a to b crosses the near plane z = -w.
+		glm::vec4 NearIntersection(const glm::vec4& a, const glm::vec4& b) {
+			const float da = a.z + a.w, db = b.z + b.w;
+			return a + (b - a) * (da / (da - db));
+		}
+
+		bool OutsideSamePlane(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+			return (a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+				(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+				(a.z > a.w && b.z > b.w && c.z > c.w);
+		}
+	}
+
+	OcclusionCuller::OcclusionCuller() : threadCount(0) {
+		unsigned int width = WIDTH, height = HEIGHT;
+		while (true) {
+			this->levels.push_back(std::vector<float>(width * height, 1.0f));
+			this->levelWidths.push_back(width);
+			this->levelHeights.push_back(height);
+			if (width < 2 || height < 2) {
+				break;
+			}
+			width /= 2;
+			height /= 2;
+		}
+	}
+
+	void OcclusionCuller::Clear() {
+		this->triangles.clear();
+		std::fill(this->levels[0].begin(), this->levels[0].end(), 1.0f);
+	}
+
+	void OcclusionCuller::AddOccluder(const glm::mat4& modelViewProj, const OccluderGeometry& geometry) {
+		const unsigned char* positions = reinterpret_cast<const unsigned char*>(geometry.positions);
+		for (size_t i = 0; i + 2 < geometry.indexCount; i += 3) {
+			glm::vec4 clip[3];
+			bool valid = true;
+			for (int corner = 0; corner < 3; ++corner) {
+				const unsigned int index = geometry.indices[i + corner];
+				if (index >= geometry.vertexCount) {
+					valid = false;
+					break;
+				}
+				const float* position = reinterpret_cast<const float*>(positions + index * geometry.stride);
+				clip[corner] = modelViewProj * glm::vec4(position[0], position[1], position[2], 1.0f);
+			}
+			if (valid) {
+				AddClipTriangle(clip[0], clip[1], clip[2]);
+			}
+		}
+	}
+
+	void OcclusionCuller::AddClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+		if (OutsideSamePlane(a, b, c)) {
+			return;
+		}
+		// Sutherland-Hodgman against the near plane, a triangle becomes at most a quad.
+		const glm::vec4 input[3] = { a, b, c };
+		glm::vec4 output[4];
+		int count = 0;
+		for (int i = 0; i < 3; ++i) {
+			const glm::vec4& current = input[i];
+			const glm::vec4& next = input[(i + 1) % 3];
+			const bool currentInside = current.z >= -current.w;
+			const bool nextInside = next.z >= -next.w;
+			if (currentInside) {
+				output[count++] = current;
+			}
+			if (currentInside != nextInside) {
+				output[count++] = NearIntersection(current, next);
+			}
+		}
+		for (int i = 1; i + 1 < count; ++i) {
+			AddScreenTriangle(output[0], output[i], output[i + 1]);
+		}
+	}
+
+	void OcclusionCuller::AddScreenTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+		const glm::vec4* clip[3] = { &a, &b, &c };
+		float x[3], y[3], z[3];
+		for (int i = 0; i < 3; ++i) {
+			if (clip[i]->w <= 0.0f) {
+				return;
+			}
+			const float inverseW = 1.0f / clip[i]->w;
+			x[i] = (clip[i]->x * inverseW * 0.5f + 0.5f) * WIDTH;
+			y[i] = (clip[i]->y * inverseW * 0.5f + 0.5f) * HEIGHT;
+			z[i] = clip[i]->z * inverseW * 0.5f + 0.5f;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::abs(area) < 1e-6f) {
+			return;
+		}
+		if (area < 0.0f) {
+			// Occluders are two sided, wind every triangle counter clockwise.
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		triangle.minX = std::max(0, static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))));
+		triangle.maxX = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(std::max(x[0], std::max(x[1], x[2])))));
+		triangle.minY = std::max(0, static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))));
+		triangle.maxY = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(std::max(y[0], std::max(y[1], y[2])))));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			return;
+		}
+
+		// Edge i is opposite to vertex i and positive on the side of the triangle.
+		for (int i = 0; i < 3; ++i) {
+			const int from = (i + 1) % 3, to = (i + 2) % 3;
+			triangle.edgeA[i] = y[from] - y[to];
+			triangle.edgeB[i] = x[to] - x[from];
+			triangle.edgeC[i] = -(triangle.edgeA[i] * x[from] + triangle.edgeB[i] * y[from]);
+		}
+		// The depth interpolated with the barycentric weights edge / area.
+		triangle.depthA = (triangle.edgeA[0] * z[0] + triangle.edgeA[1] * z[1] + triangle.edgeA[2] * z[2]) / area;
+		triangle.depthB = (triangle.edgeB[0] * z[0] + triangle.edgeB[1] * z[1] + triangle.edgeB[2] * z[2]) / area;
+		triangle.depthC = (triangle.edgeC[0] * z[0] + triangle.edgeC[1] * z[1] + triangle.edgeC[2] * z[2]) / area;
+		this->triangles.push_back(triangle);
+	}
+
+	void OcclusionCuller::RasterizeRows(int firstRow, int lastRow) {
+		float* depth = &this->levels[0][0];
+		for (auto itr = this->triangles.begin(); itr != this->triangles.end(); ++itr) {
+			const Triangle& triangle = *itr;
+			const int top = std::min(triangle.maxY, lastRow - 1);
+			const int left = triangle.minX & ~3;
+			for (int row = std::max(triangle.minY, firstRow); row <= top; ++row) {
+				const float centerY = row + 0.5f;
+				float* line = depth + row * WIDTH;
+#ifdef SIGMA_OCCLUSION_SSE
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 step = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+				__m128 edgeA[3], edgeRow[3];
+				for (int i = 0; i < 3; ++i) {
+					edgeA[i] = _mm_set1_ps(triangle.edgeA[i]);
+					edgeRow[i] = _mm_set1_ps(triangle.edgeB[i] * centerY + triangle.edgeC[i]);
+				}
+				const __m128 depthA = _mm_set1_ps(triangle.depthA);
+				const __m128 depthRow = _mm_set1_ps(triangle.depthB * centerY + triangle.depthC);
+				for (int x = left; x <= triangle.maxX; x += 4) {
+					const __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), step);
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], centerX), edgeRow[0]), zero);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], centerX), edgeRow[1]), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], centerX), edgeRow[2]), zero));
+					if (_mm_movemask_ps(inside) == 0) {
+						continue;
+					}
+					const __m128 current = _mm_loadu_ps(line + x);
+					const __m128 nearest = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(depthA, centerX), depthRow));
+					_mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+				}
+#else
+				for (int x = left; x <= triangle.maxX; ++x) {
+					const float centerX = x + 0.5f;
+					bool inside = true;
+					for (int i = 0; i < 3; ++i) {
+						inside = inside && (triangle.edgeA[i] * centerX + triangle.edgeB[i] * centerY + triangle.edgeC[i] >= 0.0f);
+					}
+					if (inside) {
+						line[x] = std::min(line[x], triangle.depthA * centerX + triangle.depthB * centerY + triangle.depthC);
+					}
+				}
+#endif
+			}
+		}
+	}
+
+	void OcclusionCuller::BuildHierarchy() {
+		for (size_t level = 1; level < this->levels.size(); ++level) {
+			const std::vector<float>& source = this->levels[level - 1];
+			const unsigned int sourceWidth = this->levelWidths[level - 1];
+			std::vector<float>& target = this->levels[level];
+			for (unsigned int y = 0; y < this->levelHeights[level]; ++y) {
+				for (unsigned int x = 0; x < this->levelWidths[level]; ++x) {
+					const float* top = &source[(2 * y) * sourceWidth + 2 * x];
+					const float* bottom = top + sourceWidth;
+					target[y * this->levelWidths[level] + x] = std::max(std::max(top[0], top[1]), std::max(bottom[0], bottom[1]));
+				}
+			}
+		}
+	}
+
+	size_t OcclusionCuller::Rasterize() {
+		unsigned int threads = this->threadCount;
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = std::min(threads, HEIGHT);
+		if (threads < 2 || this->triangles.size() < PARALLEL_THRESHOLD) {
+			RasterizeRows(0, HEIGHT);
+			BuildHierarchy();
+			return 1;
+		}
+
+		// Each thread writes its own band of rows, the calling thread takes the first one.
+		const int band = (HEIGHT + threads - 1) / threads;
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; ++t) {
+			const int first = std::min<int>(HEIGHT, t * band);
+			const int last = std::min<int>(HEIGHT, first + band);
+			if (first >= last) {
+				break;
+			}
+			workers.push_back(std::thread(&OcclusionCuller::RasterizeRows, this, first, last));
+		}
+		RasterizeRows(0, std::min<int>(HEIGHT, band));
+		for (auto itr = workers.begin(); itr != workers.end(); ++itr) {
+			itr->join();
+		}
+		BuildHierarchy();
+		return workers.size() + 1;
+	}
+
+	bool OcclusionCuller::IsBoxVisible(const glm::mat4& viewProj, const glm::vec3& minimum, const glm::vec3& maximum) const {
+		float minX = static_cast<float>(WIDTH), maxX = 0.0f, minY = static_cast<float>(HEIGHT), maxY = 0.0f, nearest = 1.0f;
+		for (int corner = 0; corner < 8; ++corner) {
+			const glm::vec4 point((corner & 1) ? maximum.x : minimum.x, (corner & 2) ? maximum.y : minimum.y, (corner & 4) ? maximum.z : minimum.z, 1.0f);
+			const glm::vec4 clip = viewProj * point;
+			if (clip.w <= 1e-6f || clip.z < -clip.w) {
+				return true;
+			}
+			const float inverseW = 1.0f / clip.w;
+			const float x = (clip.x * inverseW * 0.5f + 0.5f) * WIDTH;
+			const float y = (clip.y * inverseW * 0.5f + 0.5f) * HEIGHT;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip.z * inverseW * 0.5f + 0.5f);
+		}
+		if (maxX < 0.0f || minX >= WIDTH || maxY < 0.0f || minY >= HEIGHT) {
+			return false;
+		}
+		const int left = std::max(0, static_cast<int>(std::floor(minX)));
+		const int right = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(maxX)));
+		const int bottom = std::max(0, static_cast<int>(std::floor(minY)));
+		const int top = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(maxY)));
+
+		// The finest level where the rectangle covers at most 2x2 texels.
+		size_t level = 0;
+		while (level + 1 < this->levels.size() && ((right >> level) - (left >> level) > 1 || (top >> level) - (bottom >> level) > 1)) {
+			++level;
+		}
+		const std::vector<float>& depth = this->levels[level];
+		const unsigned int width = this->levelWidths[level];
+		for (int y = bottom >> level; y <= (top >> level); ++y) {
+			for (int x = left >> level; x <= (right >> level); ++x) {
+				if (nearest <= depth[y * width + x]) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+} // namespace Sigma
@@ -0,0 +1,153 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Sigma {
+	const size_t Profiler::MAX_EVENTS;
+
+	namespace {
+		std::atomic<bool> enabled(false);
+		std::atomic<uint64_t> frameNumber(0);
+		const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+		std::mutex eventMutex;
+		std::vector<ProfileEvent> events; // A ring once MAX_EVENTS is reached.
+		size_t oldestEvent = 0;
+		std::map<std::thread::id, unsigned int> threadTracks;
+
+		// Writes a string literal as a JSON string.
+		void WriteString(std::ofstream& file, const char* text) {
+			file << '"';
+			for (const char* c = text; *c; ++c) {
+				if (*c == '"' || *c == '\\') {
+					file << '\\';
+				}
+				file << *c;
+			}
+			file << '"';
+		}
+	}
+
+	void Profiler::SetEnabled(bool enable) {
+		enabled = enable;
+	}
+
+	bool Profiler::IsEnabled() {
+		return enabled;
+	}
+
+	double Profiler::Now() {
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - epoch;
+		return elapsed.count();
+	}
+
+	void Profiler::NextFrame() {
+		++frameNumber;
+	}
+
+	uint64_t Profiler::Frame() {
+		return frameNumber;
+	}
+
+	unsigned int Profiler::ThreadTrack() {
+		std::lock_guard<std::mutex> lock(eventMutex);
+		auto itr = threadTracks.find(std::this_thread::get_id());
+		if (itr != threadTracks.end()) {
+			return itr->second;
+		}
+		const unsigned int track = static_cast<unsigned int>(threadTracks.size()) + 1;
+		threadTracks[std::this_thread::get_id()] = track;
+		return track;
+	}
+
+	void Profiler::Record(const char* name, unsigned int track, double start, double duration, uint64_t frame) {
+		if (!enabled) {
+			return;
+		}
+		ProfileEvent event = { name, track, frame == ~0ull ? frameNumber.load() : frame, start, duration };
+		std::lock_guard<std::mutex> lock(eventMutex);
+		if (events.size() < MAX_EVENTS) {
+			events.push_back(event);
+		}
+		else {
+			events[oldestEvent] = event;
+			oldestEvent = (oldestEvent + 1) % MAX_EVENTS;
+		}
+	}
+
+	std::vector<ProfileEvent> Profiler::Events() {
+		std::lock_guard<std::mutex> lock(eventMutex);
+		std::vector<ProfileEvent> copy(events.begin() + oldestEvent, events.end());
+		copy.insert(copy.end(), events.begin(), events.begin() + oldestEvent);
+		return copy;
+	}
+
+	std::vector<ProfileSummary> Profiler::Summarize() {
+		std::vector<ProfileEvent> recorded = Events();
+		std::vector<ProfileSummary> summaries;
+		for (auto itr = recorded.begin(); itr != recorded.end(); ++itr) {
+			auto summary = summaries.begin();
+			for (; summary != summaries.end(); ++summary) {
+				if (summary->track == itr->track && std::strcmp(summary->name, itr->name) == 0) {
+					break;
+				}
+			}
+			const double milliseconds = itr->duration / 1000.0;
+			if (summary == summaries.end()) {
+				ProfileSummary added = { itr->name, itr->track, 0, 0.0, 0.0 };
+				summaries.push_back(added);
+				summary = summaries.end() - 1;
+			}
+			summary->count++;
+			summary->average += milliseconds;
+			summary->maximum = std::max(summary->maximum, milliseconds);
+		}
+		for (auto itr = summaries.begin(); itr != summaries.end(); ++itr) {
+			itr->average /= itr->count;
+		}
+		std::sort(summaries.begin(), summaries.end(), [](const ProfileSummary& a, const ProfileSummary& b) {
+			return a.track != b.track ? a.track < b.track : std::strcmp(a.name, b.name) < 0;
+		});
+		return summaries;
+	}
+
+	void Profiler::Clear() {
+		std::lock_guard<std::mutex> lock(eventMutex);
+		events.clear();
+		oldestEvent = 0;
+	}
+
+	bool Profiler::WriteJSON(const std::string& path) {
+		std::ofstream file(path.c_str());
+		if (!file) {
+			return false;
+		}
+		std::vector<ProfileEvent> recorded = Events();
+		file.precision(15);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << PROFILE_TRACK_GPU << ",\"args\":{\"name\":\"GPU\"}}";
+		for (auto itr = recorded.begin(); itr != recorded.end(); ++itr) {
+			file << ",\n{\"name\":";
+			WriteString(file, itr->name);
+			file << ",\"cat\":\"" << (itr->track == PROFILE_TRACK_GPU ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << itr->track
+				<< ",\"ts\":" << itr->start << ",\"dur\":" << itr->duration << ",\"args\":{\"frame\":" << itr->frame << "}}";
+		}
+		file << "\n],\"summary\":[";
+		std::vector<ProfileSummary> summaries = Summarize();
+		for (auto itr = summaries.begin(); itr != summaries.end(); ++itr) {
+			file << (itr == summaries.begin() ? "\n" : ",\n") << "{\"name\":";
+			WriteString(file, itr->name);
+			file << ",\"cat\":\"" << (itr->track == PROFILE_TRACK_GPU ? "gpu" : "cpu") << "\",\"tid\":" << itr->track << ",\"count\":" << itr->count
+				<< ",\"averageMs\":" << itr->average << ",\"maxMs\":" << itr->maximum << "}";
+		}
+		file << "\n]}\n";
+		return file.good();
+	}
+} // namespace Sigma
@@ -0,0 +1,135 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace Sigma {
+	namespace {
+		bool Contains(const std::vector<int>& list, int value) {
+			return std::find(list.begin(), list.end(), value) != list.end();
+		}
+	}
+
+	void RenderGraph::Clear() {
+		this->textures.clear();
+		this->passes.clear();
+		this->slots.clear();
+	}
+
+	int RenderGraph::AddTexture(const std::string& name, unsigned int format, float scale /*= 1.0f*/) {
+		RenderGraphTexture texture;
+		texture.name = name;
+		texture.format = format;
+		texture.scale = scale;
+		texture.slot = -1;
+		texture.firstPass = 0;
+		texture.lastPass = 0;
+		this->textures.push_back(texture);
+		return static_cast<int>(this->textures.size()) - 1;
+	}
+
+	int RenderGraph::AddPass(const std::string& name) {
+		RenderGraphPass pass;
+		pass.name = name;
+		pass.culled = false;
+		this->passes.push_back(pass);
+		return static_cast<int>(this->passes.size()) - 1;
+	}
+
+	void RenderGraph::Read(int pass, int texture) {
+		this->passes[pass].reads.push_back(texture);
+	}
+
+	void RenderGraph::Write(int pass, int texture, bool clear) {
+		this->passes[pass].writes.push_back(texture);
+		if (clear) {
+			this->passes[pass].clears.push_back(texture);
+		}
+	}
+
+	void RenderGraph::Compile() {
+		// Walk back from the back buffer, a pass runs if it writes a texture a later pass needs.
+		std::vector<bool> needed(this->textures.size(), false);
+		for (size_t i = this->passes.size(); i-- > 0;) {
+			RenderGraphPass& pass = this->passes[i];
+			pass.culled = true;
+			for (auto itr = pass.writes.begin(); itr != pass.writes.end(); ++itr) {
+				if (*itr == BACKBUFFER || needed[*itr]) {
+					pass.culled = false;
+					break;
+				}
+			}
+			if (pass.culled) {
+				continue;
+			}
+			// What a pass clears does not depend on earlier passes, what it draws over does.
+			for (auto itr = pass.clears.begin(); itr != pass.clears.end(); ++itr) {
+				if (*itr != BACKBUFFER) {
+					needed[*itr] = false;
+				}
+			}
+			for (auto itr = pass.writes.begin(); itr != pass.writes.end(); ++itr) {
+				if (*itr != BACKBUFFER && !Contains(pass.clears, *itr)) {
+					needed[*itr] = true;
+				}
+			}
+			for (auto itr = pass.reads.begin(); itr != pass.reads.end(); ++itr) {
+				needed[*itr] = true;
+			}
+		}
+
+		// Lifetimes over the passes that run
+		std::vector<bool> used(this->textures.size(), false);
+		for (size_t i = 0; i < this->passes.size(); ++i) {
+			const RenderGraphPass& pass = this->passes[i];
+			if (pass.culled) {
+				continue;
+			}
+			for (int list = 0; list < 2; ++list) {
+				const std::vector<int>& touched = list == 0 ? pass.reads : pass.writes;
+				for (auto itr = touched.begin(); itr != touched.end(); ++itr) {
+					if (*itr == BACKBUFFER) {
+						continue;
+					}
+					RenderGraphTexture& texture = this->textures[*itr];
+					if (!used[*itr]) {
+						used[*itr] = true;
+						texture.firstPass = static_cast<unsigned int>(i);
+					}
+					texture.lastPass = static_cast<unsigned int>(i);
+				}
+			}
+		}
+
+		// Place the textures in order of first use, each in the first compatible slot free by then
+		std::vector<int> order;
+		for (size_t i = 0; i < this->textures.size(); ++i) {
+			this->textures[i].slot = -1;
+			if (used[i]) {
+				order.push_back(static_cast<int>(i));
+			}
+		}
+		std::stable_sort(order.begin(), order.end(), [this] (int a, int b) {
+			return this->textures[a].firstPass < this->textures[b].firstPass;
+		});
+		this->slots.clear();
+		for (auto itr = order.begin(); itr != order.end(); ++itr) {
+			RenderGraphTexture& texture = this->textures[*itr];
+			for (size_t s = 0; s < this->slots.size(); ++s) {
+				RenderGraphSlot& slot = this->slots[s];
+				if (slot.format == texture.format && slot.scale == texture.scale && slot.lastPass < texture.firstPass) {
+					slot.lastPass = texture.lastPass;
+					texture.slot = static_cast<int>(s);
+					break;
+				}
+			}
+			if (texture.slot < 0) {
+				RenderGraphSlot slot;
+				slot.format = texture.format;
+				slot.scale = texture.scale;
+				slot.lastPass = texture.lastPass;
+				this->slots.push_back(slot);
+				texture.slot = static_cast<int>(this->slots.size()) - 1;
+			}
+		}
+	}
+} // namespace Sigma
@@ -0,0 +1,97 @@
+#include "RenderStats.h"
+
+#include <cmath>
+#include <sstream>
+
+namespace Sigma {
+	namespace {
+		const char* PASS_NAMES[STATS_PASS_COUNT] = { "impostors", "gbuffer", "lighting", "unlit", "overlay" };
+
+		// Divides a sum by the frames it covers, with one decimal unless it is a whole number.
+		std::string Average(double value, unsigned int frames) {
+			if (frames > 1) {
+				value /= frames;
+			}
+			std::ostringstream text;
+			text.setf(std::ios::fixed);
+			text.precision(value == std::floor(value) ? 0 : 1);
+			text << value;
+			return text.str();
+		}
+	}
+
+	RenderStats::RenderStats() : objects(0), culled(0), occluded(0), impostors(0), impostorCaptures(0), lights(0), triangles(0),
+		drawCalls(0), shaderChanges(0), instances(0), programBinds(0), vertexArrayBinds(0), textureBinds(0), uniforms(0),
+		stateCalls(0), redundantStateCalls(0), uploadedBytes(0) {
+		for (unsigned int pass = 0; pass < STATS_PASS_COUNT; ++pass) {
+			this->passDrawCalls[pass] = 0;
+		}
+	}
+
+	void RenderStats::Add(const RenderStats& other) {
+		this->objects += other.objects;
+		this->culled += other.culled;
+		this->occluded += other.occluded;
+		this->impostors += other.impostors;
+		this->impostorCaptures += other.impostorCaptures;
+		this->lights += other.lights;
+		this->triangles += other.triangles;
+		this->drawCalls += other.drawCalls;
+		for (unsigned int pass = 0; pass < STATS_PASS_COUNT; ++pass) {
+			this->passDrawCalls[pass] += other.passDrawCalls[pass];
+		}
+		this->shaderChanges += other.shaderChanges;
+		this->instances += other.instances;
+		this->programBinds += other.programBinds;
+		this->vertexArrayBinds += other.vertexArrayBinds;
+		this->textureBinds += other.textureBinds;
+		this->uniforms += other.uniforms;
+		this->stateCalls += other.stateCalls;
+		this->redundantStateCalls += other.redundantStateCalls;
+		this->uploadedBytes += other.uploadedBytes;
+	}
+
+	const char* RenderStats::PassName(unsigned int pass) {
+		return pass < STATS_PASS_COUNT ? PASS_NAMES[pass] : "";
+	}
+
+	std::string RenderStats::Summary(unsigned int frames /*= 1*/) const {
+		std::ostringstream text;
+		text << Average(this->objects, frames) << " objects (" << Average(this->culled, frames) << " frustum culled, "
+			<< Average(this->occluded, frames) << " occluded, " << Average(this->impostors, frames) << " impostors, "
+			<< Average(this->impostorCaptures, frames) << " captured), " << Average(this->drawCalls, frames) << " draws (";
+		for (unsigned int pass = 0; pass < STATS_PASS_COUNT; ++pass) {
+			text << (pass > 0 ? ", " : "") << PASS_NAMES[pass] << " " << Average(this->passDrawCalls[pass], frames);
+		}
+		text << "), " << Average(this->triangles, frames) << " triangles, " << Average(this->lights, frames) << " lights, binds "
+			<< Average(this->programBinds, frames) << " programs " << Average(this->vertexArrayBinds, frames) << " VAOs "
+			<< Average(this->textureBinds, frames) << " textures, " << Average(this->uniforms, frames) << " uniforms, "
+			<< Average(static_cast<double>(this->uploadedBytes) / 1024.0, frames) << " KB uploaded, "
+			<< Average(this->stateCalls, frames) << " state calls (" << Average(this->redundantStateCalls, frames) << " skipped)";
+		return text.str();
+	}
+
+	void RenderStats::WriteJSON(std::ostream& stream, unsigned int frames /*= 1*/) const {
+		stream << "{\"objects\":" << Average(this->objects, frames)
+			<< ",\"culled\":" << Average(this->culled, frames)
+			<< ",\"occluded\":" << Average(this->occluded, frames)
+			<< ",\"impostors\":" << Average(this->impostors, frames)
+			<< ",\"impostorCaptures\":" << Average(this->impostorCaptures, frames)
+			<< ",\"lights\":" << Average(this->lights, frames)
+			<< ",\"triangles\":" << Average(this->triangles, frames)
+			<< ",\"drawCalls\":" << Average(this->drawCalls, frames)
+			<< ",\"passDrawCalls\":{";
+		for (unsigned int pass = 0; pass < STATS_PASS_COUNT; ++pass) {
+			stream << (pass > 0 ? "," : "") << "\"" << PASS_NAMES[pass] << "\":" << Average(this->passDrawCalls[pass], frames);
+		}
+		stream << "},\"shaderChanges\":" << Average(this->shaderChanges, frames)
+			<< ",\"instances\":" << Average(this->instances, frames)
+			<< ",\"programBinds\":" << Average(this->programBinds, frames)
+			<< ",\"vertexArrayBinds\":" << Average(this->vertexArrayBinds, frames)
+			<< ",\"textureBinds\":" << Average(this->textureBinds, frames)
+			<< ",\"uniforms\":" << Average(this->uniforms, frames)
+			<< ",\"stateCalls\":" << Average(this->stateCalls, frames)
+			<< ",\"redundantStateCalls\":" << Average(this->redundantStateCalls, frames)
+			<< ",\"uploadedBytes\":" << Average(static_cast<double>(this->uploadedBytes), frames) << "}";
+	}
+} // namespace Sigma
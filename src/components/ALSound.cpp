@@ -10,6 +10,9 @@ namespace Sigma {
 			alDeleteSources(1, &this->sourceid);
 			this->sourceid = 0;
 		}
+		if(this->proxy != -1) {
+			master->RemoveEmitter(this);
+		}
 	}
 	void ALSound::Update() {
 		ALint param;
@@ -161,9 +164,11 @@ namespace Sigma {
 
 	void ALSound::Position(float x, float y, float z) {
 		alSource3f(this->sourceid, AL_POSITION,x,y,z);
+		master->MoveEmitter(this, glm::vec3(x, y, z));
 	}
 	void ALSound::Position(glm::vec3 v) {
 		alSource3f(this->sourceid, AL_POSITION,v.x,v.y,v.z);
+		master->MoveEmitter(this, v);
 	}
 	void ALSound::Velocity(float x, float y, float z) {
 		alSource3f(this->sourceid, AL_VELOCITY,x,y,z);
@@ -4,18 +4,44 @@
 namespace Sigma {
 
 	void Sigma::BulletShapeMesh::SetMesh(const GLMesh* mesh, btVector3* scale) {
-		this->btmesh = new btTriangleMesh();
+		btTriangleMesh* triangles = new btTriangleMesh();
+		this->btmesh = triangles;
 		for (unsigned int i = 0; i < mesh->GetFaceCount(); ++i) {
 			const Sigma::Face* f = mesh->GetFace(i);
 			const Sigma::Vertex* v1 = mesh->GetVertex(f->v1);
 			const Sigma::Vertex* v2 = mesh->GetVertex(f->v2);
 			const Sigma::Vertex* v3 = mesh->GetVertex(f->v3);
-			this->btmesh->addTriangle(btVector3(v1->x, v1->y, v1->z), btVector3(v2->x, v2->y, v2->z), btVector3(v3->x, v3->y, v3->z));
+			triangles->addTriangle(btVector3(v1->x, v1->y, v1->z), btVector3(v2->x, v2->y, v2->z), btVector3(v3->x, v3->y, v3->z));
 		}
 
 		this->shape = new btScaledBvhTriangleMeshShape(new btBvhTriangleMeshShape(this->btmesh, false),	*scale);
 	}
 
+	void Sigma::BulletShapeMesh::SetMesh(std::shared_ptr<const MeshData> data, float scale) {
+		if (!data || data->faces.empty() || data->verts.empty()) {
+			LOG_WARN << "Collision mesh has no triangles";
+			return;
+		}
+		this->meshData = data;
+
+		// Face and Vertex are tightly packed unsigned ints and floats, Bullet can read them in place.
+		btIndexedMesh indexed;
+		indexed.m_numTriangles = data->faces.size();
+		indexed.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(&data->faces[0].v1);
+		indexed.m_triangleIndexStride = sizeof(Face);
+		indexed.m_numVertices = data->verts.size();
+		indexed.m_vertexBase = reinterpret_cast<const unsigned char*>(&data->verts[0].x);
+		indexed.m_vertexStride = sizeof(Vertex);
+		indexed.m_indexType = PHY_INTEGER;
+		indexed.m_vertexType = PHY_FLOAT;
+
+		btTriangleIndexVertexArray* array = new btTriangleIndexVertexArray();
+		array->addIndexedMesh(indexed, PHY_INTEGER);
+		this->btmesh = array;
+
+		this->shape = new btScaledBvhTriangleMeshShape(new btBvhTriangleMeshShape(this->btmesh, true), btVector3(scale, scale, scale));
+	}
+
 	// convinence function for an even scale accross all dimensions
 	void Sigma::BulletShapeMesh::SetMesh(const GLMesh* mesh, const float scale) {
 		SetMesh(mesh, new btVector3(scale, scale, scale));
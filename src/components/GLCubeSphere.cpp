@@ -1,4 +1,6 @@
 #include "components/GLCubeSphere.h"
+#include "MeshOptimizer.h"
+#include "systems/GLState.h"
 
 #include "SOIL/SOIL.h"
 
@@ -16,7 +18,9 @@ namespace Sigma {
 																	 (abs(rhs.y - lhs.y) < epsilon) &&
 																	 (abs(rhs.z - lhs.z) < epsilon)); }
 
-    GLCubeSphere::GLCubeSphere( const id_t entityID ) : GLMesh(entityID) {
+    std::map<int, SharedGeometry> GLCubeSphere::geometryCache;
+
+    GLCubeSphere::GLCubeSphere( const id_t entityID ) : GLMesh(entityID), _cubeMap(0), _cubeNormalMap(0), _subdivisionLevels(1), _rotationSpeed(0.0f), _fixToCamera(false) {
         // initialization handled by GLMesh or InitializeBuffers
     }
 
@@ -25,11 +29,37 @@ namespace Sigma {
         if(this->_cubeNormalMap != 0) {
             glDeleteTextures(1, &this->_cubeNormalMap);
 		}
+        // The names may get reused while GLState still thinks they are bound.
+        GLState::Invalidate();
     }
 
     void GLCubeSphere::InitializeBuffers() {
         srand(this->GetEntityID());
 
+        SharedGeometry& cached = GLCubeSphere::geometryCache[this->_subdivisionLevels];
+        if (cached.elementBuffer != 0) {
+            // Every cubesphere of this level draws the same buffers.
+            ShareGeometry(cached);
+            GLMesh::InitializeBuffers();
+        }
+        else {
+            BuildGeometry();
+            GLMesh::InitializeBuffers();
+            cached = DetachGeometry();
+            LOG << "Generated cubesphere geometry with " << this->_subdivisionLevels << " subdivisions: " << cached.lods[0].faceCount << " faces, " << cached.vertexCount << " verts";
+        }
+
+		// shader program was compiled and linked in GLMesh::InitializeBuffers.
+		//  Now we can set relevant custom uniform values
+		this->shader->Use();
+		this->shader->AddUniform("cubeMap");
+		glUniform1i((*this->shader)("cubeMap"), 0);
+		this->shader->AddUniform("cubeNormalMap");
+		glUniform1i((*this->shader)("cubeNormalMap"), 1);
+		this->shader->UnUse();
+    } // function InitializeBuffers
+
+    void GLCubeSphere::BuildGeometry() {
         // add vertices of cube corners. these are basis of the first faces.
         float t = 1.0f;
 
@@ -70,18 +100,19 @@ namespace Sigma {
         //  Cubesphere normals are computed in the shader 'shaders/cubesphere.vert'.
         //  TODO get GLIcoSphere's normal calculations into a shader too
 
-		GLMesh::InitializeBuffers();
+		// The shader normalizes the positions anyway. Doing it here gives the simplifier and the
+		//  bounding sphere the real shape instead of a subdivided cube.
+		for (auto itr = this->verts.begin(); itr != this->verts.end(); ++itr) {
+			glm::vec3 n = glm::normalize(glm::vec3(itr->x, itr->y, itr->z));
+			*itr = Vertex(n.x, n.y, n.z);
+		}
 
-		// shader program was compiled and linked in GLMesh::InitializeBuffers.
-		//  Now we can set relevant custom uniform values
-		this->shader->Use();
-		this->shader->AddUniform("cubeMap");
-		glUniform1i((*this->shader)("cubeMap"), 0);
-		this->shader->AddUniform("cubeNormalMap");
-		glUniform1i((*this->shader)("cubeNormalMap"), 1);
-		this->shader->UnUse();
+		mesh::OptimizeVertexCache(&this->faces[0].v1, this->faces.size() * 3, this->verts.size());
 
-    } // function InitializeBuffers
+		if (this->lodLevels > 0) {
+			GenerateLODs(this->lodLevels);
+		}
+    } // function BuildGeometry
 
     bool GLCubeSphere::LoadTexture(std::string texture_name) {
         // SOIL makes this straightforward..
@@ -137,6 +168,8 @@ namespace Sigma {
 				}
 			}
         }
+		// SOIL binds the textures it creates behind GLState's back.
+		GLState::Invalidate();
 
 		if ((this->_cubeMap == 0) && (this->_cubeNormalMap == 0)) {
 			return false;
@@ -148,98 +181,58 @@ namespace Sigma {
         return Vertex((v1.x + v2.x)/2.0f, (v1.y + v2.y)/2.0f, (v1.z + v2.z)/2.0f);
     }
 
-    int GLCubeSphere::CreateOrGetMidpoint(std::map<int64_t,int> &cache, const int v1, const int v2){
-        // cache standard: smaller vertex index first.
-        int64_t key = v1 < v2
-                ? (static_cast<int64_t>(v1) << 32 | static_cast<int64_t>(v2))
-                : (static_cast<int64_t>(v2) << 32 | static_cast<int64_t>(v1));
-        // look up midpoint based on key hash
-        auto found = cache.find(key);
-        if (found != cache.end()) {
-            return found->second;
-        }
-		else {
-            // create and save vertex
-            int next_index = cache[key] = this->verts.size();
-            //Vertex midpt();
-            AddVertex(GetMidPoint(this->verts[v1], this->verts[v2]));
-            return next_index;
-        }
-    }
-
     void GLCubeSphere::Refine(int level) {
-        // cache of midpoints. allows lookup from 2 vertices to their midpoint
-        std::map<int64_t, int> cache;
+        std::vector<unsigned int> indices;
+        indices.reserve(this->faces.size() * 3);
+        for (auto faceitr = this->faces.begin(); faceitr != this->faces.end(); ++faceitr) {
+            indices.push_back(faceitr->v1);
+            indices.push_back(faceitr->v2);
+            indices.push_back(faceitr->v3);
+        }
 
+        std::vector<unsigned int> parents;
         for (int i = 0; i < level; ++i) {
-            std::vector<Face> tempFaces; // placeholder for next level of subdivision
-            for (auto faceitr = this->faces.begin(); faceitr != this->faces.end(); ++faceitr) {
-                // index of midpoints of v1--v2, v2--v3, and v3--v1, respectively
-                int a, b, c;
-                {
-                    int v1 = (*faceitr).v1;
-                    int v2 = (*faceitr).v2;
-                    a = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-                {
-                    int v1 = (*faceitr).v2;
-                    int v2 = (*faceitr).v3;
-                    b = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-                {
-                    int v1 = (*faceitr).v3;
-                    int v2 = (*faceitr).v1;
-                    c = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-
-                tempFaces.push_back(Face((*faceitr).v1, a, c));
-                tempFaces.push_back(Face((*faceitr).v2, b, a));
-                tempFaces.push_back(Face((*faceitr).v3, c, b));
-                tempFaces.push_back(Face(a, b, c));
+            size_t count = mesh::SubdivideTriangles(indices, parents, this->verts.size());
+            this->verts.reserve(count);
+            for (size_t p = 0; p < parents.size(); p += 2) {
+                AddVertex(GetMidPoint(this->verts[parents[p]], this->verts[parents[p + 1]]));
             }
-            this->faces = tempFaces;
+        }
+
+        this->faces.clear();
+        this->faces.reserve(indices.size() / 3);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            this->faces.push_back(Face(indices[i], indices[i + 1], indices[i + 2]));
         }
     } // function Refine
 
-	void GLCubeSphere::Render(glm::mediump_float *view, glm::mediump_float *proj) {
+    void GLCubeSphere::Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj) {
         if(this->_fixToCamera) {
-            glm::mediump_float *view_ptr = view;
-            glm::mat4 view_matrix;
-
-            for(int i=0; i < 4; i++) {
-                for(int j=0; j < 4; j++) {
-                    view_matrix[i][j] = (*view_ptr++);
-                }
-            }
-
-            // Extract position from view matrix
-            glm::mat3 rotMat(view_matrix);
-            glm::vec3 d(view_matrix[3]);
+            // Extract position from view matrix, before the packet captures the model matrix
+            glm::mat3 rotMat(view);
+            glm::vec3 d(view[3]);
             glm::vec3 position = -d * rotMat;
             this->Transform()->TranslateTo(position);
+        }
+        IGLComponent::Submit(queue, pass, view, proj);
+    }
 
-			glDepthFunc(GL_LEQUAL);
+	void GLCubeSphere::Render(glm::mediump_float *view, glm::mediump_float *proj) {
+        if(this->_fixToCamera) {
+			GLState::SetDepthFunc(GL_LEQUAL);
         }
 
         // bind cubemap textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, this->_cubeMap);
+        GLState::ActiveTexture(GL_TEXTURE0);
+        GLState::BindTexture(GL_TEXTURE_CUBE_MAP, this->_cubeMap);
         if(this->_cubeNormalMap != 0){
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, this->_cubeNormalMap);
+            GLState::ActiveTexture(GL_TEXTURE1);
+            GLState::BindTexture(GL_TEXTURE_CUBE_MAP, this->_cubeNormalMap);
         }
 
         // render da mesh
         GLMesh::Render(view, proj);
 
-		// unbind that which GLMesh does not unbind
-        if(this->_cubeNormalMap != 0){
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-        }
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-		glDepthFunc(GL_LESS);
+		GLState::SetDepthFunc(GL_LESS);
     } // function Render
 } // namespace Sigma
@@ -1,15 +1,32 @@
 #include "components/GLIcoSphere.h"
+#include "MeshOptimizer.h"
 
 #include <vector>
 
 namespace Sigma{
-    GLIcoSphere::GLIcoSphere( const id_t entityID ) : GLMesh(entityID) {
-        // all initialization handled by GLMesh
+    std::map<int, GLIcoSphere::CachedGeometry> GLIcoSphere::geometryCache;
+
+    GLIcoSphere::GLIcoSphere( const id_t entityID ) : GLMesh(entityID), subdivisionLevels(4), sharedColors(false) {
+        // all other initialization handled by GLMesh
     }
 
     void GLIcoSphere::InitializeBuffers() {
         srand(this->GetEntityID());
 
+        CachedGeometry& cached = GLIcoSphere::geometryCache[this->subdivisionLevels];
+        if (cached.geometry.elementBuffer != 0) {
+            // Another icosphere already built this level, only the colors are per instance.
+            ShareGeometry(cached.geometry);
+            if (this->sharedColors) {
+                this->buffers[this->ColorBufIndex] = cached.colorBuffer;
+            }
+            else {
+                GenerateColors(cached.midpointParents);
+            }
+            GLMesh::InitializeBuffers();
+            return;
+        }
+
         // Create the verts to begin refining at.
         double t = (1.0 + glm::sqrt(5.0)) / 2.0;
         glm::vec2 coordPair = glm::normalize(glm::vec2(1,t));
@@ -29,21 +46,6 @@ namespace Sigma{
         AddVertex(Vertex(-coordPair.g, 0, -coordPair.r));
         AddVertex(Vertex(-coordPair.g, 0, coordPair.r));
 
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-        AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
-
         AddFace(Face(0,11,5));
         AddFace(Face(0,5,1));
         AddFace(Face(0,1,7));
@@ -68,8 +70,8 @@ namespace Sigma{
         AddFace(Face(8,6,7));
         AddFace(Face(9,8,1));
 
-        // Refine the IcoSphere by 4 levels. This results in 20*4^4 = 5120 faces.
-        Refine(4);
+        // Refine the IcoSphere. The default of 4 levels results in 20*4^4 = 5120 faces.
+        Refine(this->subdivisionLevels);
 
         AddMeshGroupIndex(0);
 
@@ -84,9 +86,37 @@ namespace Sigma{
             AddVertexNormal(Vertex(norm.x, norm.y, norm.z));
         }
 
+        // Only the triangle order changes, vertex indices (and thus the midpoint parents) stay valid.
+        mesh::OptimizeVertexCache(&this->faces[0].v1, this->faces.size() * 3, this->verts.size());
+
+        if (this->lodLevels > 0) {
+            GenerateLODs(this->lodLevels);
+        }
+
+        cached.midpointParents.swap(this->midpointParents);
+        GenerateColors(cached.midpointParents);
+
         GLMesh::InitializeBuffers();
+        cached.geometry = DetachGeometry();
+        cached.colorBuffer = this->buffers[this->ColorBufIndex];
+        LOG << "Generated icosphere geometry with " << this->subdivisionLevels << " subdivisions: " << cached.geometry.lods[0].faceCount << " faces, " << cached.geometry.vertexCount << " verts";
     } // function InitializeBuffers
 
+    void GLIcoSphere::GenerateColors(const std::vector<unsigned int>& parents) {
+        this->colors.clear();
+        this->colors.reserve(12 + parents.size() / 2);
+        for (int i = 0; i < 12; ++i) {
+            AddVertexColor((rand() % 6) > 0 ? Color(0,0,1) : Color(0,1,0));
+        }
+
+        // placeholders for random "terrain gen" of land (green) and water (blue)
+        float green, blue;
+        for (size_t i = 0; i + 1 < parents.size(); i += 2) {
+            RefineColor(parents[i], parents[i + 1], &green, &blue);
+            AddVertexColor(Color(0.0f, green, blue));
+        }
+    }
+
     void GLIcoSphere::Render(glm::mediump_float *view, glm::mediump_float *proj) {
         GLMesh::Render(view, proj);
     }
@@ -98,60 +128,31 @@ namespace Sigma{
     }
 
     void GLIcoSphere::Refine(int level) {
-        // cache of midpoints. allows lookup from 2 vertices to their midpoint
-        std::map<int64_t, int> cache;
+        std::vector<unsigned int> indices;
+        indices.reserve(this->faces.size() * 3);
+        for (auto faceitr = this->faces.begin(); faceitr != this->faces.end(); ++faceitr) {
+            indices.push_back(faceitr->v1);
+            indices.push_back(faceitr->v2);
+            indices.push_back(faceitr->v3);
+        }
 
+        this->midpointParents.clear();
+        std::vector<unsigned int> parents;
         for (int i = 0; i < level; ++i) {
-            std::vector<Face> tempFaces; // placeholder for next level of subdivision
-            for (auto faceitr = this->faces.begin(); faceitr != this->faces.end(); ++faceitr) {
-                // index of midpoints of v1--v2, v2--v3, and v3--v1, respectively
-                int a, b, c;
-                {
-                    int v1 = (*faceitr).v1;
-                    int v2 = (*faceitr).v2;
-                    a = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-                {
-                    int v1 = (*faceitr).v2;
-                    int v2 = (*faceitr).v3;
-                    b = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-                {
-                    int v1 = (*faceitr).v3;
-                    int v2 = (*faceitr).v1;
-                    c = this->CreateOrGetMidpoint(cache, v1, v2);
-                }
-
-                tempFaces.push_back(Face((*faceitr).v1, a, c));
-                tempFaces.push_back(Face((*faceitr).v2, b, a));
-                tempFaces.push_back(Face((*faceitr).v3, c, b));
-                tempFaces.push_back(Face(a, b, c));
+            size_t count = mesh::SubdivideTriangles(indices, parents, this->verts.size());
+            this->verts.reserve(count);
+            for (size_t p = 0; p < parents.size(); p += 2) {
+                AddVertex(GetUnitSphereMidPoint(this->verts[parents[p]], this->verts[parents[p + 1]]));
             }
-            this->faces = tempFaces;
+            this->midpointParents.insert(this->midpointParents.end(), parents.begin(), parents.end());
         }
-    } // function Refine
 
-    int GLIcoSphere::CreateOrGetMidpoint(std::map<int64_t,int> &cache, const int v1, const int v2){
-        // cache standard: smaller vertex index first.
-        int64_t key = v1 < v2
-                ? (static_cast<int64_t>(v1) << 32 | static_cast<int64_t>(v2))
-                : (static_cast<int64_t>(v2) << 32 | static_cast<int64_t>(v1));
-        // placeholders for random "terrain gen" of land (green) and water (blue)
-        float green, blue;
-        // look up midpoint based on key hash
-        auto found = cache.find(key);
-        if (found != cache.end()) {
-            return found->second;
+        this->faces.clear();
+        this->faces.reserve(indices.size() / 3);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            this->faces.push_back(Face(indices[i], indices[i + 1], indices[i + 2]));
         }
-		else {
-            // create and save vertex
-            int next_index = cache[key] = this->verts.size();
-            AddVertex(GetUnitSphereMidPoint(this->verts[v1], this->verts[v2]));
-            RefineColor(v1, v2, &green, &blue);
-            AddVertexColor(Color(0.0f, green, blue));
-            return next_index;
-        }
-    }
+    } // function Refine
 
     void GLIcoSphere::RefineColor(const int v1, const int v2, float* green, float* blue) const {
         *green = 0.0f; *blue = 0.0f; // exactly one of these will be set to 1 by the end of this function
@@ -4,6 +4,7 @@
 #include "GL/glew.h"
 #endif
 #include "strutils.h"
+#include "MeshOptimizer.h"
 
 #include <algorithm>
 #include <stdexcept>
@@ -13,13 +14,54 @@
 #include <sstream>
 #include "resources/GLTexture.h"
 #include "systems/OpenGLSystem.h"
+#include "systems/GLState.h"
 
 namespace Sigma{
 
     // static member initialization
     const std::string GLMesh::DEFAULT_SHADER = "shaders/mesh_deferred";
+    float GLMesh::lodThreshold = 0.001f;
+    const float GLMesh::OCCLUDER_ERROR = 0.01f;
+    std::map<std::string, std::weak_ptr<const MeshData>> GLMesh::sharedMeshData;
+    size_t GLMesh::releasedBytes = 0;
+
+    namespace {
+        // How far (relative to the threshold) the projected error has to move past the threshold
+        // before the level changes, so instances near the switch distance do not flicker.
+        const float kLODHysteresis = 0.2f;
+        // A level that keeps more than this fraction of the previous level's faces is not worth keeping.
+        const float kLODMinReduction = 0.85f;
+        // The largest simplification error (relative to the mesh extent) a single level may add.
+        const float kLODMaxError = 0.25f;
+
+        // Appends the indices of faces narrowed to the element type of the buffer.
+        template<typename T>
+        void AppendIndices(std::vector<T>& indices, const std::vector<Face>& faces) {
+            for (auto itr = faces.begin(); itr != faces.end(); ++itr) {
+                indices.push_back(static_cast<T>(itr->v1));
+                indices.push_back(static_cast<T>(itr->v2));
+                indices.push_back(static_cast<T>(itr->v3));
+            }
+        }
 
-    GLMesh::GLMesh(const id_t entityID) : IGLComponent(entityID) {
+        // Returns the largest side of the bounding box of the vertices referenced by indices.
+        float IndexedExtent(const std::vector<unsigned int>& indices, const std::vector<Vertex>& verts) {
+            if (indices.empty()) {
+                return 0.0f;
+            }
+            Vertex minimum = verts[indices[0]];
+            Vertex maximum = minimum;
+            for (size_t i = 1; i < indices.size(); ++i) {
+                const Vertex& v = verts[indices[i]];
+                minimum.x = std::min(minimum.x, v.x); maximum.x = std::max(maximum.x, v.x);
+                minimum.y = std::min(minimum.y, v.y); maximum.y = std::max(maximum.y, v.y);
+                minimum.z = std::min(minimum.z, v.z); maximum.z = std::max(maximum.z, v.z);
+            }
+            return std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+        }
+    }
+
+    GLMesh::GLMesh(const id_t entityID) : IGLComponent(entityID), optimizeOverdraw(false), lodLevels(4), currentLOD(0), lastTriangleCount(0), sharedGeometry(false), perInstanceAttributes(false), indexType(GL_UNSIGNED_INT), indexSize(sizeof(GLuint)), uploadedVertexCount(0), residency(RESIDENT_NONE), occluder(false), staticBatch(nullptr), staticEntry(-1) {
         memset(&this->buffers, 0, sizeof(this->buffers));
         this->vao = 0;
         this->drawMode = GL_TRIANGLES;
@@ -40,14 +82,16 @@ namespace Sigma{
         if (this->vao == 0) {
             glGenVertexArrays(1, &this->vao); // Generate the VAO
         }
-        glBindVertexArray(this->vao); // Bind the VAO
+        GLState::BindVertexArray(this->vao); // Bind the VAO
 
-        if (this->verts.size() > 0) {
+        if (this->verts.size() > 0 || this->sharedGeometry) {
             if (this->buffers[this->VertBufIndex] == 0) {
                 glGenBuffers(1, &this->buffers[this->VertBufIndex]); 	// Generate the vertex buffer.
             }
             glBindBuffer(GL_ARRAY_BUFFER, this->buffers[this->VertBufIndex]); // Bind the vertex buffer.
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * this->verts.size(), &this->verts.front(), GL_STATIC_DRAW); // Stores the verts in the vertex buffer.
+            if (!this->sharedGeometry) {
+                glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * this->verts.size(), &this->verts.front(), GL_STATIC_DRAW); // Stores the verts in the vertex buffer.
+            }
             GLint posLocation = glGetAttribLocation((*shader).GetProgram(), "in_Position"); // Find the location in the shader where the vertex buffer data will be placed.
             glVertexAttribPointer(posLocation, 3, GL_FLOAT, GL_FALSE, 0, 0); // Tell the VAO the vertex data will be stored at the location we just found.
             glEnableVertexAttribArray(posLocation); // Enable the VAO line for vertex data.
@@ -62,51 +106,205 @@ namespace Sigma{
             glVertexAttribPointer(uvLocation, 2, GL_FLOAT, GL_FALSE, 0, 0); // Tell the VAO the vertex data will be stored at the location we just found.
             glEnableVertexAttribArray(uvLocation); // Enable the VAO line for vertex data.
         }
-        if (this->colors.size() > 0) {
+        if (this->colors.size() > 0 || (this->sharedGeometry && this->buffers[this->ColorBufIndex] != 0)) {
             if (this->buffers[this->ColorBufIndex] == 0) {
                 glGenBuffers(1, &this->buffers[this->ColorBufIndex]);
             }
             glBindBuffer(GL_ARRAY_BUFFER, this->buffers[this->ColorBufIndex]);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Color) * this->colors.size(), &this->colors.front(), GL_STATIC_DRAW);
+            if (this->colors.size() > 0) {
+                glBufferData(GL_ARRAY_BUFFER, sizeof(Color) * this->colors.size(), &this->colors.front(), GL_STATIC_DRAW);
+            }
             GLint colLocation = glGetAttribLocation((*shader).GetProgram(), "in_Color");
             glVertexAttribPointer(colLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
             glEnableVertexAttribArray(colLocation);
         }
-        if (this->faces.size() > 0) {
+        if (this->sharedGeometry) {
+            // The shared element buffer already holds every level, only record it in the VAO.
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers[this->ElemBufIndex]);
+        }
+        else if (this->faces.size() > 0) {
+            if (this->lods.empty() || this->lods[0].faceCount != this->faces.size()) {
+                BuildBaseLOD();
+            }
             if (this->buffers[this->ElemBufIndex] == 0) {
                 glGenBuffers(1, &this->buffers[this->ElemBufIndex]); // Generate the element buffer.
             }
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers[this->ElemBufIndex]); // Bind the element buffer.
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Face) * this->faces.size(), &this->faces.front(), GL_STATIC_DRAW); // Store the faces in the element buffer.
+            // The simplified levels are stored right after the full resolution faces.
+            const size_t indexCount = (this->faces.size() + this->lodFaces.size()) * 3;
+            if (this->verts.size() <= 65536) {
+                // Every index fits in 16 bits, which halves the element buffer.
+                std::vector<GLushort> indices;
+                indices.reserve(indexCount);
+                AppendIndices(indices, this->faces);
+                AppendIndices(indices, this->lodFaces);
+                this->indexType = GL_UNSIGNED_SHORT;
+                this->indexSize = sizeof(GLushort);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indexCount, &indices.front(), GL_STATIC_DRAW); // Store the faces in the element buffer.
+            }
+            else {
+                this->indexType = GL_UNSIGNED_INT;
+                this->indexSize = sizeof(GLuint);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Face) * (this->faces.size() + this->lodFaces.size()), nullptr, GL_STATIC_DRAW);
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(Face) * this->faces.size(), &this->faces.front()); // Store the faces in the element buffer.
+                if (this->lodFaces.size() > 0) {
+                    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Face) * this->faces.size(), sizeof(Face) * this->lodFaces.size(), &this->lodFaces.front());
+                }
+            }
         }
-        if (this->vertNorms.size() > 0) {
+        if (this->vertNorms.size() > 0 || (this->sharedGeometry && this->buffers[this->NormalBufIndex] != 0)) {
             if (this->buffers[this->NormalBufIndex] == 0) {
                 glGenBuffers(1, &this->buffers[this->NormalBufIndex]);
             }
             glBindBuffer(GL_ARRAY_BUFFER, this->buffers[this->NormalBufIndex]);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex)*this->vertNorms.size(), &this->vertNorms[0], GL_STATIC_DRAW);
+            if (!this->sharedGeometry) {
+                glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex)*this->vertNorms.size(), &this->vertNorms[0], GL_STATIC_DRAW);
+            }
             GLint normalLocation = glGetAttribLocation((*shader).GetProgram(), "in_Normal");
             glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
             glEnableVertexAttribArray(normalLocation);
         }
 
-        glBindVertexArray(0); // Reset the buffer binding because we are good programmers.
+        GLState::BindVertexArray(0); // Reset the buffer binding because we are good programmers.
+
+        // Bounding sphere around the center of the bounding box, used for LOD selection.
+        if (this->verts.size() > 0) {
+            this->uploadedVertexCount = this->verts.size();
+            glm::vec3 minimum(this->verts[0].x, this->verts[0].y, this->verts[0].z);
+            glm::vec3 maximum = minimum;
+            for (auto itr = this->verts.begin(); itr != this->verts.end(); ++itr) {
+                minimum = glm::min(minimum, glm::vec3(itr->x, itr->y, itr->z));
+                maximum = glm::max(maximum, glm::vec3(itr->x, itr->y, itr->z));
+            }
+            this->boundingCenter = (minimum + maximum) * 0.5f;
+            this->boundingRadius = 0.0f;
+            for (auto itr = this->verts.begin(); itr != this->verts.end(); ++itr) {
+                this->boundingRadius = std::max(this->boundingRadius, glm::distance(this->boundingCenter, glm::vec3(itr->x, itr->y, itr->z)));
+            }
+        }
+
+		// The view, projection and material come from uniform blocks, the samplers never change.
+		GLSLShader* programs[] = { this->shader.get(), this->instancedShader.get() };
+		for (GLSLShader* program : programs) {
+			if (!program) {
+				continue;
+			}
+			program->Use();
+			program->AddUniform("in_Model");
+			program->AddUniform("texAmb");
+			program->AddUniform("texDiff");
+			glUniform1i((*program)("texDiff"), 0);
+			glUniform1i((*program)("texAmb"), 1);
+			program->UnUse();
+		}
+
+		for (auto itr = this->mats.begin(); itr != this->mats.end(); ++itr) {
+			RenderQueue::BuildMaterialBuffer(itr->second);
+		}
 
-		this->shader->Use();
-		this->shader->AddUniform("in_Model");
-		this->shader->AddUniform("in_View");
-		this->shader->AddUniform("in_Proj");
-		this->shader->AddUniform("texEnabled");
-		this->shader->AddUniform("ambientTexEnabled");
-		this->shader->AddUniform("diffuseTexEnabled");
-		this->shader->AddUniform("texAmb");
-		this->shader->AddUniform("texDiff");
-		this->shader->AddUniform("specularHardness");
-		this->shader->UnUse();
+        // Own texture coordinates or colors on top of shared geometry can not be drawn instanced.
+        this->perInstanceAttributes = this->sharedGeometry && (this->texCoords.size() > 0 || this->colors.size() > 0);
+
+        if (this->occluder) {
+            BuildOccluder();
+        }
+        if (this->staticBatch) {
+            AddToStaticBatch();
+        }
+        ReleaseCPUData();
     }
 
-    void GLMesh::Render(glm::mediump_float *view, glm::mediump_float *proj) {
-        glm::mat4 modelMatrix = this->Transform()->GetMatrix();
+    void GLMesh::BuildOccluder() {
+        this->occluderVerts.clear();
+        this->occluderIndices.clear();
+        if (this->verts.empty() || this->lods.empty()) {
+            LOG_WARN << "Occluder " << this->meshName << " has no CPU geometry, it hides nothing";
+            return;
+        }
+
+        // The coarsest level close enough to the surface. It may bulge out by its error, so it is
+        // shrunk by that much below.
+        size_t level = 0;
+        for (size_t i = 1; i < this->lods.size(); ++i) {
+            if (this->lods[i].error <= GLMesh::OCCLUDER_ERROR * this->boundingRadius) {
+                level = i;
+            }
+        }
+
+        const size_t baseFace = this->faces.size();
+        const bool hasNormals = this->vertNorms.size() == this->verts.size();
+        std::vector<unsigned int> remap(this->verts.size(), ~0u);
+        std::vector<Vertex> outward;
+        const MeshLOD& lod = this->lods[level];
+        for (auto itr = lod.ranges.begin(); itr != lod.ranges.end(); ++itr) {
+            for (unsigned int i = 0; i < itr->faceCount; ++i) {
+                const unsigned int faceIndex = itr->firstFace + i;
+                const Face& face = (faceIndex < baseFace) ? this->faces[faceIndex] : this->lodFaces[faceIndex - baseFace];
+                const unsigned int corners[3] = { face.v1, face.v2, face.v3 };
+                for (int corner = 0; corner < 3; ++corner) {
+                    unsigned int& vertex = remap[corners[corner]];
+                    if (vertex == ~0u) {
+                        vertex = static_cast<unsigned int>(this->occluderVerts.size());
+                        const Vertex& source = this->verts[corners[corner]];
+                        this->occluderVerts.push_back(source);
+                        // Without normals, away from the center is outward for the closed meshes occluders suit.
+                        outward.push_back(hasNormals ? this->vertNorms[corners[corner]] :
+                            Vertex(source.x - this->boundingCenter.x, source.y - this->boundingCenter.y, source.z - this->boundingCenter.z));
+                    }
+                    this->occluderIndices.push_back(vertex);
+                }
+            }
+        }
+        if (lod.error > 0.0f && !this->occluderVerts.empty()) {
+            ShrinkOccluder(&this->occluderVerts[0].x, &outward[0].x, sizeof(Vertex), this->occluderVerts.size(), lod.error);
+        }
+        LOG << "Occluder " << this->meshName << ": " << this->occluderIndices.size() / 3 << " triangles from level " << level
+            << ", shrunk by " << lod.error;
+    }
+
+    void GLMesh::AddToStaticBatch() {
+        if (this->sharedGeometry || this->drawMode != GL_TRIANGLES || this->verts.empty() || this->lods.empty()) {
+            return;
+        }
+        std::vector<unsigned int> indices;
+        indices.reserve((this->faces.size() + this->lodFaces.size()) * 3);
+        AppendIndices(indices, this->faces);
+        AppendIndices(indices, this->lodFaces);
+
+        StaticGeometry geometry;
+        geometry.positions = &this->verts[0];
+        geometry.vertexCount = this->verts.size();
+        geometry.normals = (this->vertNorms.size() == this->verts.size()) ? &this->vertNorms[0] : nullptr;
+        geometry.texCoords = (this->texCoords.size() == this->verts.size()) ? &this->texCoords[0] : nullptr;
+        geometry.colors = (this->colors.size() == this->verts.size()) ? &this->colors[0] : nullptr;
+        geometry.indices = &indices[0];
+        geometry.indexCount = indices.size();
+        for (unsigned int level = 0; level < this->lods.size(); ++level) {
+            const MeshLOD& lod = this->lods[level];
+            for (auto itr = lod.ranges.begin(); itr != lod.ranges.end(); ++itr) {
+                auto mat_itr = this->mats.find(itr->material);
+                StaticRange range = { level, itr->firstFace * 3, itr->faceCount * 3, (mat_itr != this->mats.end()) ? &mat_itr->second : nullptr };
+                geometry.ranges.push_back(range);
+            }
+        }
+        this->staticEntry = this->staticBatch->Add(this->shader, this->Transform()->GetMatrix(), this->cull_face,
+            this->IsLightingEnabled() ? PASS_GBUFFER : PASS_UNLIT, geometry);
+    }
+
+    bool GLMesh::GetOccluder(OccluderGeometry& geometry) const {
+        if (this->occluderIndices.empty()) {
+            return false;
+        }
+        geometry.positions = &this->occluderVerts[0].x;
+        geometry.stride = sizeof(Vertex);
+        geometry.vertexCount = this->occluderVerts.size();
+        geometry.indices = &this->occluderIndices[0];
+        geometry.indexCount = this->occluderIndices.size();
+        return true;
+    }
+
+    void GLMesh::Render(glm::mediump_float* /*view*/, glm::mediump_float* /*proj*/) {
+        glm::mat4 modelMatrix = this->RenderMatrix();
 
 		//if(this->parentTransform != 0) {
 		//	modelMatrix = this->parentTransform->GetMatrix() * modelMatrix;
@@ -114,63 +312,66 @@ namespace Sigma{
 
         this->shader->Use();
         glUniformMatrix4fv((*this->shader)("in_Model"), 1, GL_FALSE, &modelMatrix[0][0]);
-        glUniformMatrix4fv((*this->shader)("in_View"), 1, GL_FALSE, view);
-        glUniformMatrix4fv((*this->shader)("in_Proj"), 1, GL_FALSE, proj);
 
-        glBindVertexArray(this->Vao());
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->GetBuffer(this->ElemBufIndex));
+        // The VAO holds the element buffer binding.
+        GLState::BindVertexArray(this->Vao());
+        GLState::SetCullFace(this->cull_face);
+
+        // The level picked when the frame was built, the next frame may be picking another one
+        const unsigned int level = this->RenderLOD();
+        if (level < this->lods.size()) {
+            const MeshLOD& lod = this->lods[level];
+            for (auto itr = lod.ranges.begin(); itr != lod.ranges.end(); ++itr) {
+                auto mat_itr = this->mats.find(itr->material);
+                RenderQueue::ApplyMaterial(mat_itr != this->mats.end() ? &mat_itr->second : nullptr);
+                glDrawElements(this->DrawMode(), itr->faceCount * 3, this->indexType, reinterpret_cast<void*>(itr->firstFace * 3 * this->indexSize));
+            }
+        }
+    } // function Render
 
-        if(this->cull_face == 0) {
-            glDisable(GL_CULL_FACE);
+    void GLMesh::Submit(RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& proj) {
+        glm::mat4 modelMatrix = this->Transform()->GetMatrix();
+        glm::mat4 modelView = view * modelMatrix;
+
+        UpdateLOD(modelView, proj[1][1]);
+        if (this->currentLOD >= this->lods.size()) {
+            return;
         }
-        else {
-            glCullFace(this->cull_face);
-        }
-
-        glActiveTexture(GL_TEXTURE0);
-        size_t prev = 0;
-        for (int i = 0, cur = this->MeshGroup_ElementCount(0); cur != 0; prev = cur, cur = this->MeshGroup_ElementCount(++i)) {
-            if (this->faceGroups.size() > 0) {
-                Material& mat = this->mats[this->faceGroups[prev]];
-
-				if (mat.ambientMap) {
-					glUniform1i((*this->shader)("texEnabled"), 1);
-					glUniform1i((*this->shader)("ambientTexEnabled"), 1);
-					glUniform1i((*this->shader)("texAmb"), 1);
-					glActiveTexture(GL_TEXTURE1);
-					glBindTexture(GL_TEXTURE_2D, mat.ambientMap);
-				} else {
-					glUniform1i((*this->shader)("ambientTexEnabled"), 0);
-				}
-
-				if (mat.diffuseMap) {
-					glUniform1i((*this->shader)("texEnabled"), 1);
-					glUniform1i((*this->shader)("diffuseTexEnabled"), 1);
-					glUniform1i((*this->shader)("texDiff"), 0);
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, mat.diffuseMap);
-				} else {
-					glUniform1i((*this->shader)("diffuseTexEnabled"), 0);
-				}
-
-				glUniform1f((*this->shader)("specularHardness"), mat.hardness);
-            }
-			else {
-				glUniform1i((*this->shader)("texEnabled"), 0);
-				glUniform1i((*this->shader)("diffuseTexEnabled"), 0);
-				glUniform1i((*this->shader)("ambientTexEnabled"), 0);
-			}
-            glDrawElements(this->DrawMode(), cur, GL_UNSIGNED_INT, (void*)prev);
+
+        if (this->staticEntry >= 0) {
+            // The batch already holds every level, only tell it which one to draw.
+            this->staticBatch->Select(this->staticEntry, this->currentLOD);
+            return;
         }
 
-        // reset defaults
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        this->shader->UnUse();
-    } // function Render
+        DrawPacket packet;
+        packet.shader = this->shader.get();
+        packet.instancedShader = this->instancedShader.get();
+        packet.vao = this->Vao();
+        packet.geometry = this->perInstanceAttributes ? 0 : this->buffers[this->ElemBufIndex];
+        packet.mode = this->DrawMode();
+        packet.indexType = this->indexType;
+        packet.cullFace = this->cull_face;
+        packet.matrix = queue.AddInstance(modelMatrix);
+
+        const float depth = -(modelView * glm::vec4(this->boundingCenter, 1.0f)).z;
+        const unsigned int program = this->shader->GetProgram();
+        const MeshLOD& lod = this->lods[this->currentLOD];
+        for (auto itr = lod.ranges.begin(); itr != lod.ranges.end(); ++itr) {
+            auto mat_itr = this->mats.find(itr->material);
+            packet.material = (mat_itr != this->mats.end()) ? &mat_itr->second : nullptr;
+            packet.count = itr->faceCount * 3;
+            packet.offset = itr->firstFace * 3 * this->indexSize;
+            packet.key = RenderQueue::MakeKey(pass, program, RenderQueue::MaterialKey(packet.material), packet.geometry, depth);
+            queue.Push(packet);
+        }
+    }
+
+    unsigned int GLMesh::UpdateLOD(const glm::mat4& modelView, float projScale) {
+        this->currentLOD = SelectLOD(modelView, projScale);
+        this->lastTriangleCount = (this->currentLOD < this->lods.size()) ? this->lods[this->currentLOD].faceCount : 0;
+        return this->currentLOD;
+    }
 
     bool operator ==(const VertexIndices &lhs, const VertexIndices &rhs) {
         return (lhs.vertex==rhs.vertex &&
@@ -417,9 +618,283 @@ namespace Sigma{
 
 			surfaceNorms.clear();
 		}
+
+		OptimizeMesh(fname);
+		if (this->lodLevels > 0) {
+			GenerateLODs(this->lodLevels);
+		}
+		this->meshName = fname;
 		return true;
     } // function LoadMesh
 
+    std::shared_ptr<const MeshData> GLMesh::LoadMeshData(const std::string& fname) {
+        auto found = GLMesh::sharedMeshData.find(fname);
+        if (found != GLMesh::sharedMeshData.end()) {
+            std::shared_ptr<const MeshData> data = found->second.lock();
+            if (data) {
+                return data;
+            }
+        }
+
+        // Nobody keeps this file resident, load it the same way a GLMesh would.
+        GLMesh mesh(0);
+        mesh.SetLODLevels(0);
+        if (!mesh.LoadMesh(fname)) {
+            return std::shared_ptr<const MeshData>();
+        }
+        std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+        data->verts.swap(mesh.verts);
+        data->faces.swap(mesh.faces);
+        GLMesh::sharedMeshData[fname] = data;
+        return data;
+    }
+
+    void GLMesh::ReleaseCPUData() {
+        size_t released = 0;
+
+        if (this->residency & RESIDENT_GEOMETRY) {
+            if (!this->meshData && this->verts.size() > 0) {
+                // Share the resident copy so physics does not load a duplicate of the same file.
+                std::shared_ptr<const MeshData> existing;
+                if (!this->meshName.empty()) {
+                    existing = GLMesh::sharedMeshData[this->meshName].lock();
+                }
+                if (existing && existing->faces.size() == this->faces.size() && existing->verts.size() == this->verts.size()) {
+                    released += this->verts.capacity() * sizeof(Vertex) + this->faces.capacity() * sizeof(Face);
+                    this->meshData = existing;
+                }
+                else {
+                    std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+                    data->verts.swap(this->verts);
+                    data->faces.swap(this->faces);
+                    if (!this->meshName.empty()) {
+                        GLMesh::sharedMeshData[this->meshName] = data;
+                    }
+                    this->meshData = data;
+                }
+                std::vector<Vertex>().swap(this->verts);
+                std::vector<Face>().swap(this->faces);
+            }
+        }
+        else {
+            released += this->verts.capacity() * sizeof(Vertex) + this->faces.capacity() * sizeof(Face);
+            std::vector<Vertex>().swap(this->verts);
+            std::vector<Face>().swap(this->faces);
+        }
+
+        if (!(this->residency & RESIDENT_ATTRIBUTES)) {
+            released += this->vertNorms.capacity() * sizeof(Vertex) + this->texCoords.capacity() * sizeof(TexCoord)
+                + this->colors.capacity() * sizeof(Color) + this->lodFaces.capacity() * sizeof(Face);
+            for (auto itr = this->faceGroups.begin(); itr != this->faceGroups.end(); ++itr) {
+                released += sizeof(*itr) + itr->second.capacity();
+            }
+            std::vector<Vertex>().swap(this->vertNorms);
+            std::vector<TexCoord>().swap(this->texCoords);
+            std::vector<Color>().swap(this->colors);
+            std::vector<Face>().swap(this->lodFaces);
+            this->faceGroups.clear();
+        }
+
+        GLMesh::releasedBytes += released;
+        if (!this->meshName.empty()) {
+            LOG << "Released " << released / 1024 << " KB of CPU mesh data for " << this->meshName << " (" << GLMesh::releasedBytes / 1024 << " KB in total)";
+        }
+    } // function ReleaseCPUData
+
+    void GLMesh::OptimizeMesh(const std::string& name) {
+        if (this->faces.empty() || this->verts.empty()) {
+            return;
+        }
+
+        // Triangles may only move inside a range that shares one face group and one material.
+        std::vector<unsigned int> boundaries = GroupBoundaries();
+
+        unsigned int* indices = &this->faces[0].v1;
+        const size_t indexCount = this->faces.size() * 3;
+        float before = mesh::CalculateACMR(indices, indexCount, this->verts.size());
+
+        for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+            unsigned int start = boundaries[i];
+            unsigned int count = std::min<unsigned int>(boundaries[i + 1], this->faces.size()) - start;
+            if (count == 0) {
+                continue;
+            }
+
+            mesh::OptimizeVertexCache(&this->faces[start].v1, count * 3, this->verts.size());
+            if (this->optimizeOverdraw) {
+                mesh::OptimizeOverdraw(&this->faces[start].v1, count * 3, &this->verts[0].x, this->verts.size(), sizeof(Vertex));
+            }
+        }
+
+        // Vertex fetch order follows the new triangle order across all groups.
+        std::vector<unsigned int> remap;
+        size_t vertexCount = mesh::OptimizeVertexFetch(remap, indices, indexCount, this->verts.size());
+        mesh::RemapVertices(this->verts, remap, vertexCount);
+        mesh::RemapVertices(this->vertNorms, remap, vertexCount);
+        mesh::RemapVertices(this->texCoords, remap, vertexCount);
+        mesh::RemapVertices(this->colors, remap, vertexCount);
+
+        float after = mesh::CalculateACMR(indices, indexCount, this->verts.size());
+        LOG << "Optimized mesh " << name << ": " << this->faces.size() << " faces, " << this->verts.size() << " verts, ACMR " << before << " -> " << after;
+    } // function OptimizeMesh
+
+    void GLMesh::ShareGeometry(const SharedGeometry& geometry) {
+        this->buffers[this->VertBufIndex] = geometry.vertexBuffer;
+        this->buffers[this->NormalBufIndex] = geometry.normalBuffer;
+        this->buffers[this->ElemBufIndex] = geometry.elementBuffer;
+        this->indexType = geometry.indexType;
+        this->indexSize = (geometry.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+        this->lods = geometry.lods;
+        this->currentLOD = 0;
+        this->boundingCenter = geometry.boundingCenter;
+        this->boundingRadius = geometry.boundingRadius;
+        this->sharedGeometry = true;
+    }
+
+    SharedGeometry GLMesh::DetachGeometry() {
+        SharedGeometry geometry;
+        geometry.vertexBuffer = this->buffers[this->VertBufIndex];
+        geometry.normalBuffer = this->buffers[this->NormalBufIndex];
+        geometry.elementBuffer = this->buffers[this->ElemBufIndex];
+        geometry.indexType = this->indexType;
+        geometry.vertexCount = this->uploadedVertexCount;
+        geometry.lods = this->lods;
+        geometry.boundingCenter = this->boundingCenter;
+        geometry.boundingRadius = this->boundingRadius;
+
+        // The GPU copy is all that is drawn from now on.
+        std::vector<Vertex>().swap(this->verts);
+        std::vector<Vertex>().swap(this->vertNorms);
+        std::vector<Face>().swap(this->faces);
+        std::vector<Face>().swap(this->lodFaces);
+        this->groupIndex.clear();
+        this->sharedGeometry = true;
+        return geometry;
+    }
+
+    std::vector<unsigned int> GLMesh::GroupBoundaries() const {
+        // Split at every group start and every material change.
+        std::vector<unsigned int> boundaries(this->groupIndex.begin(), this->groupIndex.end());
+        for (auto itr = this->faceGroups.begin(); itr != this->faceGroups.end(); ++itr) {
+            boundaries.push_back(itr->first);
+        }
+        boundaries.push_back(0);
+        boundaries.push_back(this->faces.size());
+        std::sort(boundaries.begin(), boundaries.end());
+        boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+        while (boundaries.size() > 1 && boundaries.back() > this->faces.size()) {
+            boundaries.pop_back();
+        }
+        return boundaries;
+    }
+
+    void GLMesh::BuildBaseLOD() {
+        this->lods.clear();
+        this->lodFaces.clear();
+        this->currentLOD = 0;
+
+        MeshLOD base;
+        base.faceCount = this->faces.size();
+        std::vector<unsigned int> boundaries = GroupBoundaries();
+        for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+            MeshRange range;
+            range.firstFace = boundaries[i];
+            range.faceCount = boundaries[i + 1] - boundaries[i];
+            if (range.faceCount == 0) {
+                continue;
+            }
+            // The material in use is the one of the last material change at or before this range.
+            auto group = this->faceGroups.upper_bound(range.firstFace);
+            if (group != this->faceGroups.begin()) {
+                range.material = (--group)->second;
+            }
+            base.ranges.push_back(range);
+        }
+        this->lods.push_back(base);
+    }
+
+    void GLMesh::GenerateLODs(unsigned int levels) {
+        BuildBaseLOD();
+        if (this->faces.empty() || this->verts.empty()) {
+            return;
+        }
+
+        const size_t baseFace = this->faces.size(); // lodFaces start after faces in the element buffer.
+        for (unsigned int level = 1; level <= levels; ++level) {
+            const MeshLOD& previous = this->lods.back();
+            const size_t levelStart = this->lodFaces.size();
+            MeshLOD lod;
+            lod.error = previous.error;
+
+            for (auto itr = previous.ranges.begin(); itr != previous.ranges.end(); ++itr) {
+                // Copy the source indices, lodFaces may reallocate while this level is appended.
+                const Face* source = (itr->firstFace < baseFace) ? &this->faces[itr->firstFace] : &this->lodFaces[itr->firstFace - baseFace];
+                std::vector<unsigned int> indices(&source->v1, &source->v1 + itr->faceCount * 3);
+                std::vector<unsigned int> simplified(indices.size());
+
+                float error = 0.0f;
+                size_t target = (itr->faceCount / 2) * 3;
+                size_t count = mesh::SimplifyMesh(&simplified[0], &indices[0], indices.size(), &this->verts[0].x, this->verts.size(), sizeof(Vertex),
+                    target, kLODMaxError, &error);
+                if (count == 0) {
+                    continue;
+                }
+                mesh::OptimizeVertexCache(&simplified[0], count, this->verts.size());
+
+                MeshRange range;
+                range.firstFace = baseFace + this->lodFaces.size();
+                range.faceCount = count / 3;
+                range.material = itr->material;
+                for (size_t i = 0; i < count; i += 3) {
+                    this->lodFaces.push_back(Face(simplified[i], simplified[i + 1], simplified[i + 2]));
+                }
+                lod.ranges.push_back(range);
+                lod.faceCount += range.faceCount;
+                // SimplifyMesh reports the error relative to the extent of the range.
+                lod.error = std::max(lod.error, previous.error + error * IndexedExtent(indices, this->verts));
+            }
+
+            if (lod.faceCount > previous.faceCount * kLODMinReduction) {
+                // Not worth another level, drop the faces that were added for it.
+                this->lodFaces.erase(this->lodFaces.begin() + levelStart, this->lodFaces.end());
+                break;
+            }
+            this->lods.push_back(lod);
+        }
+
+        std::stringstream counts;
+        for (auto itr = this->lods.begin(); itr != this->lods.end(); ++itr) {
+            counts << " " << itr->faceCount;
+        }
+        LOG << "Generated " << this->lods.size() << " levels of detail, faces:" << counts.str();
+    } // function GenerateLODs
+
+    unsigned int GLMesh::SelectLOD(const glm::mat4& modelView, float projScale) const {
+        if (this->lods.size() < 2 || this->boundingRadius <= 0.0f) {
+            return 0;
+        }
+
+        glm::vec4 center = modelView * glm::vec4(this->boundingCenter, 1.0f);
+        float scale = std::max(glm::length(glm::vec3(modelView[0])), std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+        float depth = -center.z;
+        if (depth <= this->boundingRadius * scale) {
+            // The camera is inside or right next to the bounds.
+            return 0;
+        }
+
+        // Fraction of the screen height covered by one model unit at this depth.
+        float projected = scale * projScale / (2.0f * depth);
+        unsigned int selected = 0;
+        for (unsigned int i = 1; i < this->lods.size(); ++i) {
+            float limit = GLMesh::lodThreshold * ((i > this->currentLOD) ? (1.0f - kLODHysteresis) : (1.0f + kLODHysteresis));
+            if (this->lods[i].error * projected > limit) {
+                break;
+            }
+            selected = i;
+        }
+        return selected;
+    }
+
     void GLMesh::LoadShader() {
        IGLComponent::LoadShader(GLMesh::DEFAULT_SHADER);
     }
@@ -1,5 +1,6 @@
 #include "components/GLScreenQuad.h"
 #include "resources/GLTexture.h"
+#include "systems/GLState.h"
 
 #include "Sigma.h"
 
@@ -44,38 +45,47 @@ namespace Sigma {
 	void GLScreenQuad::Render(glm::mediump_float *view, glm::mediump_float *proj) {
 		//this->shader->Use();
 
-		glDisable(GL_CULL_FACE);
-		glDisable(GL_DEPTH_TEST);
-		glDepthMask(GL_FALSE);
+		GLState::SetCullFace(0);
+		GLState::SetDepthTest(false);
+		GLState::SetDepthMask(false);
 
-		glBindVertexArray(this->vao);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->GetBuffer(this->ElemBufIndex));
+		// The VAO holds the element buffer binding.
+		GLState::BindVertexArray(this->vao);
 
 		if(this->texture) {
 			glUniform1i(glGetUniformLocation((*this->shader).GetProgram(), "in_Texture"), 0);
-			glBindTexture(GL_TEXTURE_2D, this->texture->GetID());
-			glActiveTexture(GL_TEXTURE0);
+			GLState::ActiveTexture(GL_TEXTURE0);
+			GLState::BindTexture(GL_TEXTURE_2D, this->texture->GetID());
 		}
 
-		size_t prev = 0;
-		for (int i = 0, cur = this->MeshGroup_ElementCount(0); cur != 0; prev = cur, cur = this->MeshGroup_ElementCount(++i)) {
-			glDrawElements(this->DrawMode(), cur, GL_UNSIGNED_INT, (void*)prev);
+		size_t offset = 0;
+		for (int i = 0, cur = this->MeshGroup_ElementCount(0); cur != 0; offset += cur, cur = this->MeshGroup_ElementCount(++i)) {
+			glDrawElements(this->DrawMode(), cur, this->indexType, reinterpret_cast<void*>(offset * this->indexSize));
 		}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
-		glBindVertexArray(0);
-
-		// Clear the texture for next frame
-
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		glEnable(GL_DEPTH_TEST);
-		glDepthMask(GL_TRUE);
-		glEnable(GL_CULL_FACE);
+		// Restore the defaults the other passes expect, GLState drops them when the next quad
+		// disables them again.
+		GLState::SetDepthTest(true);
+		GLState::SetDepthMask(true);
+		GLState::SetCullFace(GL_BACK);
 
 		//this->shader->UnUse();
 	}
 
+	void GLScreenQuad::GetSpriteQuad(SpriteQuad& quad) const {
+		const float left = this->x * 2.0f - 1.0f;
+		const float top = this->y * -2.0f + 1.0f;
+		const float right = (this->x + this->w) * 2.0f - 1.0f;
+		const float bottom = (this->y + this->h) * -2.0f + 1.0f;
+		quad.corners[0] = glm::vec3(left, top, 0.0f);
+		quad.corners[1] = glm::vec3(right, top, 0.0f);
+		quad.corners[2] = glm::vec3(left, bottom, 0.0f);
+		quad.corners[3] = glm::vec3(right, bottom, 0.0f);
+		quad.uvRect = this->inverted ? glm::vec4(0.0f, 1.0f, 1.0f, 0.0f) : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		quad.color = glm::vec4(1.0f);
+		quad.texture = this->texture ? this->texture->GetID() : 0;
+	}
+
 	unsigned int GLScreenQuad::GetTexture() {
 		if (this->texture) {
 			return this->texture->GetID();
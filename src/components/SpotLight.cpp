@@ -11,7 +11,22 @@ namespace Sigma {
 		this->innerAngle = 3.14159f * 0.03f;
 		this->cosInnerAngle = glm::cos(this->innerAngle);
 		this->cosOuterAngle = glm::cos(this->outerAngle);
+		// The distance attenuation of spotlight.frag drops below 1/256 here.
+		this->range = 500.0f;
 
 		this->enabled = true;
 	}
+
+	void SpotLight::BoundingSphere(glm::vec3& center, float& radius) {
+		const glm::vec3 position = this->transform.ExtractPosition();
+		if (this->cosOuterAngle <= 0.5f) {
+			// Past 60 degrees the sphere around the apex is the smaller one.
+			center = position;
+			radius = this->range;
+			return;
+		}
+		// The sphere through the apex and the rim of the lit cap.
+		radius = this->range / (2.0f * this->cosOuterAngle);
+		center = position + glm::normalize(this->transform.GetForward()) * radius;
+	}
 }
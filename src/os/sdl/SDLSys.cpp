@@ -4,6 +4,7 @@
 #include "SDL_opengl.h"
 
 #include "Sigma.h"
+#include "systems/GLState.h"
 
 Sigma::event::KeyboardInputSystem IOpSys::KeyboardEventSystem;
 Sigma::event::MouseInputSystem IOpSys::MouseEventSystem;
@@ -33,8 +34,8 @@ void* SDLSys::CreateGraphicsWindow(const unsigned int width, const unsigned int
     }
 
     this->Fullscreen = false;
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    Sigma::GLState::SetDepthTest(true);
+    Sigma::GLState::SetDepthFunc(GL_LESS);
 
     // Set the relative mouse state (hide mouse)
     /*
@@ -258,8 +259,8 @@ void SDLSys::RenderText(std::string text, float x, float y, unsigned int texture
 			TTF_SizeText(this->font, text.c_str(), &w, &h);
 
 			// Bind the texture for writing
-			glBindTexture(GL_TEXTURE_2D, texture_id);
-			glActiveTexture(GL_TEXTURE0);
+			Sigma::GLState::ActiveTexture(GL_TEXTURE0);
+			Sigma::GLState::BindTexture(GL_TEXTURE_2D, texture_id);
 
 			// Convert text surface to RGBA8 format
 			SDL_Surface *convertSurface = SDL_CreateRGBSurface(0, textSurface->w, textSurface->h, 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
@@ -277,7 +278,7 @@ void SDLSys::RenderText(std::string text, float x, float y, unsigned int texture
 
 		
 			// Free resources/cleanup
-			glBindTexture(GL_TEXTURE_2D, 0);
+			Sigma::GLState::BindTexture(GL_TEXTURE_2D, 0);
 			SDL_FreeSurface(convertSurface);
 			SDL_FreeSurface(textSurface);
 		}
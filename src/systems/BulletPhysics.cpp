@@ -99,9 +99,11 @@ namespace Sigma {
 			}
 			else if (p->GetName() == "meshFile") {
 				LOG << "Loading mesh: " << p->Get<std::string>();
-				GLMesh meshFile(0);
-				meshFile.LoadMesh(p->Get<std::string>());
-				mesh->SetMesh(&meshFile, scale);
+				// Shares the CPU copy of a resident GLMesh of the same file if there is one.
+				std::shared_ptr<const MeshData> data = GLMesh::LoadMeshData(p->Get<std::string>());
+				if (data) {
+					mesh->SetMesh(data, scale);
+				}
 			}
 		}
 		mesh->InitializeRigidBody(x, y, z, rx, ry, rz);
@@ -0,0 +1,233 @@
+#include "systems/DrawListBuilder.h"
+#include "IGLComponent.h"
+
+#include <algorithm>
+
+namespace Sigma {
+	const size_t DrawListBuilder::PARALLEL_THRESHOLD;
+	const size_t DrawListBuilder::PARALLEL_SORT_THRESHOLD;
+
+	DrawListBuilder::DrawListBuilder() : threadCount(0), jobGeneration(0), jobPending(0), barrierArrived(0), barrierGeneration(0), stopping(false) {}
+
+	DrawListBuilder::~DrawListBuilder() {
+		StopWorkers();
+	}
+
+	void DrawListBuilder::SubmitRange(IGLComponent* const* components, size_t first, size_t last, RenderQueue& queue, const glm::mat4& view, const glm::mat4& proj) {
+		for (size_t i = first; i < last; ++i) {
+			IGLComponent *component = components[i];
+			component->Submit(queue, component->IsLightingEnabled() ? PASS_GBUFFER : PASS_UNLIT, view, proj);
+		}
+	}
+
+	unsigned int DrawListBuilder::Threads() const {
+		if (this->threadCount == 0) {
+			return std::max(1u, std::thread::hardware_concurrency());
+		}
+		return this->threadCount;
+	}
+
+	void DrawListBuilder::UseThreads(unsigned int count) {
+		if (this->workers.size() != count - 1) {
+			StopWorkers();
+			StartWorkers(count - 1);
+		}
+	}
+
+	size_t DrawListBuilder::Build(IGLComponent* const* components, size_t count, RenderQueue& queue, const glm::mat4& view, const glm::mat4& proj) {
+		const unsigned int threads = Threads();
+		if (threads < 2 || count < PARALLEL_THRESHOLD) {
+			SubmitRange(components, 0, count, queue, view, proj);
+			return 1;
+		}
+		UseThreads(threads);
+		this->partOffsets.resize(threads);
+
+		Job job;
+		job.sort = false;
+		job.parts = threads;
+		job.queue = &queue;
+		job.components = components;
+		job.count = count;
+		job.chunk = (count + threads - 1) / threads;
+		job.view = &view;
+		job.proj = &proj;
+		PostJob(job);
+		BuildPart(job, 0);
+		WaitForWorkers();
+
+		// Ranges past the end are empty, their queues too
+		return std::min<size_t>(threads, (count + job.chunk - 1) / job.chunk);
+	}
+
+	size_t DrawListBuilder::Sort(RenderQueue& queue) {
+		const unsigned int threads = Threads();
+		const size_t count = queue.order.size();
+		if (threads < 2 || count < PARALLEL_SORT_THRESHOLD) {
+			queue.Sort();
+			return 1;
+		}
+		UseThreads(threads);
+		queue.scratch.resize(count);
+		this->sortCounts.resize(threads * 256);
+
+		Job job;
+		job.sort = true;
+		job.parts = threads;
+		job.queue = &queue;
+		job.components = nullptr;
+		job.count = 0;
+		job.chunk = 0;
+		job.view = nullptr;
+		job.proj = nullptr;
+		PostJob(job);
+		const bool swapped = SortPart(job, 0);
+		WaitForWorkers();
+		if (swapped) {
+			queue.order.swap(queue.scratch);
+		}
+		return threads;
+	}
+
+	void DrawListBuilder::BuildPart(const Job& job, unsigned int participant) {
+		// The calling thread takes the first range straight into the target queue, the workers
+		// fill their own queues, then copy them after it.
+		const size_t first = std::min(job.count, participant * job.chunk);
+		const size_t last = std::min(job.count, first + job.chunk);
+		if (participant == 0) {
+			SubmitRange(job.components, first, last, *job.queue, *job.view, *job.proj);
+		}
+		else {
+			RenderQueue &partQueue = *this->queues[participant];
+			partQueue.Clear();
+			SubmitRange(job.components, first, last, partQueue, *job.view, *job.proj);
+		}
+		Barrier();
+
+		if (participant == 0) {
+			RenderQueueOffsets end = job.queue->Offsets();
+			for (unsigned int part = 1; part < job.parts; ++part) {
+				const RenderQueueOffsets sizes = this->queues[part]->Offsets();
+				this->partOffsets[part] = end;
+				end.packets += sizes.packets;
+				end.instances += sizes.instances;
+				end.sprites += sizes.sprites;
+			}
+			job.queue->Resize(end);
+		}
+		Barrier();
+
+		if (participant > 0) {
+			job.queue->AppendAt(*this->queues[participant], this->partOffsets[participant]);
+		}
+	}
+
+	bool DrawListBuilder::SortPart(const Job& job, unsigned int participant) {
+		const size_t count = job.queue->order.size();
+		const size_t slice = (count + job.parts - 1) / job.parts;
+		const size_t first = std::min(count, participant * slice);
+		const size_t last = std::min(count, first + slice);
+		SortEntry *entries = &job.queue->order[0];
+		SortEntry *sorted = &job.queue->scratch[0];
+		bool swapped = false;
+		for (unsigned int shift = 0; shift < 64; shift += 8) {
+			RadixCount(entries, first, last, shift, &this->sortCounts[participant * 256]);
+			Barrier();
+			size_t offsets[256];
+			if (RadixOffsets(&this->sortCounts[0], job.parts, participant, offsets)) {
+				RadixScatter(entries, first, last, shift, offsets, sorted);
+				std::swap(entries, sorted);
+				swapped = !swapped;
+			}
+			// The next pass counts entries moved by other participants and overwrites the counts.
+			if (shift < 56) {
+				Barrier();
+			}
+		}
+		return swapped;
+	}
+
+	void DrawListBuilder::Barrier() {
+		std::unique_lock<std::mutex> lock(this->jobMutex);
+		const unsigned int generation = this->barrierGeneration;
+		if (++this->barrierArrived == this->job.parts) {
+			this->barrierArrived = 0;
+			this->barrierGeneration++;
+			lock.unlock();
+			this->barrierDone.notify_all();
+			return;
+		}
+		while (this->barrierGeneration == generation) {
+			this->barrierDone.wait(lock);
+		}
+	}
+
+	void DrawListBuilder::PostJob(const Job& job) {
+		{
+			std::lock_guard<std::mutex> lock(this->jobMutex);
+			this->job = job;
+			this->jobPending = static_cast<unsigned int>(this->workers.size());
+			this->jobGeneration++;
+		}
+		this->jobReady.notify_all();
+	}
+
+	void DrawListBuilder::WaitForWorkers() {
+		std::unique_lock<std::mutex> lock(this->jobMutex);
+		while (this->jobPending > 0) {
+			this->jobDone.wait(lock);
+		}
+	}
+
+	void DrawListBuilder::StartWorkers(unsigned int count) {
+		while (this->queues.size() < count + 1) {
+			this->queues.push_back(std::unique_ptr<RenderQueue>(new RenderQueue()));
+		}
+		this->stopping = false;
+		for (unsigned int i = 0; i < count; ++i) {
+			this->workers.push_back(std::thread(&DrawListBuilder::WorkerLoop, this, i, this->jobGeneration));
+		}
+	}
+
+	void DrawListBuilder::StopWorkers() {
+		if (this->workers.empty()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(this->jobMutex);
+			this->stopping = true;
+		}
+		this->jobReady.notify_all();
+		for (auto itr = this->workers.begin(); itr != this->workers.end(); ++itr) {
+			itr->join();
+		}
+		this->workers.clear();
+	}
+
+	void DrawListBuilder::WorkerLoop(unsigned int index, unsigned int generation) {
+		std::unique_lock<std::mutex> lock(this->jobMutex);
+		for (;;) {
+			while (!this->stopping && this->jobGeneration == generation) {
+				this->jobReady.wait(lock);
+			}
+			if (this->stopping) {
+				return;
+			}
+			generation = this->jobGeneration;
+			const Job job = this->job;
+			lock.unlock();
+
+			if (job.sort) {
+				SortPart(job, index + 1);
+			}
+			else {
+				BuildPart(job, index + 1);
+			}
+
+			lock.lock();
+			if (--this->jobPending == 0) {
+				this->jobDone.notify_one();
+			}
+		}
+	}
+} // namespace Sigma
@@ -0,0 +1,120 @@
+#include "systems/GLGPUTimer.h"
+#include "Profiler.h"
+
+namespace Sigma {
+	const unsigned int GLGPUTimer::LATENCY;
+	const unsigned int GLGPUTimer::CALIBRATION_FRAMES;
+
+	GLGPUTimer::GLGPUTimer() : supported(false), current(0), recording(false), framesSinceCalibration(0),
+		gpuReference(0), cpuReference(0.0), droppedFrames(0) {}
+
+	GLGPUTimer::~GLGPUTimer() {
+		Destroy();
+	}
+
+	bool GLGPUTimer::Create() {
+#ifdef __APPLE__
+		this->supported = true;
+#else
+		this->supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+#endif
+		if (this->supported) {
+			Calibrate();
+		}
+		return this->supported;
+	}
+
+	void GLGPUTimer::Destroy() {
+		for (unsigned int i = 0; i < LATENCY; ++i) {
+			Frame& frame = this->frames[i];
+			if (!frame.queries.empty()) {
+				glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), &frame.queries[0]);
+				frame.queries.clear();
+			}
+			frame.passes.clear();
+			frame.used = 0;
+		}
+		this->open.clear();
+		this->recording = false;
+	}
+
+	void GLGPUTimer::Calibrate() {
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		this->cpuReference = Profiler::Now();
+		this->gpuReference = gpuTime;
+		this->framesSinceCalibration = 0;
+	}
+
+	void GLGPUTimer::Collect(Frame& frame) {
+		if (frame.used == 0) {
+			return;
+		}
+		for (size_t i = 0; i < 2 * frame.used; ++i) {
+			GLint available = 0;
+			glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				this->droppedFrames++;
+				return;
+			}
+		}
+		for (size_t i = 0; i < frame.used; ++i) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+			const double start = this->cpuReference + (static_cast<double>(begin) - static_cast<double>(this->gpuReference)) / 1000.0;
+			Profiler::Record(frame.passes[i].name, PROFILE_TRACK_GPU, start, (static_cast<double>(end) - static_cast<double>(begin)) / 1000.0, frame.frame);
+		}
+	}
+
+	void GLGPUTimer::BeginFrame() {
+		// Passes left open end with the frame.
+		while (!this->open.empty()) {
+			End();
+		}
+		this->recording = false;
+		if (!this->supported) {
+			return;
+		}
+		this->current = (this->current + 1) % LATENCY;
+		Frame& frame = this->frames[this->current];
+		Collect(frame);
+		frame.used = 0;
+		frame.passes.clear();
+
+		if (!Profiler::IsEnabled()) {
+			return;
+		}
+		if (++this->framesSinceCalibration >= CALIBRATION_FRAMES) {
+			Calibrate();
+		}
+		frame.frame = Profiler::Frame();
+		this->recording = true;
+	}
+
+	void GLGPUTimer::Begin(const char* name) {
+		if (!this->recording) {
+			return;
+		}
+		Frame& frame = this->frames[this->current];
+		if (frame.queries.size() < 2 * (frame.used + 1)) {
+			const size_t first = frame.queries.size();
+			frame.queries.resize(first + 2);
+			glGenQueries(2, &frame.queries[first]);
+		}
+		Pass pass = { name };
+		frame.passes.push_back(pass);
+		this->open.push_back(frame.used);
+		glQueryCounter(frame.queries[2 * frame.used], GL_TIMESTAMP);
+		frame.used++;
+	}
+
+	void GLGPUTimer::End() {
+		if (!this->recording || this->open.empty()) {
+			return;
+		}
+		Frame& frame = this->frames[this->current];
+		glQueryCounter(frame.queries[2 * this->open.back() + 1], GL_TIMESTAMP);
+		this->open.pop_back();
+	}
+} // namespace Sigma
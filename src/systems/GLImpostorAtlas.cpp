@@ -0,0 +1,100 @@
+#include "systems/GLImpostorAtlas.h"
+#include "systems/GLState.h"
+#include "Sigma.h"
+
+namespace Sigma {
+	GLImpostorAtlas::GLImpostorAtlas() : depthBuffer(0), framebuffer(0) {
+		this->textures[0] = this->textures[1] = 0;
+	}
+
+	GLImpostorAtlas::~GLImpostorAtlas() {
+		Destroy();
+	}
+
+	bool GLImpostorAtlas::Create(unsigned int size) {
+		glGenTextures(2, this->textures);
+		for (int i = 0; i < 2; ++i) {
+			GLState::BindTexture(GL_TEXTURE_2D, this->textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+		glGenRenderbuffers(1, &this->depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &this->framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->textures[0], 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, this->textures[1], 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+		// The depth output of the classic layout has no attachment and is dropped.
+		const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+
+		// Nothing is drawn in the cells yet
+		const GLfloat empty[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		glClearBufferfv(GL_COLOR, 0, empty);
+		glClearBufferfv(GL_COLOR, 1, empty);
+
+		const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR << "Impostor atlas framebuffer incomplete: " << status;
+			Destroy();
+			return false;
+		}
+
+		this->shader.LoadFromFile(GL_VERTEX_SHADER, "shaders/impostor.vert");
+		this->shader.LoadFromFile(GL_FRAGMENT_SHADER, "shaders/impostor.frag");
+		this->shader.CreateAndLinkProgram();
+		this->shader.Use();
+		this->shader.AddUniform("in_ViewProj");
+		this->shader.AddUniform("in_Texture");
+		this->shader.AddUniform("in_NormalTexture");
+		glUniform1i(this->shader("in_Texture"), 0);
+		glUniform1i(this->shader("in_NormalTexture"), 1);
+		this->shader.UnUse();
+
+		LOG << "Impostor atlas of " << size << "x" << size << " (" << (size * size * 12 / 1024) << " KB)";
+		return true;
+	}
+
+	void GLImpostorAtlas::Destroy() {
+		if (this->framebuffer != 0) {
+			glDeleteFramebuffers(1, &this->framebuffer);
+			this->framebuffer = 0;
+		}
+		if (this->depthBuffer != 0) {
+			glDeleteRenderbuffers(1, &this->depthBuffer);
+			this->depthBuffer = 0;
+		}
+		if (this->textures[0] != 0) {
+			glDeleteTextures(2, this->textures);
+			this->textures[0] = this->textures[1] = 0;
+			GLState::Invalidate();
+		}
+	}
+
+	void GLImpostorAtlas::BeginCapture(unsigned int x, unsigned int y, unsigned int size) {
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glViewport(x, y, size, size);
+
+		// Clear the cell only, the other cells hold the images still in use
+		glScissor(x, y, size, size);
+		GLState::SetScissorTest(true);
+		GLState::SetDepthMask(true);
+		const GLfloat empty[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const GLfloat one = 1.0f;
+		glClearBufferfv(GL_COLOR, 0, empty);
+		glClearBufferfv(GL_COLOR, 1, empty);
+		glClearBufferfv(GL_DEPTH, 0, &one);
+		GLState::SetScissorTest(false);
+		GLState::SetDepthTest(true);
+	}
+} // namespace Sigma
@@ -0,0 +1,141 @@
+#include "systems/GLRingBuffer.h"
+#include "Sigma.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Sigma {
+	GLRingBuffer::GLRingBuffer() : buffer(0), frameSize(0), frame(0), persistent(false), fenced(false), mapped(nullptr), flushed(0), head(0) {
+		for (unsigned int i = 0; i < FRAMES; ++i) {
+			this->fences[i] = 0;
+		}
+	}
+
+	GLRingBuffer::~GLRingBuffer() {
+		Destroy();
+	}
+
+	bool GLRingBuffer::Create(size_t frameSize) {
+		Destroy();
+		this->frameSize = frameSize;
+		this->frame = 0;
+		this->head = 0;
+		this->flushed = 0;
+
+		GLint version[2] = { 0, 0 };
+		glGetIntegerv(GL_MAJOR_VERSION, &version[0]);
+		glGetIntegerv(GL_MINOR_VERSION, &version[1]);
+		this->fenced = version[0] > 3 || (version[0] == 3 && version[1] >= 2);
+#ifndef __APPLE__
+		this->persistent = this->fenced && (GLEW_ARB_buffer_storage || GLEW_VERSION_4_4);
+#endif
+
+		glGenBuffers(1, &this->buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+		if (this->persistent) {
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, frameSize * FRAMES, nullptr, flags);
+			this->mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * FRAMES, flags));
+			if (!this->mapped) {
+				LOG_WARN << "Persistent mapping of the stream buffer failed, orphaning it every frame instead.";
+				glDeleteBuffers(1, &this->buffer);
+				glGenBuffers(1, &this->buffer);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+				this->persistent = false;
+			}
+		}
+		if (!this->persistent) {
+			// One region is enough, orphaning gives every frame fresh storage.
+			glBufferData(GL_COPY_WRITE_BUFFER, frameSize, nullptr, GL_STREAM_DRAW);
+			this->staging.resize(frameSize);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return this->buffer != 0;
+	}
+
+	void GLRingBuffer::Destroy() {
+		for (unsigned int i = 0; i < FRAMES; ++i) {
+			if (this->fences[i]) {
+				glDeleteSync(this->fences[i]);
+				this->fences[i] = 0;
+			}
+		}
+		if (this->buffer != 0) {
+			if (this->mapped) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+				glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				this->mapped = nullptr;
+			}
+			glDeleteBuffers(1, &this->buffer);
+			this->buffer = 0;
+		}
+		this->staging.clear();
+	}
+
+	void GLRingBuffer::BeginFrame() {
+		this->frame = (this->frame + 1) % FRAMES;
+		this->head = 0;
+		this->flushed = 0;
+
+		if (this->persistent) {
+			GLsync &fence = this->fences[this->frame];
+			if (fence) {
+				// Usually signaled long ago, the region was last used FRAMES - 1 frames back.
+				GLenum result = glClientWaitSync(fence, 0, 0);
+				while (result == GL_TIMEOUT_EXPIRED) {
+					result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+				}
+				glDeleteSync(fence);
+				fence = 0;
+			}
+		}
+		else if (this->buffer != 0) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, this->frameSize, nullptr, GL_STREAM_DRAW);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+	}
+
+	void GLRingBuffer::EndFrame() {
+		Flush();
+		if (this->persistent) {
+			this->fences[this->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+
+	void* GLRingBuffer::Allocate(size_t size, size_t alignment, size_t& offset) {
+		if (this->buffer == 0) {
+			return nullptr;
+		}
+		size_t start = this->head.load();
+		size_t aligned, end;
+		do {
+			aligned = (start + alignment - 1) & ~(alignment - 1);
+			end = aligned + size;
+			if (end > this->frameSize) {
+				return nullptr;
+			}
+		} while (!this->head.compare_exchange_weak(start, end));
+
+		if (this->persistent) {
+			offset = this->frame * this->frameSize + aligned;
+			return this->mapped + offset;
+		}
+		offset = aligned;
+		return &this->staging[aligned];
+	}
+
+	void GLRingBuffer::Flush() {
+		if (this->persistent || this->buffer == 0) {
+			return;
+		}
+		const size_t end = this->head.load();
+		if (end > this->flushed) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, this->flushed, end - this->flushed, &this->staging[this->flushed]);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			this->flushed = end;
+		}
+	}
+} // namespace Sigma
@@ -3,6 +3,7 @@
 //Last Modified: February 2, 2011
 
 #include "systems/GLSLShader.h"
+#include "systems/GLState.h"
 #include <iostream>
 #include <fstream>
 
@@ -67,6 +68,14 @@ void GLSLShader::CreateAndLinkProgram() {
 	glBindFragDataLocation(_program, 1, "out_Normal");
 	glBindFragDataLocation(_program, 2, "out_Depth");
 
+	// Fixed vertex attribute locations, names a shader does not use are ignored
+	glBindAttribLocation(_program, ATTRIB_POSITION, "in_Position");
+	glBindAttribLocation(_program, ATTRIB_NORMAL, "in_Normal");
+	glBindAttribLocation(_program, ATTRIB_UV, "in_UV");
+	glBindAttribLocation(_program, ATTRIB_COLOR, "in_Color");
+	glBindAttribLocation(_program, ATTRIB_INSTANCE_MODEL, "in_InstanceModel");
+	glBindAttribLocation(_program, ATTRIB_INSTANCE_COLOR, "in_InstanceColor");
+
 	glLinkProgram (_program);
 	glGetProgramiv (_program, GL_LINK_STATUS, &status);
 	if (status == GL_FALSE) {
@@ -79,17 +88,27 @@ void GLSLShader::CreateAndLinkProgram() {
 		delete [] infoLog;
 	}
 
+	// Connect the shared uniform blocks to their fixed binding points
+	GLuint blockIndex = glGetUniformBlockIndex(_program, "FrameData");
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(_program, blockIndex, BLOCK_FRAME);
+	}
+	blockIndex = glGetUniformBlockIndex(_program, "MaterialData");
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(_program, blockIndex, BLOCK_MATERIAL);
+	}
+
 	glDeleteShader(_shaders[VERTEX_SHADER]);
 	glDeleteShader(_shaders[FRAGMENT_SHADER]);
 	glDeleteShader(_shaders[GEOMETRY_SHADER]);
 }
 
 void GLSLShader::Use() {
-	glUseProgram(_program);
+	Sigma::GLState::UseProgram(_program);
 }
 
 void GLSLShader::UnUse() {
-	glUseProgram(0);
+	Sigma::GLState::UseProgram(0);
 }
 
 void GLSLShader::AddAttribute(const std::string attribute) {
@@ -106,6 +125,8 @@ void GLSLShader::AddUniform(const std::string uniform) {
 }
 
 GLuint GLSLShader::operator()(const std::string uniform){
+	// Locations are only looked up to set a value, so this counts the uniform uploads.
+	Sigma::GLState::CountUniform();
 	return _uniformLocationList[uniform];
 }
 GLuint GLSLShader::GetProgram() const {
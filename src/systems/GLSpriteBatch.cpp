@@ -0,0 +1,260 @@
+#include "systems/GLSpriteBatch.h"
+#include "systems/GLState.h"
+#include "systems/GLRingBuffer.h"
+
+#include <algorithm>
+
+namespace Sigma {
+	namespace {
+		// The screen rectangle a quad covers.
+		struct Bounds {
+			float minX, minY, maxX, maxY;
+		};
+
+		Bounds QuadBounds(const SpriteQuad& quad) {
+			Bounds bounds = { quad.corners[0].x, quad.corners[0].y, quad.corners[0].x, quad.corners[0].y };
+			for (int i = 1; i < 4; ++i) {
+				bounds.minX = std::min(bounds.minX, quad.corners[i].x);
+				bounds.minY = std::min(bounds.minY, quad.corners[i].y);
+				bounds.maxX = std::max(bounds.maxX, quad.corners[i].x);
+				bounds.maxY = std::max(bounds.maxY, quad.corners[i].y);
+			}
+			return bounds;
+		}
+
+		// Quads that only share an edge do not overlap.
+		bool Overlap(const Bounds& a, const Bounds& b) {
+			return a.minX < b.maxX && b.minX < a.maxX && a.minY < b.maxY && b.minY < a.maxY;
+		}
+
+		unsigned char ColorByte(float value) {
+			return static_cast<unsigned char>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	GLSpriteBatch::GLSpriteBatch() : vao(0), indexBuffer(0), indexCapacity(0), vertexBuffer(0), vertexCapacity(0), whiteTexture(0),
+		streamBuffer(nullptr) {}
+
+	GLSpriteBatch::~GLSpriteBatch() {
+		Destroy();
+	}
+
+	void GLSpriteBatch::Create() {
+		this->shader.LoadFromFile(GL_VERTEX_SHADER, "shaders/spritebatch.vert");
+		this->shader.LoadFromFile(GL_FRAGMENT_SHADER, "shaders/spritebatch.frag");
+		this->shader.CreateAndLinkProgram();
+		this->shader.Use();
+		this->shader.AddUniform("in_ViewProj");
+		this->shader.AddUniform("in_Texture");
+		glUniform1i(this->shader("in_Texture"), 0);
+		this->shader.UnUse();
+
+		glGenVertexArrays(1, &this->vao);
+		GLState::BindVertexArray(this->vao);
+		glEnableVertexAttribArray(GLSLShader::ATTRIB_POSITION);
+		glEnableVertexAttribArray(GLSLShader::ATTRIB_UV);
+		glEnableVertexAttribArray(GLSLShader::ATTRIB_COLOR);
+		GLState::BindVertexArray(0);
+
+		const unsigned char white[4] = { 255, 255, 255, 255 };
+		glGenTextures(1, &this->whiteTexture);
+		GLState::BindTexture(GL_TEXTURE_2D, this->whiteTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void GLSpriteBatch::Destroy() {
+		if (this->vao != 0) {
+			glDeleteVertexArrays(1, &this->vao);
+			this->vao = 0;
+			GLState::Invalidate();
+		}
+		GLuint* buffers[] = { &this->indexBuffer, &this->vertexBuffer };
+		for (GLuint* buffer : buffers) {
+			if (*buffer != 0) {
+				glDeleteBuffers(1, buffer);
+				*buffer = 0;
+			}
+		}
+		if (this->whiteTexture != 0) {
+			glDeleteTextures(1, &this->whiteTexture);
+			this->whiteTexture = 0;
+			GLState::Invalidate();
+		}
+		this->indexCapacity = 0;
+		this->vertexCapacity = 0;
+	}
+
+	void GLSpriteBatch::Order(const std::vector<SpriteQuad>& quads, bool keepOrder) {
+		this->order.clear();
+		this->runs.clear();
+
+		if (!keepOrder) {
+			for (unsigned int i = 0; i < quads.size(); ++i) {
+				this->order.push_back(i);
+			}
+			std::stable_sort(this->order.begin(), this->order.end(), [&quads] (unsigned int a, unsigned int b) {
+				return quads[a].texture < quads[b].texture;
+			});
+			for (size_t i = 0; i < this->order.size(); ++i) {
+				const GLuint texture = quads[this->order[i]].texture;
+				if (this->runs.empty() || this->runs.back().texture != texture) {
+					Run run = { texture, i, 0 };
+					this->runs.push_back(run);
+				}
+				this->runs.back().count++;
+			}
+			return;
+		}
+
+		// Each quad goes back through the runs to the latest one of its texture, unless a run in
+		// between covers it, which must stay drawn on top of what came before.
+		struct PendingRun {
+			GLuint texture;
+			std::vector<unsigned int> quads;
+			std::vector<Bounds> bounds;
+			Bounds total;
+		};
+		std::vector<PendingRun> pending;
+		for (unsigned int i = 0; i < quads.size(); ++i) {
+			const Bounds bounds = QuadBounds(quads[i]);
+			size_t target = pending.size();
+			for (size_t r = pending.size(); r-- > 0;) {
+				const PendingRun& run = pending[r];
+				if (run.texture == quads[i].texture) {
+					target = r;
+					break;
+				}
+				if (!Overlap(run.total, bounds)) {
+					continue;
+				}
+				bool covered = false;
+				for (auto itr = run.bounds.begin(); itr != run.bounds.end() && !covered; ++itr) {
+					covered = Overlap(*itr, bounds);
+				}
+				if (covered) {
+					break;
+				}
+			}
+			if (target == pending.size()) {
+				PendingRun run;
+				run.texture = quads[i].texture;
+				run.total = bounds;
+				pending.push_back(run);
+			}
+			PendingRun& run = pending[target];
+			run.quads.push_back(i);
+			run.bounds.push_back(bounds);
+			run.total.minX = std::min(run.total.minX, bounds.minX);
+			run.total.minY = std::min(run.total.minY, bounds.minY);
+			run.total.maxX = std::max(run.total.maxX, bounds.maxX);
+			run.total.maxY = std::max(run.total.maxY, bounds.maxY);
+		}
+		for (auto itr = pending.begin(); itr != pending.end(); ++itr) {
+			Run run = { itr->texture, this->order.size(), itr->quads.size() };
+			this->runs.push_back(run);
+			this->order.insert(this->order.end(), itr->quads.begin(), itr->quads.end());
+		}
+	}
+
+	void GLSpriteBatch::ReserveIndices(size_t count) {
+		if (count <= this->indexCapacity) {
+			return;
+		}
+		this->indexCapacity = std::max(count, this->indexCapacity * 2);
+		std::vector<GLuint> indices;
+		indices.reserve(this->indexCapacity * 6);
+		for (GLuint quad = 0; quad < this->indexCapacity; ++quad) {
+			const GLuint first = quad * 4;
+			const GLuint quadIndices[6] = { first, first + 1, first + 2, first + 2, first + 1, first + 3 };
+			indices.insert(indices.end(), quadIndices, quadIndices + 6);
+		}
+		if (this->indexBuffer == 0) {
+			glGenBuffers(1, &this->indexBuffer);
+		}
+		// The element buffer binding is part of the VAO.
+		GLState::BindVertexArray(this->vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		GLState::CountUpload(indices.size() * sizeof(GLuint));
+	}
+
+	void GLSpriteBatch::Draw(const std::vector<SpriteQuad>& quads, const glm::mat4& viewProj, bool keepOrder, GLSLShader* shader /*= nullptr*/) {
+		if (quads.empty() || this->vao == 0) {
+			return;
+		}
+		Order(quads, keepOrder);
+
+		// Write the vertices in draw order, straight into the ring buffer when it has room
+		const size_t bytes = quads.size() * 4 * sizeof(SpriteVertex);
+		size_t offset = 0;
+		SpriteVertex* vertices = nullptr;
+		if (this->streamBuffer) {
+			vertices = static_cast<SpriteVertex*>(this->streamBuffer->Allocate(bytes, sizeof(float), offset));
+		}
+		const bool streamed = (vertices != nullptr);
+		if (!streamed) {
+			this->staging.resize(quads.size() * 4);
+			vertices = &this->staging[0];
+		}
+		for (auto itr = this->order.begin(); itr != this->order.end(); ++itr) {
+			const SpriteQuad& quad = quads[*itr];
+			const float u[4] = { quad.uvRect.x, quad.uvRect.z, quad.uvRect.x, quad.uvRect.z };
+			const float v[4] = { quad.uvRect.y, quad.uvRect.y, quad.uvRect.w, quad.uvRect.w };
+			for (int corner = 0; corner < 4; ++corner) {
+				SpriteVertex& vertex = *vertices++;
+				vertex.position[0] = quad.corners[corner].x;
+				vertex.position[1] = quad.corners[corner].y;
+				vertex.position[2] = quad.corners[corner].z;
+				vertex.uv[0] = u[corner];
+				vertex.uv[1] = v[corner];
+				vertex.color[0] = ColorByte(quad.color.r);
+				vertex.color[1] = ColorByte(quad.color.g);
+				vertex.color[2] = ColorByte(quad.color.b);
+				vertex.color[3] = ColorByte(quad.color.a);
+			}
+		}
+
+		GLuint source = 0;
+		if (streamed) {
+			this->streamBuffer->Flush();
+			source = this->streamBuffer->Buffer();
+		}
+		else {
+			if (this->vertexBuffer == 0) {
+				glGenBuffers(1, &this->vertexBuffer);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+			this->vertexCapacity = std::max(this->vertexCapacity, bytes);
+			// Orphan the old storage so the draws of the previous call do not stall the upload.
+			glBufferData(GL_ARRAY_BUFFER, this->vertexCapacity, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, &this->staging[0]);
+			GLState::CountUpload(bytes);
+			source = this->vertexBuffer;
+		}
+
+		ReserveIndices(quads.size());
+		GLState::BindVertexArray(this->vao);
+		glBindBuffer(GL_ARRAY_BUFFER, source);
+		glVertexAttribPointer(GLSLShader::ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), reinterpret_cast<void*>(offset));
+		glVertexAttribPointer(GLSLShader::ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), reinterpret_cast<void*>(offset + 3 * sizeof(float)));
+		glVertexAttribPointer(GLSLShader::ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), reinterpret_cast<void*>(offset + 5 * sizeof(float)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GLSLShader& program = shader ? *shader : this->shader;
+		program.Use();
+		glUniformMatrix4fv(program("in_ViewProj"), 1, GL_FALSE, &viewProj[0][0]);
+		GLState::SetCullFace(0);
+		GLState::ActiveTexture(GL_TEXTURE0);
+		for (auto itr = this->runs.begin(); itr != this->runs.end(); ++itr) {
+			GLState::BindTexture(GL_TEXTURE_2D, itr->texture ? itr->texture : this->whiteTexture);
+			glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(itr->count * 6), GL_UNSIGNED_INT, reinterpret_cast<void*>(itr->first * 6 * sizeof(GLuint)));
+			this->counters.draws++;
+		}
+		this->counters.quads += static_cast<unsigned int>(quads.size());
+		program.UnUse();
+		GLState::SetCullFace(GL_BACK);
+	}
+} // namespace Sigma
@@ -0,0 +1,157 @@
+#include "systems/GLState.h"
+
+namespace Sigma {
+	GLuint GLState::program = GLState::UNKNOWN;
+	GLuint GLState::vao = GLState::UNKNOWN;
+	GLuint GLState::activeUnit = GLState::UNKNOWN;
+	GLuint GLState::textures2D[GLState::MAX_TEXTURE_UNITS];
+	GLuint GLState::texturesCube[GLState::MAX_TEXTURE_UNITS];
+	GLuint GLState::cullFace = GLState::UNKNOWN;
+	GLuint GLState::depthTest = GLState::UNKNOWN;
+	GLuint GLState::depthMask = GLState::UNKNOWN;
+	GLuint GLState::depthFunc = GLState::UNKNOWN;
+	GLuint GLState::scissorTest = GLState::UNKNOWN;
+	GLuint GLState::blend = GLState::UNKNOWN;
+	GLuint GLState::blendSource = GLState::UNKNOWN;
+	GLuint GLState::blendDestination = GLState::UNKNOWN;
+	GLStateCounters GLState::counters;
+
+	namespace {
+		// The texture tables are zero initialized as statics, mark them unknown before first use.
+		struct InvalidateOnLoad {
+			InvalidateOnLoad() { GLState::Invalidate(); }
+		} invalidateOnLoad;
+	}
+
+	void GLState::UseProgram(GLuint program) {
+		if (Changed(GLState::program, program)) {
+			counters.programs++;
+			glUseProgram(program);
+		}
+	}
+
+	void GLState::BindVertexArray(GLuint vao) {
+		if (Changed(GLState::vao, vao)) {
+			counters.vertexArrays++;
+			glBindVertexArray(vao);
+		}
+	}
+
+	void GLState::ActiveTexture(GLenum unit) {
+		if (Changed(activeUnit, static_cast<GLuint>(unit - GL_TEXTURE0))) {
+			glActiveTexture(unit);
+		}
+	}
+
+	void GLState::BindTexture(GLenum target, GLuint texture) {
+		if (activeUnit < MAX_TEXTURE_UNITS) {
+			if (target == GL_TEXTURE_2D) {
+				if (!Changed(textures2D[activeUnit], texture)) {
+					return;
+				}
+			}
+			else if (target == GL_TEXTURE_CUBE_MAP) {
+				if (!Changed(texturesCube[activeUnit], texture)) {
+					return;
+				}
+			}
+			else {
+				counters.issued++;
+			}
+		}
+		else {
+			counters.issued++;
+		}
+		counters.textures++;
+		glBindTexture(target, texture);
+	}
+
+	void GLState::SetCullFace(GLenum face) {
+		const GLuint previous = cullFace;
+		if (!Changed(cullFace, static_cast<GLuint>(face))) {
+			return;
+		}
+		if (face == 0) {
+			glDisable(GL_CULL_FACE);
+			return;
+		}
+		if (previous == 0 || previous == UNKNOWN) {
+			glEnable(GL_CULL_FACE);
+		}
+		glCullFace(face);
+	}
+
+	void GLState::SetDepthTest(bool enabled) {
+		if (Changed(depthTest, static_cast<GLuint>(enabled))) {
+			if (enabled) {
+				glEnable(GL_DEPTH_TEST);
+			}
+			else {
+				glDisable(GL_DEPTH_TEST);
+			}
+		}
+	}
+
+	void GLState::SetDepthMask(bool write) {
+		if (Changed(depthMask, static_cast<GLuint>(write))) {
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+		}
+	}
+
+	void GLState::SetDepthFunc(GLenum func) {
+		if (Changed(depthFunc, static_cast<GLuint>(func))) {
+			glDepthFunc(func);
+		}
+	}
+
+	void GLState::SetScissorTest(bool enabled) {
+		if (Changed(scissorTest, static_cast<GLuint>(enabled))) {
+			if (enabled) {
+				glEnable(GL_SCISSOR_TEST);
+			}
+			else {
+				glDisable(GL_SCISSOR_TEST);
+			}
+		}
+	}
+
+	void GLState::SetBlend(bool enabled) {
+		if (Changed(blend, static_cast<GLuint>(enabled))) {
+			if (enabled) {
+				glEnable(GL_BLEND);
+			}
+			else {
+				glDisable(GL_BLEND);
+			}
+		}
+	}
+
+	void GLState::SetBlendFunc(GLenum source, GLenum destination) {
+		if (blendSource == source && blendDestination == destination) {
+			counters.redundant++;
+			return;
+		}
+		blendSource = source;
+		blendDestination = destination;
+		counters.issued++;
+		glBlendFunc(source, destination);
+	}
+
+	void GLState::Invalidate() {
+		program = UNKNOWN;
+		vao = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+			textures2D[i] = UNKNOWN;
+			texturesCube[i] = UNKNOWN;
+		}
+		cullFace = UNKNOWN;
+		depthTest = UNKNOWN;
+		depthMask = UNKNOWN;
+		depthFunc = UNKNOWN;
+		scissorTest = UNKNOWN;
+		blend = UNKNOWN;
+		blendSource = UNKNOWN;
+		blendDestination = UNKNOWN;
+	}
+} // namespace Sigma
@@ -0,0 +1,369 @@
+#include "systems/GLStaticBatch.h"
+#include "systems/GLSLShader.h"
+#include "systems/GLState.h"
+#include "systems/RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Sigma {
+	namespace {
+		// Same test as the render queue uses to merge instances.
+		bool SameMaterial(const Material* a, const Material* b) {
+			if (a == b) {
+				return true;
+			}
+			return a && b && a->ambientMap == b->ambientMap && a->diffuseMap == b->diffuseMap && a->hardness == b->hardness;
+		}
+	}
+
+	GLStaticBatch::GLStaticBatch() : indirect(false), vertexCount(0), indexCount(0), uploadedVertices(0), uploadedIndices(0),
+		layoutChanged(false), vertexBuffer(0), elementBuffer(0), commandBuffer(0), vertexCapacity(0), indexCapacity(0) {}
+
+	GLStaticBatch::~GLStaticBatch() {
+		Destroy();
+	}
+
+	bool GLStaticBatch::Create() {
+#ifdef __APPLE__
+		this->indirect = false;
+#else
+		this->indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+#endif
+		return this->indirect;
+	}
+
+	void GLStaticBatch::Destroy() {
+		for (auto itr = this->vertexArrays.begin(); itr != this->vertexArrays.end(); ++itr) {
+			glDeleteVertexArrays(1, &itr->second);
+		}
+		if (!this->vertexArrays.empty()) {
+			GLState::Invalidate();
+		}
+		this->vertexArrays.clear();
+		GLuint* buffers[] = { &this->vertexBuffer, &this->elementBuffer, &this->commandBuffer };
+		for (GLuint* buffer : buffers) {
+			if (*buffer != 0) {
+				glDeleteBuffers(1, buffer);
+				*buffer = 0;
+			}
+		}
+		this->vertexCapacity = 0;
+		this->indexCapacity = 0;
+		this->uploadedVertices = 0;
+		this->uploadedIndices = 0;
+	}
+
+	GLStaticBatch::Group& GLStaticBatch::FindGroup(const std::shared_ptr<GLSLShader>& shader, const Material* material, GLuint cullFace, unsigned int pass) {
+		for (auto itr = this->groups.begin(); itr != this->groups.end(); ++itr) {
+			if (itr->shader == shader && itr->cullFace == cullFace && itr->pass == pass &&
+				SameMaterial(itr->textured ? &itr->material : nullptr, material)) {
+				return *itr;
+			}
+		}
+		Group group;
+		group.shader = shader;
+		group.textured = (material != nullptr);
+		if (material) {
+			group.material = *material;
+		}
+		group.cullFace = cullFace;
+		group.pass = pass;
+		group.firstCommand = 0;
+		group.visible = 0;
+		group.triangles = 0;
+		this->groups.push_back(group);
+		return this->groups.back();
+	}
+
+	int GLStaticBatch::Add(const std::shared_ptr<GLSLShader>& shader, const glm::mat4& model, GLuint cullFace, unsigned int pass, const StaticGeometry& geometry) {
+		if (!shader || geometry.vertexCount == 0 || geometry.indexCount == 0 || geometry.ranges.empty()) {
+			return -1;
+		}
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		// Bake the vertices into world space, normals go through the inverse transpose.
+		const glm::mat4 normalMatrix = glm::transpose(glm::inverse(model));
+		const size_t baseVertex = this->vertexCount;
+		for (size_t i = 0; i < geometry.vertexCount; ++i) {
+			StaticVertex vertex;
+			std::memset(&vertex, 0, sizeof(vertex));
+			const glm::vec4 position = model * glm::vec4(geometry.positions[i].x, geometry.positions[i].y, geometry.positions[i].z, 1.0f);
+			vertex.position[0] = position.x;
+			vertex.position[1] = position.y;
+			vertex.position[2] = position.z;
+			if (geometry.normals) {
+				glm::vec3 normal(normalMatrix * glm::vec4(geometry.normals[i].x, geometry.normals[i].y, geometry.normals[i].z, 0.0f));
+				const float length = glm::length(normal);
+				if (length > 0.0f) {
+					normal /= length;
+				}
+				vertex.normal[0] = normal.x;
+				vertex.normal[1] = normal.y;
+				vertex.normal[2] = normal.z;
+			}
+			if (geometry.texCoords) {
+				vertex.uv[0] = geometry.texCoords[i].u;
+				vertex.uv[1] = geometry.texCoords[i].v;
+			}
+			if (geometry.colors) {
+				vertex.color[0] = geometry.colors[i].r;
+				vertex.color[1] = geometry.colors[i].g;
+				vertex.color[2] = geometry.colors[i].b;
+			}
+			this->pendingVertices.push_back(vertex);
+		}
+		this->vertexCount += geometry.vertexCount;
+
+		// Indices are rebased on the pool, so the commands need no base vertex and the
+		// glMultiDrawElements fallback draws the same ranges.
+		const size_t baseIndex = this->indexCount;
+		for (size_t i = 0; i < geometry.indexCount; ++i) {
+			this->pendingIndices.push_back(static_cast<GLuint>(baseVertex + geometry.indices[i]));
+		}
+		this->indexCount += geometry.indexCount;
+
+		const unsigned int entry = static_cast<unsigned int>(this->selection.size());
+		unsigned int lodCount = 0;
+		for (auto itr = geometry.ranges.begin(); itr != geometry.ranges.end(); ++itr) {
+			lodCount = std::max(lodCount, itr->lod + 1);
+		}
+		for (auto itr = geometry.ranges.begin(); itr != geometry.ranges.end(); ++itr) {
+			unsigned int ordinal = 0;
+			for (auto previous = geometry.ranges.begin(); previous != itr; ++previous) {
+				if (previous->lod == itr->lod && SameMaterial(previous->material, itr->material)) {
+					ordinal++;
+				}
+			}
+			Group& group = FindGroup(shader, itr->material, cullFace, pass);
+			Slot* slot = nullptr;
+			for (auto sitr = group.slots.rbegin(); sitr != group.slots.rend() && sitr->entry == entry; ++sitr) {
+				if (sitr->ordinal == ordinal) {
+					slot = &*sitr;
+					break;
+				}
+			}
+			if (!slot) {
+				Slot added;
+				added.entry = entry;
+				added.ordinal = ordinal;
+				added.firstIndex.assign(lodCount, 0);
+				added.count.assign(lodCount, 0);
+				group.slots.push_back(added);
+				slot = &group.slots.back();
+			}
+			slot->firstIndex[itr->lod] = static_cast<GLuint>(baseIndex + itr->firstIndex);
+			slot->count[itr->lod] = itr->count;
+		}
+
+		this->selection.push_back(0);
+		this->layoutChanged = true;
+		return static_cast<int>(entry);
+	}
+
+	void GLStaticBatch::BeginFrame() {
+		std::fill(this->selection.begin(), this->selection.end(), 0u);
+	}
+
+	bool GLStaticBatch::Reserve(GLuint& buffer, size_t& capacity, size_t used, size_t size) {
+		if (size <= capacity) {
+			return false;
+		}
+		const size_t grown = std::max(size, capacity * 2);
+		GLuint replacement = 0;
+		glGenBuffers(1, &replacement);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, replacement);
+		glBufferData(GL_COPY_WRITE_BUFFER, grown, nullptr, GL_STATIC_DRAW);
+		if (buffer != 0) {
+			if (used > 0) {
+				glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &buffer);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		buffer = replacement;
+		capacity = grown;
+		return true;
+	}
+
+	void GLStaticBatch::UploadPending() {
+		if (this->pendingVertices.empty()) {
+			return;
+		}
+		const size_t vertexBytes = sizeof(StaticVertex) * this->uploadedVertices;
+		const size_t indexBytes = sizeof(GLuint) * this->uploadedIndices;
+		bool replaced = Reserve(this->vertexBuffer, this->vertexCapacity, vertexBytes,
+			vertexBytes + sizeof(StaticVertex) * this->pendingVertices.size());
+		replaced = Reserve(this->elementBuffer, this->indexCapacity, indexBytes,
+			indexBytes + sizeof(GLuint) * this->pendingIndices.size()) || replaced;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->vertexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, vertexBytes, sizeof(StaticVertex) * this->pendingVertices.size(), &this->pendingVertices.front());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, this->elementBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, indexBytes, sizeof(GLuint) * this->pendingIndices.size(), &this->pendingIndices.front());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		GLState::CountUpload(sizeof(StaticVertex) * this->pendingVertices.size() + sizeof(GLuint) * this->pendingIndices.size());
+
+		this->uploadedVertices += this->pendingVertices.size();
+		this->uploadedIndices += this->pendingIndices.size();
+		std::vector<StaticVertex>().swap(this->pendingVertices);
+		std::vector<GLuint>().swap(this->pendingIndices);
+
+		// The vertex arrays still point at the old pools.
+		if (replaced) {
+			for (auto itr = this->vertexArrays.begin(); itr != this->vertexArrays.end(); ++itr) {
+				SetupVertexArray(itr->second, itr->first);
+			}
+		}
+	}
+
+	void GLStaticBatch::SetupVertexArray(GLuint vao, GLuint program) {
+		struct Attribute {
+			const char* name;
+			GLint size;
+			size_t offset;
+		};
+		const Attribute attributes[] = {
+			{ "in_Position", 3, offsetof(StaticVertex, position) },
+			{ "in_Normal", 3, offsetof(StaticVertex, normal) },
+			{ "in_UV", 2, offsetof(StaticVertex, uv) },
+			{ "in_Color", 3, offsetof(StaticVertex, color) }
+		};
+		GLState::BindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+		for (const Attribute& attribute : attributes) {
+			const GLint location = glGetAttribLocation(program, attribute.name);
+			if (location < 0) {
+				continue;
+			}
+			glVertexAttribPointer(location, attribute.size, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), reinterpret_cast<void*>(attribute.offset));
+			glEnableVertexAttribArray(location);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->elementBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void GLStaticBatch::Update(const std::vector<unsigned int>& selection) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->counters = StaticBatchCounters();
+		UploadPending();
+
+		const bool relayout = this->layoutChanged;
+		if (relayout) {
+			size_t total = 0;
+			for (auto itr = this->groups.begin(); itr != this->groups.end(); ++itr) {
+				itr->firstCommand = total;
+				total += itr->slots.size();
+			}
+			DrawCommand hidden = { 0, 0, 0, 0, 0 };
+			this->commands.assign(total, hidden);
+			this->drawnSelection.clear();
+			this->layoutChanged = false;
+		}
+		else if (selection == this->drawnSelection) {
+			// Nothing moved in or out of view, the commands and the group counts stand.
+			for (auto itr = this->groups.begin(); itr != this->groups.end(); ++itr) {
+				this->counters.commands += itr->visible;
+				this->counters.triangles += itr->triangles;
+			}
+			return;
+		}
+
+		// Rewrite the commands whose entry changed, and remember the span to upload.
+		size_t dirtyFirst = this->commands.size(), dirtyLast = 0;
+		for (auto itr = this->groups.begin(); itr != this->groups.end(); ++itr) {
+			itr->visible = 0;
+			itr->triangles = 0;
+			for (size_t i = 0; i < itr->slots.size(); ++i) {
+				const Slot& slot = itr->slots[i];
+				const unsigned int selected = (slot.entry < selection.size()) ? selection[slot.entry] : 0;
+				DrawCommand command = { 0, 0, 0, 0, 0 };
+				if (selected > 0) {
+					const size_t lod = std::min<size_t>(selected - 1, slot.count.size() - 1);
+					command.count = slot.count[lod];
+					command.firstIndex = slot.firstIndex[lod];
+					command.instanceCount = (command.count > 0) ? 1 : 0;
+				}
+				if (command.instanceCount) {
+					itr->visible++;
+					itr->triangles += command.count / 3;
+				}
+				const size_t position = itr->firstCommand + i;
+				if (relayout || std::memcmp(&command, &this->commands[position], sizeof(command)) != 0) {
+					this->commands[position] = command;
+					dirtyFirst = std::min(dirtyFirst, position);
+					dirtyLast = std::max(dirtyLast, position);
+					this->counters.patched++;
+				}
+			}
+			this->counters.commands += itr->visible;
+			this->counters.triangles += itr->triangles;
+		}
+		this->drawnSelection = selection;
+
+		if (!this->indirect || this->commands.empty()) {
+			return;
+		}
+		if (this->commandBuffer == 0) {
+			glGenBuffers(1, &this->commandBuffer);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+		if (relayout) {
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * this->commands.size(), &this->commands.front(), GL_DYNAMIC_DRAW);
+			GLState::CountUpload(sizeof(DrawCommand) * this->commands.size());
+		}
+		else if (dirtyFirst <= dirtyLast) {
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * dirtyFirst, sizeof(DrawCommand) * (dirtyLast - dirtyFirst + 1), &this->commands[dirtyFirst]);
+			GLState::CountUpload(sizeof(DrawCommand) * (dirtyLast - dirtyFirst + 1));
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void GLStaticBatch::Draw(unsigned int pass) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->uploadedIndices == 0) {
+			return;
+		}
+		const glm::mat4 identity(1.0f);
+		for (auto itr = this->groups.begin(); itr != this->groups.end(); ++itr) {
+			if (itr->pass != pass || itr->visible == 0) {
+				continue;
+			}
+			GLSLShader& shader = *itr->shader;
+			shader.Use();
+			glUniformMatrix4fv(shader("in_Model"), 1, GL_FALSE, &identity[0][0]);
+
+			GLuint& vao = this->vertexArrays[shader.GetProgram()];
+			if (vao == 0) {
+				glGenVertexArrays(1, &vao);
+				SetupVertexArray(vao, shader.GetProgram());
+			}
+			GLState::BindVertexArray(vao);
+			GLState::SetCullFace(itr->cullFace);
+			RenderQueue::ApplyMaterial(itr->textured ? &itr->material : nullptr);
+
+			if (this->indirect) {
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(DrawCommand) * itr->firstCommand),
+					static_cast<GLsizei>(itr->slots.size()), sizeof(DrawCommand));
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			}
+			else {
+				this->counts.clear();
+				this->offsets.clear();
+				for (size_t i = 0; i < itr->slots.size(); ++i) {
+					const DrawCommand& command = this->commands[itr->firstCommand + i];
+					if (command.instanceCount) {
+						this->counts.push_back(static_cast<GLsizei>(command.count));
+						this->offsets.push_back(reinterpret_cast<const GLvoid*>(sizeof(GLuint) * command.firstIndex));
+					}
+				}
+				glMultiDrawElements(GL_TRIANGLES, &this->counts.front(), GL_UNSIGNED_INT, &this->offsets.front(), static_cast<GLsizei>(this->counts.size()));
+			}
+			this->counters.draws++;
+		}
+		GLState::SetCullFace(GL_BACK);
+	}
+} // namespace Sigma
@@ -8,7 +8,10 @@ namespace Sigma {
 	// We need ctor and dstor to be exported to a dll even if they don't do anything
 	// this avoids needing to export getFactoryFunctions() which is only used by Sigma
 	OpenALSystem::OpenALSystem() : nextindex(1), device(nullptr), context(nullptr) { }
-	OpenALSystem::~OpenALSystem() { }
+	OpenALSystem::~OpenALSystem() {
+		// The sources remove themselves from the emitter index, destroy them while it still exists
+		this->_Components.clear();
+	}
 
 	bool OpenALSystem::Start() {
 		const char * alcx;
@@ -151,6 +154,28 @@ namespace Sigma {
 		}
 		return false;
 	}
+	void OpenALSystem::MoveEmitter(ALSound* sound, const glm::vec3& position) {
+		if(sound->proxy == BoundingVolumeHierarchy::NULL_NODE) {
+			sound->proxy = this->emitters.Insert(position, 0.0f, sound);
+		}
+		else {
+			this->emitters.Move(sound->proxy, position, 0.0f);
+		}
+	}
+
+	void OpenALSystem::RemoveEmitter(ALSound* sound) {
+		this->emitters.Remove(sound->proxy);
+		sound->proxy = BoundingVolumeHierarchy::NULL_NODE;
+	}
+
+	void OpenALSystem::QueryEmitters(const glm::vec3& center, float radius, std::vector<ALSound*>& results) {
+		this->emitterResults.clear();
+		this->emitters.QuerySphere(center, radius, this->emitterResults);
+		for(auto itr = this->emitterResults.begin(); itr != this->emitterResults.end(); ++itr) {
+			results.push_back(static_cast<ALSound*>(*itr));
+		}
+	}
+
 	int OpenALSystem::AllocateBuffer() {
 		int x;
 		std::unique_ptr<resource::ALBuffer> testbuff(new resource::ALBuffer());
@@ -1,5 +1,7 @@
 #include "systems/OpenGLSystem.h"
 #include "systems/GLSLShader.h"
+#include "systems/GLState.h"
+#include "Profiler.h"
 #include "systems/GLSixDOFView.h"
 #include "controllers/FPSCamera.h"
 #include "components/GLSprite.h"
@@ -23,11 +25,22 @@ extern "C" const GLubyte * gluErrorString (GLenum error);
 #include "glm/glm.hpp"
 #include "glm/ext.hpp"
 
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
 namespace Sigma{
 	// RenderTarget methods
 	RenderTarget::~RenderTarget() {
 		glDeleteTextures(this->texture_ids.size(), &this->texture_ids[0]); // Perhaps should check if texture was created for this RT or is used elsewhere
-		glDeleteRenderbuffers(1, &this->depth_id);
+		GLState::Invalidate();
+		if (this->depthTexture) {
+			glDeleteTextures(1, &this->depth_id);
+		}
+		else {
+			glDeleteRenderbuffers(1, &this->depth_id);
+		}
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		glDeleteFramebuffers(1, &this->fbo_id);
 	}
@@ -62,8 +75,31 @@ namespace Sigma{
 
 	std::map<std::string, Sigma::resource::GLTexture> OpenGLSystem::textures;
 
+	namespace {
+		// Window space depth of a point at a positive view depth, for glDepthBoundsEXT.
+		float WindowDepth(const glm::mat4& projection, float depth) {
+			const float ndc = (projection[3][2] - projection[2][2] * depth) / depth;
+			return glm::clamp(ndc * 0.5f + 0.5f, 0.0f, 1.0f);
+		}
+
+		// The impostor atlas, 64 cells of 256 pixels.
+		const unsigned int IMPOSTOR_ATLAS_SIZE = 2048;
+		const unsigned int IMPOSTOR_CELL_SIZE = 256;
+		// Cells drawn again per frame at most, the others keep their image one more frame.
+		const unsigned int IMPOSTOR_CAPTURES_PER_FRAME = 8;
+		// Closer than this many bounding radii, the flat image would show the wrong parallax.
+		const float IMPOSTOR_MIN_DISTANCE = 10.0f;
+	}
+
 	OpenGLSystem::OpenGLSystem() : windowWidth(1024), windowHeight(768), deltaAccumulator(0.0),
-		framerate(60.0f), pointQuad(1000), ambientQuad(1001), spotQuad(1002) {}
+		framerate(60.0f), ambientQuad(1001), clusteredQuad(1003), depthBoundsSupported(false), depthClampSupported(false),
+		sceneFrame(0), renderableProxies(0), occlusionCulling(true), frameUniformBuffer(0), uniformAlignment(256), impostors(true), clusteredLighting(true),
+		leanGBuffer(false), graphWidth(0), graphHeight(0), boundFramebuffer(0), buildFrame(0), readyFrame(-1), drawingFrame(-1),
+		framesBuilt(0), framesDrawn(0), renderThreadRunning(false), passDrawMark(0), statsLogInterval(0.0), statsLogStart(-1.0), statsLogFrames(0) {}
+
+	OpenGLSystem::~OpenGLSystem() {
+		this->StopRenderThread();
+	}
 
 
 	std::map<std::string, Sigma::IFactory::FactoryFunction> OpenGLSystem::getFactoryFunctions() {
@@ -214,6 +250,18 @@ namespace Sigma{
 			else if (p->GetName() == "lightEnabled") {
 				sphere->SetLightingEnabled(p->Get<bool>());
 			}
+			else if (p->GetName() == "impostor") {
+				sphere->SetImpostorEnabled(p->Get<bool>());
+			}
+			else if (p->GetName() == "lodLevels") {
+				sphere->SetLODLevels(p->Get<int>());
+			}
+			else if (p->GetName() == "subdivisions" || p->GetName() == "subdivision_levels") {
+				sphere->SetSubdivisions(p->Get<int>());
+			}
+			else if (p->GetName() == "sharedColors") {
+				sphere->SetSharedColors(p->Get<bool>());
+			}
 		}
 		sphere->Transform()->Scale(scale,scale,scale);
 		sphere->Transform()->Translate(x,y,z);
@@ -266,7 +314,7 @@ namespace Sigma{
 			else if (p->GetName() == "rz") {
 				rz = p->Get<float>();
 			}
-			else if (p->GetName() == "subdivision_levels") {
+			else if (p->GetName() == "subdivision_levels" || p->GetName() == "subdivisions") {
 				subdivision_levels = p->Get<int>();
 			}
 			else if (p->GetName() == "texture") {
@@ -287,6 +335,12 @@ namespace Sigma{
 			else if (p->GetName() == "lightEnabled") {
 				sphere->SetLightingEnabled(p->Get<bool>());
 			}
+			else if (p->GetName() == "impostor") {
+				sphere->SetImpostorEnabled(p->Get<bool>());
+			}
+			else if (p->GetName() == "lodLevels") {
+				sphere->SetLODLevels(p->Get<int>());
+			}
 		}
 
 		sphere->SetSubdivisions(subdivision_levels);
@@ -316,6 +370,7 @@ namespace Sigma{
 		int componentID = 0;
 		std::string cull_face = "back";
 		std::string shaderfile = "";
+		std::string meshfile = "";
 
 		for (auto propitr = properties.begin(); propitr != properties.end(); ++propitr) {
 			const Property*  p = &*propitr;
@@ -348,7 +403,29 @@ namespace Sigma{
 				continue;
 			}
 			else if (p->GetName() == "meshFile") {
-				mesh->LoadMesh(p->Get<std::string>());
+				meshfile = p->Get<std::string>();
+			}
+			else if (p->GetName() == "optimizeOverdraw") {
+				mesh->SetOptimizeOverdraw(p->Get<bool>());
+			}
+			else if (p->GetName() == "lodLevels") {
+				mesh->SetLODLevels(p->Get<int>());
+			}
+			else if (p->GetName() == "residency") {
+				// Which CPU data survives the upload: none, geometry, attributes or all.
+				std::string residency = p->Get<std::string>();
+				if (residency == "geometry") {
+					mesh->SetResidency(GLMesh::RESIDENT_GEOMETRY);
+				}
+				else if (residency == "attributes") {
+					mesh->SetResidency(GLMesh::RESIDENT_ATTRIBUTES);
+				}
+				else if (residency == "all") {
+					mesh->SetResidency(GLMesh::RESIDENT_ALL);
+				}
+				else {
+					mesh->SetResidency(GLMesh::RESIDENT_NONE);
+				}
 			}
 			else if (p->GetName() == "shader") {
 				shaderfile = p->Get<std::string>();
@@ -362,6 +439,21 @@ namespace Sigma{
 			else if (p->GetName() == "lightEnabled") {
 				mesh->SetLightingEnabled(p->Get<bool>());
 			}
+			else if (p->GetName() == "impostor") {
+				mesh->SetImpostorEnabled(p->Get<bool>());
+			}
+			else if (p->GetName() == "occluder") {
+				mesh->SetOccluder(p->Get<bool>());
+			}
+			else if (p->GetName() == "static") {
+				// Never moves, drawn from the shared pools of the static batch.
+				mesh->SetStaticBatch(p->Get<bool>() ? &this->staticBatch : nullptr);
+			}
+		}
+
+		// Load after all properties are read, so load options apply regardless of their order.
+		if(meshfile != "") {
+			mesh->LoadMesh(meshfile);
 		}
 
 		mesh->SetCullFace(cull_face);
@@ -437,7 +529,7 @@ namespace Sigma{
 		quad->SetSize(w, h);
 		quad->LoadShader("shaders/quad");
 		quad->InitializeBuffers();
-		this->screensSpaceComp.push_back(std::unique_ptr<IGLComponent>(quad));
+		this->screensSpaceComp.push_back(std::unique_ptr<GLScreenQuad>(quad));
 
 		return quad;
 	}
@@ -532,6 +624,9 @@ namespace Sigma{
 				light->outerAngle = p->Get<float>();
 				light->cosOuterAngle = glm::cos(light->outerAngle);
 			}
+			else if (p->GetName() == "range") {
+				light->range = p->Get<float>();
+			}
 		}
 
 		light->transform.TranslateTo(x, y, z);
@@ -542,17 +637,256 @@ namespace Sigma{
 		return light;
 	}
 
-	int OpenGLSystem::createRenderTarget(const unsigned int w, const unsigned int h, bool hasDepth) {
+	int OpenGLSystem::createRenderTarget(const unsigned int w, const unsigned int h, bool hasDepth, bool depthTexture) {
 		std::unique_ptr<RenderTarget> newRT(new RenderTarget());
 
 		newRT->width = w;
 		newRT->height = h;
 		newRT->hasDepth = hasDepth;
+		newRT->depthTexture = depthTexture;
 
 		this->renderTargets.push_back(std::move(newRT));
 		return (this->renderTargets.size() - 1);
 	}
 
+	void OpenGLSystem::createLeanGBuffer() {
+		RenderGraph& graph = this->renderGraph;
+		LeanGraph& lean = this->leanGraph;
+		graph.Clear();
+		lean.albedo = graph.AddTexture("Albedo", GL_RGBA8); // Albedo and specular hardness
+		lean.normal = graph.AddTexture("Normal", GL_RG16); // Octahedral normal
+		lean.depth = graph.AddTexture("Depth", GL_DEPTH24_STENCIL8);
+		lean.light = graph.AddTexture("Light", GL_RGBA8); // The lit image plus the unlit and overlay passes
+		lean.volumeDepth = graph.AddTexture("Volume depth", GL_DEPTH24_STENCIL8); // Copy of depth, see the volumes pass
+
+		lean.gbuffer = graph.AddPass("GBuffer");
+		graph.Write(lean.gbuffer, lean.albedo, true);
+		graph.Write(lean.gbuffer, lean.normal, true);
+		graph.Write(lean.gbuffer, lean.depth, true);
+
+		// Ambient and clustered lights, full screen, the sampled depth is not attached
+		lean.lighting = graph.AddPass("Lighting");
+		graph.Read(lean.lighting, lean.albedo);
+		graph.Read(lean.lighting, lean.normal);
+		graph.Read(lean.lighting, lean.depth);
+		graph.Write(lean.lighting, lean.light, true);
+
+		// Without clustered lighting, the light volumes are depth tested against a copy of the
+		// depth, blitted when the pass begins, as sampling an attached texture is a feedback loop
+		lean.volumes = graph.AddPass("Light volumes");
+		graph.Read(lean.volumes, lean.albedo);
+		graph.Read(lean.volumes, lean.normal);
+		graph.Read(lean.volumes, lean.depth);
+		graph.Write(lean.volumes, lean.light, false);
+		graph.Write(lean.volumes, lean.volumeDepth, false);
+
+		lean.unlit = graph.AddPass("Unlit");
+		graph.Write(lean.unlit, lean.light, false);
+		graph.Write(lean.unlit, lean.depth, false);
+
+		lean.overlay = graph.AddPass("Overlay");
+		graph.Write(lean.overlay, lean.light, false);
+		graph.Write(lean.overlay, lean.depth, false);
+
+		lean.present = graph.AddPass("Present");
+		graph.Read(lean.present, lean.light);
+		graph.Write(lean.present, RenderGraph::BACKBUFFER, false);
+
+		graph.Compile();
+		for (size_t i = 0; i < graph.PassCount(); ++i) {
+			if (graph.IsCulled(static_cast<int>(i))) {
+				LOG << "Render graph: the " << graph.GetPass(static_cast<int>(i)).name << " pass is culled.";
+			}
+		}
+
+		this->leanGBuffer = true;
+	}
+
+	namespace {
+		bool IsDepthFormat(GLenum format) {
+			return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8 || format == GL_DEPTH_COMPONENT16
+				|| format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F;
+		}
+
+		bool HasStencil(GLenum format) {
+			return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+		}
+
+		// Size of a texel, for the memory the render graph reports.
+		size_t TexelSize(GLenum format) {
+			switch (format) {
+			case GL_R8:
+				return 1;
+			case GL_RG8:
+			case GL_R16F:
+			case GL_DEPTH_COMPONENT16:
+				return 2;
+			case GL_RGBA16F:
+			case GL_RG32F:
+			case GL_DEPTH32F_STENCIL8:
+				return 8;
+			case GL_RGBA32F:
+				return 16;
+			default:
+				return 4;
+			}
+		}
+
+		// The size of a render graph texture at a viewport size, never empty.
+		GLsizei ScaledSize(float scale, unsigned int size) {
+			return std::max(static_cast<GLsizei>(scale * size), 1);
+		}
+	}
+
+	void OpenGLSystem::BeginRenderGraph(unsigned int width, unsigned int height) {
+		this->boundFramebuffer = ~0u;
+		const RenderGraph& graph = this->renderGraph;
+		if (width == this->graphWidth && height == this->graphHeight && !this->graphTextures.empty()) {
+			return;
+		}
+
+		const bool create = this->graphTextures.empty();
+		if (create) {
+			this->graphTextures.resize(graph.SlotCount());
+			if (!this->graphTextures.empty()) {
+				glGenTextures(static_cast<GLsizei>(this->graphTextures.size()), &this->graphTextures[0]);
+			}
+		}
+
+		// The textures keep their names when resized, so the framebuffers stay valid
+		size_t bytes = 0;
+		for (size_t i = 0; i < graph.SlotCount(); ++i) {
+			const RenderGraphSlot& slot = graph.GetSlot(static_cast<int>(i));
+			const GLsizei slotWidth = ScaledSize(slot.scale, width), slotHeight = ScaledSize(slot.scale, height);
+			const bool depth = IsDepthFormat(slot.format);
+			GLState::BindTexture(GL_TEXTURE_2D, this->graphTextures[i]);
+			if (create) {
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+			}
+			if (depth) {
+				glTexImage2D(GL_TEXTURE_2D, 0, slot.format, slotWidth, slotHeight, 0, HasStencil(slot.format) ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT,
+					slot.format == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8 : (slot.format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_FLOAT), NULL);
+			}
+			else {
+				glTexImage2D(GL_TEXTURE_2D, 0, slot.format, slotWidth, slotHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			}
+			bytes += static_cast<size_t>(slotWidth) * slotHeight * TexelSize(slot.format);
+		}
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+		printOpenGLError();
+
+		if (create) {
+			this->passFramebuffers.assign(graph.PassCount(), 0);
+			for (size_t i = 0; i < graph.PassCount(); ++i) {
+				const RenderGraphPass& pass = graph.GetPass(static_cast<int>(i));
+				if (pass.culled || std::find(pass.writes.begin(), pass.writes.end(), RenderGraph::BACKBUFFER) != pass.writes.end()) {
+					continue;
+				}
+				std::vector<GLuint> colors;
+				GLuint depth = 0;
+				GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+				for (auto itr = pass.writes.begin(); itr != pass.writes.end(); ++itr) {
+					const GLenum format = graph.GetTexture(*itr).format;
+					if (IsDepthFormat(format)) {
+						depth = this->GraphTexture(*itr);
+						depthAttachment = HasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+					}
+					else {
+						colors.push_back(this->GraphTexture(*itr));
+					}
+				}
+				this->passFramebuffers[i] = this->FindGraphFramebuffer(colors, depth, depthAttachment);
+			}
+		}
+
+		this->graphWidth = width;
+		this->graphHeight = height;
+		LOG << "Render graph: " << graph.TextureCount() << " targets in " << graph.SlotCount() << " textures, "
+			<< this->graphFramebuffers.size() << " framebuffers, " << (bytes / 1024) << " KB at " << width << "x" << height;
+	}
+
+	GLuint OpenGLSystem::FindGraphFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthAttachment) {
+		std::vector<GLuint> key(colors);
+		key.push_back(depth);
+		auto found = this->graphFramebuffers.find(key);
+		if (found != this->graphFramebuffers.end()) {
+			return found->second;
+		}
+
+		GLuint framebuffer = 0;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		std::vector<GLenum> buffers;
+		for (size_t i = 0; i < colors.size(); ++i) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, colors[i], 0);
+			buffers.push_back(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i));
+		}
+		if (depth) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+		}
+		// Draw buffers are framebuffer state, set once instead of every time a pass binds it
+		if (buffers.empty()) {
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else {
+			glDrawBuffers(static_cast<GLsizei>(buffers.size()), &buffers[0]);
+		}
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR << "Error: Render graph framebuffer format is not compatible.";
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		this->graphFramebuffers[key] = framebuffer;
+		return framebuffer;
+	}
+
+	void OpenGLSystem::BeginRenderPass(int pass) {
+		const RenderGraph& graph = this->renderGraph;
+		const RenderGraphPass& declared = graph.GetPass(pass);
+		if (declared.culled) {
+			return;
+		}
+
+		// Passes drawing into the same textures share a framebuffer, which stays bound between them
+		const GLuint framebuffer = this->passFramebuffers[pass];
+		if (framebuffer != this->boundFramebuffer) {
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+			float scale = 1.0f;
+			if (!declared.writes.empty() && declared.writes[0] != RenderGraph::BACKBUFFER) {
+				scale = graph.GetTexture(declared.writes[0]).scale;
+			}
+			glViewport(0, 0, ScaledSize(scale, this->graphWidth), ScaledSize(scale, this->graphHeight));
+			this->boundFramebuffer = framebuffer;
+		}
+
+		const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		GLint color = 0;
+		for (auto itr = declared.writes.begin(); itr != declared.writes.end(); ++itr) {
+			const bool depth = *itr != RenderGraph::BACKBUFFER && IsDepthFormat(graph.GetTexture(*itr).format);
+			const bool clear = std::find(declared.clears.begin(), declared.clears.end(), *itr) != declared.clears.end();
+			if (clear && depth) {
+				GLState::SetDepthMask(true);
+				if (HasStencil(graph.GetTexture(*itr).format)) {
+					glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+				}
+				else {
+					const GLfloat one = 1.0f;
+					glClearBufferfv(GL_DEPTH, 0, &one);
+				}
+			}
+			else if (clear) {
+				glClearBufferfv(GL_COLOR, color, black);
+			}
+			if (!depth) {
+				color++;
+			}
+		}
+	}
+
 	void OpenGLSystem::initRenderTarget(unsigned int rtID) {
 		RenderTarget *rt = this->renderTargets[rtID].get();
 
@@ -568,8 +902,22 @@ namespace Sigma{
 		glGetIntegerv(GL_DEPTH_BITS, &depthBits);
 #endif
 
+		// Create the depth texture, sampled by the lighting in place of a depth color target
+		if(rt->hasDepth && rt->depthTexture) {
+			glGenTextures(1, &rt->depth_id);
+			GLState::BindTexture(GL_TEXTURE_2D, rt->depth_id);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, rt->width, rt->height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+			printOpenGLError();
+
+			GLState::BindTexture(GL_TEXTURE_2D, 0);
+		}
 		// Create the depth render buffer
-		if(rt->hasDepth) {
+		else if(rt->hasDepth) {
 			glGenRenderbuffers(1, &rt->depth_id);
 			glBindRenderbuffer(GL_RENDERBUFFER, rt->depth_id);
 
@@ -591,7 +939,12 @@ namespace Sigma{
 			printOpenGLError();
 		}
 
-		if(rt->hasDepth) {
+		if(rt->hasDepth && rt->depthTexture) {
+			//Attach depth texture to FBO
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, rt->depth_id, 0);
+			printOpenGLError();
+		}
+		else if(rt->hasDepth) {
 			//Attach depth buffer to FBO
 			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rt->depth_id);
 			printOpenGLError();
@@ -621,7 +974,7 @@ namespace Sigma{
 		GLuint texture_id;
 
 		glGenTextures(1, &texture_id);
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		GLState::BindTexture(GL_TEXTURE_2D, texture_id);
 
 		// Texture params for full screen quad
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -640,7 +993,129 @@ namespace Sigma{
 
 		this->renderTargets[rtID]->texture_ids.push_back(texture_id);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void OpenGLSystem::addComponent(id_t entityID, IComponent* component) {
+		auto entity = this->_Components.find(entityID);
+		if (entity != this->_Components.end()) {
+			auto replaced = entity->second.find(component->getComponentTypeName());
+			if (replaced != entity->second.end()) {
+				this->UnregisterComponent(replaced->second.get());
+
+				// A snapshot built before now may still point at the component, keep it until drawn.
+				RetiredComponent retired;
+				retired.component = std::move(replaced->second);
+				retired.frame = this->framesBuilt;
+				this->retiredComponents.push_back(std::move(retired));
+			}
+		}
+		ISystem<IComponent>::addComponent(entityID, component);
+
+		IGLComponent *glComp = dynamic_cast<IGLComponent *>(component);
+		if (glComp) {
+			this->renderables.push_back(glComp);
+			return;
+		}
+		PointLight *light = dynamic_cast<PointLight *>(component);
+		if (light) {
+			this->pointLights.push_back(light);
+			return;
+		}
+		SpotLight *spotLight = dynamic_cast<SpotLight *>(component);
+		if (spotLight) {
+			this->spotLights.push_back(spotLight);
+		}
+	}
+
+	void OpenGLSystem::UnregisterComponent(IComponent* component) {
+		this->renderables.erase(std::remove(this->renderables.begin(), this->renderables.end(), component), this->renderables.end());
+		this->pointLights.erase(std::remove(this->pointLights.begin(), this->pointLights.end(), component), this->pointLights.end());
+		this->spotLights.erase(std::remove(this->spotLights.begin(), this->spotLights.end(), component), this->spotLights.end());
+
+		auto found = this->sceneProxies.find(component);
+		if (found != this->sceneProxies.end()) {
+			this->sceneIndex.Remove(found->second.proxy);
+			this->sceneProxies.erase(found);
+		}
+		this->impostorCache.Remove(component);
+	}
+
+	void OpenGLSystem::ReleaseRetiredComponents(unsigned int drawn) {
+		auto kept = this->retiredComponents.begin();
+		for (auto itr = this->retiredComponents.begin(); itr != this->retiredComponents.end(); ++itr) {
+			if (itr->frame > drawn) {
+				*kept++ = std::move(*itr);
+			}
+		}
+		this->retiredComponents.erase(kept, this->retiredComponents.end());
+	}
+
+	void OpenGLSystem::UpdateSceneIndex() {
+		this->sceneFrame++;
+		this->renderableProxies = 0;
+		this->unboundedComponents.clear();
+
+		for (auto itr = this->renderables.begin(); itr != this->renderables.end(); ++itr) {
+			IGLComponent *glComp = *itr;
+			auto found = this->sceneProxies.find(glComp);
+			const unsigned int version = glComp->Transform()->GetVersion();
+			if (found != this->sceneProxies.end() && found->second.version == version && found->second.modelRadius == glComp->BoundingRadius()) {
+				found->second.frame = this->sceneFrame;
+				this->renderableProxies++;
+				continue;
+			}
+
+			glm::vec3 center;
+			float radius;
+			if (!glComp->WorldBoundingSphere(center, radius)) {
+				this->unboundedComponents.push_back(glComp);
+				continue;
+			}
+			if (found == this->sceneProxies.end()) {
+				SceneProxy proxy;
+				proxy.proxy = this->sceneIndex.Insert(center, radius, glComp, SCENE_RENDERABLE);
+				found = this->sceneProxies.insert(std::make_pair(static_cast<IComponent*>(glComp), proxy)).first;
+			}
+			else {
+				this->sceneIndex.Move(found->second.proxy, center, radius);
+			}
+			found->second.version = version;
+			found->second.modelRadius = glComp->BoundingRadius();
+			found->second.frame = this->sceneFrame;
+			this->renderableProxies++;
+		}
+
+		for (auto itr = this->pointLights.begin(); itr != this->pointLights.end(); ++itr) {
+			PointLight *light = *itr;
+			auto found = this->sceneProxies.find(light);
+			// Lights have no transform, moving a proxy within its fat box costs next to nothing.
+			if (found == this->sceneProxies.end()) {
+				SceneProxy proxy;
+				proxy.proxy = this->sceneIndex.Insert(light->position, light->radius, light, SCENE_POINT_LIGHT);
+				proxy.version = 0;
+				proxy.modelRadius = 0.0f;
+				found = this->sceneProxies.insert(std::make_pair(static_cast<IComponent*>(light), proxy)).first;
+			}
+			else {
+				this->sceneIndex.Move(found->second.proxy, light->position, light->radius);
+			}
+			found->second.frame = this->sceneFrame;
+		}
+
+		// Remove the proxies of components that lost their bounds.
+		for (auto itr = this->sceneProxies.begin(); itr != this->sceneProxies.end(); ) {
+			if (itr->second.frame != this->sceneFrame) {
+				this->sceneIndex.Remove(itr->second.proxy);
+				this->impostorCache.Remove(itr->first);
+				itr = this->sceneProxies.erase(itr);
+			}
+			else {
+				++itr;
+			}
+		}
+
+		this->sceneIndex.RebuildIfDegraded();
 	}
 
 	bool OpenGLSystem::Update(const double delta) {
@@ -649,267 +1124,821 @@ namespace Sigma{
 		// Check if the deltaAccumulator is greater than 1/<framerate>th of a second.
 		//  ..if so, it's time to render a new frame
 		if (this->deltaAccumulator > (1.0 / this->framerate)) {
+			this->deltaAccumulator = 0.0;
 
-			/////////////////////
-			// Rendering Setup //
-			/////////////////////
+			// One profiler frame per frame built, like the GPU timer frames
+			Profiler::NextFrame();
+
+			if (!this->renderThread.joinable()) {
+				// Every frame built before was drawn before its Update returned.
+				this->ReleaseRetiredComponents(this->framesDrawn);
+				this->BuildFrame(this->frames[0]);
+				this->framesBuilt++;
+				this->RenderFrame(this->frames[0]);
+				this->framesDrawn++;
+				return true;
+			}
+
+			// Wait for the render thread to pick up the last snapshot, it then draws it while this
+			// one is built. The simulation is never more than one frame ahead of the screen.
+			FrameSnapshot &frame = this->frames[this->buildFrame];
+			unsigned int drawn;
+			{
+				std::unique_lock<std::mutex> lock(this->frameMutex);
+				while (this->readyFrame >= 0 || this->drawingFrame == static_cast<int>(this->buildFrame)) {
+					this->frameDone.wait(lock);
+				}
+				drawn = this->framesDrawn;
+			}
+			this->ReleaseRetiredComponents(drawn);
 
-			glm::vec3 viewPosition;
-			glm::mat4 viewProjInv;
+			this->BuildFrame(frame);
+			this->framesBuilt++;
 
-			// Setup the view matrix and position variables
-			glm::mat4 viewMatrix;
-			if (this->views.size() > 0) {
-				viewMatrix = this->views[this->views.size() - 1]->GetViewMatrix();
-				viewPosition = this->views[this->views.size() - 1]->Transform()->GetPosition();
+			{
+				std::lock_guard<std::mutex> lock(this->frameMutex);
+				this->readyFrame = static_cast<int>(this->buildFrame);
 			}
+			this->frameReady.notify_one();
+			this->buildFrame ^= 1;
+		}
+		return false;
+	}
 
-			// Setup the projection matrix
-			glm::mat4 viewProj = this->ProjectionMatrix * viewMatrix;
-
-			viewProjInv = glm::inverse(viewProj);
+	void OpenGLSystem::StartRenderThread(std::function<void(bool)> bindContext, std::function<void()> present) {
+		if (this->renderThread.joinable()) {
+			return;
+		}
+		this->bindContext = bindContext;
+		this->present = present;
+		this->buildFrame = 0;
+		this->readyFrame = -1;
+		this->drawingFrame = -1;
+		this->renderThreadRunning = true;
+
+		// The context can only be current on one thread.
+		this->bindContext(false);
+		this->renderThread = std::thread(&OpenGLSystem::RenderLoop, this);
+	}
 
-			// Calculate frustum for culling
-			this->GetView(0)->CalculateFrustum(viewProj);
+	void OpenGLSystem::StopRenderThread() {
+		if (!this->renderThread.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(this->frameMutex);
+			this->renderThreadRunning = false;
+		}
+		this->frameReady.notify_one();
+		this->renderThread.join();
 
-			// Clear the backbuffer and primary depth/stencil buffer
-			glClearColor(0.0f,0.0f,0.0f,1.0f);
-			glViewport(0, 0, this->windowWidth, this->windowHeight); // Set the viewport size to fill the window
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // Clear required buffers
+		// Take the context back so the GL objects can be released on this thread.
+		this->bindContext(true);
+	}
 
-			//////////////////
-			// GBuffer Pass //
-			//////////////////
+	void OpenGLSystem::RenderLoop() {
+		this->bindContext(true);
 
-			// Bind the first buffer, which is the Geometry Buffer
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->BindWrite();
+		std::unique_lock<std::mutex> lock(this->frameMutex);
+		for (;;) {
+			while (this->readyFrame < 0 && this->renderThreadRunning) {
+				this->frameReady.wait(lock);
 			}
+			// A snapshot handed over before the stop is still drawn.
+			if (this->readyFrame < 0) {
+				break;
+			}
+			const int frame = this->readyFrame;
+			this->drawingFrame = frame;
+			this->readyFrame = -1;
+			lock.unlock();
+			this->frameDone.notify_one();
 
-			// Disable blending
-			glDisable(GL_BLEND);
-
-			// Clear the GBuffer
-			glClearColor(0.0f,0.0f,0.0f,1.0f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // Clear required buffers
+			this->RenderFrame(this->frames[frame]);
+			this->present();
 
-			// Loop through and draw each GL Component component.
-			for (auto eitr = this->_Components.begin(); eitr != this->_Components.end(); ++eitr) {
-				for (auto citr = eitr->second.begin(); citr != eitr->second.end(); ++citr) {
-					IGLComponent *glComp = dynamic_cast<IGLComponent *>(citr->second.get());
+			lock.lock();
+			this->drawingFrame = -1;
+			this->framesDrawn++;
+			this->frameDone.notify_one();
+		}
+		lock.unlock();
 
-					if(glComp && glComp->IsLightingEnabled()) {
-						glComp->GetShader()->Use();
+		this->bindContext(false);
+	}
 
-						// Set view position
-						//glUniform3f(glGetUniformBlockIndex(glComp->GetShader()->GetProgram(), "viewPosW"), viewPosition.x, viewPosition.y, viewPosition.z);
+	void OpenGLSystem::BuildFrame(FrameSnapshot& frame) {
+		PROFILE_SCOPE("BuildFrame");
+		glm::vec3 viewPosition;
+		glm::mat4 viewProjInv;
 
-						// For now, turn on ambient intensity and turn off lighting
-						glUniform1f(glGetUniformLocation(glComp->GetShader()->GetProgram(), "ambLightIntensity"), 0.05f);
-						glUniform1f(glGetUniformLocation(glComp->GetShader()->GetProgram(), "diffuseLightIntensity"), 0.0f);
-						glUniform1f(glGetUniformLocation(glComp->GetShader()->GetProgram(), "specularLightIntensity"), 0.0f);
+		// Setup the view matrix and position variables
+		glm::mat4 viewMatrix;
+		if (this->views.size() > 0) {
+			viewMatrix = this->views[this->views.size() - 1]->GetViewMatrix();
+			viewPosition = this->views[this->views.size() - 1]->Transform()->GetPosition();
+		}
 
-						glComp->Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
-					}
-				}
-			}
+		// Setup the projection matrix
+		glm::mat4 viewProj = this->ProjectionMatrix * viewMatrix;
+		frame.view = viewMatrix;
+		frame.projection = this->ProjectionMatrix;
+		frame.width = this->windowWidth;
+		frame.height = this->windowHeight;
+		frame.clusterNear = this->lightClusterer.NearPlane();
+
+		viewProjInv = glm::inverse(viewProj);
+
+		// Calculate frustum for culling
+		this->GetView(0)->CalculateFrustum(viewProj);
+
+		// The per frame uniforms, every shader reads them from the FrameData block.
+		// For now, turn on ambient intensity and turn off lighting for the GBuffer pass.
+		FrameUniforms &frameUniforms = frame.uniforms;
+		frameUniforms.view = viewMatrix;
+		frameUniforms.proj = this->ProjectionMatrix;
+		frameUniforms.viewProjInverse = viewProjInv;
+		frameUniforms.viewPosition = viewPosition;
+		frameUniforms.ambientIntensity = 0.05f;
+		frameUniforms.diffuseIntensity = 0.0f;
+		frameUniforms.specularIntensity = 0.0f;
+		frameUniforms.screenSize = glm::vec2(this->windowWidth, this->windowHeight);
+		frameUniforms.gbufferLayout = this->leanGBuffer ? 1 : 0;
+
+		// Queue the draws of every GL component, then sort them by pass, shader, material and depth.
+		// Components with bounds come from a frustum query of the scene index, the others are always drawn.
+		this->UpdateSceneIndex();
+		frame.stats = RenderStats();
+		frame.queue.Clear();
+		this->staticBatch.BeginFrame();
+		for (auto itr = this->unboundedComponents.begin(); itr != this->unboundedComponents.end(); ++itr) {
+			(*itr)->Submit(frame.queue, (*itr)->IsLightingEnabled() ? PASS_GBUFFER : PASS_UNLIT, viewMatrix, this->ProjectionMatrix);
+			frame.stats.objects++;
+		}
 
-			// Unbind the first buffer, which is the Geometry Buffer
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->UnbindWrite();
-			}
+		glm::vec4 *frustumPlanes = frame.frustumPlanes;
+		FrustumCuller::ExtractPlanes(viewProj, frustumPlanes);
+		this->sceneResults.clear();
+		this->sceneIndex.QueryFrustum(frustumPlanes, this->sceneResults, SCENE_RENDERABLE);
+		this->visibleComponents.clear();
+		for (auto itr = this->sceneResults.begin(); itr != this->sceneResults.end(); ++itr) {
+			this->visibleComponents.push_back(static_cast<IGLComponent *>(*itr));
+		}
+		if (this->occlusionCulling) {
+			frame.stats.occluded = this->CullOccluded(viewProj);
+		}
+		frame.impostorCaptures.clear();
+		frame.impostors.clear();
+		if (this->impostors && this->impostorAtlas.IsCreated()) {
+			frame.stats.impostors = this->SelectImpostors(frame, viewPosition);
+			frame.stats.impostorCaptures = static_cast<unsigned int>(frame.impostorCaptures.size());
+		}
+		// The scene index update brought every transform up to date, so the visible components
+		// can be submitted concurrently. The unbounded ones above may move themselves, like the
+		// cube spheres following the camera, so they are submitted first on this thread.
+		if (!this->visibleComponents.empty()) {
+			this->drawListBuilder.Build(&this->visibleComponents[0], this->visibleComponents.size(), frame.queue, viewMatrix, this->ProjectionMatrix);
+		}
+		frame.stats.objects += static_cast<unsigned int>(this->visibleComponents.size()) + frame.stats.impostors;
+		frame.stats.culled = static_cast<unsigned int>(this->renderableProxies - this->sceneResults.size());
+		this->drawListBuilder.Sort(frame.queue);
+		frame.staticSelection = this->staticBatch.Selection();
+
+		// Copy the lights in the frustum, enabled spot lights only
+		frame.clustered = this->clusteredLighting;
+		frame.lights.clear();
+		this->sceneResults.clear();
+		this->sceneIndex.QueryFrustum(frustumPlanes, this->sceneResults, SCENE_POINT_LIGHT);
+		for (auto litr = this->sceneResults.begin(); litr != this->sceneResults.end(); ++litr) {
+			PointLight *light = static_cast<PointLight *>(*litr);
+			LightSnapshot snapshot;
+			snapshot.position = light->position;
+			snapshot.radius = light->radius;
+			snapshot.color = light->color;
+			snapshot.center = light->position;
+			snapshot.boundingRadius = light->radius;
+			snapshot.spot = false;
+			frame.lights.push_back(snapshot);
+		}
 
-			// Copy gbuffer's depth buffer to the screen depth buffer
-			// needed for non deferred rendering at the end of this method
-			// NOTE: I'm sure there's a faster way to do this
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->BindRead();
+		for (auto litr = this->spotLights.begin(); litr != this->spotLights.end(); ++litr) {
+			SpotLight *spotLight = *litr;
+			LightSnapshot snapshot;
+			spotLight->BoundingSphere(snapshot.center, snapshot.boundingRadius);
+			if (!spotLight->IsEnabled() || !FrustumCuller::SphereVisible(frustumPlanes, snapshot.center, snapshot.boundingRadius)) {
+				continue;
 			}
+			snapshot.position = spotLight->transform.ExtractPosition();
+			snapshot.direction = glm::normalize(spotLight->transform.GetForward());
+			snapshot.radius = spotLight->range;
+			snapshot.color = spotLight->color;
+			snapshot.cosInnerAngle = spotLight->cosInnerAngle;
+			snapshot.cosOuterAngle = spotLight->cosOuterAngle;
+			snapshot.spot = true;
+			frame.lights.push_back(snapshot);
+		}
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-			glBlitFramebuffer(0, 0, this->windowWidth, this->windowHeight, 0, 0, this->windowWidth, this->windowHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		if (frame.clustered) {
+			this->BinClusteredLights(frame);
+		}
+	}
 
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->UnbindRead();
+	unsigned int OpenGLSystem::CullOccluded(const glm::mat4& viewProj) {
+		PROFILE_SCOPE("CullOccluded");
+		this->occlusionCuller.Clear();
+		this->occluderFlags.assign(this->visibleComponents.size(), 0);
+		OccluderGeometry geometry;
+		for (size_t i = 0; i < this->visibleComponents.size(); ++i) {
+			IGLComponent *component = this->visibleComponents[i];
+			if (component->GetOccluder(geometry)) {
+				this->occlusionCuller.AddOccluder(viewProj * component->Transform()->GetMatrix(), geometry);
+				this->occluderFlags[i] = 1;
 			}
+		}
+		if (this->occlusionCuller.TriangleCount() == 0) {
+			return 0;
+		}
+		this->occlusionCuller.Rasterize();
+
+		// Occluders would hide themselves, they are kept as they are.
+		size_t kept = 0;
+		for (size_t i = 0; i < this->visibleComponents.size(); ++i) {
+			IGLComponent *component = this->visibleComponents[i];
+			glm::vec3 center;
+			float radius;
+			if (!this->occluderFlags[i] && component->WorldBoundingSphere(center, radius) &&
+				!this->occlusionCuller.IsBoxVisible(viewProj, center - glm::vec3(radius), center + glm::vec3(radius))) {
+				continue;
+			}
+			this->visibleComponents[kept++] = component;
+		}
+		const unsigned int occluded = static_cast<unsigned int>(this->visibleComponents.size() - kept);
+		this->visibleComponents.resize(kept);
+		return occluded;
+	}
 
-			///////////////////
-			// Lighting Pass //
-			///////////////////
+	unsigned int OpenGLSystem::SelectImpostors(FrameSnapshot& frame, const glm::vec3& viewPosition) {
+		PROFILE_SCOPE("SelectImpostors");
+		this->impostorCache.BeginFrame();
+		// Pixels covered by one world unit one unit away from the camera.
+		const float pixelScale = 0.5f * frame.projection[1][1] * static_cast<float>(frame.height);
+		size_t kept = 0;
+		for (size_t i = 0; i < this->visibleComponents.size(); ++i) {
+			IGLComponent *component = this->visibleComponents[i];
+			glm::vec3 center;
+			float radius;
+			if (!component->IsImpostorEnabled() || !component->WorldBoundingSphere(center, radius)) {
+				this->visibleComponents[kept++] = component;
+				continue;
+			}
+			const glm::vec3 toCenter = center - viewPosition;
+			const float distance = glm::length(toCenter);
+			if (distance <= radius * IMPOSTOR_MIN_DISTANCE || 2.0f * radius * pixelScale > IMPOSTOR_CELL_SIZE * distance) {
+				this->visibleComponents[kept++] = component;
+				continue;
+			}
 
-			// Disable depth testing
-			glDepthFunc(GL_NONE);
-			glDepthMask(GL_FALSE);
+			// The cell is drawn again once the component is seen from another side
+			const glm::vec3 direction = toCenter / distance;
+			const glm::mat4 model = component->Transform()->GetMatrix();
+			const glm::vec3 objectDirection = glm::normalize(glm::inverse(glm::mat3(model)) * direction);
+			bool capture = false;
+			const int cell = this->impostorCache.Request(static_cast<IComponent *>(component), objectDirection, capture);
+			if (cell < 0) {
+				this->visibleComponents[kept++] = component;
+				continue;
+			}
 
-			// Bind the Geometry buffer for reading
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->BindRead();
+			// The image and the billboard share the same axes, derived from the direction alone
+			const glm::vec3 up = std::abs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+			const glm::vec3 right = glm::normalize(glm::cross(direction, up));
+			const glm::vec3 imageUp = glm::cross(right, direction);
+			if (capture) {
+				ImpostorCapture impostorCapture;
+				impostorCapture.component = component;
+				impostorCapture.model = model;
+				impostorCapture.view = glm::lookAt(center - direction * (2.0f * radius), center, imageUp);
+				impostorCapture.projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+				impostorCapture.lod = component->UpdateLOD(frame.view * model, frame.projection[1][1]);
+				impostorCapture.triangles = component->LastTriangleCount();
+				this->impostorCache.CellOrigin(cell, impostorCapture.x, impostorCapture.y);
+				frame.impostorCaptures.push_back(impostorCapture);
+			}
+
+			// On the front of the bounding sphere so what passes behind it stays hidden, shrunk to
+			// cover the same part of the screen as it would at the center
+			const glm::vec3 front = center - direction * radius;
+			const float halfSize = radius * (distance - radius) / distance;
+			SpriteQuad quad;
+			quad.corners[0] = front + (imageUp - right) * halfSize;
+			quad.corners[1] = front + (imageUp + right) * halfSize;
+			quad.corners[2] = front - (imageUp + right) * halfSize;
+			quad.corners[3] = front - (imageUp - right) * halfSize;
+			quad.uvRect = this->impostorCache.CellRect(cell);
+			quad.color = glm::vec4(1.0f);
+			quad.texture = this->impostorAtlas.Albedo();
+			if (component->IsLightingEnabled()) {
+				frame.impostors.push_back(quad);
+			}
+			else {
+				frame.queue.AddSprite(quad);
 			}
+		}
+		const unsigned int replaced = static_cast<unsigned int>(this->visibleComponents.size() - kept);
+		this->visibleComponents.resize(kept);
+		return replaced;
+	}
 
-			// Ambient light pass
+	void OpenGLSystem::RenderImpostorCaptures(const FrameSnapshot& frame, glm::mat4& viewMatrix, glm::mat4& projectionMatrix) {
+		// The atlas has the classic GBuffer layout whatever the frame uses
+		FrameUniforms uniforms = frame.uniforms;
+		uniforms.screenSize = glm::vec2(static_cast<float>(IMPOSTOR_CELL_SIZE));
+		uniforms.gbufferLayout = 0;
+		GLState::SetBlend(false);
+		for (auto itr = frame.impostorCaptures.begin(); itr != frame.impostorCaptures.end(); ++itr) {
+			this->impostorAtlas.BeginCapture(itr->x, itr->y, IMPOSTOR_CELL_SIZE);
+			uniforms.view = itr->view;
+			uniforms.proj = itr->projection;
+			uniforms.viewProjInverse = glm::inverse(itr->projection * itr->view);
+			uniforms.viewPosition = glm::vec3(glm::inverse(itr->view)[3]);
+			this->BindFrameUniforms(uniforms);
+
+			// The shaders read the matrices of the capture from FrameData, Render ignores its own
+			itr->component->SetRenderMatrix(itr->model);
+			itr->component->SetRenderLOD(itr->lod);
+			itr->component->Render(&viewMatrix[0][0], &projectionMatrix[0][0]);
+			this->drawStats.drawCalls++;
+			this->drawStats.triangles += itr->triangles;
+		}
 
-			// Ensure that blending is disabled
-			glDisable(GL_BLEND);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		this->boundFramebuffer = ~0u;
+		glViewport(0, 0, frame.width, frame.height);
+		this->BindFrameUniforms(frame.uniforms);
+	}
 
-			// Currently simple constant ambient light, could use SSAO here
-			glm::vec4 ambientLight(0.1f, 0.1f, 0.1f, 1.0f);
+	void OpenGLSystem::RenderFrame(FrameSnapshot& frame) {
+		PROFILE_SCOPE("RenderFrame");
+		// Reads back the GPU times of a frame a few frames old, never waiting for the GPU.
+		this->gpuTimer.BeginFrame();
+		this->gpuTimer.Begin("Frame");
 
-			GLSLShader &shader = (*this->ambientQuad.GetShader().get());
-			shader.Use();
+		for (auto itr = this->frameCallbacks.begin(); itr != this->frameCallbacks.end(); ++itr) {
+			(*itr)();
+		}
 
-			// Load variables
-			glUniform4f(shader("ambientColor"), ambientLight.r, ambientLight.g, ambientLight.b, ambientLight.a);
-			glUniform1i(shader("colorBuffer"), 0);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[0]);
+		// Copies, the components take non const matrices.
+		glm::mat4 viewMatrix = frame.view;
+		glm::mat4 projectionMatrix = frame.projection;
+		const unsigned int windowWidth = frame.width, windowHeight = frame.height;
+
+		glClearColor(0.0f,0.0f,0.0f,1.0f);
+		glViewport(0, 0, windowWidth, windowHeight); // Set the viewport size to fill the window
+		if (this->leanGBuffer) {
+			// The graph's targets follow the viewport, each pass clears what it draws into and the
+			// back buffer is entirely overwritten by the final copy
+			this->BeginRenderGraph(windowWidth, windowHeight);
+		}
+		else {
+			// Clear the backbuffer and primary depth/stencil buffer
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // Clear required buffers
+		}
 
-			this->ambientQuad.Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
+		this->drawStats = frame.stats;
+		GLState::ResetCounters();
+		this->spriteBatch.ResetCounters();
 
-			shader.UnUse();
+		// Waits for the GPU to release the region written three frames ago, usually long done.
+		this->streamBuffer.BeginFrame();
 
-			// Dynamic light passes
-			// Turn on additive blending
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_ONE, GL_ONE);
+		// Uploads the static meshes of new components and restarts the batch counters
+		this->staticBatch.Update(frame.staticSelection);
+		this->passDrawMark = 0;
 
-			// Loop through each light, render a fullscreen quad if it is visible
-			for(auto eitr = this->_Components.begin(); eitr != this->_Components.end(); ++eitr) {
-				for (auto citr = eitr->second.begin(); citr != eitr->second.end(); ++citr) {
-					// Check if this component is a point light
-					PointLight *light = dynamic_cast<PointLight*>(citr->second.get());
+		// Upload the per frame uniforms
+		this->BindFrameUniforms(frame.uniforms);
 
-					// If it is a point light, and it intersects the frustum, then render
-					if(light && this->GetView(0)->CameraFrustum.intersectsSphere(light->position, light->radius) ) {
+		// Draw the impostors seen from a new side into their atlas cells
+		if (!frame.impostorCaptures.empty()) {
+			this->gpuTimer.Begin("Impostors");
+			this->RenderImpostorCaptures(frame, viewMatrix, projectionMatrix);
+			this->gpuTimer.End();
+		}
+		this->EndStatsPass(STATS_PASS_IMPOSTORS, frame);
 
-						GLSLShader &shader = (*this->pointQuad.GetShader().get());
-						shader.Use();
+		//////////////////
+		// GBuffer Pass //
+		//////////////////
 
-						// Load variables
-						glUniform3fv(shader("viewPosW"), 1, &viewPosition[0]);
-						glUniformMatrix4fv(shader("viewProjInverse"), 1, false, &viewProjInv[0][0]);
-						glUniform3fv(shader("lightPosW"), 1, &light->position[0]);
-						glUniform1f(shader("lightRadius"), light->radius);
-						glUniform4fv(shader("lightColor"), 1, &light->color[0]);
+		this->gpuTimer.Begin("GBuffer");
 
-						glUniform1i(shader("diffuseBuffer"), 0);
-						glUniform1i(shader("normalBuffer"), 1);
-						glUniform1i(shader("depthBuffer"), 2);
+		// Disable blending
+		GLState::SetBlend(false);
 
-						// Bind GBuffer textures
-						glActiveTexture(GL_TEXTURE0);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[0]);
-						glActiveTexture(GL_TEXTURE1);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[1]);
-						glActiveTexture(GL_TEXTURE2);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[2]);
+		if (this->leanGBuffer) {
+			this->BeginRenderPass(this->leanGraph.gbuffer);
+		}
+		else if(this->renderTargets.size() > 0) {
+			// Bind the first buffer, which is the Geometry Buffer
+			this->renderTargets[0]->BindWrite();
 
-						this->pointQuad.Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
+			// Clear the GBuffer
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // Clear required buffers
+		}
 
-						shader.UnUse();
+		// Draw the lit components, the static ones first as they are usually the large occluders.
+		this->staticBatch.Draw(PASS_GBUFFER);
+		frame.queue.Submit(PASS_GBUFFER, viewMatrix, projectionMatrix);
 
-						continue;
-					}
+		// Billboards of the far lit components, their albedo and normals come from the atlas
+		if (!frame.impostors.empty()) {
+			GLState::ActiveTexture(GL_TEXTURE1);
+			GLState::BindTexture(GL_TEXTURE_2D, this->impostorAtlas.Normal());
+			this->spriteBatch.Draw(frame.impostors, projectionMatrix * viewMatrix, false, &this->impostorAtlas.GetShader());
+		}
 
-					SpotLight *spotLight = dynamic_cast<SpotLight *>(citr->second.get());
+		this->gpuTimer.End();
+		this->EndStatsPass(STATS_PASS_GBUFFER, frame);
 
-					if(spotLight && spotLight->IsEnabled()) {
-						GLSLShader &shader = (*this->spotQuad.GetShader().get());
-						shader.Use();
+		if (this->leanGBuffer) {
+			// The rest of the frame draws into the light target
+			this->BeginRenderPass(this->leanGraph.lighting);
+		}
+		else {
+			// Copy gbuffer's depth buffer to the screen depth buffer
+			// needed for non deferred rendering at the end of this method
+			if(this->renderTargets.size() > 0) {
+				this->renderTargets[0]->UnbindWrite();
+				this->renderTargets[0]->BindRead();
+			}
 
-						glm::vec3 position = spotLight->transform.ExtractPosition();
-						glm::vec3 direction = spotLight->transform.GetForward();
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
-						// Load variables
-						glUniform3fv(shader("viewPosW"), 1, &viewPosition[0]);
-						glUniformMatrix4fv(shader("viewProjInverse"), 1, false, &viewProjInv[0][0]);
-						glUniform3fv(shader("lightPosW"), 1, &position[0]);
-						glUniform3fv(shader("lightDirW"), 1, &direction[0]);
-						glUniform4fv(shader("lightColor"), 1, &spotLight->color[0]);
-						glUniform1f(shader("lightCosInnerAngle"), spotLight->cosInnerAngle);
-						glUniform1f(shader("lightCosOuterAngle"), spotLight->cosOuterAngle);
+			if(this->renderTargets.size() > 0) {
+				this->renderTargets[0]->UnbindRead();
+			}
+		}
 
-						glUniform1i(shader("diffuseBuffer"), 0);
-						glUniform1i(shader("normalBuffer"), 1);
-						glUniform1i(shader("depthBuffer"), 2);
+		///////////////////
+		// Lighting Pass //
+		///////////////////
+
+		// Disable depth testing, the lighting only reads the GBuffer depth
+		GLState::SetDepthTest(false);
+		GLState::SetDepthMask(false);
+		GLuint gbufferAlbedo, gbufferNormal, gbufferDepth;
+		if (this->leanGBuffer) {
+			gbufferAlbedo = this->GraphTexture(this->leanGraph.albedo);
+			gbufferNormal = this->GraphTexture(this->leanGraph.normal);
+			gbufferDepth = this->GraphTexture(this->leanGraph.depth);
+		}
+		else {
+			gbufferAlbedo = this->renderTargets[0]->texture_ids[0];
+			gbufferNormal = this->renderTargets[0]->texture_ids[1];
+			gbufferDepth = this->renderTargets[0]->texture_ids[2];
 
-						// Bind GBuffer textures
-						glActiveTexture(GL_TEXTURE0);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[0]);
-						glActiveTexture(GL_TEXTURE1);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[1]);
-						glActiveTexture(GL_TEXTURE2);
-						glBindTexture(GL_TEXTURE_2D, this->renderTargets[0]->texture_ids[2]);
+			// Bind the Geometry buffer for reading
+			this->renderTargets[0]->BindRead();
+		}
 
-						this->spotQuad.Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
+		// Ambient light pass
+		this->gpuTimer.Begin("Lighting");
+		this->gpuTimer.Begin("Ambient");
+
+		// Ensure that blending is disabled
+		GLState::SetBlend(false);
+
+		// Currently simple constant ambient light, could use SSAO here
+		glm::vec4 ambientLight(0.1f, 0.1f, 0.1f, 1.0f);
+
+		GLSLShader &shader = (*this->ambientQuad.GetShader().get());
+		shader.Use();
+
+		// Load variables
+		glUniform4f(shader("ambientColor"), ambientLight.r, ambientLight.g, ambientLight.b, ambientLight.a);
+		glUniform1i(shader("colorBuffer"), 0);
+		GLState::ActiveTexture(GL_TEXTURE0);
+		GLState::BindTexture(GL_TEXTURE_2D, gbufferAlbedo);
+
+		this->ambientQuad.Render(&viewMatrix[0][0], &projectionMatrix[0][0]);
+		this->drawStats.drawCalls++;
+
+		shader.UnUse();
+		this->gpuTimer.End();
+
+		// Dynamic light passes
+		// Turn on additive blending
+		GLState::SetBlend(true);
+		GLState::SetBlendFunc(GL_ONE, GL_ONE);
+
+		if (frame.clustered) {
+			// Shade every light touching the cluster of each pixel in one fullscreen pass
+			this->gpuTimer.Begin("Clustered lights");
+			this->drawStats.lights = static_cast<unsigned int>(this->UploadClusteredLights(frame));
+			if (this->drawStats.lights > 0) {
+				GLSLShader &shader = (*this->clusteredQuad.GetShader().get());
+				shader.Use();
+
+				glUniform3i(shader("clusterDims"), LightClusterer::TILES_X, LightClusterer::TILES_Y, LightClusterer::SLICES);
+				glUniform1f(shader("clusterNear"), frame.clusterNear);
+				glUniform1f(shader("clusterScale"), frame.clusterScale);
+
+				glUniform1i(shader("diffuseBuffer"), 0);
+				glUniform1i(shader("normalBuffer"), 1);
+				glUniform1i(shader("depthBuffer"), 2);
+				glUniform1i(shader("clusterBuffer"), 3);
+				glUniform1i(shader("lightIndexBuffer"), 4);
+				glUniform1i(shader("lightBuffer"), 5);
+
+				// Bind GBuffer textures and the cluster buffers
+				GLState::ActiveTexture(GL_TEXTURE0);
+				GLState::BindTexture(GL_TEXTURE_2D, gbufferAlbedo);
+				GLState::ActiveTexture(GL_TEXTURE1);
+				GLState::BindTexture(GL_TEXTURE_2D, gbufferNormal);
+				GLState::ActiveTexture(GL_TEXTURE2);
+				GLState::BindTexture(GL_TEXTURE_2D, gbufferDepth);
+				for (int i = 0; i < 3; ++i) {
+					GLState::ActiveTexture(GL_TEXTURE3 + i);
+					GLState::BindTexture(GL_TEXTURE_BUFFER, this->lightTextures[i]);
+				}
 
-						shader.UnUse();
+				this->clusteredQuad.Render(&viewMatrix[0][0], &projectionMatrix[0][0]);
+				this->drawStats.drawCalls++;
 
-						continue;
-					}
-				}
+				shader.UnUse();
 			}
-
-			// Unbind the Geometry buffer for reading
-			if(this->renderTargets.size() > 0) {
-				this->renderTargets[0]->UnbindRead();
+			this->gpuTimer.End();
+		}
+		else {
+			if (this->leanGBuffer) {
+				this->BeginRenderPass(this->leanGraph.volumes);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, this->passFramebuffers[this->leanGraph.gbuffer]);
+				glBlitFramebuffer(0, 0, this->graphWidth, this->graphHeight, 0, 0, this->graphWidth, this->graphHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 			}
 
-			// Remove blending
-			glDisable(GL_BLEND);
+			// Draw the bounding volume of each light, only the pixels it may reach get shaded
+			GLState::SetDepthTest(true);
+			GLState::SetDepthFunc(GL_GEQUAL);
+			GLState::SetCullFace(GL_FRONT);
+			if (this->depthClampSupported) {
+				glEnable(GL_DEPTH_CLAMP);
+			}
+#ifndef __APPLE__
+			if (this->depthBoundsSupported) {
+				glEnable(GL_DEPTH_BOUNDS_TEST_EXT);
+			}
+#endif
 
-			// Re-enabled depth test
-			glDepthFunc(GL_LESS);
-			glDepthMask(GL_TRUE);
+			// Bind GBuffer textures
+			GLState::ActiveTexture(GL_TEXTURE0);
+			GLState::BindTexture(GL_TEXTURE_2D, gbufferAlbedo);
+			GLState::ActiveTexture(GL_TEXTURE1);
+			GLState::BindTexture(GL_TEXTURE_2D, gbufferNormal);
+			GLState::ActiveTexture(GL_TEXTURE2);
+			GLState::BindTexture(GL_TEXTURE_2D, gbufferDepth);
+
+			// Point lights the scene index found in the frustum
+			this->gpuTimer.Begin("Point lights");
+			GLSLShader &pointShader = this->pointVolumeShader;
+			pointShader.Use();
+			glUniform1i(pointShader("diffuseBuffer"), 0);
+			glUniform1i(pointShader("normalBuffer"), 1);
+			glUniform1i(pointShader("depthBuffer"), 2);
+
+			for (auto litr = frame.lights.begin(); litr != frame.lights.end(); ++litr) {
+				if (litr->spot) {
+					continue;
+				}
 
-			////////////////////
-			// Composite Pass //
-			////////////////////
+				// Load variables
+				glUniform3fv(pointShader("lightPosW"), 1, &litr->position[0]);
+				glUniform1f(pointShader("lightRadius"), litr->radius);
+				glUniform4fv(pointShader("lightColor"), 1, &litr->color[0]);
 
-			// Not needed yet
+				glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), litr->position), glm::vec3(litr->radius));
+				if (this->RenderLightVolume(frame, VOLUME_SPHERE, model, litr->position, litr->radius, pointShader)) {
+					this->drawStats.lights++;
+				}
+			}
 
-			///////////////////////
-			// Draw Unlit Objects
-			///////////////////////
+			pointShader.UnUse();
+			this->gpuTimer.End();
 
-			// Loop through and draw each GL Component component.
-			for (auto eitr = this->_Components.begin(); eitr != this->_Components.end(); ++eitr) {
-				for (auto citr = eitr->second.begin(); citr != eitr->second.end(); ++citr) {
-					IGLComponent *glComp = dynamic_cast<IGLComponent *>(citr->second.get());
+			// Enabled spot lights whose bounding sphere is in the frustum
+			this->gpuTimer.Begin("Spot lights");
+			GLSLShader &spotShader = this->spotVolumeShader;
+			spotShader.Use();
+			glUniform1i(spotShader("diffuseBuffer"), 0);
+			glUniform1i(spotShader("normalBuffer"), 1);
+			glUniform1i(spotShader("depthBuffer"), 2);
 
-					if(glComp && !glComp->IsLightingEnabled()) {
-						glComp->GetShader()->Use();
+			for (auto litr = frame.lights.begin(); litr != frame.lights.end(); ++litr) {
+				if (!litr->spot) {
+					continue;
+				}
+				const glm::vec3 &position = litr->position;
+				const glm::vec3 &direction = litr->direction;
+
+				// Load variables
+				glUniform3fv(spotShader("lightPosW"), 1, &position[0]);
+				glUniform3fv(spotShader("lightDirW"), 1, &direction[0]);
+				glUniform4fv(spotShader("lightColor"), 1, &litr->color[0]);
+				glUniform1f(spotShader("lightCosInnerAngle"), litr->cosInnerAngle);
+				glUniform1f(spotShader("lightCosOuterAngle"), litr->cosOuterAngle);
+
+				// Narrow cones get a cone along the light axis, wide ones their bounding sphere
+				glm::mat4 model;
+				LightVolume volume = VOLUME_SPHERE;
+				if (litr->cosOuterAngle > 0.5f) {
+					const float base = litr->radius * glm::sqrt(1.0f - litr->cosOuterAngle * litr->cosOuterAngle) / litr->cosOuterAngle;
+					glm::vec3 up = glm::abs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+					glm::vec3 right = glm::normalize(glm::cross(direction, up));
+					up = glm::cross(right, direction);
+					model = glm::mat4(glm::vec4(right * base, 0.0f), glm::vec4(up * base, 0.0f), glm::vec4(direction * -litr->radius, 0.0f), glm::vec4(position, 1.0f));
+					volume = VOLUME_CONE;
+				}
+				else {
+					model = glm::scale(glm::translate(glm::mat4(1.0f), litr->center), glm::vec3(litr->boundingRadius));
+				}
+				if (this->RenderLightVolume(frame, volume, model, litr->center, litr->boundingRadius, spotShader)) {
+					this->drawStats.lights++;
+				}
+			}
 
-						// Set view position
-						glUniform3f(glGetUniformBlockIndex(glComp->GetShader()->GetProgram(), "viewPosW"), viewPosition.x, viewPosition.y, viewPosition.z);
+			spotShader.UnUse();
+			this->gpuTimer.End();
 
-						glComp->Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
-					}
-				}
+			// Back to the state of the lighting pass
+			if (this->depthClampSupported) {
+				glDisable(GL_DEPTH_CLAMP);
+			}
+#ifndef __APPLE__
+			if (this->depthBoundsSupported) {
+				glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
 			}
+#endif
+			GLState::SetScissorTest(false);
+			GLState::SetCullFace(GL_BACK);
+			GLState::SetDepthTest(false);
+		}
+
+		// Unbind the Geometry buffer for reading
+		if(!this->leanGBuffer && this->renderTargets.size() > 0) {
+			this->renderTargets[0]->UnbindRead();
+		}
+		this->gpuTimer.End();
+
+		// Remove blending
+		GLState::SetBlend(false);
+
+		// Re-enabled depth test
+		GLState::SetDepthTest(true);
+		GLState::SetDepthFunc(GL_LESS);
+		GLState::SetDepthMask(true);
+		this->EndStatsPass(STATS_PASS_LIGHTING, frame);
+
+		////////////////////
+		// Composite Pass //
+		////////////////////
+
+		// Not needed yet
+
+		///////////////////////
+		// Draw Unlit Objects
+		///////////////////////
+
+		// Unlit components light themselves with full intensity. A second copy of the uniforms
+		// keeps the lit passes' copy untouched while the GPU may still read it.
+		FrameUniforms unlitUniforms = frame.uniforms;
+		unlitUniforms.ambientIntensity = 0.15f;
+		unlitUniforms.diffuseIntensity = 1.0f;
+		unlitUniforms.specularIntensity = 1.0f;
+		this->BindFrameUniforms(unlitUniforms);
+
+		this->gpuTimer.Begin("Unlit");
+		if (this->leanGBuffer) {
+			this->BeginRenderPass(this->leanGraph.unlit);
+		}
+		this->staticBatch.Draw(PASS_UNLIT);
+		frame.queue.Submit(PASS_UNLIT, viewMatrix, projectionMatrix);
+
+		// Sprites in as few draws as their textures allow, depth tested against the scene
+		if (!frame.queue.Sprites().empty()) {
+			GLState::SetBlend(true);
+			GLState::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			this->spriteBatch.Draw(frame.queue.Sprites(), projectionMatrix * viewMatrix, false);
+			GLState::SetBlend(false);
+		}
+		this->gpuTimer.End();
+		this->EndStatsPass(STATS_PASS_UNLIT, frame);
 
-			//////////////////
-			// Overlay Pass //
-			//////////////////
+		//////////////////
+		// Overlay Pass //
+		//////////////////
 
-			// Enable transparent rendering
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// Enable transparent rendering
+		this->gpuTimer.Begin("Overlay");
+		if (this->leanGBuffer) {
+			this->BeginRenderPass(this->leanGraph.overlay);
+		}
+		GLState::SetBlend(true);
+		GLState::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-			for (auto citr = this->screensSpaceComp.begin(); citr != this->screensSpaceComp.end(); ++citr) {
-				citr->get()->GetShader()->Use();
-				citr->get()->Render(&viewMatrix[0][0], &this->ProjectionMatrix[0][0]);
+		// Every screen space quad in one batch, in the order they were created where they overlap
+		this->overlayQuads.resize(this->screensSpaceComp.size());
+		for (size_t i = 0; i < this->screensSpaceComp.size(); ++i) {
+			this->screensSpaceComp[i]->GetSpriteQuad(this->overlayQuads[i]);
+		}
+		if (!this->overlayQuads.empty()) {
+			GLState::SetDepthTest(false);
+			GLState::SetDepthMask(false);
+			this->spriteBatch.Draw(this->overlayQuads, glm::mat4(1.0f), true);
+			GLState::SetDepthTest(true);
+			GLState::SetDepthMask(true);
+		}
+		this->drawStats.objects += static_cast<unsigned int>(this->overlayQuads.size());
+
+		// Remove blending
+		GLState::SetBlend(false);
+		this->gpuTimer.End();
+		this->EndStatsPass(STATS_PASS_OVERLAY, frame);
+
+		if (this->leanGBuffer) {
+			// Present the light target
+			this->BeginRenderPass(this->leanGraph.present);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, this->FindGraphFramebuffer(std::vector<GLuint>(1, this->GraphTexture(this->leanGraph.light)), 0, GL_DEPTH_ATTACHMENT));
+			glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+
+		this->gpuTimer.End();
+
+		// The draws of the batches join the ones counted as they were made
+		const RenderQueueCounters& queueCounters = frame.queue.GetCounters();
+		const GLStateCounters& stateCounters = GLState::GetCounters();
+		this->drawStats.drawCalls = FrameDrawCalls(frame);
+		this->drawStats.triangles += queueCounters.triangles + this->staticBatch.GetCounters().triangles + this->spriteBatch.GetCounters().quads * 2;
+		this->drawStats.shaderChanges += queueCounters.shaderChanges;
+		this->drawStats.instances += queueCounters.instances;
+		this->drawStats.programBinds = stateCounters.programs;
+		this->drawStats.vertexArrayBinds = stateCounters.vertexArrays;
+		this->drawStats.textureBinds = stateCounters.textures;
+		this->drawStats.uniforms = stateCounters.uniforms;
+		this->drawStats.stateCalls = stateCounters.issued;
+		this->drawStats.redundantStateCalls = stateCounters.redundant;
+		this->drawStats.uploadedBytes = stateCounters.uploadedBytes + this->streamBuffer.Used();
+
+		// Fences the region of this frame
+		this->streamBuffer.EndFrame();
+
+		{
+			std::lock_guard<std::mutex> lock(this->frameMutex);
+			this->frameStats = this->drawStats;
+		}
+
+		if (this->statsLogInterval > 0.0) {
+			const double now = Profiler::Now();
+			if (this->statsLogStart < 0.0) {
+				this->statsLogStart = now;
 			}
+			this->statsLogSum.Add(this->drawStats);
+			this->statsLogFrames++;
+			if (now - this->statsLogStart >= this->statsLogInterval * 1000000.0) {
+				LOG << "Render stats per frame over " << this->statsLogFrames << " frames: " << this->statsLogSum.Summary(this->statsLogFrames);
+				this->statsLogSum = RenderStats();
+				this->statsLogFrames = 0;
+				this->statsLogStart = now;
+			}
+		}
 
-			// Remove blending
-			glDisable(GL_BLEND);
+		// Unbind frame buffer
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
 
-			// Unbind frame buffer
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	unsigned int OpenGLSystem::FrameDrawCalls(const FrameSnapshot& frame) const {
+		return this->drawStats.drawCalls + frame.queue.GetCounters().draws + this->staticBatch.GetCounters().draws + this->spriteBatch.GetCounters().draws;
+	}
 
-			this->deltaAccumulator = 0.0;
-			return true;
+	void OpenGLSystem::EndStatsPass(RenderStatsPass pass, const FrameSnapshot& frame) {
+		const unsigned int draws = FrameDrawCalls(frame);
+		this->drawStats.passDrawCalls[pass] = draws - this->passDrawMark;
+		this->passDrawMark = draws;
+	}
+
+	void OpenGLSystem::BindFrameUniforms(const FrameUniforms& uniforms) {
+		size_t offset = 0;
+		void* data = this->streamBuffer.Allocate(sizeof(FrameUniforms), this->uniformAlignment, offset);
+		if (data) {
+			std::memcpy(data, &uniforms, sizeof(FrameUniforms));
+			this->streamBuffer.Flush();
+			glBindBufferRange(GL_UNIFORM_BUFFER, GLSLShader::BLOCK_FRAME, this->streamBuffer.Buffer(), offset, sizeof(FrameUniforms));
+			return;
 		}
-		return false;
+		glBindBuffer(GL_UNIFORM_BUFFER, this->frameUniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &uniforms, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		GLState::CountUpload(sizeof(FrameUniforms));
+		glBindBufferBase(GL_UNIFORM_BUFFER, GLSLShader::BLOCK_FRAME, this->frameUniformBuffer);
 	}
 
 	GLTransform *OpenGLSystem::GetTransformFor(const unsigned int entityID) {
@@ -950,6 +1979,7 @@ namespace Sigma{
 			0.1f, // near culling plane
 			10000.0f // far culling plane
 			);
+		this->lightClusterer.SetProjection(this->ProjectionMatrix);
 
 		// App specific global gl settings
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
@@ -964,49 +1994,48 @@ namespace Sigma{
 		if (GLEW_ARB_multisample) {
 			glEnable(GL_MULTISAMPLE_ARB);
 		}
+		this->depthBoundsSupported = GLEW_EXT_depth_bounds_test != 0;
 #endif
-		glEnable(GL_CULL_FACE);
-		glCullFace(GL_BACK);
-		glEnable(GL_DEPTH_TEST);
-
-		// Setup a screen quad for deferred rendering
-		this->pointQuad.SetSize(1.0f, 1.0f);
-		this->pointQuad.SetPosition(0.0f, 0.0f);
-		this->pointQuad.LoadShader("shaders/pointlight");
-		this->pointQuad.Inverted(true);
-		this->pointQuad.InitializeBuffers();
-		this->pointQuad.SetCullFace("none");
-
-		this->pointQuad.GetShader()->Use();
-		this->pointQuad.GetShader()->AddUniform("viewPosW");
-		this->pointQuad.GetShader()->AddUniform("viewProjInverse");
-		this->pointQuad.GetShader()->AddUniform("lightPosW");
-		this->pointQuad.GetShader()->AddUniform("lightRadius");
-		this->pointQuad.GetShader()->AddUniform("lightColor");
-		this->pointQuad.GetShader()->AddUniform("diffuseBuffer");
-		this->pointQuad.GetShader()->AddUniform("normalBuffer");
-		this->pointQuad.GetShader()->AddUniform("depthBuffer");
-		this->pointQuad.GetShader()->UnUse();
-
-		this->spotQuad.SetSize(1.0f, 1.0f);
-		this->spotQuad.SetPosition(0.0f, 0.0f);
-		this->spotQuad.LoadShader("shaders/spotlight");
-		this->spotQuad.Inverted(true);
-		this->spotQuad.InitializeBuffers();
-		this->spotQuad.SetCullFace("none");
-
-		this->spotQuad.GetShader()->Use();
-		this->spotQuad.GetShader()->AddUniform("viewPosW");
-		this->spotQuad.GetShader()->AddUniform("viewProjInverse");
-		this->spotQuad.GetShader()->AddUniform("lightPosW");
-		this->spotQuad.GetShader()->AddUniform("lightDirW");
-		this->spotQuad.GetShader()->AddUniform("lightColor");
-		this->spotQuad.GetShader()->AddUniform("lightCosInnerAngle");
-		this->spotQuad.GetShader()->AddUniform("lightCosOuterAngle");
-		this->spotQuad.GetShader()->AddUniform("diffuseBuffer");
-		this->spotQuad.GetShader()->AddUniform("normalBuffer");
-		this->spotQuad.GetShader()->AddUniform("depthBuffer");
-		this->spotQuad.GetShader()->UnUse();
+		this->depthClampSupported = OpenGLVersion[0] > 3 || (OpenGLVersion[0] == 3 && OpenGLVersion[1] >= 2);
+		GLState::Invalidate();
+		GLState::SetCullFace(GL_BACK);
+		GLState::SetDepthTest(true);
+		GLState::SetDepthFunc(GL_LESS);
+
+		// The per frame uniform block shared by every shader
+		glGenBuffers(1, &this->frameUniformBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->frameUniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		// The instances and uniforms of a frame, 4 MB holds about 50000 instances.
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &this->uniformAlignment);
+		this->uniformAlignment = std::max(this->uniformAlignment, 16);
+		if (this->streamBuffer.Create(4 * 1024 * 1024)) {
+			for (unsigned int i = 0; i < 2; ++i) {
+				this->frames[i].queue.SetStreamBuffer(&this->streamBuffer);
+			}
+			this->spriteBatch.SetStreamBuffer(&this->streamBuffer);
+			LOG << "Streaming per frame data through a " << (this->streamBuffer.IsPersistent() ? "persistently mapped" : "orphaned") << " ring buffer";
+		}
+
+		if (!this->gpuTimer.Create()) {
+			LOG_WARN << "Timer queries are not supported, the profiler will only show CPU times.";
+		}
+
+		if (!this->staticBatch.Create()) {
+			LOG << "Multi draw indirect is not supported, static meshes are drawn with glMultiDrawElements.";
+		}
+
+		this->spriteBatch.Create();
+
+		if (this->impostorAtlas.Create(IMPOSTOR_ATLAS_SIZE)) {
+			this->impostorCache.Resize(IMPOSTOR_ATLAS_SIZE, IMPOSTOR_CELL_SIZE);
+			this->impostorCache.SetCaptureBudget(IMPOSTOR_CAPTURES_PER_FRAME);
+		}
+
+		// Setup the light volumes and a screen quad for deferred rendering
+		this->CreateLightVolumes();
 
 		this->ambientQuad.SetSize(1.0f, 1.0f);
 		this->ambientQuad.SetPosition(0.0f, 0.0f);
@@ -1020,9 +2049,229 @@ namespace Sigma{
 		this->ambientQuad.GetShader()->AddUniform("colorBuffer");
 		this->ambientQuad.GetShader()->UnUse();
 
+		this->clusteredQuad.SetSize(1.0f, 1.0f);
+		this->clusteredQuad.SetPosition(0.0f, 0.0f);
+		this->clusteredQuad.LoadShader("shaders/clusteredlight");
+		this->clusteredQuad.Inverted(true);
+		this->clusteredQuad.InitializeBuffers();
+		this->clusteredQuad.SetCullFace("none");
+
+		this->clusteredQuad.GetShader()->Use();
+		this->clusteredQuad.GetShader()->AddUniform("clusterDims");
+		this->clusteredQuad.GetShader()->AddUniform("clusterNear");
+		this->clusteredQuad.GetShader()->AddUniform("clusterScale");
+		this->clusteredQuad.GetShader()->AddUniform("clusterBuffer");
+		this->clusteredQuad.GetShader()->AddUniform("lightIndexBuffer");
+		this->clusteredQuad.GetShader()->AddUniform("lightBuffer");
+		this->clusteredQuad.GetShader()->AddUniform("diffuseBuffer");
+		this->clusteredQuad.GetShader()->AddUniform("normalBuffer");
+		this->clusteredQuad.GetShader()->AddUniform("depthBuffer");
+		this->clusteredQuad.GetShader()->UnUse();
+
+		// Buffer textures holding the light clusters, see UploadClusteredLights
+		const GLenum lightFormats[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+		glGenBuffers(3, this->lightBuffers);
+		glGenTextures(3, this->lightTextures);
+		for (int i = 0; i < 3; ++i) {
+			glBindBuffer(GL_TEXTURE_BUFFER, this->lightBuffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+			GLState::BindTexture(GL_TEXTURE_BUFFER, this->lightTextures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, lightFormats[i], this->lightBuffers[i]);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
 		return OpenGLVersion;
 	}
 
+	void OpenGLSystem::CreateLightVolumes() {
+		const int SEGMENTS = 16; // Around the sphere and the cone.
+		const int STACKS = 8; // From pole to pole of the sphere.
+		const float PI = 3.14159265f;
+
+		// The flat faces are pushed out until they hold the curved surface.
+		const float ringScale = 1.0f / glm::cos(PI / SEGMENTS);
+		const float sphereScale = ringScale / glm::cos(PI / STACKS);
+
+		std::vector<glm::vec3> vertices[2];
+		std::vector<GLushort> indices[2];
+
+		// Sphere, rings of SEGMENTS vertices from the top pole to the bottom pole
+		for (int stack = 0; stack <= STACKS; ++stack) {
+			const float phi = PI * stack / STACKS;
+			for (int segment = 0; segment < SEGMENTS; ++segment) {
+				const float theta = 2.0f * PI * segment / SEGMENTS;
+				vertices[VOLUME_SPHERE].push_back(sphereScale * glm::vec3(glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta)));
+			}
+		}
+		for (int stack = 0; stack < STACKS; ++stack) {
+			for (int segment = 0; segment < SEGMENTS; ++segment) {
+				const GLushort a = static_cast<GLushort>(stack * SEGMENTS + segment);
+				const GLushort b = static_cast<GLushort>(stack * SEGMENTS + (segment + 1) % SEGMENTS);
+				const GLushort c = static_cast<GLushort>(a + SEGMENTS);
+				const GLushort d = static_cast<GLushort>(b + SEGMENTS);
+				const GLushort quad[6] = { a, b, c, b, d, c };
+				indices[VOLUME_SPHERE].insert(indices[VOLUME_SPHERE].end(), quad, quad + 6);
+			}
+		}
+
+		// Cone, the apex, the base center then the base ring
+		vertices[VOLUME_CONE].push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+		vertices[VOLUME_CONE].push_back(glm::vec3(0.0f, 0.0f, -1.0f));
+		for (int segment = 0; segment < SEGMENTS; ++segment) {
+			const float theta = 2.0f * PI * segment / SEGMENTS;
+			vertices[VOLUME_CONE].push_back(glm::vec3(ringScale * glm::cos(theta), ringScale * glm::sin(theta), -1.0f));
+		}
+		for (int segment = 0; segment < SEGMENTS; ++segment) {
+			const GLushort a = static_cast<GLushort>(2 + segment);
+			const GLushort b = static_cast<GLushort>(2 + (segment + 1) % SEGMENTS);
+			const GLushort faces[6] = { 0, a, b, 1, b, a };
+			indices[VOLUME_CONE].insert(indices[VOLUME_CONE].end(), faces, faces + 6);
+		}
+
+		glGenVertexArrays(2, this->volumeVAOs);
+		glGenBuffers(4, this->volumeBuffers);
+		for (int volume = 0; volume < 2; ++volume) {
+			GLState::BindVertexArray(this->volumeVAOs[volume]);
+			glBindBuffer(GL_ARRAY_BUFFER, this->volumeBuffers[volume * 2]);
+			glBufferData(GL_ARRAY_BUFFER, vertices[volume].size() * sizeof(glm::vec3), &vertices[volume][0], GL_STATIC_DRAW);
+			glVertexAttribPointer(GLSLShader::ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+			glEnableVertexAttribArray(GLSLShader::ATTRIB_POSITION);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->volumeBuffers[volume * 2 + 1]);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices[volume].size() * sizeof(GLushort), &indices[volume][0], GL_STATIC_DRAW);
+			this->volumeIndexCounts[volume] = static_cast<GLsizei>(indices[volume].size());
+		}
+		GLState::BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// The light shaders read the GBuffer at the window position of the volume fragments
+		this->pointVolumeShader.LoadFromFile(GL_VERTEX_SHADER, "shaders/lightvolume.vert");
+		this->pointVolumeShader.LoadFromFile(GL_FRAGMENT_SHADER, "shaders/pointlight.frag");
+		this->pointVolumeShader.CreateAndLinkProgram();
+		this->pointVolumeShader.Use();
+		this->pointVolumeShader.AddUniform("volumeModel");
+		this->pointVolumeShader.AddUniform("lightPosW");
+		this->pointVolumeShader.AddUniform("lightRadius");
+		this->pointVolumeShader.AddUniform("lightColor");
+		this->pointVolumeShader.AddUniform("diffuseBuffer");
+		this->pointVolumeShader.AddUniform("normalBuffer");
+		this->pointVolumeShader.AddUniform("depthBuffer");
+		this->pointVolumeShader.UnUse();
+
+		this->spotVolumeShader.LoadFromFile(GL_VERTEX_SHADER, "shaders/lightvolume.vert");
+		this->spotVolumeShader.LoadFromFile(GL_FRAGMENT_SHADER, "shaders/spotlight.frag");
+		this->spotVolumeShader.CreateAndLinkProgram();
+		this->spotVolumeShader.Use();
+		this->spotVolumeShader.AddUniform("volumeModel");
+		this->spotVolumeShader.AddUniform("lightPosW");
+		this->spotVolumeShader.AddUniform("lightDirW");
+		this->spotVolumeShader.AddUniform("lightColor");
+		this->spotVolumeShader.AddUniform("lightCosInnerAngle");
+		this->spotVolumeShader.AddUniform("lightCosOuterAngle");
+		this->spotVolumeShader.AddUniform("diffuseBuffer");
+		this->spotVolumeShader.AddUniform("normalBuffer");
+		this->spotVolumeShader.AddUniform("depthBuffer");
+		this->spotVolumeShader.UnUse();
+	}
+
+	bool OpenGLSystem::RenderLightVolume(const FrameSnapshot& frame, LightVolume volume, const glm::mat4& model, const glm::vec3& center, float radius, GLSLShader& shader) {
+		const glm::vec3 viewCenter(frame.view * glm::vec4(center, 1.0f));
+		const float nearDepth = -viewCenter.z - radius;
+		const float farDepth = -viewCenter.z + radius;
+
+		if (nearDepth > frame.clusterNear) {
+			// In front of the camera, clip to the projected corners of the box around the sphere
+			float minimumX = 1.0f, minimumY = 1.0f, maximumX = -1.0f, maximumY = -1.0f;
+			for (int i = 0; i < 8; ++i) {
+				glm::vec4 corner = frame.projection * glm::vec4(viewCenter.x + ((i & 1) ? radius : -radius),
+					viewCenter.y + ((i & 2) ? radius : -radius), viewCenter.z + ((i & 4) ? radius : -radius), 1.0f);
+				minimumX = std::min(minimumX, corner.x / corner.w);
+				minimumY = std::min(minimumY, corner.y / corner.w);
+				maximumX = std::max(maximumX, corner.x / corner.w);
+				maximumY = std::max(maximumY, corner.y / corner.w);
+			}
+			// Normalized device coordinates to whole pixels
+			const GLint x = static_cast<GLint>(std::floor(glm::clamp(minimumX * 0.5f + 0.5f, 0.0f, 1.0f) * frame.width));
+			const GLint y = static_cast<GLint>(std::floor(glm::clamp(minimumY * 0.5f + 0.5f, 0.0f, 1.0f) * frame.height));
+			const GLsizei width = static_cast<GLsizei>(std::ceil(glm::clamp(maximumX * 0.5f + 0.5f, 0.0f, 1.0f) * frame.width)) - x;
+			const GLsizei height = static_cast<GLsizei>(std::ceil(glm::clamp(maximumY * 0.5f + 0.5f, 0.0f, 1.0f) * frame.height)) - y;
+			if (width <= 0 || height <= 0) {
+				return false;
+			}
+			glScissor(x, y, width, height);
+			GLState::SetScissorTest(true);
+		}
+		else {
+			// The camera is inside or next to the sphere, it may cover the whole window
+			GLState::SetScissorTest(false);
+		}
+#ifndef __APPLE__
+		if (this->depthBoundsSupported) {
+			const float nearBound = nearDepth > frame.clusterNear ? WindowDepth(frame.projection, nearDepth) : 0.0f;
+			glDepthBoundsEXT(nearBound, WindowDepth(frame.projection, farDepth));
+		}
+#endif
+
+		glUniformMatrix4fv(shader("volumeModel"), 1, GL_FALSE, &model[0][0]);
+		GLState::BindVertexArray(this->volumeVAOs[volume]);
+		glDrawElements(GL_TRIANGLES, this->volumeIndexCounts[volume], GL_UNSIGNED_SHORT, 0);
+		this->drawStats.drawCalls++;
+		return true;
+	}
+
+	void OpenGLSystem::BinClusteredLights(FrameSnapshot& frame) {
+		this->lightClusterer.Clear();
+		frame.lightData.clear();
+		frame.clusterScale = this->lightClusterer.SliceScale();
+
+		for (auto litr = frame.lights.begin(); litr != frame.lights.end(); ++litr) {
+			const glm::vec3 viewPosition(frame.view * glm::vec4(litr->position, 1.0f));
+			if (litr->spot) {
+				this->lightClusterer.AddSpotLight(viewPosition, glm::normalize(glm::vec3(frame.view * glm::vec4(litr->direction, 0.0f))), litr->radius, litr->cosOuterAngle);
+				frame.lightData.push_back(glm::vec4(litr->position, litr->radius));
+				frame.lightData.push_back(litr->color);
+				frame.lightData.push_back(glm::vec4(litr->direction, litr->cosOuterAngle));
+				frame.lightData.push_back(glm::vec4(litr->cosInnerAngle, 1.0f, 0.0f, 0.0f));
+			}
+			else {
+				this->lightClusterer.AddPointLight(viewPosition, litr->radius);
+				frame.lightData.push_back(glm::vec4(litr->position, litr->radius));
+				frame.lightData.push_back(litr->color);
+				frame.lightData.push_back(glm::vec4(0.0f));
+				frame.lightData.push_back(glm::vec4(0.0f));
+			}
+		}
+
+		if (this->lightClusterer.Size() == 0) {
+			frame.clusters.clear();
+			frame.lightIndices.clear();
+			return;
+		}
+		this->lightClusterer.Bin();
+		frame.clusters = this->lightClusterer.Clusters();
+		frame.lightIndices = this->lightClusterer.Indices();
+	}
+
+	size_t OpenGLSystem::UploadClusteredLights(const FrameSnapshot& frame) {
+		if (frame.lightData.empty()) {
+			return 0;
+		}
+
+		// Orphan and refill the buffers, the lists may be empty but the buffers may not.
+		const std::vector<unsigned int> &clusters = frame.clusters;
+		const std::vector<unsigned int> &indices = frame.lightIndices;
+		const unsigned int none = 0;
+		glBindBuffer(GL_TEXTURE_BUFFER, this->lightBuffers[0]);
+		glBufferData(GL_TEXTURE_BUFFER, clusters.size() * sizeof(unsigned int), &clusters[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->lightBuffers[1]);
+		glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(indices.size(), 1) * sizeof(unsigned int), indices.empty() ? &none : &indices[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, this->lightBuffers[2]);
+		glBufferData(GL_TEXTURE_BUFFER, frame.lightData.size() * sizeof(glm::vec4), &frame.lightData[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		GLState::CountUpload((clusters.size() + std::max<size_t>(indices.size(), 1)) * sizeof(unsigned int) + frame.lightData.size() * sizeof(glm::vec4));
+
+		return frame.lightData.size() / 4;
+	}
+
 	void OpenGLSystem::SetViewportSize(const unsigned int width, const unsigned int height) {
 		this->windowHeight = height;
 		this->windowWidth = width;
@@ -1040,6 +2289,7 @@ namespace Sigma{
 			0.1f,
 			10000.0f
 			);
+		this->lightClusterer.SetProjection(this->ProjectionMatrix);
 	}
 
 } // namespace Sigma
@@ -0,0 +1,291 @@
+#include "systems/RenderQueue.h"
+#include "systems/GLSLShader.h"
+#include "systems/GLState.h"
+#include "systems/GLRingBuffer.h"
+#include "IGLComponent.h"
+
+#include <algorithm>
+
+namespace Sigma {
+	namespace {
+		bool EntryBefore(const SortEntry& entry, uint64_t key) {
+			return entry.key < key;
+		}
+
+		// Materials are per mesh, so instances of different entities compare by content.
+		bool SameMaterial(const Material* a, const Material* b) {
+			if (a == b) {
+				return true;
+			}
+			return a && b && a->ambientMap == b->ambientMap && a->diffuseMap == b->diffuseMap && a->hardness == b->hardness;
+		}
+
+		bool InstancingSupported() {
+#ifdef __APPLE__
+			return true;
+#else
+			return GLEW_VERSION_3_3 != 0;
+#endif
+		}
+	}
+
+	RenderQueue::~RenderQueue() {
+		if (this->instanceBuffer != 0) {
+			glDeleteBuffers(1, &this->instanceBuffer);
+		}
+	}
+
+	unsigned int RenderQueue::MaterialKey(const Material* material) {
+		if (!material) {
+			return 0;
+		}
+		// Only the textures matter for the state changes, collisions just cost an extra bind.
+		unsigned int key = (material->diffuseMap * 257u) ^ (material->ambientMap * 31u);
+		return ((key ^ (key >> 16)) & 0xFFFF) | 1;
+	}
+
+	void RenderQueue::BuildMaterialBuffer(Material& material) {
+		// std140 layout of the MaterialData block.
+		struct MaterialUniforms {
+			float specularHardness;
+			GLint diffuseTexEnabled;
+			GLint ambientTexEnabled;
+			GLint texEnabled;
+		} uniforms;
+		uniforms.specularHardness = material.hardness;
+		uniforms.diffuseTexEnabled = (material.diffuseMap != 0) ? 1 : 0;
+		uniforms.ambientTexEnabled = (material.ambientMap != 0) ? 1 : 0;
+		uniforms.texEnabled = (uniforms.diffuseTexEnabled || uniforms.ambientTexEnabled) ? 1 : 0;
+
+		if (material.uniformBuffer == 0) {
+			glGenBuffers(1, &material.uniformBuffer);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, material.uniformBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms), &uniforms, GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void RenderQueue::ApplyMaterial(const Material* material) {
+		// Untextured draws use a material with every map disabled.
+		static Material untextured;
+		if (!material) {
+			if (untextured.uniformBuffer == 0) {
+				BuildMaterialBuffer(untextured);
+			}
+			material = &untextured;
+		}
+		else if (material->ambientMap) {
+			GLState::ActiveTexture(GL_TEXTURE1);
+			GLState::BindTexture(GL_TEXTURE_2D, material->ambientMap);
+		}
+		if (material->diffuseMap) {
+			GLState::ActiveTexture(GL_TEXTURE0);
+			GLState::BindTexture(GL_TEXTURE_2D, material->diffuseMap);
+		}
+		GLState::ActiveTexture(GL_TEXTURE0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, GLSLShader::BLOCK_MATERIAL, material->uniformBuffer);
+	}
+
+	void RenderQueue::Clear() {
+		this->packets.clear();
+		this->order.clear();
+		this->instances.clear();
+		this->sprites.clear();
+		this->counters = RenderQueueCounters();
+	}
+
+	RenderQueueOffsets RenderQueue::Offsets() const {
+		RenderQueueOffsets sizes;
+		sizes.packets = this->packets.size();
+		sizes.instances = this->instances.size();
+		sizes.sprites = this->sprites.size();
+		return sizes;
+	}
+
+	void RenderQueue::Resize(const RenderQueueOffsets& sizes) {
+		this->packets.resize(sizes.packets);
+		this->order.resize(sizes.packets);
+		this->instances.resize(sizes.instances);
+		this->sprites.resize(sizes.sprites);
+	}
+
+	void RenderQueue::AppendAt(const RenderQueue& other, const RenderQueueOffsets& at) {
+		const unsigned int packetBase = static_cast<unsigned int>(at.packets);
+		const unsigned int instanceBase = static_cast<unsigned int>(at.instances);
+		for (size_t i = 0; i < other.packets.size(); ++i) {
+			DrawPacket &packet = this->packets[at.packets + i];
+			packet = other.packets[i];
+			packet.matrix += instanceBase;
+		}
+		for (size_t i = 0; i < other.order.size(); ++i) {
+			SortEntry entry = { other.order[i].key, other.order[i].index + packetBase };
+			this->order[at.packets + i] = entry;
+		}
+		std::copy(other.instances.begin(), other.instances.end(), this->instances.begin() + at.instances);
+		std::copy(other.sprites.begin(), other.sprites.end(), this->sprites.begin() + at.sprites);
+	}
+
+	size_t RenderQueue::InstanceRun(size_t first, size_t last) const {
+		const DrawPacket& packet = this->packets[this->order[first].index];
+		if (packet.component || !packet.instancedShader || packet.geometry == 0) {
+			return first + 1;
+		}
+		size_t end = first + 1;
+		for (; end < last; ++end) {
+			const DrawPacket& next = this->packets[this->order[end].index];
+			if (next.component || next.instancedShader != packet.instancedShader || next.geometry != packet.geometry ||
+				next.offset != packet.offset || next.count != packet.count || next.mode != packet.mode ||
+				next.cullFace != packet.cullFace || !SameMaterial(next.material, packet.material)) {
+				break;
+			}
+		}
+		return end;
+	}
+
+	void RenderQueue::BindInstanceAttributes(size_t firstInstance) {
+		glBindBuffer(GL_ARRAY_BUFFER, this->instanceSource);
+		const size_t base = this->instanceOffset + firstInstance * sizeof(InstanceData);
+		for (GLuint column = 0; column < 4; ++column) {
+			const GLuint location = GLSLShader::ATTRIB_INSTANCE_MODEL + column;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(base + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+		}
+		glEnableVertexAttribArray(GLSLShader::ATTRIB_INSTANCE_COLOR);
+		glVertexAttribPointer(GLSLShader::ATTRIB_INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(base + sizeof(glm::mat4)));
+		glVertexAttribDivisor(GLSLShader::ATTRIB_INSTANCE_COLOR, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	unsigned int RenderQueue::Submit(unsigned int pass, const glm::mat4& view, const glm::mat4& proj, const ShaderSetup& setup) {
+		// The packets are sorted, so the pass is a contiguous run of the order.
+		auto first = std::lower_bound(this->order.begin(), this->order.end(), MakeKey(pass, 0, 0, 0, 0.0f), EntryBefore);
+		auto last = std::lower_bound(first, this->order.end(), MakeKey(pass + 1, 0, 0, 0, 0.0f), EntryBefore);
+		if (pass >= 0xF) {
+			last = this->order.end();
+		}
+
+		// Find the runs that can be merged and upload their instances in one go.
+		const size_t begin = first - this->order.begin(), end = last - this->order.begin();
+		this->batches.clear();
+		this->instanceStaging.clear();
+		this->instanceSource = 0;
+		if (InstancingSupported()) {
+			for (size_t position = begin; position < end; ) {
+				size_t runEnd = InstanceRun(position, end);
+				if (runEnd - position > 1) {
+					InstanceBatch batch = { position, runEnd, this->instanceStaging.size() };
+					this->batches.push_back(batch);
+					for (size_t i = position; i < runEnd; ++i) {
+						this->instanceStaging.push_back(this->instances[this->packets[this->order[i].index].matrix]);
+					}
+				}
+				position = runEnd;
+			}
+		}
+		if (!this->instanceStaging.empty()) {
+			const size_t bytes = sizeof(InstanceData) * this->instanceStaging.size();
+			void* stream = nullptr;
+			if (this->streamBuffer) {
+				stream = this->streamBuffer->Allocate(bytes, sizeof(glm::vec4), this->instanceOffset);
+			}
+			if (stream) {
+				std::memcpy(stream, &this->instanceStaging.front(), bytes);
+				this->streamBuffer->Flush();
+				this->instanceSource = this->streamBuffer->Buffer();
+			}
+		}
+		if (!this->instanceStaging.empty() && this->instanceSource == 0) {
+			if (this->instanceBuffer == 0) {
+				glGenBuffers(1, &this->instanceBuffer);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, this->instanceBuffer);
+			this->instanceCapacity = std::max(this->instanceCapacity, this->instanceStaging.size());
+			// Orphan the old storage so the draws of the previous pass do not stall the upload.
+			glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * this->instanceCapacity, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * this->instanceStaging.size(), &this->instanceStaging.front());
+			GLState::CountUpload(sizeof(InstanceData) * this->instanceStaging.size());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			this->instanceSource = this->instanceBuffer;
+			this->instanceOffset = 0;
+		}
+
+		glm::mat4 viewMatrix = view;
+		glm::mat4 projMatrix = proj;
+
+		// The state set by the previous packet. VAO and face culling are filtered by GLState.
+		GLSLShader* currentShader = nullptr;
+		const Material* currentMaterial = nullptr;
+		bool materialValid = false;
+		unsigned int currentMatrix = ~0u;
+
+		auto nextBatch = this->batches.begin();
+		for (size_t position = begin; position < end; ++position) {
+			const DrawPacket& packet = this->packets[this->order[position].index];
+			const bool instanced = (nextBatch != this->batches.end() && nextBatch->first == position);
+			GLSLShader* shader = instanced ? packet.instancedShader : packet.shader;
+
+			if (shader != currentShader && shader) {
+				shader->Use();
+				if (setup) {
+					setup(*shader);
+				}
+				currentShader = shader;
+				materialValid = false;
+				currentMatrix = ~0u;
+				this->counters.shaderChanges++;
+			}
+
+			if (packet.component) {
+				// Components with their own Render may bind other textures and uniforms.
+				packet.component->SetRenderMatrix(this->instances[packet.matrix].model);
+				packet.component->SetRenderLOD(packet.lod);
+				packet.component->Render(&viewMatrix[0][0], &projMatrix[0][0]);
+				this->counters.draws++;
+				this->counters.triangles += packet.count / 3;
+				currentShader = nullptr;
+				materialValid = false;
+				continue;
+			}
+
+			GLState::BindVertexArray(packet.vao);
+			GLState::SetCullFace(packet.cullFace);
+
+			if (!materialValid || !SameMaterial(packet.material, currentMaterial)) {
+				ApplyMaterial(packet.material);
+				currentMaterial = packet.material;
+				materialValid = true;
+				this->counters.materialChanges++;
+			}
+
+			if (instanced) {
+				const GLsizei instanceCount = static_cast<GLsizei>(nextBatch->last - nextBatch->first);
+				BindInstanceAttributes(nextBatch->firstInstance);
+				glDrawElementsInstanced(packet.mode, packet.count, packet.indexType, reinterpret_cast<void*>(packet.offset), instanceCount);
+				this->counters.draws++;
+				this->counters.instancedDraws++;
+				this->counters.instances += instanceCount;
+				this->counters.triangles += packet.count / 3 * instanceCount;
+				position = nextBatch->last - 1;
+				++nextBatch;
+				continue;
+			}
+
+			// Push only keeps packets with a shader, currentShader is set
+			if (packet.matrix != currentMatrix) {
+				glUniformMatrix4fv((*currentShader)("in_Model"), 1, GL_FALSE, &this->instances[packet.matrix].model[0][0]);
+				currentMatrix = packet.matrix;
+			}
+
+			glDrawElements(packet.mode, packet.count, packet.indexType, reinterpret_cast<void*>(packet.offset));
+			this->counters.draws++;
+			this->counters.triangles += packet.count / 3;
+		}
+
+		// The screen space passes expect back face culling. Bindings are left as they are,
+		// the next pass rebinds what it needs and GLState skips what is already bound.
+		GLState::SetCullFace(GL_BACK);
+
+		return static_cast<unsigned int>(last - first);
+	}
+} // namespace Sigma
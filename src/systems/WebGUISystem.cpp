@@ -39,6 +39,14 @@ namespace Sigma {
 		return true;
 	}
 
+	void WebGUISystem::UploadTextures() {
+		for (auto eitr = this->_Components.begin(); eitr != this->_Components.end(); ++eitr) {
+			for (auto citr = eitr->second.begin(); citr != eitr->second.end(); ++citr) {
+				citr->second->UploadPaint();
+			}
+		}
+	}
+
 	IComponent* WebGUISystem::createWebGUIView(const id_t entityID, const std::vector<Property> &properties) {
 		float x, y, width, height;
 		bool transparent = false;
@@ -0,0 +1,75 @@
+#include "Log.h"
+#include "tests/tests/TestHelpers.h"
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+// Measures how many bounding spheres per second the frustum culler tests, comparing the
+// one sphere at a time reference, the SIMD batch on one thread and the threaded batch.
+
+namespace {
+	using TestHelpers::RandomFloat;
+
+	// glOrtho(-100, 100, -100, 100, 1, 1000)
+	void BenchmarkPlanes(glm::vec4 planes[6]) {
+		glm::mat4 ortho(1.0f);
+		ortho[0] = glm::vec4(0.01f, 0.0f, 0.0f, 0.0f);
+		ortho[1] = glm::vec4(0.0f, 0.01f, 0.0f, 0.0f);
+		ortho[2] = glm::vec4(0.0f, 0.0f, -2.0f / 999.0f, 0.0f);
+		ortho[3] = glm::vec4(0.0f, 0.0f, -1001.0f / 999.0f, 1.0f);
+		Sigma::FrustumCuller::ExtractPlanes(ortho, planes);
+	}
+
+	template<typename Function>
+	double MillisecondsPerRun(int runs, Function function) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < runs; ++i) {
+			function();
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / runs;
+	}
+}
+
+int main() {
+	Log::Print::Init();
+
+	glm::vec4 planes[6];
+	BenchmarkPlanes(planes);
+
+	const size_t sizes[] = { 1000, 10000, 100000, 1000000 };
+	for (size_t size : sizes) {
+		std::srand(1);
+		Sigma::FrustumCuller culler;
+		std::vector<glm::vec4> spheres;
+		for (size_t i = 0; i < size; ++i) {
+			glm::vec4 sphere(RandomFloat(-200.0f, 200.0f), RandomFloat(-200.0f, 200.0f), RandomFloat(-1200.0f, 200.0f), RandomFloat(0.5f, 10.0f));
+			spheres.push_back(sphere);
+			culler.Add(glm::vec3(sphere.x, sphere.y, sphere.z), sphere.w);
+		}
+		const int runs = static_cast<int>(std::max<size_t>(10, 20000000 / size));
+		std::vector<unsigned char> visible(size);
+		size_t count = 0;
+
+		double reference = MillisecondsPerRun(runs, [&]() {
+			count = 0;
+			for (size_t i = 0; i < size; ++i) {
+				visible[i] = Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(spheres[i].x, spheres[i].y, spheres[i].z), spheres[i].w) ? 1 : 0;
+				count += visible[i];
+			}
+		});
+
+		culler.SetThreadCount(1);
+		double batched = MillisecondsPerRun(runs, [&]() { count = culler.Cull(planes, visible); });
+
+		culler.SetThreadCount(0);
+		double threaded = MillisecondsPerRun(runs, [&]() { count = culler.Cull(planes, visible); });
+
+		LOG << size << " spheres, " << count << " visible: reference " << reference << " ms, batched " << batched
+			<< " ms, threaded " << threaded << " ms (" << size / threaded / 1000.0 << " M spheres/s)";
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "Log.h"
+#include "tests/tests/TestHelpers.h"
+#include "IGLComponent.h"
+#include "systems/DrawListBuilder.h"
+#include "systems/RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+// Measures how long building and sorting the draw list of a 50k object scene takes with
+// DrawListBuilder on 1 to 8 threads, the merge of the thread queues and the sort included, and building a list of PARALLEL_THRESHOLD objects, where
+// waking the workers costs the most compared to the work. No GL context is needed, nothing is drawn.
+
+namespace {
+	using TestHelpers::RandomFloat;
+
+	// Submits like GLMesh: a level of detail picked from the distance, then one packet per material range.
+	class BenchmarkMesh : public Sigma::IGLComponent {
+	public:
+		BenchmarkMesh(const id_t entityID, GLSLShader* shader) : IGLComponent(entityID), packetShader(shader) {
+			this->boundingRadius = 1.0f;
+			this->materials[0].diffuseMap = 1 + entityID % 7;
+			this->materials[1].diffuseMap = 9 + entityID % 3;
+		}
+
+		void InitializeBuffers() {}
+		unsigned int MeshGroup_ElementCount(const unsigned int /*group*/ = 0) const { return 0; }
+		void Render(glm::mediump_float* /*view*/, glm::mediump_float* /*proj*/) {}
+
+		void Submit(Sigma::RenderQueue& queue, unsigned int pass, const glm::mat4& view, const glm::mat4& /*proj*/) {
+			const glm::mat4 model = this->Transform()->GetMatrix();
+			const glm::vec4 center = view * model * glm::vec4(this->boundingCenter, 1.0f);
+			const float depth = -center.z;
+			const unsigned int lod = depth < 50.0f ? 0 : (depth < 200.0f ? 1 : 2);
+
+			Sigma::DrawPacket packet;
+			packet.shader = this->packetShader;
+			packet.vao = 1;
+			packet.geometry = 10 + lod;
+			packet.matrix = queue.AddInstance(model);
+			for (int range = 0; range < 2; ++range) {
+				packet.material = &this->materials[range];
+				packet.count = (3 - lod) * 300;
+				packet.offset = range * 4096;
+				packet.key = Sigma::RenderQueue::MakeKey(pass, 1, Sigma::RenderQueue::MaterialKey(packet.material), packet.geometry, depth);
+				queue.Push(packet);
+			}
+		}
+	private:
+		Sigma::Material materials[2];
+		GLSLShader* packetShader;
+	};
+
+	template<typename Function>
+	double MillisecondsPerRun(int runs, Function function) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < runs; ++i) {
+			function();
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / runs;
+	}
+}
+
+int main() {
+	Log::Print::Init();
+
+	const size_t size = 50000;
+	std::srand(1);
+	// Never loaded, the queue only drops packets without a shader.
+	GLSLShader shader;
+	std::vector<std::unique_ptr<BenchmarkMesh>> meshes;
+	std::vector<Sigma::IGLComponent*> components;
+	for (size_t i = 0; i < size; ++i) {
+		meshes.push_back(std::unique_ptr<BenchmarkMesh>(new BenchmarkMesh(static_cast<id_t>(i), &shader)));
+		meshes.back()->Transform()->TranslateTo(RandomFloat(-500.0f, 500.0f), RandomFloat(-50.0f, 50.0f), RandomFloat(-500.0f, 500.0f));
+		// Bring the cached matrix up to date, as the scene index update does every frame.
+		meshes.back()->Transform()->GetMatrix();
+		components.push_back(meshes.back().get());
+	}
+
+	const glm::mat4 view(1.0f);
+	const glm::mat4 proj(1.0f);
+	Sigma::RenderQueue queue;
+	Sigma::DrawListBuilder builder;
+	const int runs = 50;
+	double single = 0.0;
+
+	const unsigned int threadCounts[] = { 1, 2, 4, 8 };
+	for (unsigned int threads : threadCounts) {
+		builder.SetThreadCount(threads);
+		double build = MillisecondsPerRun(runs, [&]() {
+			queue.Clear();
+			builder.Build(&components[0], components.size(), queue, view, proj);
+		});
+		double sorted = MillisecondsPerRun(runs, [&]() {
+			queue.Clear();
+			builder.Build(&components[0], components.size(), queue, view, proj);
+			builder.Sort(queue);
+		});
+		double small = MillisecondsPerRun(runs, [&]() {
+			queue.Clear();
+			builder.Build(&components[0], Sigma::DrawListBuilder::PARALLEL_THRESHOLD, queue, view, proj);
+		});
+		if (threads == 1) {
+			single = build;
+		}
+		LOG << size << " objects, " << threads << " threads: build " << build << " ms (" << single / build
+			<< "x), build and sort " << sorted << " ms, build of " << Sigma::DrawListBuilder::PARALLEL_THRESHOLD << " objects " << small << " ms";
+	}
+	return 0;
+}
@@ -0,0 +1,289 @@
+#include "Log.h"
+#include "HeadlessContext.h"
+#include "CameraPath.h"
+#include "Profiler.h"
+#include "SCParser.h"
+#include "systems/OpenGLSystem.h"
+#include "systems/FactorySystem.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Renders a scene without a window along a fixed camera path with a fixed time step, so every run
+// draws the same frames: reports the startup time and frame times, and can write the last frame
+// and compare it to a golden image. Runs under Mesa llvmpipe with no display, e.g. in CI:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 HeadlessBenchmark --frames 300 --path bench.path --golden bench.ppm
+//
+// Options, all optional:
+//   --width <w> --height <h>   framebuffer size, 1280x720 by default
+//   --frames <n>               frames to draw, 300 by default
+//   --scene <file>             scene to load, test.sc by default
+//   --path <file>              camera path, see CameraPath, the camera stays at the origin without one
+//   --profile <file>           writes the CPU and GPU markers as JSON, see Profiler::WriteJSON
+//   --stats <file>             writes the frame times and the render stats per frame as JSON
+//   --screenshot <file>        writes the last frame as a binary PPM
+//   --golden <file>            compares the last frame to a PPM, the exit code is 1 if they differ
+//   --tolerance <t>            largest channel difference a golden pixel may have, 8 by default
+
+namespace {
+	// Pixels of a golden image allowed past the tolerance, for rasterization differences between drivers.
+	const double GOLDEN_OUTLIERS = 0.001;
+	const double FRAME_DELTA = 1.0 / 60.0;
+	// Far above 1 / FRAME_DELTA, so every Update draws a frame instead of waiting for the frame rate cap.
+	const double UNCAPPED_FRAME_RATE = 1000000.0;
+
+	// Writes bottom row first RGB pixels, as glReadPixels returns them, to a PPM.
+	bool WritePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+		std::ofstream file(path.c_str(), std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		file << "P6\n" << width << " " << height << "\n255\n";
+		for (int y = height - 1; y >= 0; --y) {
+			file.write(reinterpret_cast<const char*>(&rgb[static_cast<size_t>(y) * width * 3]), width * 3);
+		}
+		return file.good();
+	}
+
+	// Reads a binary PPM written by WritePPM, bottom row first.
+	bool ReadPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb) {
+		std::ifstream file(path.c_str(), std::ios::binary);
+		std::string magic;
+		int maximum = 0;
+		file >> magic >> width >> height >> maximum;
+		if (!file || magic != "P6" || maximum != 255 || width <= 0 || height <= 0) {
+			return false;
+		}
+		file.get();
+		rgb.resize(static_cast<size_t>(width) * height * 3);
+		for (int y = height - 1; y >= 0; --y) {
+			file.read(reinterpret_cast<char*>(&rgb[static_cast<size_t>(y) * width * 3]), width * 3);
+		}
+		return file.good();
+	}
+
+	// Sets the camera to a key, GLTransform only rotates relative to its current rotation.
+	void PlaceCamera(Sigma::GLTransform& transform, const Sigma::CameraKey& key) {
+		transform.TranslateTo(key.position);
+		transform.Rotate(key.rotation - glm::vec3(transform.GetPitch(), transform.GetYaw(), transform.GetRoll()));
+	}
+
+	double Percentile(std::vector<double> values, double fraction) {
+		if (values.empty()) {
+			return 0.0;
+		}
+		const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+}
+
+int main(int argCount, char **argValues) {
+	Log::Print::Init();
+
+	const double startupBegin = Sigma::Profiler::Now();
+
+	int width = 1280, height = 720, frames = 300, tolerance = 8;
+	std::string scenePath = "test.sc", cameraPath, profilePath, statsPath, screenshotPath, goldenPath;
+	for (int i = 1; i + 1 < argCount; i += 2) {
+		const std::string option = argValues[i];
+		const char* value = argValues[i + 1];
+		if (option == "--width") {
+			width = std::atoi(value);
+		}
+		else if (option == "--height") {
+			height = std::atoi(value);
+		}
+		else if (option == "--frames") {
+			frames = std::atoi(value);
+		}
+		else if (option == "--scene") {
+			scenePath = value;
+		}
+		else if (option == "--path") {
+			cameraPath = value;
+		}
+		else if (option == "--profile") {
+			profilePath = value;
+		}
+		else if (option == "--stats") {
+			statsPath = value;
+		}
+		else if (option == "--screenshot") {
+			screenshotPath = value;
+		}
+		else if (option == "--golden") {
+			goldenPath = value;
+		}
+		else if (option == "--tolerance") {
+			tolerance = std::atoi(value);
+		}
+		else {
+			LOG_ERROR << "Unknown option " << option;
+			return -1;
+		}
+	}
+	Sigma::Profiler::SetEnabled(!profilePath.empty());
+
+	Sigma::CameraPath path;
+	if (!cameraPath.empty() && !path.Load(cameraPath)) {
+		LOG_ERROR << "Failed loading the camera path " << cameraPath;
+		return -1;
+	}
+
+	Sigma::HeadlessContext context;
+	if (!context.Initialize(width, height)) {
+		LOG_ERROR << "Failed creating the headless context.";
+		return -1;
+	}
+
+	Sigma::OpenGLSystem glsys;
+	Sigma::FactorySystem& factory = Sigma::FactorySystem::getInstance();
+	factory.register_Factory(glsys);
+
+	const int* version = glsys.Start();
+	if (version[0] == -1) {
+		LOG_ERROR << "Error starting OpenGL!";
+		return -1;
+	}
+	glsys.SetViewportSize(width, height);
+	glsys.SetFrameRate(UNCAPPED_FRAME_RATE);
+	glsys.createLeanGBuffer();
+
+	// Only the GL components are created, the others need systems a benchmark does not run.
+	Sigma::parser::SCParser parser;
+	if (!parser.Parse(scenePath)) {
+		LOG_ERROR << "Failed to load entities from " << scenePath;
+		return -1;
+	}
+	for (unsigned int i = 0; i < parser.EntityCount(); ++i) {
+		Sigma::parser::Entity* e = parser.GetEntity(i);
+		for (auto itr = e->components.begin(); itr != e->components.end(); ++itr) {
+			factory.create(itr->type, e->id, const_cast<std::vector<Property>&>(itr->properties));
+		}
+	}
+	if (!glsys.GetView()) {
+		std::vector<Property> props;
+		glsys.createGLView(1, props);
+	}
+	Sigma::GLTransform& camera = *glsys.GetView()->Transform();
+	camera.SetEuler(true);
+
+	// Startup ends with the first frame, which compiles what the driver compiles lazily.
+	PlaceCamera(camera, path.Sample(0.0));
+	if (!glsys.Update(FRAME_DELTA)) {
+		LOG_ERROR << "The first frame was not drawn.";
+		return -1;
+	}
+	context.SwapBuffers();
+	const double startup = (Sigma::Profiler::Now() - startupBegin) / 1000.0;
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frames);
+	Sigma::RenderStats stats;
+	int skipped = 0;
+	for (int frame = 1; frame <= frames; ++frame) {
+		const double frameBegin = Sigma::Profiler::Now();
+		PlaceCamera(camera, path.Sample(frame * FRAME_DELTA));
+		const bool drawn = glsys.Update(FRAME_DELTA);
+		context.SwapBuffers();
+		if (drawn) {
+			// Only frames drawn are timed, a swap alone would lower the average
+			frameTimes.push_back((Sigma::Profiler::Now() - frameBegin) / 1000.0);
+			stats.Add(glsys.GetFrameStats());
+		}
+		else {
+			skipped++;
+		}
+	}
+
+	int result = 0;
+	if (skipped > 0) {
+		LOG_ERROR << skipped << " of " << frames << " updates drew no frame, the times are of the others only";
+		result = 1;
+	}
+	frames = static_cast<int>(frameTimes.size());
+	double total = 0.0;
+	for (double time : frameTimes) {
+		total += time;
+	}
+	LOG << glGetString(GL_RENDERER) << " " << width << "x" << height << ": startup " << startup << " ms, "
+		<< frames << " frames, average " << (frames > 0 ? total / frames : 0.0) << " ms, median "
+		<< Percentile(frameTimes, 0.5) << " ms, 95th percentile " << Percentile(frameTimes, 0.95) << " ms";
+	if (frames > 0) {
+		LOG << "Per frame: " << stats.Summary(frames);
+	}
+
+	if (!statsPath.empty()) {
+		std::ofstream file(statsPath.c_str());
+		file << "{\"renderer\":\"" << glGetString(GL_RENDERER) << "\",\"width\":" << width << ",\"height\":" << height
+			<< ",\"frames\":" << frames << ",\"startupMs\":" << startup << ",\"averageMs\":" << (frames > 0 ? total / frames : 0.0)
+			<< ",\"medianMs\":" << Percentile(frameTimes, 0.5) << ",\"p95Ms\":" << Percentile(frameTimes, 0.95) << ",\"stats\":";
+		stats.WriteJSON(file, frames > 0 ? frames : 1);
+		file << "}\n";
+		if (file.good()) {
+			LOG << "Stats written to " << statsPath;
+		}
+		else {
+			LOG_ERROR << "Failed writing the stats to " << statsPath;
+		}
+	}
+
+	if (!profilePath.empty()) {
+		if (Sigma::Profiler::WriteJSON(profilePath)) {
+			LOG << "Profile written to " << profilePath;
+		}
+		else {
+			LOG_ERROR << "Failed writing the profile to " << profilePath;
+		}
+	}
+
+	std::vector<unsigned char> pixels;
+	context.ReadPixels(pixels);
+	if (!screenshotPath.empty() && !WritePPM(screenshotPath, width, height, pixels)) {
+		LOG_ERROR << "Failed writing the screenshot to " << screenshotPath;
+	}
+
+	if (!goldenPath.empty()) {
+		int goldenWidth = 0, goldenHeight = 0;
+		std::vector<unsigned char> golden;
+		if (!ReadPPM(goldenPath, goldenWidth, goldenHeight, golden)) {
+			LOG_ERROR << "Failed reading the golden image " << goldenPath;
+			result = 1;
+		}
+		else if (goldenWidth != width || goldenHeight != height) {
+			LOG_ERROR << "The golden image is " << goldenWidth << "x" << goldenHeight << ", the frame " << width << "x" << height;
+			result = 1;
+		}
+		else {
+			size_t outliers = 0;
+			int largest = 0;
+			for (size_t i = 0; i < pixels.size(); i += 3) {
+				int difference = 0;
+				for (size_t c = 0; c < 3; ++c) {
+					difference = std::max(difference, std::abs(static_cast<int>(pixels[i + c]) - static_cast<int>(golden[i + c])));
+				}
+				largest = std::max(largest, difference);
+				if (difference > tolerance) {
+					outliers++;
+				}
+			}
+			const size_t pixelCount = pixels.size() / 3;
+			if (outliers > GOLDEN_OUTLIERS * pixelCount) {
+				LOG_ERROR << "The frame differs from " << goldenPath << ": " << outliers << " of " << pixelCount
+					<< " pixels past the tolerance, largest difference " << largest;
+				result = 1;
+			}
+			else {
+				LOG << "The frame matches " << goldenPath << ", largest difference " << largest;
+			}
+		}
+	}
+
+	// glsys is destroyed before the context, while its GL objects can still be deleted.
+	return result;
+}
@@ -12,6 +12,10 @@
 #include "systems/WebGUISystem.h"
 #include "OS.h"
 #include "components/SpotLight.h"
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <cstring>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -35,6 +39,20 @@ int main(int argCount, char **argValues) {
 		return exitCode;
 	}
 
+	// --profile <file> records CPU and GPU markers and writes them to file as JSON on exit.
+	// --stats <seconds> logs the render stats averaged over each period.
+	std::string profilePath;
+	double statsInterval = 0.0;
+	for (int i = 1; i + 1 < argCount; ++i) {
+		if (std::strcmp(argValues[i], "--profile") == 0) {
+			profilePath = argValues[i + 1];
+		}
+		else if (std::strcmp(argValues[i], "--stats") == 0) {
+			statsInterval = std::atof(argValues[i + 1]);
+		}
+	}
+	Sigma::Profiler::SetEnabled(!profilePath.empty());
+
 	Sigma::OS glfwos;
 	Sigma::OpenGLSystem glsys;
 	Sigma::OpenALSystem alsys;
@@ -72,12 +90,9 @@ int main(int argCount, char **argValues) {
 	// Setup deferred rendering //
 	//////////////////////////////
 
-	// Create render target for the GBuffer, Light Accumulation buffer, and final composite buffer
-	unsigned int geoBuffer = glsys.createRenderTarget(glfwos.GetWindowWidth(), glfwos.GetWindowHeight(), true);
-	glsys.createRTBuffer(geoBuffer, GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE);	// Diffuse texture
-	glsys.createRTBuffer(geoBuffer, GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE);	// Normal texture
-	glsys.createRTBuffer(geoBuffer, GL_R32F, GL_RED, GL_FLOAT);				// Depth texture
-	glsys.initRenderTarget(geoBuffer); // Create the opengl assets
+	// Create the GBuffer: albedo and hardness, octahedral normals, and a depth texture
+	// read back for position reconstruction, lights are accumulated in a target sharing the depth
+	glsys.createLeanGBuffer();
 
 	///////////////////
 	// Setup physics //
@@ -201,7 +216,14 @@ int main(int argCount, char **argValues) {
 
 	FlashlightState fs = FL_OFF;
 
+	// Draw on a dedicated thread owning the context, the loop below simulates the next frame
+	// while the last one is drawn. The GUI pages are uploaded on that thread.
+	glsys.AddFrameCallback([&webguisys]() { webguisys.UploadTextures(); });
+	glsys.SetStatsLogInterval(statsInterval);
+	glsys.StartRenderThread([&glfwos](bool current) { glfwos.MakeContextCurrent(current); }, [&glfwos]() { glfwos.SwapBuffers(); });
+
 	LOG << "Main loop begins ";
+	int viewportWidth = glfwos.GetWindowWidth(), viewportHeight = glfwos.GetWindowHeight();
 	while (!glfwos.Closing()) {
 		// Get time in ms, store it in seconds too
 		double deltaSec = glfwos.GetDeltaTime();
@@ -243,7 +265,16 @@ int main(int argCount, char **argValues) {
 
 		alsys.Update();
 
-		// Update the renderer and present
+		// Follow the window size, the render targets are resized by the next frame drawn. A
+		// minimized window has no size, the last one is kept.
+		if ((glfwos.GetWindowWidth() != viewportWidth || glfwos.GetWindowHeight() != viewportHeight)
+			&& glfwos.GetWindowWidth() > 0 && glfwos.GetWindowHeight() > 0) {
+			viewportWidth = glfwos.GetWindowWidth();
+			viewportHeight = glfwos.GetWindowHeight();
+			glsys.SetViewportSize(viewportWidth, viewportHeight);
+		}
+
+		// Update the renderer, frames drawn on this thread are presented here
 		if (glsys.Update(deltaSec)) {
 			glfwos.SwapBuffers();
 		}
@@ -251,6 +282,17 @@ int main(int argCount, char **argValues) {
 		glfwos.OSMessageLoop();
 	}
 
+	glsys.StopRenderThread();
+
+	if (!profilePath.empty()) {
+		if (Sigma::Profiler::WriteJSON(profilePath)) {
+			LOG << "Profile written to " << profilePath;
+		}
+		else {
+			LOG_ERROR << "Failed writing the profile to " << profilePath;
+		}
+	}
+
 	CefShutdown();
 	return 0;
 }
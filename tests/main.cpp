@@ -1,6 +1,18 @@
 #include "gtest/gtest.h"
 #include "tests/EntityManagerTest.h"
 #include "tests/PropertyTest.h"
+#include "tests/MeshOptimizerTest.h"
+#include "tests/RenderQueueTest.h"
+#include "tests/FrustumCullerTest.h"
+#include "tests/BoundingVolumeHierarchyTest.h"
+#include "tests/GLTransformTest.h"
+#include "tests/LightClustererTest.h"
+#include "tests/ProfilerTest.h"
+#include "tests/OcclusionCullerTest.h"
+#include "tests/CameraPathTest.h"
+#include "tests/RenderGraphTest.h"
+#include "tests/ImpostorCacheTest.h"
+#include "tests/RenderStatsTest.h"
 
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "BoundingVolumeHierarchy.h"
+#include "TestHelpers.h"
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	using TestHelpers::RandomFloat;
+
+	struct TestProxy {
+		glm::vec3 center;
+		float radius;
+		unsigned int mask;
+		int id;
+	};
+
+	std::vector<void*> Sorted(std::vector<void*> results) {
+		std::sort(results.begin(), results.end());
+		return results;
+	}
+
+	bool Overlap(const TestProxy& proxy, const glm::vec3& center, float radius) {
+		glm::vec3 offset = proxy.center - center;
+		return glm::dot(offset, offset) <= (proxy.radius + radius) * (proxy.radius + radius);
+	}
+
+	// Checks every query type against a linear scan.
+	void ExpectQueriesMatchBruteForce(Sigma::BoundingVolumeHierarchy& bvh, std::vector<TestProxy>& proxies) {
+		for (int query = 0; query < 20; ++query) {
+			glm::vec3 center(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+			float radius = RandomFloat(1.0f, 30.0f);
+
+			std::vector<void*> expected, found;
+			for (auto itr = proxies.begin(); itr != proxies.end(); ++itr) {
+				if (itr->mask & 1 && Overlap(*itr, center, radius)) {
+					expected.push_back(&*itr);
+				}
+			}
+			bvh.QuerySphere(center, radius, found, 1);
+			EXPECT_EQ(Sorted(expected), Sorted(found));
+
+			Sigma::AABB box = Sigma::AABB::FromSphere(center, radius);
+			expected.clear();
+			found.clear();
+			for (auto itr = proxies.begin(); itr != proxies.end(); ++itr) {
+				float x = std::max(box.minimum.x, std::min(itr->center.x, box.maximum.x)) - itr->center.x;
+				float y = std::max(box.minimum.y, std::min(itr->center.y, box.maximum.y)) - itr->center.y;
+				float z = std::max(box.minimum.z, std::min(itr->center.z, box.maximum.z)) - itr->center.z;
+				if (x * x + y * y + z * z <= itr->radius * itr->radius) {
+					expected.push_back(&*itr);
+				}
+			}
+			bvh.QueryAABB(box, found);
+			EXPECT_EQ(Sorted(expected), Sorted(found));
+
+			// A ray along +x through the query center.
+			expected.clear();
+			found.clear();
+			glm::vec3 origin(-150.0f, center.y, center.z);
+			for (auto itr = proxies.begin(); itr != proxies.end(); ++itr) {
+				float dy = itr->center.y - origin.y, dz = itr->center.z - origin.z;
+				if (dy * dy + dz * dz <= itr->radius * itr->radius && itr->center.x + itr->radius >= origin.x) {
+					expected.push_back(&*itr);
+				}
+			}
+			bvh.QueryRay(origin, glm::vec3(1.0f, 0.0f, 0.0f), 1000.0f, found);
+			EXPECT_EQ(Sorted(expected), Sorted(found));
+		}
+
+		// An axis aligned frustum, x and y in [-50, 50], z in [-100, 0].
+		glm::vec4 planes[6] = {
+			glm::vec4(1.0f, 0.0f, 0.0f, 50.0f), glm::vec4(-1.0f, 0.0f, 0.0f, 50.0f),
+			glm::vec4(0.0f, 1.0f, 0.0f, 50.0f), glm::vec4(0.0f, -1.0f, 0.0f, 50.0f),
+			glm::vec4(0.0f, 0.0f, -1.0f, 0.0f), glm::vec4(0.0f, 0.0f, 1.0f, 100.0f)
+		};
+		std::vector<void*> expected, found;
+		for (auto itr = proxies.begin(); itr != proxies.end(); ++itr) {
+			if (Sigma::FrustumCuller::SphereVisible(planes, itr->center, itr->radius)) {
+				expected.push_back(&*itr);
+			}
+		}
+		bvh.QueryFrustum(planes, found);
+		EXPECT_EQ(Sorted(expected), Sorted(found));
+	}
+
+	TEST(BoundingVolumeHierarchyTest, QueriesMatchBruteForce) {
+		std::srand(3);
+		Sigma::BoundingVolumeHierarchy bvh;
+		std::vector<TestProxy> proxies(2000);
+		for (size_t i = 0; i < proxies.size(); ++i) {
+			proxies[i].center = glm::vec3(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+			proxies[i].radius = RandomFloat(0.1f, 3.0f);
+			proxies[i].mask = (i % 3 == 0) ? 2 : 1;
+			proxies[i].id = bvh.Insert(proxies[i].center, proxies[i].radius, &proxies[i], proxies[i].mask);
+		}
+		EXPECT_EQ(proxies.size(), bvh.Size());
+		// The rotations keep the tree balanced, log2(2000) is 11.
+		EXPECT_LE(bvh.Height(), 24);
+
+		ExpectQueriesMatchBruteForce(bvh, proxies);
+	}
+
+	TEST(BoundingVolumeHierarchyTest, MoveRemoveAndRebuild) {
+		std::srand(5);
+		Sigma::BoundingVolumeHierarchy bvh;
+		std::vector<TestProxy> proxies(1000);
+		for (size_t i = 0; i < proxies.size(); ++i) {
+			proxies[i].center = glm::vec3(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+			proxies[i].radius = RandomFloat(0.1f, 3.0f);
+			proxies[i].mask = 1;
+			proxies[i].id = bvh.Insert(proxies[i].center, proxies[i].radius, &proxies[i]);
+		}
+
+		// Small moves stay inside the fat boxes, large ones reinsert.
+		EXPECT_FALSE(bvh.Move(proxies[0].id, proxies[0].center + glm::vec3(0.1f, 0.0f, 0.0f), proxies[0].radius));
+		proxies[0].center = proxies[0].center + glm::vec3(0.1f, 0.0f, 0.0f);
+		for (int frame = 0; frame < 10; ++frame) {
+			for (size_t i = 0; i < proxies.size(); i += 2) {
+				proxies[i].center = proxies[i].center + glm::vec3(RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f));
+				bvh.Move(proxies[i].id, proxies[i].center, proxies[i].radius);
+			}
+			bvh.RebuildIfDegraded();
+		}
+		ExpectQueriesMatchBruteForce(bvh, proxies);
+
+		bvh.Rebuild();
+		EXPECT_LE(bvh.Height(), 24);
+		ExpectQueriesMatchBruteForce(bvh, proxies);
+
+		// Remove every other proxy, then clear the tree.
+		std::vector<TestProxy> kept;
+		for (size_t i = 0; i < proxies.size(); ++i) {
+			if (i % 2) {
+				bvh.Remove(proxies[i].id);
+			}
+		}
+		for (size_t i = 0; i < proxies.size(); i += 2) {
+			kept.push_back(proxies[i]);
+		}
+		std::vector<void*> found;
+		bvh.QuerySphere(glm::vec3(0.0f, 0.0f, 0.0f), 1000.0f, found);
+		EXPECT_EQ(kept.size(), found.size());
+		EXPECT_EQ(kept.size(), bvh.Size());
+		for (size_t i = 0; i < proxies.size(); i += 2) {
+			bvh.Remove(proxies[i].id);
+		}
+		EXPECT_EQ(0u, bvh.Size());
+		EXPECT_EQ(0, bvh.Height());
+	}
+}  // namespace
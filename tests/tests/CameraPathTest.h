@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CameraPath.h"
+
+namespace {
+	TEST(CameraPathTest, InterpolatesBetweenKeys) {
+		Sigma::CameraPath path;
+		ASSERT_TRUE(path.Parse("# time x y z pitch yaw roll\n0 0 0 0 0 0 0\n\n2 4 2 -8 0 90 0\n"));
+		ASSERT_EQ(2u, path.KeyCount());
+		EXPECT_DOUBLE_EQ(2.0, path.Duration());
+
+		Sigma::CameraKey middle = path.Sample(1.0);
+		EXPECT_FLOAT_EQ(2.0f, middle.position.x);
+		EXPECT_FLOAT_EQ(1.0f, middle.position.y);
+		EXPECT_FLOAT_EQ(-4.0f, middle.position.z);
+		EXPECT_FLOAT_EQ(45.0f, middle.rotation.y);
+
+		EXPECT_FLOAT_EQ(0.0f, path.Sample(-1.0).position.x);
+		EXPECT_FLOAT_EQ(4.0f, path.Sample(10.0).position.x);
+	}
+
+	TEST(CameraPathTest, RejectsMalformedPaths) {
+		Sigma::CameraPath path;
+		EXPECT_FALSE(path.Parse("0 0 0 0 0 0\n"));
+		EXPECT_FALSE(path.Parse("1 0 0 0 0 0 0\n1 1 1 1 0 0 0\n"));
+		EXPECT_EQ(0u, path.KeyCount());
+		EXPECT_FLOAT_EQ(0.0f, path.Sample(1.0).position.x);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "FrustumCuller.h"
+#include "TestHelpers.h"
+#include <vector>
+#include <cstdlib>
+
+namespace {
+	using TestHelpers::RandomFloat;
+
+	// glOrtho(-10, 10, -10, 10, 1, 100): a box looking down -z from the origin.
+	void OrthoPlanes(glm::vec4 planes[6]) {
+		glm::mat4 ortho(1.0f);
+		ortho[0] = glm::vec4(0.1f, 0.0f, 0.0f, 0.0f);
+		ortho[1] = glm::vec4(0.0f, 0.1f, 0.0f, 0.0f);
+		ortho[2] = glm::vec4(0.0f, 0.0f, -2.0f / 99.0f, 0.0f);
+		ortho[3] = glm::vec4(0.0f, 0.0f, -101.0f / 99.0f, 1.0f);
+		Sigma::FrustumCuller::ExtractPlanes(ortho, planes);
+	}
+
+	TEST(FrustumCullerTest, SphereVisibleUsesSignedDistance) {
+		glm::vec4 planes[6];
+		OrthoPlanes(planes);
+
+		EXPECT_TRUE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(0.0f, 0.0f, -50.0f), 1.0f));
+		EXPECT_FALSE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(0.0f, 0.0f, 50.0f), 1.0f));
+		EXPECT_FALSE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(12.0f, 0.0f, -50.0f), 1.0f));
+		EXPECT_FALSE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(0.0f, -12.0f, -50.0f), 1.0f));
+		EXPECT_FALSE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(0.0f, 0.0f, -102.0f), 1.0f));
+		// Spheres crossing a plane are visible.
+		EXPECT_TRUE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(10.5f, 0.0f, -50.0f), 1.0f));
+		EXPECT_TRUE(Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(0.0f, 0.0f, -0.5f), 0.6f));
+	}
+
+	TEST(FrustumCullerTest, BatchedCullMatchesSphereVisible) {
+		glm::vec4 planes[6];
+		OrthoPlanes(planes);
+
+		// Not a multiple of 4 or 8 so the scalar tail runs too.
+		std::srand(42);
+		Sigma::FrustumCuller culler;
+		std::vector<glm::vec4> spheres;
+		for (int i = 0; i < 1003; ++i) {
+			glm::vec4 sphere(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), RandomFloat(-120.0f, 20.0f), RandomFloat(0.0f, 5.0f));
+			spheres.push_back(sphere);
+			EXPECT_EQ(static_cast<unsigned int>(i), culler.Add(glm::vec3(sphere.x, sphere.y, sphere.z), sphere.w));
+		}
+
+		std::vector<unsigned char> visible;
+		size_t count = culler.Cull(planes, visible);
+
+		ASSERT_EQ(spheres.size(), visible.size());
+		size_t expectedCount = 0;
+		for (size_t i = 0; i < spheres.size(); ++i) {
+			bool expected = Sigma::FrustumCuller::SphereVisible(planes, glm::vec3(spheres[i].x, spheres[i].y, spheres[i].z), spheres[i].w);
+			EXPECT_EQ(expected ? 1 : 0, visible[i]);
+			expectedCount += expected ? 1 : 0;
+		}
+		EXPECT_EQ(expectedCount, count);
+		EXPECT_GT(count, 0u);
+		EXPECT_LT(count, spheres.size());
+	}
+
+	TEST(FrustumCullerTest, ThreadedCullMatchesSingleThread) {
+		glm::vec4 planes[6];
+		OrthoPlanes(planes);
+
+		std::srand(7);
+		Sigma::FrustumCuller culler;
+		for (size_t i = 0; i < Sigma::FrustumCuller::PARALLEL_THRESHOLD * 2 + 5; ++i) {
+			culler.Add(glm::vec3(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f), RandomFloat(-120.0f, 20.0f)), RandomFloat(0.0f, 5.0f));
+		}
+
+		std::vector<unsigned char> single, threaded;
+		culler.SetThreadCount(1);
+		size_t singleCount = culler.Cull(planes, single);
+		culler.SetThreadCount(3);
+		size_t threadedCount = culler.Cull(planes, threaded);
+
+		EXPECT_EQ(singleCount, threadedCount);
+		EXPECT_TRUE(single == threaded);
+	}
+}  // namespace
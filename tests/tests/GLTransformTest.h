@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GLTransform.h"
+
+namespace {
+	TEST(GLTransformTest, VersionChangesWhenReparented) {
+		// The first parent changed once more than the second, as many times as the child changes
+		// when re-parented, so adding up the changes would give the same version twice
+		Sigma::GLTransform first, second, child;
+		first.Translate(1.0f, 0.0f, 0.0f);
+		first.Translate(1.0f, 0.0f, 0.0f);
+		second.Translate(0.0f, 1.0f, 0.0f);
+		child.SetParentTransform(&first);
+		const unsigned int underFirst = child.GetVersion();
+
+		child.SetParentTransform(&second);
+		const unsigned int underSecond = child.GetVersion();
+		EXPECT_NE(underFirst, underSecond);
+
+		// A change of the parent changes the child's version too
+		second.Rotate(0.0f, 1.0f, 0.0f);
+		EXPECT_NE(underSecond, child.GetVersion());
+		EXPECT_EQ(child.GetVersion(), child.GetVersion());
+	}
+}
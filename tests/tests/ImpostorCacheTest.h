@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ImpostorCache.h"
+
+namespace {
+	TEST(ImpostorCacheTest, CapturesAgainOnlyPastTheAngleThreshold) {
+		Sigma::ImpostorCache cache;
+		cache.Resize(512, 256);
+		cache.SetAngleThreshold(5.0f);
+		int planet = 0;
+		bool capture = false;
+
+		cache.BeginFrame();
+		int cell = cache.Request(&planet, glm::vec3(0.0f, 0.0f, -1.0f), capture);
+		EXPECT_EQ(0, cell);
+		EXPECT_TRUE(capture);
+
+		// About 3 degrees, the image is still good
+		cache.BeginFrame();
+		EXPECT_EQ(cell, cache.Request(&planet, glm::normalize(glm::vec3(0.05f, 0.0f, -1.0f)), capture));
+		EXPECT_FALSE(capture);
+
+		// About 11 degrees from where the image was taken
+		cache.BeginFrame();
+		EXPECT_EQ(cell, cache.Request(&planet, glm::normalize(glm::vec3(0.2f, 0.0f, -1.0f)), capture));
+		EXPECT_TRUE(capture);
+		EXPECT_EQ(1u, cache.Captures());
+
+		// The cell of the bottom left of the atlas, its top row first
+		glm::vec4 rect = cache.CellRect(cell);
+		EXPECT_FLOAT_EQ(0.0f, rect.x);
+		EXPECT_FLOAT_EQ(0.5f, rect.y);
+		EXPECT_FLOAT_EQ(0.5f, rect.z);
+		EXPECT_FLOAT_EQ(0.0f, rect.w);
+	}
+
+	TEST(ImpostorCacheTest, GivesAwayTheLeastRecentlyRequestedCell) {
+		Sigma::ImpostorCache cache;
+		cache.Resize(512, 256);
+		ASSERT_EQ(4u, cache.CellCount());
+		int objects[6];
+		const glm::vec3 direction(0.0f, 0.0f, -1.0f);
+		bool capture = false;
+
+		cache.BeginFrame();
+		for (int i = 0; i < 4; ++i) {
+			EXPECT_EQ(i, cache.Request(&objects[i], direction, capture));
+		}
+		// Every cell is in use this frame
+		EXPECT_EQ(-1, cache.Request(&objects[4], direction, capture));
+		EXPECT_FALSE(capture);
+
+		cache.BeginFrame();
+		for (int i = 1; i < 4; ++i) {
+			cache.Request(&objects[i], direction, capture);
+		}
+		EXPECT_EQ(0, cache.Request(&objects[4], direction, capture));
+		EXPECT_TRUE(capture);
+
+		// The first object lost its cell and gets a new image in the one freed by Remove
+		cache.Remove(&objects[2]);
+		cache.BeginFrame();
+		EXPECT_EQ(2, cache.Request(&objects[0], direction, capture));
+		EXPECT_TRUE(capture);
+
+		// Past the budget new objects wait for the next frame
+		cache.SetCaptureBudget(1);
+		cache.BeginFrame();
+		cache.Request(&objects[5], direction, capture);
+		EXPECT_TRUE(capture);
+		EXPECT_EQ(-1, cache.Request(&objects[2], direction, capture));
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "LightClusterer.h"
+#include "TestHelpers.h"
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+	using TestHelpers::RandomFloat;
+
+	void AddRandomLights(Sigma::LightClusterer& clusterer, int count) {
+		for (int i = 0; i < count; ++i) {
+			glm::vec3 position(RandomFloat(-150.0f, 150.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-210.0f, 10.0f));
+			if (i % 2) {
+				glm::vec3 direction(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f));
+				direction = direction / std::sqrt(glm::dot(direction, direction));
+				clusterer.AddSpotLight(position, direction, RandomFloat(5.0f, 40.0f), RandomFloat(0.5f, 0.99f));
+			}
+			else {
+				clusterer.AddPointLight(position, RandomFloat(1.0f, 20.0f));
+			}
+		}
+	}
+
+	// Checks the cluster lists against the reference test of every light and cluster.
+	void ExpectBinMatchesReference(const Sigma::LightClusterer& clusterer) {
+		const std::vector<unsigned int>& clusters = clusterer.Clusters();
+		const std::vector<unsigned int>& indices = clusterer.Indices();
+		ASSERT_EQ(Sigma::LightClusterer::CLUSTER_COUNT * 2, clusters.size());
+		for (unsigned int cluster = 0; cluster < Sigma::LightClusterer::CLUSTER_COUNT; ++cluster) {
+			std::vector<unsigned int> expected;
+			for (unsigned int light = 0; light < clusterer.Size(); ++light) {
+				if (clusterer.Intersects(light, cluster)) {
+					expected.push_back(light);
+				}
+			}
+			std::vector<unsigned int> found(indices.begin() + clusters[cluster * 2], indices.begin() + clusters[cluster * 2] + clusters[cluster * 2 + 1]);
+			EXPECT_EQ(expected, found);
+		}
+	}
+
+	TEST(LightClustererTest, ExtractsPlanesAndBinsLightsInTheirCluster) {
+		Sigma::LightClusterer clusterer;
+		clusterer.SetProjection(TestHelpers::Perspective90(16.0f / 9.0f, 0.5f, 200.0f));
+		EXPECT_NEAR(0.5f, clusterer.NearPlane(), 1e-3f);
+		EXPECT_NEAR(200.0f, clusterer.FarPlane(), 0.5f);
+
+		// A small light on the view axis, 10 units away, and one behind the camera.
+		clusterer.AddPointLight(glm::vec3(0.0f, 0.0f, -10.0f), 0.1f);
+		clusterer.AddPointLight(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f);
+		clusterer.SetThreadCount(1);
+		clusterer.Bin();
+
+		const unsigned int slice = static_cast<unsigned int>(std::log(10.0f / clusterer.NearPlane()) * clusterer.SliceScale());
+		const unsigned int cluster = Sigma::LightClusterer::ClusterIndex(Sigma::LightClusterer::TILES_X / 2, Sigma::LightClusterer::TILES_Y / 2, slice);
+		const std::vector<unsigned int>& clusters = clusterer.Clusters();
+		ASSERT_EQ(1u, clusters[cluster * 2 + 1]);
+		EXPECT_EQ(0u, clusterer.Indices()[clusters[cluster * 2]]);
+		// Only the tiles sharing the corner at the center of the screen can hold the first light.
+		EXPECT_LE(clusterer.Indices().size(), 4u);
+	}
+
+	TEST(LightClustererTest, BatchedAndThreadedBinningMatchReference) {
+		std::srand(11);
+		Sigma::LightClusterer clusterer;
+		clusterer.SetProjection(TestHelpers::Perspective90(16.0f / 9.0f, 0.5f, 200.0f));
+		AddRandomLights(clusterer, static_cast<int>(Sigma::LightClusterer::PARALLEL_THRESHOLD) + 37);
+
+		clusterer.SetThreadCount(1);
+		size_t single = clusterer.Bin();
+		EXPECT_GT(single, 0u);
+		ExpectBinMatchesReference(clusterer);
+
+		std::vector<unsigned int> singleClusters = clusterer.Clusters();
+		std::vector<unsigned int> singleIndices = clusterer.Indices();
+		clusterer.SetThreadCount(3);
+		EXPECT_EQ(single, clusterer.Bin());
+		EXPECT_TRUE(singleClusters == clusterer.Clusters());
+		EXPECT_TRUE(singleIndices == clusterer.Indices());
+	}
+}  // namespace
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "MeshOptimizer.h"
+#include <vector>
+#include <algorithm>
+
+namespace {
+	// Builds a w*h grid of quads (2 triangles each) in scanline order.
+	std::vector<unsigned int> MakeGrid(unsigned int w, unsigned int h, std::vector<float>& positions) {
+		positions.clear();
+		for (unsigned int y = 0; y <= h; ++y) {
+			for (unsigned int x = 0; x <= w; ++x) {
+				positions.push_back(static_cast<float>(x));
+				positions.push_back(static_cast<float>(y));
+				positions.push_back(0.0f);
+			}
+		}
+		std::vector<unsigned int> indices;
+		for (unsigned int y = 0; y < h; ++y) {
+			for (unsigned int x = 0; x < w; ++x) {
+				unsigned int i = y * (w + 1) + x;
+				indices.push_back(i); indices.push_back(i + 1); indices.push_back(i + w + 1);
+				indices.push_back(i + 1); indices.push_back(i + w + 2); indices.push_back(i + w + 1);
+			}
+		}
+		return indices;
+	}
+
+	// Rotates each triangle so its smallest index comes first (keeps winding), then sorts the list.
+	std::vector<std::vector<unsigned int>> CanonicalTriangles(const std::vector<unsigned int>& indices) {
+		std::vector<std::vector<unsigned int>> tris;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			std::vector<unsigned int> t(indices.begin() + i, indices.begin() + i + 3);
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			tris.push_back(t);
+		}
+		std::sort(tris.begin(), tris.end());
+		return tris;
+	}
+
+	TEST(MeshOptimizerTest, ACMRWorstAndBestCase) {
+		std::vector<unsigned int> separate;
+		for (unsigned int i = 0; i < 30; ++i) {
+			separate.push_back(i);
+		}
+		EXPECT_FLOAT_EQ(3.0f, Sigma::mesh::CalculateACMR(&separate[0], separate.size(), 30));
+
+		std::vector<unsigned int> same(30, 0);
+		same[1] = 1; same[2] = 2;
+		for (size_t i = 3; i < same.size(); i += 3) {
+			same[i] = 0; same[i + 1] = 1; same[i + 2] = 2;
+		}
+		EXPECT_FLOAT_EQ(0.3f, Sigma::mesh::CalculateACMR(&same[0], same.size(), 3));
+	}
+
+	TEST(MeshOptimizerTest, VertexCacheKeepsTrianglesAndImprovesACMR) {
+		std::vector<float> positions;
+		std::vector<unsigned int> indices = MakeGrid(64, 64, positions);
+		std::vector<unsigned int> original = indices;
+		const size_t vertexCount = positions.size() / 3;
+
+		// Shuffle the triangles deterministically to get a poor starting order.
+		for (size_t i = 0; i < indices.size() / 3; ++i) {
+			size_t j = (i * 7919) % (indices.size() / 3);
+			std::swap_ranges(indices.begin() + i * 3, indices.begin() + i * 3 + 3, indices.begin() + j * 3);
+		}
+		float before = Sigma::mesh::CalculateACMR(&indices[0], indices.size(), vertexCount);
+
+		Sigma::mesh::OptimizeVertexCache(&indices[0], indices.size(), vertexCount);
+		float after = Sigma::mesh::CalculateACMR(&indices[0], indices.size(), vertexCount);
+
+		EXPECT_EQ(CanonicalTriangles(original), CanonicalTriangles(indices));
+		EXPECT_LT(after, before);
+		EXPECT_LT(after, 0.8f);
+	}
+
+	TEST(MeshOptimizerTest, OverdrawKeepsTriangles) {
+		std::vector<float> positions;
+		std::vector<unsigned int> indices = MakeGrid(32, 32, positions);
+		const size_t vertexCount = positions.size() / 3;
+		Sigma::mesh::OptimizeVertexCache(&indices[0], indices.size(), vertexCount);
+		std::vector<unsigned int> optimized = indices;
+
+		Sigma::mesh::OptimizeOverdraw(&indices[0], indices.size(), &positions[0], vertexCount, sizeof(float) * 3);
+
+		EXPECT_EQ(CanonicalTriangles(optimized), CanonicalTriangles(indices));
+	}
+
+	TEST(MeshOptimizerTest, VertexFetchOrdersByFirstUse) {
+		unsigned int indices[] = { 5, 3, 9, 3, 9, 1 };
+		std::vector<unsigned int> remap;
+		size_t count = Sigma::mesh::OptimizeVertexFetch(remap, indices, 6, 10);
+
+		ASSERT_EQ(4u, count);
+		EXPECT_EQ(0u, indices[0]);
+		EXPECT_EQ(1u, indices[1]);
+		EXPECT_EQ(2u, indices[2]);
+		EXPECT_EQ(1u, indices[3]);
+		EXPECT_EQ(2u, indices[4]);
+		EXPECT_EQ(3u, indices[5]);
+		EXPECT_EQ(~0u, remap[0]);
+
+		std::vector<int> attribute;
+		for (int i = 0; i < 10; ++i) {
+			attribute.push_back(i * 10);
+		}
+		Sigma::mesh::RemapVertices(attribute, remap, count);
+		ASSERT_EQ(4u, attribute.size());
+		EXPECT_EQ(50, attribute[0]);
+		EXPECT_EQ(30, attribute[1]);
+		EXPECT_EQ(90, attribute[2]);
+		EXPECT_EQ(10, attribute[3]);
+	}
+
+	TEST(MeshOptimizerTest, SimplifyReducesFlatGridWithoutError) {
+		std::vector<float> positions;
+		std::vector<unsigned int> indices = MakeGrid(16, 16, positions);
+		const size_t vertexCount = positions.size() / 3;
+		std::vector<unsigned int> simplified(indices.size());
+		float error = 1.0f;
+
+		size_t count = Sigma::mesh::SimplifyMesh(&simplified[0], &indices[0], indices.size(), &positions[0], vertexCount, sizeof(float) * 3,
+			indices.size() / 4, 0.01f, &error);
+
+		EXPECT_EQ(0u, count % 3);
+		EXPECT_LT(count, indices.size() / 2);
+		EXPECT_NEAR(0.0f, error, 1e-3f);
+
+		// The border is locked, so every border vertex must still be referenced.
+		std::vector<bool> used(vertexCount, false);
+		for (size_t i = 0; i < count; ++i) {
+			used[simplified[i]] = true;
+		}
+		for (unsigned int x = 0; x <= 16; ++x) {
+			EXPECT_TRUE(used[x]);
+			EXPECT_TRUE(used[16 * 17 + x]);
+		}
+	}
+
+	TEST(MeshOptimizerTest, SubdivideSharesEdgeMidpoints) {
+		// A closed tetrahedron: 4 faces, 6 edges.
+		unsigned int tetra[] = { 0, 1, 2, 0, 3, 1, 1, 3, 2, 2, 3, 0 };
+		std::vector<unsigned int> indices(tetra, tetra + 12);
+		std::vector<unsigned int> parents;
+
+		size_t count = Sigma::mesh::SubdivideTriangles(indices, parents, 4);
+
+		EXPECT_EQ(10u, count);
+		EXPECT_EQ(48u, indices.size());
+		ASSERT_EQ(12u, parents.size());
+		for (size_t i = 0; i < parents.size(); i += 2) {
+			EXPECT_LT(parents[i], parents[i + 1]);
+		}
+		// The first child keeps the first corner of the source triangle.
+		EXPECT_EQ(0u, indices[0]);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			EXPECT_LT(indices[i], count);
+		}
+	}
+}  // namespace
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "OcclusionCuller.h"
+#include "TestHelpers.h"
+#include <vector>
+#include <cmath>
+
+namespace {
+	// A square in the plane z = depth, facing the camera at the origin.
+	void AddWall(Sigma::OcclusionCuller& culler, const glm::mat4& viewProj, float depth, float halfSize) {
+		const float positions[] = {
+			-halfSize, -halfSize, depth, halfSize, -halfSize, depth,
+			halfSize, halfSize, depth, -halfSize, halfSize, depth
+		};
+		const unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+		Sigma::OccluderGeometry geometry;
+		geometry.positions = positions;
+		geometry.vertexCount = 4;
+		geometry.indices = indices;
+		geometry.indexCount = 6;
+		culler.AddOccluder(viewProj, geometry);
+	}
+
+	// A sphere tessellated in rings and segments, the normals are the unit positions.
+	void MakeSphere(float radius, std::vector<float>& positions, std::vector<float>& normals, std::vector<unsigned int>& indices) {
+		const unsigned int rings = 16, segments = 32;
+		for (unsigned int ring = 0; ring <= rings; ++ring) {
+			const float theta = 3.14159265f * ring / rings;
+			for (unsigned int segment = 0; segment < segments; ++segment) {
+				const float phi = 2.0f * 3.14159265f * segment / segments;
+				const float normal[3] = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+				for (int axis = 0; axis < 3; ++axis) {
+					normals.push_back(normal[axis]);
+					positions.push_back(normal[axis] * radius);
+				}
+			}
+		}
+		for (unsigned int ring = 0; ring < rings; ++ring) {
+			for (unsigned int segment = 0; segment < segments; ++segment) {
+				const unsigned int a = ring * segments + segment, b = ring * segments + (segment + 1) % segments;
+				const unsigned int quad[6] = { a, b, b + segments, a, b + segments, a + segments };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	TEST(OcclusionCullerTest, ShrunkOccluderKeepsObjectsPastTheSilhouette) {
+		// A level of detail of a sphere of radius 5, 20 units away, bulging out by its error of 1.5.
+		const glm::mat4 viewProj = TestHelpers::Perspective90(2.0f, 1.0f, 100.0f);
+		glm::mat4 model(1.0f);
+		model[3] = glm::vec4(0.0f, 0.0f, -20.0f, 1.0f);
+		std::vector<float> positions, normals;
+		std::vector<unsigned int> indices;
+		MakeSphere(6.5f, positions, normals, indices);
+		Sigma::OccluderGeometry geometry;
+		geometry.positions = &positions[0];
+		geometry.vertexCount = positions.size() / 3;
+		geometry.indices = &indices[0];
+		geometry.indexCount = indices.size();
+
+		// Far behind the sphere, 0.3 off its center per unit of depth: past the silhouette of the
+		// radius 5 sphere (0.26) but inside the bulge (0.34). The other one is at 0.15.
+		const glm::vec3 extent(0.2f, 0.2f, 0.2f);
+		const glm::vec3 past(60.0f * 0.3f, 0.0f, -60.0f), inside(60.0f * 0.15f, 0.0f, -60.0f);
+
+		Sigma::OcclusionCuller culler;
+		culler.SetThreadCount(1);
+		culler.Clear();
+		culler.AddOccluder(viewProj * model, geometry);
+		culler.Rasterize();
+		EXPECT_FALSE(culler.IsBoxVisible(viewProj, past - extent, past + extent));
+
+		Sigma::ShrinkOccluder(&positions[0], &normals[0], 3 * sizeof(float), geometry.vertexCount, 1.5f);
+		EXPECT_FLOAT_EQ(5.0f, glm::length(glm::vec3(positions[3], positions[4], positions[5])));
+		culler.Clear();
+		culler.AddOccluder(viewProj * model, geometry);
+		culler.Rasterize();
+		EXPECT_TRUE(culler.IsBoxVisible(viewProj, past - extent, past + extent));
+		EXPECT_FALSE(culler.IsBoxVisible(viewProj, inside - extent, inside + extent));
+	}
+
+	TEST(OcclusionCullerTest, HidesBoxesBehindAWall) {
+		// The buffer is twice as wide as high.
+		const glm::mat4 viewProj = TestHelpers::Perspective90(2.0f, 1.0f, 100.0f);
+		Sigma::OcclusionCuller culler;
+		culler.SetThreadCount(1);
+		culler.Clear();
+		AddWall(culler, viewProj, -10.0f, 5.0f);
+		EXPECT_EQ(2u, culler.TriangleCount());
+		culler.Rasterize();
+
+		EXPECT_LT(culler.Depth(Sigma::OcclusionCuller::WIDTH / 2, Sigma::OcclusionCuller::HEIGHT / 2), 1.0f);
+		EXPECT_EQ(1.0f, culler.Depth(0, 0));
+
+		// Behind the wall, in front of it, beside it, and straddling the near plane.
+		EXPECT_FALSE(culler.IsBoxVisible(viewProj, glm::vec3(-1.0f, -1.0f, -22.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+		EXPECT_TRUE(culler.IsBoxVisible(viewProj, glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f)));
+		EXPECT_TRUE(culler.IsBoxVisible(viewProj, glm::vec3(20.0f, -1.0f, -22.0f), glm::vec3(24.0f, 1.0f, -20.0f)));
+		EXPECT_TRUE(culler.IsBoxVisible(viewProj, glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, 1.0f)));
+
+		// Without occluders nothing in view is hidden.
+		culler.Clear();
+		culler.Rasterize();
+		EXPECT_TRUE(culler.IsBoxVisible(viewProj, glm::vec3(-1.0f, -1.0f, -22.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+	}
+
+	TEST(OcclusionCullerTest, ThreadedRasterizationMatchesSingleThreaded) {
+		const glm::mat4 viewProj = TestHelpers::Perspective90(2.0f, 1.0f, 100.0f);
+		Sigma::OcclusionCuller single, threaded;
+		single.SetThreadCount(1);
+		threaded.SetThreadCount(4);
+		single.Clear();
+		threaded.Clear();
+		// Enough small walls to go past the threading threshold, one crossing the near plane.
+		for (unsigned int i = 0; i < Sigma::OcclusionCuller::PARALLEL_THRESHOLD; ++i) {
+			const glm::mat4 model = glm::mat4(1.0f);
+			glm::mat4 offset = model;
+			offset[3] = glm::vec4(static_cast<float>(i % 32) - 16.0f, static_cast<float>(i / 32 % 16) - 8.0f, -static_cast<float>(i % 7), 1.0f);
+			AddWall(single, viewProj * offset, -20.0f, 0.4f);
+			AddWall(threaded, viewProj * offset, -20.0f, 0.4f);
+		}
+		AddWall(single, viewProj, 0.5f, 3.0f);
+		AddWall(threaded, viewProj, 0.5f, 3.0f);
+		EXPECT_EQ(1u, single.Rasterize());
+		EXPECT_EQ(4u, threaded.Rasterize());
+
+		for (unsigned int y = 0; y < Sigma::OcclusionCuller::HEIGHT; ++y) {
+			for (unsigned int x = 0; x < Sigma::OcclusionCuller::WIDTH; ++x) {
+				ASSERT_EQ(single.Depth(x, y), threaded.Depth(x, y));
+			}
+		}
+	}
+}  // namespace
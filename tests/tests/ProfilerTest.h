@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Profiler.h"
+#include <vector>
+
+namespace {
+	TEST(ProfilerTest, RecordsOnlyWhenEnabled) {
+		Sigma::Profiler::Clear();
+		Sigma::Profiler::SetEnabled(false);
+		Sigma::Profiler::Record("Disabled", Sigma::PROFILE_TRACK_GPU, 0.0, 1000.0);
+		{
+			PROFILE_SCOPE("Disabled");
+		}
+		EXPECT_TRUE(Sigma::Profiler::Events().empty());
+
+		Sigma::Profiler::SetEnabled(true);
+		{
+			PROFILE_SCOPE("Scope");
+		}
+		Sigma::Profiler::SetEnabled(false);
+		std::vector<Sigma::ProfileEvent> events = Sigma::Profiler::Events();
+		ASSERT_EQ(1u, events.size());
+		EXPECT_EQ(Sigma::Profiler::ThreadTrack(), events[0].track);
+		EXPECT_NE(Sigma::PROFILE_TRACK_GPU, events[0].track);
+		EXPECT_GE(events[0].duration, 0.0);
+		Sigma::Profiler::Clear();
+	}
+
+	TEST(ProfilerTest, SummarizesEachMarkerPerTrack) {
+		Sigma::Profiler::Clear();
+		Sigma::Profiler::SetEnabled(true);
+		Sigma::Profiler::Record("GBuffer", Sigma::PROFILE_TRACK_GPU, 0.0, 1000.0);
+		Sigma::Profiler::Record("GBuffer", Sigma::PROFILE_TRACK_GPU, 5000.0, 3000.0);
+		Sigma::Profiler::Record("GBuffer", 1, 0.0, 500.0);
+		Sigma::Profiler::SetEnabled(false);
+
+		std::vector<Sigma::ProfileSummary> summaries = Sigma::Profiler::Summarize();
+		ASSERT_EQ(2u, summaries.size());
+		EXPECT_EQ(Sigma::PROFILE_TRACK_GPU, summaries[0].track);
+		EXPECT_EQ(2u, summaries[0].count);
+		EXPECT_DOUBLE_EQ(2.0, summaries[0].average);
+		EXPECT_DOUBLE_EQ(3.0, summaries[0].maximum);
+		EXPECT_EQ(1u, summaries[1].track);
+		EXPECT_DOUBLE_EQ(0.5, summaries[1].average);
+		Sigma::Profiler::Clear();
+	}
+}  // namespace
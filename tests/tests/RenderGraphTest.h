@@ -0,0 +1,87 @@
+#pragma once
+
+#include "RenderGraph.h"
+
+namespace {
+	// Format values only need to differ, the graph makes no GL call.
+	const unsigned int COLOR_FORMAT = 1;
+	const unsigned int DEPTH_FORMAT = 2;
+
+	TEST(RenderGraphTest, CullsPassesNothingPresentedDependsOn) {
+		using Sigma::RenderGraph;
+		RenderGraph graph;
+		int scene = graph.AddTexture("Scene", COLOR_FORMAT);
+		int debug = graph.AddTexture("Debug", COLOR_FORMAT);
+		int draw = graph.AddPass("Draw");
+		graph.Write(draw, scene, true);
+		int unused = graph.AddPass("Debug view");
+		graph.Read(unused, scene);
+		graph.Write(unused, debug, true);
+		int overdraw = graph.AddPass("Overdraw");
+		graph.Write(overdraw, scene, false);
+		int present = graph.AddPass("Present");
+		graph.Read(present, scene);
+		graph.Write(present, RenderGraph::BACKBUFFER, false);
+		graph.Compile();
+
+		EXPECT_FALSE(graph.IsCulled(draw));
+		EXPECT_TRUE(graph.IsCulled(unused));
+		EXPECT_FALSE(graph.IsCulled(overdraw));
+		EXPECT_FALSE(graph.IsCulled(present));
+		EXPECT_EQ(-1, graph.Slot(debug));
+		EXPECT_EQ(1u, graph.SlotCount());
+
+		// A pass clearing the scene before it is presented makes the earlier draws useless
+		RenderGraph cleared;
+		scene = cleared.AddTexture("Scene", COLOR_FORMAT);
+		draw = cleared.AddPass("Draw");
+		cleared.Write(draw, scene, true);
+		int redraw = cleared.AddPass("Redraw");
+		cleared.Write(redraw, scene, true);
+		present = cleared.AddPass("Present");
+		cleared.Read(present, scene);
+		cleared.Write(present, RenderGraph::BACKBUFFER, false);
+		cleared.Compile();
+		EXPECT_TRUE(cleared.IsCulled(draw));
+		EXPECT_FALSE(cleared.IsCulled(redraw));
+		EXPECT_EQ(1u, cleared.GetTexture(scene).firstPass);
+	}
+
+	TEST(RenderGraphTest, AliasesTexturesWithDisjointLifetimes) {
+		using Sigma::RenderGraph;
+		RenderGraph graph;
+		int gbuffer = graph.AddTexture("GBuffer", COLOR_FORMAT);
+		int depth = graph.AddTexture("Depth", DEPTH_FORMAT);
+		int light = graph.AddTexture("Light", COLOR_FORMAT);
+		int bloom = graph.AddTexture("Bloom", COLOR_FORMAT, 0.5f);
+		int tonemapped = graph.AddTexture("Tonemapped", COLOR_FORMAT);
+
+		int geometry = graph.AddPass("Geometry");
+		graph.Write(geometry, gbuffer, true);
+		graph.Write(geometry, depth, true);
+		int lighting = graph.AddPass("Lighting");
+		graph.Read(lighting, gbuffer);
+		graph.Read(lighting, depth);
+		graph.Write(lighting, light, true);
+		int blur = graph.AddPass("Bloom");
+		graph.Read(blur, light);
+		graph.Write(blur, bloom, true);
+		int tonemap = graph.AddPass("Tonemap");
+		graph.Read(tonemap, light);
+		graph.Read(tonemap, bloom);
+		graph.Write(tonemap, tonemapped, true);
+		int present = graph.AddPass("Present");
+		graph.Read(present, tonemapped);
+		graph.Write(present, RenderGraph::BACKBUFFER, false);
+		graph.Compile();
+
+		// The tonemapped image reuses the GBuffer, free after lighting, but not the light target it reads.
+		EXPECT_EQ(graph.Slot(gbuffer), graph.Slot(tonemapped));
+		EXPECT_NE(graph.Slot(light), graph.Slot(tonemapped));
+		EXPECT_NE(graph.Slot(gbuffer), graph.Slot(light));
+		EXPECT_NE(graph.Slot(bloom), graph.Slot(gbuffer));
+		EXPECT_EQ(4u, graph.SlotCount());
+		EXPECT_EQ(0u, graph.GetTexture(depth).firstPass);
+		EXPECT_EQ(1u, graph.GetTexture(depth).lastPass);
+	}
+}
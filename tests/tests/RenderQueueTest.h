@@ -0,0 +1,83 @@
+#pragma once
+
+#include "systems/RenderQueue.h"
+#include <vector>
+#include <algorithm>
+
+namespace {
+	bool KeyLess(const Sigma::SortEntry& a, const Sigma::SortEntry& b) {
+		return a.key < b.key;
+	}
+
+	TEST(RenderQueueTest, KeyOrdersPassShaderMaterialGeometryDepth) {
+		using Sigma::RenderQueue;
+		EXPECT_LT(RenderQueue::MakeKey(0, 9, 9, 9, 100.0f), RenderQueue::MakeKey(1, 1, 1, 1, 1.0f));
+		EXPECT_LT(RenderQueue::MakeKey(0, 1, 9, 9, 100.0f), RenderQueue::MakeKey(0, 2, 1, 1, 1.0f));
+		EXPECT_LT(RenderQueue::MakeKey(0, 1, 1, 9, 100.0f), RenderQueue::MakeKey(0, 1, 2, 1, 1.0f));
+		EXPECT_LT(RenderQueue::MakeKey(0, 1, 1, 1, 100.0f), RenderQueue::MakeKey(0, 1, 1, 2, 1.0f));
+		EXPECT_LT(RenderQueue::MakeKey(0, 1, 1, 1, 1.5f), RenderQueue::MakeKey(0, 1, 1, 1, 2.0f));
+		EXPECT_EQ(RenderQueue::MakeKey(0, 1, 1, 1, -5.0f), RenderQueue::MakeKey(0, 1, 1, 1, 0.0f));
+		EXPECT_EQ(1u, RenderQueue::KeyPass(RenderQueue::MakeKey(1, 0xFFF, 0xFFFF, 0xFF, 1.0f)));
+	}
+
+	TEST(RenderQueueTest, RadixSortMatchesStableSort) {
+		std::vector<Sigma::SortEntry> entries;
+		unsigned int seed = 12345;
+		for (unsigned int i = 0; i < 1000; ++i) {
+			seed = seed * 1103515245u + 12345u;
+			Sigma::SortEntry entry = { Sigma::RenderQueue::MakeKey(seed % 2, (seed >> 8) % 5, (seed >> 4) % 3, (seed >> 12) % 4, static_cast<float>(seed % 97)), i };
+			entries.push_back(entry);
+		}
+		std::vector<Sigma::SortEntry> expected = entries;
+		std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+		std::vector<Sigma::SortEntry> scratch;
+		Sigma::RadixSort(entries, scratch);
+
+		ASSERT_EQ(expected.size(), entries.size());
+		for (size_t i = 0; i < entries.size(); ++i) {
+			EXPECT_EQ(expected[i].key, entries[i].key);
+			EXPECT_EQ(expected[i].index, entries[i].index);
+		}
+	}
+
+	TEST(RenderQueueTest, RadixSortInSlicesMatchesStableSort) {
+		// Runs the passes of DrawListBuilder::Sort one slice after the other.
+		const size_t slices = 3;
+		std::vector<Sigma::SortEntry> entries;
+		unsigned int seed = 54321;
+		for (unsigned int i = 0; i < 1000; ++i) {
+			seed = seed * 1103515245u + 12345u;
+			Sigma::SortEntry entry = { Sigma::RenderQueue::MakeKey(seed % 2, (seed >> 8) % 5, (seed >> 4) % 3, (seed >> 12) % 4, static_cast<float>(seed % 97)), i };
+			entries.push_back(entry);
+		}
+		std::vector<Sigma::SortEntry> expected = entries;
+		std::stable_sort(expected.begin(), expected.end(), KeyLess);
+
+		std::vector<Sigma::SortEntry> sorted(entries.size());
+		const size_t slice = (entries.size() + slices - 1) / slices;
+		std::vector<size_t> counts(slices * 256);
+		for (unsigned int shift = 0; shift < 64; shift += 8) {
+			for (size_t s = 0; s < slices; ++s) {
+				Sigma::RadixCount(&entries[0], s * slice, std::min(entries.size(), (s + 1) * slice), shift, &counts[s * 256]);
+			}
+			bool moved = false;
+			for (size_t s = 0; s < slices; ++s) {
+				size_t offsets[256];
+				if (Sigma::RadixOffsets(&counts[0], slices, s, offsets)) {
+					Sigma::RadixScatter(&entries[0], s * slice, std::min(entries.size(), (s + 1) * slice), shift, offsets, &sorted[0]);
+					moved = true;
+				}
+			}
+			if (moved) {
+				entries.swap(sorted);
+			}
+		}
+
+		ASSERT_EQ(expected.size(), entries.size());
+		for (size_t i = 0; i < entries.size(); ++i) {
+			EXPECT_EQ(expected[i].key, entries[i].key);
+			EXPECT_EQ(expected[i].index, entries[i].index);
+		}
+	}
+}  // namespace
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "RenderStats.h"
+
+#include <sstream>
+
+namespace {
+	TEST(RenderStatsTest, PrintsSumsAsAveragesPerFrame) {
+		Sigma::RenderStats frame;
+		frame.objects = 3;
+		frame.drawCalls = 5;
+		frame.passDrawCalls[Sigma::STATS_PASS_GBUFFER] = 4;
+		frame.passDrawCalls[Sigma::STATS_PASS_OVERLAY] = 1;
+		frame.uploadedBytes = 2048;
+
+		Sigma::RenderStats sum;
+		sum.Add(frame);
+		frame.objects = 4;
+		sum.Add(frame);
+		EXPECT_EQ(7u, sum.objects);
+		EXPECT_EQ(10u, sum.drawCalls);
+		EXPECT_EQ(8u, sum.passDrawCalls[Sigma::STATS_PASS_GBUFFER]);
+		EXPECT_EQ(4096u, sum.uploadedBytes);
+
+		std::ostringstream json;
+		sum.WriteJSON(json, 2);
+		const std::string text = json.str();
+		EXPECT_EQ(0u, text.find("{\"objects\":3.5,"));
+		EXPECT_NE(std::string::npos, text.find("\"drawCalls\":5,"));
+		EXPECT_NE(std::string::npos, text.find("\"passDrawCalls\":{\"impostors\":0,\"gbuffer\":4,\"lighting\":0,\"unlit\":0,\"overlay\":1}"));
+		EXPECT_NE(std::string::npos, text.find("\"uploadedBytes\":2048}"));
+
+		EXPECT_NE(std::string::npos, sum.Summary(2).find("5 draws (impostors 0, gbuffer 4"));
+		EXPECT_STREQ("lighting", Sigma::RenderStats::PassName(Sigma::STATS_PASS_LIGHTING));
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <cstdlib>
+
+// Helpers shared by the tests and the benchmarks in src/tests.
+namespace TestHelpers {
+	/**
+	 * \brief Returns a number between minimum and maximum from std::rand, seeded with std::srand.
+	 */
+	inline float RandomFloat(float minimum, float maximum) {
+		return minimum + (maximum - minimum) * (static_cast<float>(std::rand()) / RAND_MAX);
+	}
+
+	/**
+	 * \brief glm::perspective with a 90 degree vertical field of view, written out.
+	 *
+	 * \param aspect The width over the height.
+	 * \param nearPlane, farPlane The view distances of the clip planes.
+	 */
+	inline glm::mat4 Perspective90(float aspect, float nearPlane, float farPlane) {
+		glm::mat4 projection(0.0f);
+		projection[0][0] = 1.0f / aspect;
+		projection[1][1] = 1.0f;
+		projection[2][2] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+		projection[2][3] = -1.0f;
+		projection[3][2] = -2.0f * farPlane * nearPlane / (farPlane - nearPlane);
+		return projection;
+	}
+}